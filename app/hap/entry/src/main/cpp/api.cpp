@@ -58,8 +58,29 @@ void delete_device(const std::string_view& device_id) {
 }
 
 void init_udp_context() {
-    udp_context = std::make_unique<ahohc::udp::Context>("192.168.177.255",8888);
-    //udp_context = std::make_unique<ahohc::udp::Context>("255.255.255.255",8888);
+    // 发往组播组，另发一份到受限广播地址以兼容不转发组播的网络，不再依赖具体网段的广播地址
+    udp_context = std::make_unique<ahohc::udp::Context>(ahoh::discovery::MULTICAST_GROUP, ahoh::discovery::PORT);
+    udp_context->add_target("255.255.255.255");
+}
+
+// 与 v1 回复相同的 JSON 字段（端口为字符串），另附 v2 的能力字段
+static std::string offer_to_json(const ahoh::discovery::Offer& offer) {
+    std::stringstream ss;
+    ss << "{\"server_ip\":\"" << ahoh::discovery::format_ipv4(offer.http_ip)
+       << "\", \"server_port\":\"" << offer.http_port
+       << "\", \"mqtt_broker_ip\":\"" << ahoh::discovery::format_ipv4(offer.mqtt_ip)
+       << "\", \"mqtt_broker_port\":\"" << offer.mqtt_port
+       << "\", \"server_id\":\"";
+    for (char c : offer.server_id) {
+        if (c == '"' || c == '\\') {
+            ss << '\\';
+        }
+        ss << c;
+    }
+    ss << "\", \"http_tls\":" << ((offer.flags & ahoh::discovery::HTTP_TLS) ? "true" : "false")
+       << ", \"mqtt_tls\":" << ((offer.flags & ahoh::discovery::MQTT_TLS) ? "true" : "false")
+       << ", \"schemas\":" << static_cast<int>(offer.schemas) << "}";
+    return ss.str();
 }
 
 std::string discover_server() {
@@ -67,7 +88,11 @@ std::string discover_server() {
         AHOHC_LOG(LOG_ERROR, TAG, "no udp context");
         return "";
     }
-    udp_context->send("AHOH_DISCOVER_SERVER");
-    return udp_context->receive(std::chrono::milliseconds(5000));
+    if (auto offer = udp_context->discover(std::chrono::milliseconds(3000))) {
+        return offer_to_json(*offer);
+    }
+    // 只支持 v1 的旧服务端不回复 v2 请求
+    udp_context->send(ahoh::discovery::V1_REQUEST);
+    return udp_context->receive(std::chrono::milliseconds(2000));
 }
 }
\ No newline at end of file
@@ -59,9 +59,22 @@ void Context::set_message_callback(MessageCallback cb) {
     message_callback = std::move(cb);
 }
 
+void Context::add_route(const std::string_view& pattern, RouteHandler handler) {
+    router.add(pattern, std::move(handler));
+    router.compile();
+}
+
 void Context::Callback::message_arrived(::mqtt::const_message_ptr msg) {
-    if (context && context->message_callback) {
-        context->message_callback(msg->get_topic(),msg->to_string());
+    if (!context) {
+        return;
+    }
+    const std::string& topic = msg->get_topic();
+    const std::string payload = msg->to_string();
+    if (context->message_callback) {
+        context->message_callback(topic, payload);
     }
+    context->router.match(topic, [&](const RouteHandler& handler, const RouteCaptures& captures) {
+        handler(topic, payload, captures);
+    });
 }
 }
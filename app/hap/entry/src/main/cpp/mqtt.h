@@ -11,6 +11,7 @@
 #include <string>
 #include <string_view>
 #include <functional>
+#include "topic_router.h"
 
 namespace ahohc::mqtt {
 
@@ -39,6 +40,12 @@ public:
     using MessageCallback = std::function<void(const std::string_view&,const std::string_view&)>;
     void set_message_callback(MessageCallback cb);
 
+    // 按 MQTT 通配模式注册处理函数（如 "/device/+/attrib/+"），captures 依次为各通配符匹配到的层级
+    // 需在 connect() 之前完成注册；同一条消息会先交给 message_callback，再分发给所有命中的路由
+    using RouteCaptures = ::ahoh::mqtt::TopicCaptures<4>;
+    using RouteHandler = std::function<void(const std::string_view&, const std::string_view&, const RouteCaptures&)>;
+    void add_route(const std::string_view& pattern, RouteHandler handler);
+
 private:
     ::mqtt::async_client client;
     ::mqtt::connect_options conn_opts;
@@ -48,6 +55,9 @@ private:
     // 用户设置的消息回调
     MessageCallback message_callback;
 
+    // 按 topic 模式注册的处理函数
+    ::ahoh::mqtt::TopicRouter<RouteHandler, 4> router;
+
     // 内部回调类，用于接收 paho.mqtt.cpp 的事件
     class Callback : public virtual ::mqtt::callback {
     public:
@@ -10,9 +10,13 @@
 #include <asio.hpp>
 #include <array>
 #include <chrono>
+#include <optional>
+#include <random>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <vector>
+#include "discovery.h"
 #include "utils/log.h"
 
 namespace ahohc::udp {
@@ -26,10 +30,9 @@ public:
         : ip(ip),
           port(port),
           socket(io_context),
-          // 这里如果需要使用随机的本地端口，可以将 port 改为 0：
-          // local_endpoint(ip::udp::endpoint(ip::address_v4::any(), 0))
-          local_endpoint(ip::udp::endpoint(ip::address_v4::any(), port)),
-          target_endpoint(ip::udp::endpoint(ip::make_address(ip), port))
+          // 使用随机的本地端口：服务端回复到请求的来源端口，且不会收到自己发出的广播
+          local_endpoint(ip::udp::endpoint(ip::address_v4::any(), 0)),
+          target_endpoints{ip::udp::endpoint(ip::make_address(ip), port)}
     {
         socket.open(ip::udp::v4());
         socket.set_option(socket_base::reuse_address(true));
@@ -37,10 +40,17 @@ public:
         socket.set_option(socket_base::broadcast(true));
     }
 
+    // 追加一个发送目标（如同时发往组播组与广播地址），端口与构造时相同
+    void add_target(const std::string_view& target_ip) {
+        target_endpoints.emplace_back(ip::make_address(target_ip), port);
+    }
+
     // 发送函数：仅负责同步地发送UDP广播消息
     void send(const std::string_view& msg) {
         try {
-            socket.send_to(buffer(msg.data(), msg.size()), target_endpoint);
+            for (const auto& target : target_endpoints) {
+                socket.send_to(buffer(msg.data(), msg.size()), target);
+            }
         } catch (const std::exception& e) {
             AHOHC_LOG(LOG_ERROR, TAG,
                       "exception caught when sending udp to %{public}s:%{public}d, error: %{public}s",
@@ -50,10 +60,50 @@ public:
 
     // 接收函数：通过异步操作和定时器等待响应数据
     std::string receive(std::chrono::milliseconds timeout = std::chrono::milliseconds(3000)) {
+        ip::udp::endpoint sender_endpoint;
+        return receive_from(sender_endpoint, timeout);
+    }
+
+    /**
+     * 发现协议 v2：发出带随机 nonce 的请求，等待 nonce 相同的回复
+     *
+     * 其他报文（其他设备的回复、迟到的上一轮回复、v1 服务端的 JSON 回复）被忽略；
+     * 回复中为 0.0.0.0 的地址替换为回复的来源地址。超时返回空。
+     */
+    std::optional<ahoh::discovery::Offer> discover(std::chrono::milliseconds timeout = std::chrono::milliseconds(3000)) {
+        const uint32_t nonce = std::random_device{}();
+        send(ahoh::discovery::encode_request(nonce));
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (true) {
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0) {
+                return std::nullopt;
+            }
+            ip::udp::endpoint sender_endpoint;
+            auto offer = ahoh::discovery::decode_offer(receive_from(sender_endpoint, remaining));
+            if (!offer || offer->nonce != nonce) {
+                continue;
+            }
+            const auto sender = sender_endpoint.address();
+            if (sender.is_v4()) {
+                const auto bytes = sender.to_v4().to_bytes();
+                if (ahoh::discovery::is_unspecified(offer->http_ip)) {
+                    offer->http_ip = {bytes[0], bytes[1], bytes[2], bytes[3]};
+                }
+                if (ahoh::discovery::is_unspecified(offer->mqtt_ip)) {
+                    offer->mqtt_ip = {bytes[0], bytes[1], bytes[2], bytes[3]};
+                }
+            }
+            return offer;
+        }
+    }
+
+private:
+    std::string receive_from(ip::udp::endpoint& sender_endpoint, std::chrono::milliseconds timeout) {
         try {
             std::string response;
             std::array<char, 1024> recv_buf{};
-            ip::udp::endpoint sender_endpoint;
             bool receive_completed = false;  // 是否完成接收
             bool timeout_occurred = false;     // 是否超时
             std::error_code receive_error;
@@ -97,14 +147,14 @@ public:
             AHOHC_LOG(LOG_ERROR, TAG,
                 "exception caught when receiving udp from %{public}s:%{public}d, error: %{public}s",
                 ip.c_str(),port,e.what());
+            return "";
         }
     }
 
-private:
     io_context io_context;
     ip::udp::socket socket; 
     ip::udp::endpoint local_endpoint;
-    ip::udp::endpoint target_endpoint;
+    std::vector<ip::udp::endpoint> target_endpoints;
     std::string ip;
     short port;
 };
@@ -0,0 +1,130 @@
+// PostgresDB 包装层基准测试，需要一个可连接的 PostgreSQL：
+//
+//   AHOH_BENCH_PG="host=127.0.0.1 user=postgres password=mysecretpassword dbname=mqttdb" ./ahoh-bench --benchmark_filter=Postgres
+//
+// 未设置 AHOH_BENCH_PG 或连接失败时跳过。表在连接内以同名临时表创建（优先于 init.sql 中的表），
+// 语句与 main.cpp 注册的相同，不读写已有数据。
+// 包装层每次调用输出一条 info 日志，测量时调到 warn，避免终端输出主导耗时。
+
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "db.h"
+
+namespace {
+
+using namespace ahohs;
+
+const std::string SAMPLE_META =
+    R"({"type":["thermometer"],"desc":"bench","heartbeat_interval":30,"attrib_schema":"v1",)"
+    R"("attrib":[{"topic":"/temperature","type":"float","desc":"摄氏温度","rw":"r"}]})";
+
+/// 整个进程共用一条连接，首次调用时建表并注册语句；不可用时返回 nullptr
+db::PostgresDB* bench_db() {
+    static std::unique_ptr<db::PostgresDB> instance = []() -> std::unique_ptr<db::PostgresDB> {
+        const char* connstr = std::getenv("AHOH_BENCH_PG");
+        if (connstr == nullptr) {
+            return nullptr;
+        }
+        if (auto logger = spdlog::get("postgres_db")) {
+            logger->set_level(spdlog::level::warn);
+        }
+        try {
+            auto database = std::make_unique<db::PostgresDB>(connstr);
+            database->create(
+                "CREATE TEMP TABLE devices (device_id TEXT PRIMARY KEY, meta JSONB, "
+                "updated_at TIMESTAMPTZ DEFAULT CURRENT_TIMESTAMP);");
+            database->create(
+                "CREATE TEMP TABLE telemetry (id BIGSERIAL PRIMARY KEY, device_id TEXT NOT NULL, "
+                "attrib TEXT NOT NULL, value JSONB, ts TIMESTAMPTZ NOT NULL);");
+            database->register_prepared_statement(
+                "upsert_device_meta",
+                "INSERT INTO devices (device_id, meta) VALUES ($1, $2) "
+                "ON CONFLICT (device_id) DO UPDATE SET meta = EXCLUDED.meta, updated_at = CURRENT_TIMESTAMP;");
+            database->register_prepared_statement(
+                "get_all_devices",
+                "SELECT device_id, meta FROM devices;");
+            database->register_prepared_statement(
+                "insert_telemetry",
+                "INSERT INTO telemetry (device_id, attrib, value, ts) "
+                "VALUES ($1, $2, $3::jsonb, to_timestamp($4::double precision / 1000.0));");
+            return database;
+        } catch (const std::exception&) {
+            return nullptr;
+        }
+    }();
+    return instance.get();
+}
+
+/// 清空设备表后写入 n 台设备
+void fill_devices(db::PostgresDB& database, std::size_t n) {
+    database.remove("TRUNCATE devices;");
+    std::vector<std::vector<std::string>> rows;
+    rows.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        rows.push_back({"device-" + std::to_string(i), SAMPLE_META});
+    }
+    database.exec_prepared_batch("upsert_device_meta", rows);
+}
+
+// 单条 upsert：一次事务、一次往返，与 POST /device 和 MQTT 元数据写库相同
+void BM_PostgresExecPrepared(benchmark::State& state) {
+    auto* database = bench_db();
+    if (database == nullptr) {
+        state.SkipWithError("AHOH_BENCH_PG is not set or the database is unreachable");
+        return;
+    }
+    fill_devices(*database, 1000);
+    std::size_t i = 0;
+    uint64_t failed = 0;
+    for (auto _ : state) {
+        failed += !database->exec_prepared("upsert_device_meta", {"device-" + std::to_string(i++ % 1000), SAMPLE_META});
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["failed"] = static_cast<double>(failed);
+}
+BENCHMARK(BM_PostgresExecPrepared)->Unit(benchmark::kMicrosecond);
+
+// GET /devices 的查询部分，参数为设备数
+void BM_PostgresQueryPrepared(benchmark::State& state) {
+    auto* database = bench_db();
+    if (database == nullptr) {
+        state.SkipWithError("AHOH_BENCH_PG is not set or the database is unreachable");
+        return;
+    }
+    const auto n = static_cast<std::size_t>(state.range(0));
+    fill_devices(*database, n);
+    for (auto _ : state) {
+        auto result = database->query_prepared("get_all_devices", {});
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+BENCHMARK(BM_PostgresQueryPrepared)->Arg(10)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// 遥测批量写入：单个事务内执行参数给定条数的 insert_telemetry
+void BM_PostgresExecPreparedBatch(benchmark::State& state) {
+    auto* database = bench_db();
+    if (database == nullptr) {
+        state.SkipWithError("AHOH_BENCH_PG is not set or the database is unreachable");
+        return;
+    }
+    const auto n = static_cast<std::size_t>(state.range(0));
+    std::vector<std::vector<std::string>> rows;
+    for (std::size_t i = 0; i < n; ++i) {
+        rows.push_back({"device-" + std::to_string(i % 100), "/temperature", "23.4", "1700000000000"});
+    }
+    uint64_t failed = 0;
+    for (auto _ : state) {
+        failed += !database->exec_prepared_batch("insert_telemetry", rows);
+    }
+    database->remove("TRUNCATE telemetry;");
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+    state.counters["failed"] = static_cast<double>(failed);
+}
+BENCHMARK(BM_PostgresExecPreparedBatch)->Arg(1)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+}  // namespace
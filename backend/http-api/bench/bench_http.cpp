@@ -0,0 +1,66 @@
+// HTTP 设备接口基准测试：响应构建与请求解析（不含 Crow 与数据库）
+//
+// 运行：./ahoh-bench --benchmark_filter='DevicesJson|DeviceUpsert'
+// BM_DevicesJson：GET /devices 从查询结果构建响应体，参数为设备数；bytes_per_second 为输出速率。
+// BM_ParseDeviceUpsert：POST /device 请求体解析，参数 0 为 meta 是 JSON 对象，1 为 meta 是 JSON 字符串（固件的形式）。
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include "device_api.h"
+
+namespace {
+
+using namespace ahohs;
+
+// mqtt_fake_code.md 中温湿度传感器的元数据，数据库中以 JSONB 文本保存
+const std::string SAMPLE_META =
+    R"({"type":["thermometer","hygrometer"],"desc":"门口的温湿度传感器","heartbeat_interval":30,)"
+    R"("attrib_schema":"v1","attrib":[)"
+    R"({"topic":"/temperature","type":"float","desc":"摄氏温度传感器读数","rw":"r"},)"
+    R"({"topic":"/humidity","type":"float","desc":"湿度传感器读数","rw":"r"},)"
+    R"({"topic":"/alert","type":"bool","desc":"传感器报警状态","rw":"rw"}]})";
+
+void BM_DevicesJson(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    std::vector<std::string> ids;
+    ids.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        ids.push_back("device-" + std::to_string(i));
+    }
+    std::vector<http_server::DeviceRow> rows;
+    rows.reserve(n);
+    for (const auto& id : ids) {
+        rows.push_back({id, SAMPLE_META});
+    }
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        std::string body = http_server::devices_json(rows);
+        bytes += body.size();
+        benchmark::DoNotOptimize(body);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_DevicesJson)->Arg(10)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+void BM_ParseDeviceUpsert(benchmark::State& state) {
+    const bool meta_as_string = state.range(0) != 0;
+    nlohmann::json body;
+    body["device_id"] = "21fvs93432j";
+    if (meta_as_string) {
+        body["meta"] = SAMPLE_META;
+    } else {
+        body["meta"] = nlohmann::json::parse(SAMPLE_META);
+    }
+    const std::string text = body.dump();
+    for (auto _ : state) {
+        auto upsert = http_server::parse_device_upsert(text);
+        benchmark::DoNotOptimize(upsert);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+BENCHMARK(BM_ParseDeviceUpsert)->Arg(0)->Arg(1);
+
+}  // namespace
@@ -0,0 +1,141 @@
+// MQTT 摄取流水线基准测试
+//
+// 运行：cmake -DAHOH_BUILD_BENCH=ON .. && make ahoh-bench && ./ahoh-bench --benchmark_filter=Ingest
+// items_per_second 即单核摄取吞吐（目标 >= 100k msgs/s）。
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "ingest.h"
+
+namespace {
+
+using namespace ahohs;
+
+/// 丢弃所有采样的遥测输出，仅用于测量摄取本身的开销
+class NullSink : public telemetry::TelemetrySink {
+ public:
+    void append(telemetry::Sample sample) override {
+        benchmark::DoNotOptimize(sample);
+    }
+    void append_event(telemetry::DeviceEvent event) override {
+        benchmark::DoNotOptimize(event);
+    }
+};
+
+std::vector<std::string> make_topics(int n_devices) {
+    static const char* attribs[] = {"/temperature", "/humidity", "/alert", "/power_on"};
+    std::vector<std::string> topics;
+    for (int i = 0; i < n_devices; ++i) {
+        for (const char* attrib : attribs) {
+            topics.push_back("/device/device_" + std::to_string(i) + "/attrib" + attrib);
+        }
+    }
+    return topics;
+}
+
+void BM_ClassifyTopic(benchmark::State& state) {
+    auto topics = make_topics(256);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ingest::classify_topic(topics[i++ % topics.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ClassifyTopic);
+
+void BM_ParseAttribPayload(benchmark::State& state) {
+    const std::vector<std::string> payloads = {
+        R"({"value":23.40})", R"({"value":true})", R"({"value":null})", R"({"value":61.25})"};
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ingest::parse_attrib_payload(payloads[i++ % payloads.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParseAttribPayload);
+
+void BM_IngestAttrib(benchmark::State& state) {
+    state::DeviceStateStore store;
+    NullSink sink;
+    liveness::LivenessTracker liveness(store, sink);
+    ingest::Ingestor ingestor(store, sink, liveness);
+    auto topics = make_topics(static_cast<int>(state.range(0)));
+    const std::string payload = R"({"value":23.40})";
+    auto now = ingest::Clock::now();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        ingestor.ingest(topics[i++ % topics.size()], payload, now);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IngestAttrib)->Arg(10)->Arg(1000)->Arg(100000);
+
+// 端到端：回调线程 submit -> 分片无锁队列 -> 工作线程 ingest；
+// 使用 Block 策略，测得的是不丢消息时的持续吞吐。参数为工作线程数。
+void BM_IngestPipeline(benchmark::State& state) {
+    state::DeviceStateStore store;
+    NullSink sink;
+    liveness::LivenessTracker liveness(store, sink);
+    ingest::Ingestor ingestor(store, sink, liveness);
+    ingest::IngestPipeline pipeline(ingestor, static_cast<std::size_t>(state.range(0)), 4096,
+                                    ingest::OverflowPolicy::Block);
+    auto topics = make_topics(1000);
+    const std::string payload = R"({"value":23.40})";
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const std::string& topic = topics[i++ % topics.size()];
+        pipeline.submit({topic, payload, ingest::Clock::now()});
+    }
+    pipeline.stop();  // 计入排空队列的时间
+    state.SetItemsProcessed(state.iterations());
+    std::size_t high_watermark = 0;
+    for (const auto& m : pipeline.metrics()) {
+        high_watermark = std::max(high_watermark, m.high_watermark);
+    }
+    state.counters["queue_hwm"] = static_cast<double>(high_watermark);
+}
+BENCHMARK(BM_IngestPipeline)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+// 同上，但分片运行在共享事件循环上（排空任务代替专属工作线程）。参数为事件循环线程数，分片数取 4
+void BM_IngestPipelineRuntime(benchmark::State& state) {
+    runtime::Runtime runtime(static_cast<std::size_t>(state.range(0)));
+    state::DeviceStateStore store;
+    NullSink sink;
+    liveness::LivenessTracker liveness(store, sink, runtime);
+    ingest::Ingestor ingestor(store, sink, liveness);
+    ingest::IngestPipeline pipeline(ingestor, runtime, 4, 4096, ingest::OverflowPolicy::Block);
+    auto topics = make_topics(1000);
+    const std::string payload = R"({"value":23.40})";
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const std::string& topic = topics[i++ % topics.size()];
+        pipeline.submit({topic, payload, ingest::Clock::now()});
+    }
+    pipeline.stop();
+    liveness.stop();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IngestPipelineRuntime)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+// 回调线程一侧的开销：DropNewest 策略下 submit 的耗时（队列满时直接丢弃）
+void BM_IngestPipelineSubmitDropNewest(benchmark::State& state) {
+    state::DeviceStateStore store;
+    NullSink sink;
+    liveness::LivenessTracker liveness(store, sink);
+    ingest::Ingestor ingestor(store, sink, liveness);
+    ingest::IngestPipeline pipeline(ingestor, 1, 4096, ingest::OverflowPolicy::DropNewest);
+    auto topics = make_topics(1000);
+    const std::string payload = R"({"value":23.40})";
+    std::size_t i = 0;
+    for (auto _ : state) {
+        pipeline.submit({topics[i++ % topics.size()], payload, ingest::Clock::now()});
+    }
+    pipeline.stop();
+    state.SetItemsProcessed(state.iterations());
+    state.counters["dropped"] = static_cast<double>(pipeline.dropped());
+}
+BENCHMARK(BM_IngestPipelineSubmitDropNewest)->UseRealTime();
+
+}  // namespace
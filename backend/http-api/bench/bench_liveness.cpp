@@ -0,0 +1,72 @@
+// 心跳存活跟踪基准测试
+//
+// BM_LivenessHeartbeat：10 万设备轮流心跳时单次重新 arm 的开销；
+// BM_TimingWheelAdvance：10 万个定时器在轮上时，每个 tick 推进的开销（没有设备到期）。
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include "liveness.h"
+
+namespace {
+
+using namespace ahohs;
+
+class NullSink : public telemetry::TelemetrySink {
+ public:
+    void append(telemetry::Sample sample) override { benchmark::DoNotOptimize(sample); }
+    void append_event(telemetry::DeviceEvent event) override { benchmark::DoNotOptimize(event); }
+};
+
+std::vector<std::string> make_devices(int n) {
+    std::vector<std::string> ids;
+    ids.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        ids.push_back("device_" + std::to_string(i));
+    }
+    return ids;
+}
+
+void BM_LivenessHeartbeat(benchmark::State& state) {
+    state::DeviceStateStore store;
+    NullSink sink;
+    liveness::LivenessTracker tracker(store, sink);
+    auto ids = make_devices(static_cast<int>(state.range(0)));
+    auto now = state::Clock::now();
+    for (const auto& id : ids) {
+        tracker.on_heartbeat(id, now);
+    }
+    std::size_t i = 0;
+    for (auto _ : state) {
+        tracker.on_heartbeat(ids[i++ % ids.size()], now);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LivenessHeartbeat)->Arg(1000)->Arg(100000);
+
+void BM_TimingWheelAdvance(benchmark::State& state) {
+    using namespace std::chrono_literals;
+    auto start = util::TimingWheel::Clock::now();
+    util::TimingWheel wheel(500ms, start);
+    for (int i = 0; i < 100000; ++i) {
+        // 心跳间隔 30s × 2，在 60s 内均匀分布
+        wheel.arm(wheel.create(i), start + 60s + std::chrono::milliseconds(i % 60000));
+    }
+    auto now = start;
+    for (auto _ : state) {
+        now += 500ms;
+        wheel.advance(now, [](util::TimingWheel::TimerId, uint64_t) {});
+        if (now - start > 50s) {
+            state.PauseTiming();
+            now = start;
+            wheel = util::TimingWheel(500ms, start);
+            for (int i = 0; i < 100000; ++i) {
+                wheel.arm(wheel.create(i), start + 60s + std::chrono::milliseconds(i % 60000));
+            }
+            state.ResumeTiming();
+        }
+    }
+}
+BENCHMARK(BM_TimingWheelAdvance);
+
+}  // namespace
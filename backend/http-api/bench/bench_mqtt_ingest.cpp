@@ -0,0 +1,113 @@
+// MQTT 多客户端摄取负载测试（需要本地 broker）
+//
+// 运行：mosquitto -p 1883 &
+//       ./ahoh-bench --benchmark_filter=MqttIngest
+// broker 地址可用环境变量 AHOH_BENCH_MQTT_BROKER 覆盖（默认 tcp://localhost:1883），
+// 连接失败时跳过。参数为摄取客户端数量，items_per_second 为端到端摄取吞吐，
+// 应随客户端数量近似线性增长直到核心数。
+
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <mqtt/async_client.h>
+#include "mqtt.h"
+
+namespace {
+
+using namespace ahohs;
+using namespace std::chrono_literals;
+
+constexpr int N_PUBLISHERS = 4;
+constexpr int N_DEVICES = 1000;
+constexpr uint64_t MESSAGES_PER_ITERATION = 200000;
+
+class NullSink : public telemetry::TelemetrySink {
+ public:
+    void append(telemetry::Sample sample) override { benchmark::DoNotOptimize(sample); }
+    void append_event(telemetry::DeviceEvent event) override { benchmark::DoNotOptimize(event); }
+};
+
+std::string broker_address() {
+    const char* env = std::getenv("AHOH_BENCH_MQTT_BROKER");
+    return env ? env : "tcp://localhost:1883";
+}
+
+void publish_range(mqtt::async_client& client, uint64_t begin, uint64_t end) {
+    const std::string payload = R"({"value":23.40})";
+    for (uint64_t i = begin; i < end; ++i) {
+        std::string topic = "/device/device_" + std::to_string(i % N_DEVICES) + "/attrib/temperature";
+        while (true) {
+            try {
+                client.publish(topic, payload.data(), payload.size(), 0, false);
+                break;
+            } catch (const mqtt::exception&) {
+                std::this_thread::yield();  // 客户端发送缓冲已满
+            }
+        }
+    }
+}
+
+void BM_MqttIngestClients(benchmark::State& state) {
+    const auto n_clients = static_cast<std::size_t>(state.range(0));
+    const std::string address = broker_address();
+
+    std::vector<std::unique_ptr<mqtt::async_client>> publishers;
+    try {
+        for (int i = 0; i < N_PUBLISHERS; ++i) {
+            auto client = std::make_unique<mqtt::async_client>(address, "ahoh-bench-pub-" + std::to_string(i));
+            client->connect()->wait();
+            publishers.push_back(std::move(client));
+        }
+    } catch (const mqtt::exception& exc) {
+        state.SkipWithError(("MQTT broker unavailable: " + std::string(exc.what())).c_str());
+        return;
+    }
+
+    state::DeviceStateStore store;
+    NullSink sink;
+    liveness::LivenessTracker liveness(store, sink);
+    ingest::Ingestor ingestor(store, sink, liveness);
+    ingest::IngestPipeline pipeline(ingestor, n_clients, INGEST_QUEUE_CAPACITY, ingest::OverflowPolicy::Block);
+    mqtt_server::MqttServer server(address, "ahoh-bench-ingest", {"/device/#"}, pipeline, n_clients);
+    server.connect();
+    std::this_thread::sleep_for(1s);  // 等待所有客户端完成订阅
+
+    const auto& stats = ingestor.stats();
+    for (auto _ : state) {
+        const uint64_t target = stats.attrib.load() + MESSAGES_PER_ITERATION;
+        auto begin = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        const uint64_t per_publisher = MESSAGES_PER_ITERATION / N_PUBLISHERS;
+        for (int i = 0; i < N_PUBLISHERS; ++i) {
+            threads.emplace_back(publish_range, std::ref(*publishers[i]), i * per_publisher, (i + 1) * per_publisher);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        auto deadline = begin + 30s;
+        while (stats.attrib.load() < target && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(1ms);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - begin;
+        state.SetIterationTime(std::chrono::duration<double>(elapsed).count());
+        if (stats.attrib.load() < target) {
+            state.counters["lost"] = static_cast<double>(target - stats.attrib.load());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * MESSAGES_PER_ITERATION);
+
+    server.disconnect();
+    pipeline.stop();
+    for (auto& client : publishers) {
+        client->disconnect()->wait();
+    }
+}
+BENCHMARK(BM_MqttIngestClients)
+    ->Arg(1)->Arg(2)->Arg(4)->Arg(8)
+    ->Iterations(3)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+}  // namespace
@@ -0,0 +1,158 @@
+// broker 重启测试：持续发布遥测的同时杀掉本地 mosquitto 再拉起，测量重连耗时与消息丢失
+//
+// 运行：./ahoh-bench --benchmark_filter=MqttBrokerRestart
+// 测试自行启动 mosquitto（可用环境变量 AHOH_BENCH_MOSQUITTO 指定可执行文件，默认从 PATH 查找），
+// 监听 18830 端口并开启持久化；找不到 mosquitto 时跳过。
+// 计数器：reconnect_ms 为摄取客户端从断线到重新连上的耗时，lost 为未被摄取的消息数。
+
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <mqtt/async_client.h>
+#include "mqtt.h"
+
+extern char** environ;
+
+namespace {
+
+using namespace ahohs;
+using namespace std::chrono_literals;
+
+constexpr int BROKER_PORT = 18830;
+constexpr uint64_t N_MESSAGES = 30000;
+constexpr auto PUBLISH_INTERVAL = 100us;
+constexpr auto BROKER_DOWNTIME = 2s;
+
+class NullSink : public telemetry::TelemetrySink {
+ public:
+    void append(telemetry::Sample sample) override { benchmark::DoNotOptimize(sample); }
+    void append_event(telemetry::DeviceEvent event) override { benchmark::DoNotOptimize(event); }
+};
+
+class Broker {
+ public:
+    Broker() {
+        dir = std::filesystem::temp_directory_path() / "ahoh-bench-mosquitto";
+        std::filesystem::create_directories(dir);
+        conf = (dir / "mosquitto.conf").string();
+        std::ofstream out(conf);
+        out << "listener " << BROKER_PORT << " 127.0.0.1\n"
+            << "allow_anonymous true\n"
+            << "persistence true\n"
+            << "persistence_location " << dir.string() << "/\n"
+            << "autosave_interval 1\n"
+            << "max_queued_messages 0\n";
+    }
+    ~Broker() { kill(); }
+
+    bool start() {
+        const char* env = std::getenv("AHOH_BENCH_MOSQUITTO");
+        std::string exe = env ? env : "mosquitto";
+        char* argv[] = {exe.data(), const_cast<char*>("-c"), conf.data(), nullptr};
+        if (posix_spawnp(&pid, exe.c_str(), nullptr, nullptr, argv, environ) != 0) {
+            pid = -1;
+            return false;
+        }
+        std::this_thread::sleep_for(300ms);
+        return true;
+    }
+
+    void kill() {
+        if (pid > 0) {
+            ::kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+            pid = -1;
+        }
+    }
+
+ private:
+    std::filesystem::path dir;
+    std::string conf;
+    pid_t pid = -1;
+};
+
+void BM_MqttBrokerRestart(benchmark::State& state) {
+    Broker broker;
+    if (!broker.start()) {
+        state.SkipWithError("mosquitto not found (set AHOH_BENCH_MOSQUITTO)");
+        return;
+    }
+    const std::string address = "tcp://127.0.0.1:" + std::to_string(BROKER_PORT);
+
+    state::DeviceStateStore store;
+    NullSink sink;
+    liveness::LivenessTracker liveness(store, sink);
+    ingest::Ingestor ingestor(store, sink, liveness);
+    ingest::IngestPipeline pipeline(ingestor, 1, INGEST_QUEUE_CAPACITY, ingest::OverflowPolicy::Block);
+    mqtt_server::MqttServer server(address, "ahoh-bench-restart", {"/device/#"}, pipeline, 1);
+    server.connect();
+
+    // 发布端同样使用持久会话，并在断线期间缓冲 QoS 1 消息
+    auto create_opts = mqtt::create_options_builder()
+                           .send_while_disconnected(true)
+                           .max_buffered_messages(static_cast<int>(N_MESSAGES))
+                           .finalize();
+    mqtt::async_client publisher(address, "ahoh-bench-restart-pub", create_opts);
+    auto conn_opts = mqtt::connect_options_builder()
+                         .clean_session(false)
+                         .automatic_reconnect(std::chrono::milliseconds(100), std::chrono::seconds(1))
+                         .finalize();
+    try {
+        publisher.connect(conn_opts)->wait();
+    } catch (const mqtt::exception& exc) {
+        state.SkipWithError(("MQTT broker unavailable: " + std::string(exc.what())).c_str());
+        return;
+    }
+    std::this_thread::sleep_for(1s);  // 等待摄取端订阅完成
+
+    const auto& stats = ingestor.stats();
+    for (auto _ : state) {
+        const uint64_t base = stats.attrib.load();
+        auto begin = std::chrono::steady_clock::now();
+        std::thread killer([&broker]() {
+            std::this_thread::sleep_for(1s);
+            broker.kill();
+            std::this_thread::sleep_for(BROKER_DOWNTIME);
+            broker.start();
+        });
+        const std::string payload = R"({"value":1})";
+        for (uint64_t i = 0; i < N_MESSAGES; ++i) {
+            std::string topic = "/device/device_" + std::to_string(i % 100) + "/attrib/counter";
+            try {
+                publisher.publish(topic, payload.data(), payload.size(), 1, false);
+            } catch (const mqtt::exception&) {
+                // 发布端缓冲已满，计入丢失
+            }
+            std::this_thread::sleep_for(PUBLISH_INTERVAL);
+        }
+        killer.join();
+        auto deadline = std::chrono::steady_clock::now() + 30s;
+        while (stats.attrib.load() - base < N_MESSAGES && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(10ms);
+        }
+        state.SetIterationTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+
+        const uint64_t received = stats.attrib.load() - base;
+        auto mqtt_stats = server.stats();
+        state.counters["received"] = static_cast<double>(received);
+        state.counters["lost"] = received < N_MESSAGES ? static_cast<double>(N_MESSAGES - received) : 0.0;
+        state.counters["duplicates"] = received > N_MESSAGES ? static_cast<double>(received - N_MESSAGES) : 0.0;
+        state.counters["reconnect_ms"] = static_cast<double>(mqtt_stats.last_reconnect_time.count());
+        state.counters["connection_losses"] = static_cast<double>(mqtt_stats.connection_losses);
+    }
+
+    publisher.disconnect()->wait();
+    server.disconnect();
+    pipeline.stop();
+}
+BENCHMARK(BM_MqttBrokerRestart)->Iterations(1)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+}  // namespace
@@ -0,0 +1,231 @@
+// 端到端摄取回放测试（使用进程内 fake broker，不需要 mosquitto）
+//
+// 运行：./ahoh-bench --benchmark_filter=MqttReplay
+// 参数为目标发布速率（条/秒）。每次迭代按该速率匀速发布 REPLAY_DURATION 的流量，
+// 经 fake broker -> MqttServer（单客户端，MQTT 3.1.1）-> IngestPipeline -> Ingestor，
+// 全部消息被摄取流水线处理完后停止计时。
+//
+// 流量来源默认为合成的属性上报（N_DEVICES 个设备轮流）。设置环境变量
+// AHOH_BENCH_MQTT_REPLAY=<文件> 时循环回放录制的流量，文件每行为 "topic payload"，
+// 即 mosquitto_sub -v -t '/device/#' 的输出格式。
+//
+// 延迟为发布前一刻到采样写入遥测输出的时间：合成流量的属性值即发送时刻，
+// 录制流量中每 PROBE_EVERY 条插入一条同样格式的探测消息。
+// 计数器：p50_us / p90_us / p99_us / max_us 为延迟分位数；publish_rate 为实际达到的发布速率
+// （发布端跟不上目标速率时低于参数）；lost 为超时仍未到达摄取流水线的消息数。
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <mqtt/async_client.h>
+#include "fake_broker.h"
+#include "mqtt.h"
+
+namespace {
+
+using namespace ahohs;
+using namespace std::chrono_literals;
+using SteadyClock = std::chrono::steady_clock;
+
+constexpr int N_DEVICES = 1000;
+constexpr auto REPLAY_DURATION = 1s;
+constexpr auto PACING_TICK = 1ms;
+constexpr auto DRAIN_TIMEOUT = 30s;
+constexpr uint64_t PROBE_EVERY = 16;
+constexpr std::string_view PROBE_ATTRIB = "/sent_ns";
+
+/// 发送时刻编码为相对进程内固定起点的纳秒数，作为属性值写入负载（double 可精确表示 2^53 以内的整数）
+const SteadyClock::time_point epoch = SteadyClock::now();
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(SteadyClock::now() - epoch).count();
+}
+
+std::string probe_payload() {
+    return R"({"value":)" + std::to_string(now_ns()) + "}";
+}
+
+/// 收集探测属性的端到端延迟，可由多个摄取工作线程并发调用
+class LatencySink : public telemetry::TelemetrySink {
+ public:
+    explicit LatencySink(std::size_t capacity) : latencies(capacity) {}
+
+    void append(telemetry::Sample sample) override {
+        const double* sent = std::get_if<double>(&sample.value);
+        if (!sent || sample.attrib != PROBE_ATTRIB) {
+            return;
+        }
+        const std::size_t i = n.fetch_add(1, std::memory_order_relaxed);
+        if (i < latencies.size()) {
+            latencies[i] = static_cast<double>(now_ns()) - *sent;
+        }
+    }
+    void append_event(telemetry::DeviceEvent event) override { benchmark::DoNotOptimize(event); }
+
+    /// 已收集的延迟（纳秒）；只在摄取暂停时调用
+    std::vector<double> collected() const {
+        return {latencies.begin(), latencies.begin() + std::min(n.load(), latencies.size())};
+    }
+
+ private:
+    std::vector<double> latencies;
+    std::atomic<std::size_t> n{0};
+};
+
+/// 循环产生待发布的消息：录制的流量原样回放并穿插探测消息，否则全部为合成探测消息
+class TrafficSource {
+ public:
+    TrafficSource() {
+        const char* path = std::getenv("AHOH_BENCH_MQTT_REPLAY");
+        if (!path) {
+            return;
+        }
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            const auto space = line.find(' ');
+            if (space == std::string::npos || space == 0) {
+                continue;
+            }
+            recorded.emplace_back(line.substr(0, space), line.substr(space + 1));
+        }
+    }
+
+    bool replaying() const { return !recorded.empty(); }
+
+    std::pair<std::string, std::string> next() {
+        const uint64_t i = counter++;
+        if (!recorded.empty() && i % PROBE_EVERY != 0) {
+            return recorded[i % recorded.size()];
+        }
+        return {"/device/device_" + std::to_string(i % N_DEVICES) + "/attrib" + std::string(PROBE_ATTRIB),
+                probe_payload()};
+    }
+
+ private:
+    std::vector<std::pair<std::string, std::string>> recorded;
+    uint64_t counter = 0;
+};
+
+uint64_t handled(const ingest::IngestPipeline& pipeline) {
+    uint64_t total = pipeline.dropped();
+    for (const auto& m : pipeline.metrics()) {
+        total += m.processed;
+    }
+    return total;
+}
+
+double percentile(std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    const auto i = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1));
+    return sorted[i] / 1e3;
+}
+
+void publish(mqtt::async_client& client, const std::string& topic, const std::string& payload) {
+    while (true) {
+        try {
+            client.publish(topic, payload.data(), payload.size(), 0, false);
+            return;
+        } catch (const mqtt::exception&) {
+            std::this_thread::yield();  // 客户端发送缓冲已满
+        }
+    }
+}
+
+void BM_MqttReplay(benchmark::State& state) {
+    const auto rate = static_cast<uint64_t>(state.range(0));
+    const uint64_t per_iteration = rate * std::chrono::duration_cast<std::chrono::milliseconds>(REPLAY_DURATION).count() / 1000;
+
+    bench::FakeBroker broker;
+    if (!broker.start()) {
+        state.SkipWithError("failed to start fake broker");
+        return;
+    }
+    mqtt::async_client publisher(broker.address(), "ahoh-bench-replay-pub");
+    try {
+        publisher.connect()->wait();
+    } catch (const mqtt::exception& exc) {
+        state.SkipWithError(("connect to fake broker failed: " + std::string(exc.what())).c_str());
+        return;
+    }
+
+    state::DeviceStateStore store;
+    LatencySink sink(per_iteration * 4);
+    liveness::LivenessTracker liveness(store, sink);
+    ingest::Ingestor ingestor(store, sink, liveness);
+    ingest::IngestPipeline pipeline(ingestor, INGEST_WORKERS, INGEST_QUEUE_CAPACITY, ingest::OverflowPolicy::Block);
+    mqtt_server::MqttServer server(broker.address(), "ahoh-bench-replay", {"/device/#"}, pipeline, 1);
+    server.connect();
+
+    // 订阅完成前发布的消息会被 broker 丢弃，反复注入探测消息直到摄取端收到
+    const auto ready_deadline = SteadyClock::now() + 5s;
+    while (handled(pipeline) == 0 && SteadyClock::now() < ready_deadline) {
+        broker.inject("/device/ahoh-bench-probe/attrib/warmup", R"({"value":0})");
+        std::this_thread::sleep_for(50ms);
+    }
+    if (handled(pipeline) == 0) {
+        state.SkipWithError("ingest client did not subscribe to fake broker");
+        server.disconnect();
+        pipeline.stop();
+        return;
+    }
+
+    TrafficSource source;
+    uint64_t lost = 0;
+    double publish_seconds = 0;
+    for (auto _ : state) {
+        const uint64_t target = handled(pipeline) + per_iteration;
+        const auto begin = SteadyClock::now();
+        auto tick = begin;
+        uint64_t sent = 0;
+        while (sent < per_iteration) {
+            // 匀速发布：每个节拍补齐到按目标速率应发出的条数
+            const auto elapsed = std::chrono::duration<double>(SteadyClock::now() - begin).count();
+            const auto due = std::min(per_iteration, static_cast<uint64_t>(elapsed * static_cast<double>(rate)) + 1);
+            for (; sent < due; ++sent) {
+                auto [topic, payload] = source.next();
+                publish(publisher, topic, payload);
+            }
+            tick += PACING_TICK;
+            std::this_thread::sleep_until(tick);
+        }
+        publish_seconds += std::chrono::duration<double>(SteadyClock::now() - begin).count();
+
+        const auto deadline = SteadyClock::now() + DRAIN_TIMEOUT;
+        while (handled(pipeline) < target && SteadyClock::now() < deadline) {
+            std::this_thread::sleep_for(100us);
+        }
+        state.SetIterationTime(std::chrono::duration<double>(SteadyClock::now() - begin).count());
+        lost += target - std::min(target, handled(pipeline));
+    }
+
+    server.disconnect();
+    pipeline.stop();
+    publisher.disconnect()->wait();
+    broker.stop();
+
+    auto latencies = sink.collected();
+    std::sort(latencies.begin(), latencies.end());
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * per_iteration));
+    state.counters["publish_rate"] = static_cast<double>(state.iterations() * per_iteration) / publish_seconds;
+    state.counters["p50_us"] = percentile(latencies, 0.50);
+    state.counters["p90_us"] = percentile(latencies, 0.90);
+    state.counters["p99_us"] = percentile(latencies, 0.99);
+    state.counters["max_us"] = percentile(latencies, 1.0);
+    state.counters["lost"] = static_cast<double>(lost);
+    state.SetLabel(source.replaying() ? "recorded" : "synthetic");
+}
+BENCHMARK(BM_MqttReplay)
+    ->Arg(10000)->Arg(50000)->Arg(100000)->Arg(200000)
+    ->Iterations(3)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+}  // namespace
@@ -0,0 +1,97 @@
+// 属性负载解析基准测试：快速路径与 nlohmann 完整解析对比
+//
+// 运行：./ahoh-bench --benchmark_filter=Payload
+// 参数 0 ~ 3 依次为固件常见的负载形式：小数、整数、布尔、null。
+// BM_PayloadFast 应在几十纳秒以内；BM_PayloadJson 为同样输入下 nlohmann 的开销；
+// BM_PayloadFallback 为快速路径不识别（字符串值）时先尝试快速路径再回退的总开销。
+// BM_PayloadV2 / BM_PayloadV2Batch：attrib_schema v2 二进制负载的解码开销，
+// 与 BM_PayloadJsonBatch（同样三个属性的 v1 JSON 批量负载）对比；bytes 计数为负载长度。
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "attrib_codec.h"
+#include "ingest.h"
+
+namespace {
+
+using namespace ahohs;
+
+const std::vector<std::string>& payloads() {
+    static const std::vector<std::string> p = {
+        R"({"value":23.40})", R"({"value":1024})", R"({"value":true})", R"({"value":null})"};
+    return p;
+}
+
+void BM_PayloadFast(benchmark::State& state) {
+    const std::string& payload = payloads()[static_cast<std::size_t>(state.range(0))];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ingest::parse_attrib_payload_fast(payload));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(payload);
+}
+BENCHMARK(BM_PayloadFast)->DenseRange(0, 3);
+
+void BM_PayloadJson(benchmark::State& state) {
+    const std::string& payload = payloads()[static_cast<std::size_t>(state.range(0))];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ingest::parse_attrib_payload_json(payload));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(payload);
+}
+BENCHMARK(BM_PayloadJson)->DenseRange(0, 3);
+
+void BM_PayloadFallback(benchmark::State& state) {
+    const std::string payload = R"({"value":"heating"})";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ingest::parse_attrib_payload(payload));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PayloadFallback);
+
+void BM_PayloadV2(benchmark::State& state) {
+    std::string payload;
+    codec::encode_value_v2(23.4f, payload);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(codec::decode_attrib_v2(payload));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["bytes"] = static_cast<double>(payload.size());
+}
+BENCHMARK(BM_PayloadV2);
+
+void BM_PayloadV2Batch(benchmark::State& state) {
+    codec::DeviceSchema schema;
+    schema.version = codec::SchemaVersion::V2;
+    schema.attribs = {"/temperature", "/humidity", "/alert"};
+    const std::string payload = codec::encode_batch_v2({{0, 23.4f}, {1, 23.0}, {2, false}});
+    for (auto _ : state) {
+        codec::decode_batch_v2(payload, schema, [](std::string_view attrib, telemetry::AttribValue value) {
+            benchmark::DoNotOptimize(attrib);
+            benchmark::DoNotOptimize(value);
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * 3);
+    state.counters["bytes"] = static_cast<double>(payload.size());
+}
+BENCHMARK(BM_PayloadV2Batch);
+
+void BM_PayloadJsonBatch(benchmark::State& state) {
+    const std::string payload = R"({"temperature":23.4,"humidity":23,"alert":false})";
+    for (auto _ : state) {
+        auto body = nlohmann::json::parse(payload, nullptr, false);
+        for (const auto& [key, value] : body.items()) {
+            benchmark::DoNotOptimize(key);
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 3);
+    state.counters["bytes"] = static_cast<double>(payload.size());
+}
+BENCHMARK(BM_PayloadJsonBatch);
+
+}  // namespace
@@ -0,0 +1,99 @@
+// 设备登记表基准测试（持久层为内存中的计数实现，不连接数据库）
+//
+// BM_RegistryGet：参数为设备数，按 device_id 读取元数据（GET /device/<id>）；
+// BM_RegistryContains：同上，只查存在性，不复制元数据；
+// BM_RegistryPutCoalesced：100 台设备反复更新元数据，刷新间隔内合并，db_writes_per_put 为合并后实际写库的比例。
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include "device_registry.h"
+
+namespace {
+
+using namespace ahohs;
+
+const std::string SAMPLE_META =
+    R"({"type":["thermometer"],"desc":"bench","heartbeat_interval":30,"attrib_schema":"v1",)"
+    R"("attrib":[{"topic":"/temperature","type":"float","desc":"摄氏温度","rw":"r"}]})";
+
+class CountingPersistence : public registry::DevicePersistence {
+ public:
+    explicit CountingPersistence(int n) : n(n) {}
+
+    bool load(const std::function<void(std::string_view, std::string_view)>& row) override {
+        for (int i = 0; i < n; ++i) {
+            row("device-" + std::to_string(i), SAMPLE_META);
+        }
+        return true;
+    }
+    bool upsert(const std::vector<registry::DeviceRecord>& devices) override {
+        written += devices.size();
+        return true;
+    }
+    bool remove(const std::vector<std::string>& device_ids) override {
+        written += device_ids.size();
+        return true;
+    }
+
+    std::size_t written = 0;
+
+ private:
+    int n;
+};
+
+std::vector<std::string> make_devices(int n) {
+    std::vector<std::string> ids;
+    ids.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        ids.push_back("device-" + std::to_string(i));
+    }
+    return ids;
+}
+
+void BM_RegistryGet(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+    CountingPersistence persistence(n);
+    registry::DeviceRegistry devices(persistence);
+    devices.load();
+    auto ids = make_devices(n);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        auto meta = devices.get(ids[i++ % ids.size()]);
+        benchmark::DoNotOptimize(meta);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RegistryGet)->Arg(1000)->Arg(100000);
+
+void BM_RegistryContains(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+    CountingPersistence persistence(n);
+    registry::DeviceRegistry devices(persistence);
+    devices.load();
+    auto ids = make_devices(n);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(devices.contains(ids[i++ % ids.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RegistryContains)->Arg(1000)->Arg(100000);
+
+void BM_RegistryPutCoalesced(benchmark::State& state) {
+    CountingPersistence persistence(100);
+    registry::DeviceRegistry devices(persistence, std::chrono::milliseconds(100));
+    devices.load();
+    auto ids = make_devices(100);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        devices.put(ids[i++ % ids.size()], SAMPLE_META);
+    }
+    devices.stop();
+    state.SetItemsProcessed(state.iterations());
+    state.counters["db_writes_per_put"] =
+        static_cast<double>(persistence.written) / static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_RegistryPutCoalesced);
+
+}  // namespace
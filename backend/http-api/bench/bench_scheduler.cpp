@@ -0,0 +1,73 @@
+// 定时任务调度器基准测试
+//
+// 运行：./ahoh-bench --benchmark_filter=Schedul
+// BM_SchedulerAdd：向已有 10 万条任务的调度器逐条添加（替换）任务的开销。
+// BM_SchedulerIdle：10 万条任务均未到期时空等 1 秒，wakeups 计数应为 0（不按 tick 轮询）。
+// BM_CronNext：计算工作日早 9 点这类 cron 表达式下一次触发时刻的开销。
+
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include "scheduler.h"
+
+namespace {
+
+using namespace ahohs;
+using namespace std::chrono_literals;
+
+constexpr int N_SCHEDULES = 100000;
+
+scheduler::json definition(int i, int64_t every) {
+    return {
+        {"id", "schedule_" + std::to_string(i)},
+        {"every", every},
+        {"then", {{"device", "device_" + std::to_string(i % 1000)}, {"attrib", "/power_on"}, {"value", false}}},
+    };
+}
+
+void BM_SchedulerAdd(benchmark::State& state) {
+    scheduler::Scheduler sched;
+    for (int i = 0; i < N_SCHEDULES; ++i) {
+        sched.add(definition(i, 86400));
+    }
+    std::vector<scheduler::Schedule> schedules;
+    for (int i = 0; i < 1000; ++i) {
+        schedules.push_back(scheduler::Schedule::parse(definition(i, 3600 + i)));
+    }
+    std::size_t i = 0;
+    for (auto _ : state) {
+        sched.add(schedules[i++ % schedules.size()]);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["schedules"] = static_cast<double>(sched.size());
+}
+BENCHMARK(BM_SchedulerAdd);
+
+void BM_SchedulerIdle(benchmark::State& state) {
+    scheduler::Scheduler sched;
+    for (int i = 0; i < N_SCHEDULES; ++i) {
+        sched.add(definition(i, 86400 + i));
+    }
+    for (auto _ : state) {
+        const uint64_t before = sched.stats().wakeups.load();
+        std::this_thread::sleep_for(1s);
+        state.counters["wakeups"] = static_cast<double>(sched.stats().wakeups.load() - before);
+    }
+    state.counters["schedules"] = static_cast<double>(sched.size());
+}
+BENCHMARK(BM_SchedulerIdle)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+void BM_CronNext(benchmark::State& state) {
+    auto cron = scheduler::CronExpr::parse("0 9 * * 1-5");
+    auto t = scheduler::WallClock::now();
+    for (auto _ : state) {
+        auto next = cron.next(t);
+        benchmark::DoNotOptimize(next);
+        t = next ? *next : scheduler::WallClock::now();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CronNext);
+
+}  // namespace
@@ -0,0 +1,70 @@
+// MQTT topic 路由器基准测试
+//
+// 参数为注册的模式数量（100 / 10k），报告每次 match 的 ns/op。
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include "topic_router.h"
+
+namespace {
+
+using Router = ahoh::mqtt::TopicRouter<int, 4>;
+
+/// 构造 n 个模式：按设备精确订阅、按属性名订阅与少量通配订阅混合
+Router make_router(int n) {
+    Router router;
+    router.add("/device/+/attrib/+", -1);
+    router.add("/device/+/heartbeat", -2);
+    router.add("/device/+/meta", -3);
+    router.add("/device/+/will", -4);
+    router.add("/device/#", -5);
+    for (int i = 0; router.size() < static_cast<std::size_t>(n); ++i) {
+        switch (i % 3) {
+            case 0: router.add("/device/dev_" + std::to_string(i) + "/attrib/+", i); break;
+            case 1: router.add("/device/+/attrib/attr_" + std::to_string(i), i); break;
+            default: router.add("/home/room_" + std::to_string(i) + "/+/#", i); break;
+        }
+    }
+    router.compile();
+    return router;
+}
+
+std::vector<std::string> make_topics() {
+    std::vector<std::string> topics;
+    for (int i = 0; i < 1024; ++i) {
+        topics.push_back("/device/dev_" + std::to_string(i * 7) + "/attrib/temperature");
+        topics.push_back("/device/dev_" + std::to_string(i * 7) + "/heartbeat");
+        topics.push_back("/home/room_" + std::to_string(i * 3 + 2) + "/light/brightness");
+    }
+    return topics;
+}
+
+void BM_TopicRouterMatchAll(benchmark::State& state) {
+    Router router = make_router(static_cast<int>(state.range(0)));
+    auto topics = make_topics();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        int sum = 0;
+        router.match(topics[i++ % topics.size()], [&](int handler, const Router::Captures& captures) {
+            sum += handler + static_cast<int>(captures.size());
+        });
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TopicRouterMatchAll)->Arg(100)->Arg(10000);
+
+void BM_TopicRouterMatchOne(benchmark::State& state) {
+    Router router = make_router(static_cast<int>(state.range(0)));
+    auto topics = make_topics();
+    Router::Captures captures;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(router.match_one(topics[i++ % topics.size()], captures));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TopicRouterMatchOne)->Arg(100)->Arg(10000);
+
+}  // namespace
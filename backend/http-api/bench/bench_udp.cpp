@@ -0,0 +1,305 @@
+// UDP 发现响应器泛洪测试：模拟断电恢复后大量设备同时广播发现请求
+//
+// 运行：./ahoh-bench --benchmark_filter=UdpDiscovery
+// 参数为同时发起请求的设备数（每个设备一个本地 UDP socket、一个未完成的请求）与响应工作线程数。
+// 每次迭代所有设备（分给 N_SENDER_THREADS 个发包线程）几乎同时发出一次请求，然后等待全部回复或超时。
+// items_per_second 为每秒完成的回复数；p50_us / p99_us 为单个请求从发出到收到回复的延迟；
+// lost 为超时仍未收到回复的请求数（接收缓冲区溢出时出现）。
+// BM_UdpDiscoveryRateLimit：开启按来源限速时，固定速率泛洪下响应器的 CPU 占用与回复 / 丢弃计数。
+// BM_UdpReplyPath：单线程驱动的一批请求 -> recvmmsg -> 校验 / 构造回复 -> sendmmsg，不含线程唤醒与调度。
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "udp.h"
+
+namespace {
+
+using namespace ahohs;
+using SteadyClock = std::chrono::steady_clock;
+
+constexpr auto REPLY_TIMEOUT = std::chrono::milliseconds(200);
+constexpr std::string_view DISCOVER_MSG = "AHOH_DISCOVER_SERVER";
+constexpr std::size_t N_SENDER_THREADS = 4;
+constexpr std::size_t N_FLOOD_SOURCES = 16;
+constexpr std::size_t FLOOD_BATCH = 64;
+constexpr auto FLOOD_DURATION = std::chrono::seconds(1);
+
+/// 127.0.0.0/8 整段都是本机地址，用 127.1.x.y 模拟局域网内不同设备的来源 IP
+sockaddr_in source_address(std::size_t device) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(0x7f010000u | static_cast<uint32_t>(device + 1));
+    return addr;
+}
+
+int bound_socket(std::size_t device) {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    sockaddr_in addr = source_address(device);
+    bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    return fd;
+}
+
+/// 一组设备套接字，由一个发包线程驱动：同时发出请求，再等待全部回复或超时
+struct DeviceGroup {
+    std::vector<int> socks;
+    std::vector<pollfd> fds;
+    std::vector<SteadyClock::time_point> sent_at;
+    std::vector<double> latencies;
+    uint64_t lost = 0;
+
+    /// 第 i 个设备绑定 source_address(first + i)，使响应器按来源 IP 分发到各工作线程
+    DeviceGroup(std::size_t first, std::size_t n) : socks(n), fds(n), sent_at(n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            socks[i] = bound_socket(first + i);
+            fds[i] = {socks[i], POLLIN, 0};
+        }
+    }
+    ~DeviceGroup() {
+        for (int fd : socks) {
+            close(fd);
+        }
+    }
+
+    void burst(const sockaddr_in& target) {
+        const std::size_t n = socks.size();
+        for (std::size_t i = 0; i < n; ++i) {
+            sent_at[i] = SteadyClock::now();
+            sendto(socks[i], DISCOVER_MSG.data(), DISCOVER_MSG.size(), 0,
+                   reinterpret_cast<const sockaddr*>(&target), sizeof(target));
+            fds[i].events = POLLIN;
+        }
+        char buf[512];
+        std::size_t pending = n;
+        const auto deadline = SteadyClock::now() + REPLY_TIMEOUT;
+        while (pending > 0 && SteadyClock::now() < deadline) {
+            if (poll(fds.data(), fds.size(), 10) <= 0) {
+                continue;
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                if (!(fds[i].revents & POLLIN) || recv(socks[i], buf, sizeof(buf), 0) <= 0) {
+                    continue;
+                }
+                latencies.push_back(std::chrono::duration<double, std::micro>(SteadyClock::now() - sent_at[i]).count());
+                fds[i].events = 0;  // 已收到回复，不再等待
+                --pending;
+            }
+        }
+        lost += pending;
+    }
+};
+
+void BM_UdpDiscoveryFlood(benchmark::State& state) {
+    const auto n_devices = static_cast<std::size_t>(state.range(0));
+    const auto n_workers = static_cast<std::size_t>(state.range(1));
+
+    // 每个设备每次迭代都发一次请求，远超限速上限，这里关闭限速以测量收发路径本身
+    udp_server::UdpResponder responder("127.0.0.1", 18080, "127.0.0.1", 1883, 0, n_workers, 0);
+    lifecycle::Lifecycle lifecycle;
+    std::thread server([&]() { responder.start(lifecycle); });
+
+    sockaddr_in target{};
+    target.sin_family = AF_INET;
+    target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    target.sin_port = htons(responder.local_port());
+
+    std::vector<std::unique_ptr<DeviceGroup>> groups;
+    const std::size_t per_group = n_devices / N_SENDER_THREADS;
+    for (std::size_t i = 0; i < N_SENDER_THREADS; ++i) {
+        groups.push_back(std::make_unique<DeviceGroup>(i * per_group, per_group));
+    }
+    for (auto _ : state) {
+        const auto begin = SteadyClock::now();
+        std::vector<std::thread> senders;
+        for (auto& group : groups) {
+            senders.emplace_back([&group, &target]() { group->burst(target); });
+        }
+        for (auto& t : senders) {
+            t.join();
+        }
+        state.SetIterationTime(std::chrono::duration<double>(SteadyClock::now() - begin).count());
+    }
+
+    lifecycle.request_stop();
+    server.join();
+
+    std::vector<double> latencies;
+    uint64_t lost = 0;
+    for (const auto& group : groups) {
+        latencies.insert(latencies.end(), group->latencies.begin(), group->latencies.end());
+        lost += group->lost;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto pct = [&](double p) {
+        return latencies.empty() ? 0.0 : latencies[static_cast<std::size_t>(p * static_cast<double>(latencies.size() - 1))];
+    };
+    state.SetItemsProcessed(static_cast<int64_t>(latencies.size()));
+    state.counters["p50_us"] = pct(0.50);
+    state.counters["p99_us"] = pct(0.99);
+    state.counters["lost"] = static_cast<double>(lost);
+    state.counters["workers"] = static_cast<double>(responder.worker_count());
+}
+BENCHMARK(BM_UdpDiscoveryFlood)
+    ->ArgsProduct({{256, 1024, 4096}, {1, 2, 4}})
+    ->UseManualTime()->Unit(benchmark::kMicrosecond);
+
+double cpu_seconds(clockid_t clock) {
+    timespec ts{};
+    clock_gettime(clock, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+/**
+ * 限速下的泛洪：N_FLOOD_SOURCES 个来源以参数给定的总速率（包/秒）持续发送发现请求
+ *
+ * cpu_pct 为响应器线程占用的 CPU（进程 CPU 时间减去发包线程自身），应与速率近似线性、
+ * 远低于不限速时；replies 只有 来源数 × UDP_LIMIT_REPLIES 量级，其余计入 rate_limited。
+ */
+void BM_UdpDiscoveryRateLimit(benchmark::State& state) {
+    const auto pps = static_cast<uint64_t>(state.range(0));
+    udp_server::UdpResponder responder("127.0.0.1", 18080, "127.0.0.1", 1883, 0, 1);
+    lifecycle::Lifecycle lifecycle;
+    std::thread server([&]() { responder.start(lifecycle); });
+
+    sockaddr_in target{};
+    target.sin_family = AF_INET;
+    target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    target.sin_port = htons(responder.local_port());
+
+    std::vector<int> socks;
+    for (std::size_t i = 0; i < N_FLOOD_SOURCES; ++i) {
+        socks.push_back(bound_socket(100000 + i));
+        int rcvbuf = 4096;  // 泛洪来源不读回复，缩小缓冲区即可
+        setsockopt(socks.back(), SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+
+    // 每个节拍用 sendmmsg 按来源轮流补齐到目标速率
+    std::vector<mmsghdr> msgs(FLOOD_BATCH);
+    iovec iov{const_cast<char*>(DISCOVER_MSG.data()), DISCOVER_MSG.size()};
+    for (auto& m : msgs) {
+        m = {};
+        m.msg_hdr.msg_name = &target;
+        m.msg_hdr.msg_namelen = sizeof(target);
+        m.msg_hdr.msg_iov = &iov;
+        m.msg_hdr.msg_iovlen = 1;
+    }
+
+    double responder_cpu = 0;
+    double elapsed = 0;
+    uint64_t sent = 0;
+    for (auto _ : state) {
+        const double process_before = cpu_seconds(CLOCK_PROCESS_CPUTIME_ID);
+        const double sender_before = cpu_seconds(CLOCK_THREAD_CPUTIME_ID);
+        const auto begin = SteadyClock::now();
+        auto tick = begin;
+        uint64_t iteration_sent = 0;
+        std::size_t source = 0;
+        while (SteadyClock::now() - begin < FLOOD_DURATION) {
+            const auto due = static_cast<uint64_t>(std::chrono::duration<double>(SteadyClock::now() - begin).count() *
+                                                   static_cast<double>(pps));
+            while (iteration_sent < due) {
+                const auto n = static_cast<unsigned>(std::min<uint64_t>(due - iteration_sent, FLOOD_BATCH));
+                const int k = sendmmsg(socks[source], msgs.data(), n, 0);
+                source = (source + 1) % socks.size();
+                if (k <= 0) {
+                    break;
+                }
+                iteration_sent += static_cast<uint64_t>(k);
+            }
+            tick += std::chrono::milliseconds(1);
+            std::this_thread::sleep_until(tick);
+        }
+        const double sender_cpu = cpu_seconds(CLOCK_THREAD_CPUTIME_ID) - sender_before;
+        const double wall = std::chrono::duration<double>(SteadyClock::now() - begin).count();
+        responder_cpu += cpu_seconds(CLOCK_PROCESS_CPUTIME_ID) - process_before - sender_cpu;
+        elapsed += wall;
+        sent += iteration_sent;
+        state.SetIterationTime(wall);
+    }
+
+    lifecycle.request_stop();
+    server.join();
+    for (int fd : socks) {
+        close(fd);
+    }
+
+    const auto stats = responder.stats();
+    state.SetItemsProcessed(static_cast<int64_t>(sent));
+    state.counters["cpu_pct"] = elapsed > 0 ? 100.0 * responder_cpu / elapsed : 0;
+    state.counters["received"] = static_cast<double>(stats.received);
+    state.counters["replies"] = static_cast<double>(stats.replied);
+    state.counters["rate_limited"] = static_cast<double>(stats.rate_limited);
+    state.counters["cached"] = static_cast<double>(stats.cached);
+}
+BENCHMARK(BM_UdpDiscoveryRateLimit)
+    ->Arg(10000)->Arg(100000)
+    ->Iterations(2)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+// 回复路径本身：同一线程发出 FLOOD_BATCH 个请求，调用 poll() 处理，再读回全部回复。
+// 参数 0 为 v1 文本请求，1 为 v2 二进制请求（每个请求的 nonce 不同）；items_per_second 为每秒回复数
+void BM_UdpReplyPath(benchmark::State& state) {
+    const bool v2 = state.range(0) != 0;
+    udp_server::UdpResponder responder("127.0.0.1", 18080, "127.0.0.1", 1883, 0, 1, 0);
+
+    sockaddr_in target{};
+    target.sin_family = AF_INET;
+    target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    target.sin_port = htons(responder.local_port());
+    int sock = bound_socket(200000);
+
+    std::vector<std::string> requests;
+    for (std::size_t i = 0; i < FLOOD_BATCH; ++i) {
+        requests.push_back(v2 ? ahoh::discovery::encode_request(static_cast<uint32_t>(i + 1)) : std::string(DISCOVER_MSG));
+    }
+    std::vector<iovec> send_iovs(FLOOD_BATCH);
+    std::vector<mmsghdr> send_msgs(FLOOD_BATCH);
+    std::vector<std::array<char, 512>> buffers(FLOOD_BATCH);
+    std::vector<iovec> recv_iovs(FLOOD_BATCH);
+    std::vector<mmsghdr> recv_msgs(FLOOD_BATCH);
+    for (std::size_t i = 0; i < FLOOD_BATCH; ++i) {
+        send_iovs[i] = {requests[i].data(), requests[i].size()};
+        send_msgs[i] = {};
+        send_msgs[i].msg_hdr.msg_name = &target;
+        send_msgs[i].msg_hdr.msg_namelen = sizeof(target);
+        send_msgs[i].msg_hdr.msg_iov = &send_iovs[i];
+        send_msgs[i].msg_hdr.msg_iovlen = 1;
+        recv_iovs[i] = {buffers[i].data(), buffers[i].size()};
+        recv_msgs[i] = {};
+        recv_msgs[i].msg_hdr.msg_iov = &recv_iovs[i];
+        recv_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    uint64_t replies = 0;
+    for (auto _ : state) {
+        sendmmsg(sock, send_msgs.data(), FLOOD_BATCH, 0);
+        responder.poll();
+        std::size_t got = 0;
+        while (got < FLOOD_BATCH) {
+            int n = recvmmsg(sock, recv_msgs.data() + got, static_cast<unsigned>(FLOOD_BATCH - got), MSG_DONTWAIT, nullptr);
+            if (n <= 0) {
+                break;  // 回复在 poll() 返回前已全部发出，读不到即丢失
+            }
+            got += static_cast<std::size_t>(n);
+        }
+        replies += got;
+    }
+    close(sock);
+
+    state.SetItemsProcessed(static_cast<int64_t>(replies));
+    state.counters["lost"] = static_cast<double>(state.iterations() * FLOOD_BATCH - replies);
+}
+BENCHMARK(BM_UdpReplyPath)->Arg(0)->Arg(1);
+
+}  // namespace
@@ -0,0 +1,500 @@
+#include "fake_broker.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace ahohs::bench {
+
+namespace {
+
+// 控制报文类型（固定报头高 4 位）
+enum PacketType : uint8_t {
+    CONNECT = 1,
+    CONNACK = 2,
+    PUBLISH = 3,
+    PUBACK = 4,
+    PUBREC = 5,
+    PUBREL = 6,
+    PUBCOMP = 7,
+    SUBSCRIBE = 8,
+    SUBACK = 9,
+    UNSUBSCRIBE = 10,
+    UNSUBACK = 11,
+    PINGREQ = 12,
+    PINGRESP = 13,
+    DISCONNECT = 14,
+};
+
+constexpr std::size_t MAX_PACKET = 1 << 20;
+constexpr std::size_t READ_CHUNK = 64 * 1024;
+
+void put_u16(std::string& out, uint16_t v) {
+    out.push_back(static_cast<char>(v >> 8));
+    out.push_back(static_cast<char>(v & 0xff));
+}
+
+void put_remaining_length(std::string& out, std::size_t len) {
+    do {
+        auto byte = static_cast<uint8_t>(len % 128);
+        len /= 128;
+        if (len > 0) {
+            byte |= 0x80;
+        }
+        out.push_back(static_cast<char>(byte));
+    } while (len > 0);
+}
+
+std::string packet(uint8_t header, std::string_view body) {
+    std::string out;
+    out.reserve(body.size() + 5);
+    out.push_back(static_cast<char>(header));
+    put_remaining_length(out, body.size());
+    out.append(body);
+    return out;
+}
+
+std::string ack(PacketType type, uint16_t packet_id) {
+    std::string body;
+    put_u16(body, packet_id);
+    return packet(static_cast<uint8_t>(type << 4), body);
+}
+
+/// 顺序读取报文可变头与负载，越界后 ok 置为 false 且后续读取都返回空值
+struct Reader {
+    std::string_view in;
+    bool ok = true;
+
+    uint8_t u8() {
+        if (in.empty()) {
+            ok = false;
+            return 0;
+        }
+        auto v = static_cast<uint8_t>(in.front());
+        in.remove_prefix(1);
+        return v;
+    }
+
+    uint16_t u16() {
+        if (in.size() < 2) {
+            ok = false;
+            return 0;
+        }
+        auto v = static_cast<uint16_t>((static_cast<uint8_t>(in[0]) << 8) | static_cast<uint8_t>(in[1]));
+        in.remove_prefix(2);
+        return v;
+    }
+
+    std::string_view str() {
+        const uint16_t len = u16();
+        if (!ok || in.size() < len) {
+            ok = false;
+            return {};
+        }
+        auto v = in.substr(0, len);
+        in.remove_prefix(len);
+        return v;
+    }
+};
+
+}  // namespace
+
+bool topic_matches(std::string_view filter, std::string_view topic) {
+    if (!topic.empty() && topic.front() == '$' && !filter.empty() && (filter.front() == '+' || filter.front() == '#')) {
+        return false;
+    }
+    while (true) {
+        const auto f_end = filter.find('/');
+        const auto t_end = topic.find('/');
+        const std::string_view f_level = filter.substr(0, f_end);
+        if (f_level == "#") {
+            return true;  // 匹配剩余所有层级，包括父层级本身（"a/#" 匹配 "a"）
+        }
+        if (f_level != "+" && f_level != topic.substr(0, t_end)) {
+            return false;
+        }
+        if (f_end == std::string_view::npos || t_end == std::string_view::npos) {
+            // 过滤器还剩 "/#" 时仍匹配父层级
+            return f_end == t_end || (t_end == std::string_view::npos && filter.substr(f_end) == "/#");
+        }
+        filter.remove_prefix(f_end + 1);
+        topic.remove_prefix(t_end + 1);
+    }
+}
+
+std::string encode_publish(std::string_view topic, std::string_view payload, int qos, bool retain, uint16_t packet_id) {
+    std::string body;
+    body.reserve(topic.size() + payload.size() + 4);
+    put_u16(body, static_cast<uint16_t>(topic.size()));
+    body.append(topic);
+    if (qos > 0) {
+        put_u16(body, packet_id);
+    }
+    body.append(payload);
+    return packet(static_cast<uint8_t>((PUBLISH << 4) | (qos << 1) | (retain ? 1 : 0)), body);
+}
+
+FakeBroker::~FakeBroker() {
+    stop();
+}
+
+bool FakeBroker::start(uint16_t port) {
+    if (running) {
+        return true;
+    }
+    listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        return false;
+    }
+    int one = 1;
+    ::setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    socklen_t len = sizeof(addr);
+    if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listen_fd, 64) != 0 ||
+        ::getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        ::close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    bound_port = ntohs(addr.sin_port);
+    running = true;
+    acceptor = std::thread([this]() { accept_loop(); });
+    return true;
+}
+
+void FakeBroker::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    ::shutdown(listen_fd, SHUT_RDWR);  // 打断阻塞中的 accept()
+    acceptor.join();
+    ::close(listen_fd);
+    listen_fd = -1;
+
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto& client : clients) {
+            ::shutdown(client->fd, SHUT_RDWR);  // 打断各读线程的 recv()，fd 由读线程关闭
+        }
+        threads.swap(workers);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    retained.clear();
+}
+
+std::string FakeBroker::address() const {
+    return "tcp://127.0.0.1:" + std::to_string(bound_port);
+}
+
+FakeBrokerStats FakeBroker::stats() const {
+    FakeBrokerStats s;
+    s.connections = n_connections.load();
+    s.publishes_in = n_publishes_in.load();
+    s.publishes_out = n_publishes_out.load();
+    std::lock_guard<std::mutex> lock(mtx);
+    s.retained = retained.size();
+    return s;
+}
+
+void FakeBroker::inject(std::string_view topic, std::string_view payload, int qos, bool retain) {
+    n_publishes_in.fetch_add(1, std::memory_order_relaxed);
+    route(topic, payload, std::min(qos, 1), retain);
+}
+
+void FakeBroker::accept_loop() {
+    while (running) {
+        const int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;  // stop() 关闭了监听 socket
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        auto client = std::make_shared<Client>();
+        client->fd = fd;
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!running) {
+            ::close(fd);
+            return;
+        }
+        n_connections.fetch_add(1, std::memory_order_relaxed);
+        clients.push_back(client);
+        workers.emplace_back([this, client]() { serve(client); });
+    }
+}
+
+void FakeBroker::serve(std::shared_ptr<Client> client) {
+    std::string buf;
+    std::size_t head = 0;  // buf 中尚未处理的第一个字节
+    bool connected = false;
+    while (true) {
+        const std::size_t old_size = buf.size();
+        buf.resize(old_size + READ_CHUNK);
+        const ssize_t n = ::recv(client->fd, buf.data() + old_size, READ_CHUNK, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                buf.resize(old_size);
+                continue;
+            }
+            break;
+        }
+        buf.resize(old_size + static_cast<std::size_t>(n));
+
+        bool keep = true;
+        while (keep) {
+            // 固定报头：类型与标志 1 字节 + 剩余长度 1 ~ 4 字节
+            std::size_t pos = head + 1;
+            std::size_t len = 0;
+            bool complete = false;
+            for (int shift = 0; shift < 28 && pos < buf.size(); shift += 7) {
+                const auto byte = static_cast<uint8_t>(buf[pos++]);
+                len |= static_cast<std::size_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) {
+                    complete = true;
+                    break;
+                }
+            }
+            if (!complete) {
+                keep = pos - head <= 4;  // 剩余长度超过 4 字节为协议错误
+                break;
+            }
+            if (len > MAX_PACKET) {
+                keep = false;
+                break;
+            }
+            if (buf.size() - pos < len) {
+                break;
+            }
+            const auto header = static_cast<uint8_t>(buf[head]);
+            keep = handle(*client, header, std::string_view(buf).substr(pos, len), connected);
+            head = pos + len;
+        }
+        if (!keep) {
+            break;
+        }
+        buf.erase(0, head);
+        head = 0;
+    }
+    drop(client);
+}
+
+bool FakeBroker::handle(Client& client, uint8_t header, std::string_view body, bool& connected) {
+    const auto type = static_cast<PacketType>(header >> 4);
+    if (!connected && type != CONNECT) {
+        return false;  // 第一个报文必须是 CONNECT
+    }
+    Reader in{body};
+    switch (type) {
+        case CONNECT: {
+            if (connected) {
+                return false;  // 重复 CONNECT 为协议错误
+            }
+            const auto protocol = in.str();
+            const uint8_t level = in.u8();
+            if (!in.ok) {
+                return false;
+            }
+            const bool v311 = protocol == "MQTT" && level == 4;
+            const bool v31 = protocol == "MQIsdp" && level == 3;
+            std::string connack;
+            put_u16(connack, 0);  // session present = 0，返回码稍后写入
+            connack[1] = static_cast<char>(v311 || v31 ? 0x00 : 0x01);  // 0x01：不支持的协议版本
+            std::lock_guard<std::mutex> lock(client.write_mtx);
+            send_all(client, packet(CONNACK << 4, connack));
+            connected = v311 || v31;
+            return connected;
+        }
+        case PUBLISH: {
+            const int qos = (header >> 1) & 0x03;
+            const bool retain = header & 0x01;
+            const auto topic = in.str();
+            const uint16_t packet_id = qos > 0 ? in.u16() : 0;
+            if (!in.ok || qos == 3 || topic.empty() || topic.find_first_of("+#") != std::string_view::npos) {
+                return false;
+            }
+            n_publishes_in.fetch_add(1, std::memory_order_relaxed);
+            route(topic, in.in, std::min(qos, 1), retain);
+            if (qos > 0) {
+                std::lock_guard<std::mutex> lock(client.write_mtx);
+                send_all(client, ack(qos == 1 ? PUBACK : PUBREC, packet_id));
+            }
+            return true;
+        }
+        case PUBREL: {
+            const uint16_t packet_id = in.u16();
+            std::lock_guard<std::mutex> lock(client.write_mtx);
+            return in.ok && send_all(client, ack(PUBCOMP, packet_id));
+        }
+        case PUBACK:
+        case PUBREC:
+        case PUBCOMP:
+            return true;  // 出站消息不重传，确认无需处理
+        case SUBSCRIBE: {
+            const uint16_t packet_id = in.u16();
+            std::vector<std::pair<std::string, int>> added;
+            std::string suback;
+            put_u16(suback, packet_id);
+            while (in.ok && !in.in.empty()) {
+                const auto filter = in.str();
+                const int qos = std::min(in.u8() & 0x03, 1);
+                if (!in.ok || filter.empty()) {
+                    return false;
+                }
+                added.emplace_back(filter, qos);
+                suback.push_back(static_cast<char>(qos));
+            }
+            if (!in.ok || added.empty()) {
+                return false;
+            }
+            struct Pending {
+                std::string topic;
+                std::string payload;
+                int qos;
+            };
+            std::vector<Pending> pending;  // 需要补发的保留消息，每个 topic 只发一次
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                for (const auto& [filter, qos] : added) {
+                    auto it = std::find_if(client.subs.begin(), client.subs.end(),
+                                           [&](const auto& sub) { return sub.first == filter; });
+                    if (it != client.subs.end()) {
+                        it->second = qos;  // 同一过滤器重复订阅时替换
+                    } else {
+                        client.subs.emplace_back(filter, qos);
+                    }
+                }
+                for (const auto& [topic, payload] : retained) {
+                    int granted = -1;
+                    for (const auto& [filter, qos] : added) {
+                        if (topic_matches(filter, topic)) {
+                            granted = std::max(granted, qos);
+                        }
+                    }
+                    if (granted >= 0) {
+                        pending.push_back({topic, payload, granted});
+                    }
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(client.write_mtx);
+                if (!send_all(client, packet(SUBACK << 4, suback))) {
+                    return false;
+                }
+            }
+            for (const auto& p : pending) {
+                deliver(client, p.topic, p.payload, p.qos, true);
+            }
+            return true;
+        }
+        case UNSUBSCRIBE: {
+            const uint16_t packet_id = in.u16();
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                while (in.ok && !in.in.empty()) {
+                    const auto filter = in.str();
+                    std::erase_if(client.subs, [&](const auto& sub) { return sub.first == filter; });
+                }
+            }
+            std::lock_guard<std::mutex> lock(client.write_mtx);
+            return in.ok && send_all(client, ack(UNSUBACK, packet_id));
+        }
+        case PINGREQ: {
+            std::lock_guard<std::mutex> lock(client.write_mtx);
+            return send_all(client, packet(PINGRESP << 4, {}));
+        }
+        case DISCONNECT:
+        default:
+            return false;
+    }
+}
+
+void FakeBroker::route(std::string_view topic, std::string_view payload, int qos, bool retain) {
+    thread_local std::vector<std::pair<std::shared_ptr<Client>, int>> targets;
+    targets.clear();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (retain) {
+            auto it = retained.find(topic);
+            if (payload.empty()) {
+                if (it != retained.end()) {
+                    retained.erase(it);  // 空负载的保留消息表示清除
+                }
+            } else if (it != retained.end()) {
+                it->second.assign(payload);
+            } else {
+                retained.emplace(std::string(topic), std::string(payload));
+            }
+        }
+        for (const auto& client : clients) {
+            int granted = -1;  // 多个过滤器命中时只投递一次，取最高的授予 QoS
+            for (const auto& [filter, sub_qos] : client->subs) {
+                if (topic_matches(filter, topic)) {
+                    granted = std::max(granted, sub_qos);
+                }
+            }
+            if (granted >= 0) {
+                targets.emplace_back(client, std::min(qos, granted));
+            }
+        }
+    }
+    // 转发给订阅者时不带 retain 标志（只有订阅时补发的保留消息才带）
+    for (auto& [client, target_qos] : targets) {
+        deliver(*client, topic, payload, target_qos, false);
+    }
+    targets.clear();
+}
+
+void FakeBroker::deliver(Client& client, std::string_view topic, std::string_view payload, int qos, bool retain) {
+    std::lock_guard<std::mutex> lock(client.write_mtx);
+    uint16_t packet_id = 0;
+    if (qos > 0) {
+        if (++client.next_packet_id == 0) {
+            client.next_packet_id = 1;
+        }
+        packet_id = client.next_packet_id;
+    }
+    if (send_all(client, encode_publish(topic, payload, qos, retain, packet_id))) {
+        n_publishes_out.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void FakeBroker::drop(const std::shared_ptr<Client>& client) {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::erase(clients, client);
+    // 写锁保证没有其他线程（转发路径）仍在向该 fd 写入
+    std::lock_guard<std::mutex> write_lock(client->write_mtx);
+    ::close(client->fd);
+    client->fd = -1;
+}
+
+bool FakeBroker::send_all(Client& client, std::string_view data) {
+    while (!data.empty()) {
+        if (client.fd < 0) {
+            return false;
+        }
+        const ssize_t n = ::send(client.fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(n));
+    }
+    return true;
+}
+
+}  // namespace ahohs::bench
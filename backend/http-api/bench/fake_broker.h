@@ -0,0 +1,100 @@
+#pragma once
+
+// 进程内 MQTT 3.1.1 broker 替身，供基准测试在没有 mosquitto 的环境下运行
+//
+// 只实现摄取链路用到的子集：CONNECT、SUBSCRIBE / UNSUBSCRIBE（支持 '+' / '#' 通配符）、
+// QoS 0 / 1 的 PUBLISH 与保留消息、PINGREQ、DISCONNECT。仅监听 127.0.0.1。
+// 不支持：MQTT v5（多客户端共享订阅模式的 MqttServer 无法连接，摄取客户端数须为 1）、
+// 持久会话（CONNACK 的 session present 恒为 0）、遗嘱消息、认证、QoS 1 的重传。
+// 入站 QoS 2 完成 PUBREC / PUBREL / PUBCOMP 握手，但按 QoS 1 转发。
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ahohs::bench {
+
+/// 计数快照
+struct FakeBrokerStats {
+    uint64_t connections = 0;    // 累计接受的连接
+    uint64_t publishes_in = 0;   // 收到的 PUBLISH（含 inject()）
+    uint64_t publishes_out = 0;  // 转发给订阅者的 PUBLISH（含保留消息）
+    std::size_t retained = 0;    // 当前保存的保留消息数
+};
+
+/// topic 是否匹配订阅过滤器；以 '$' 开头的 topic 不匹配首层通配符
+bool topic_matches(std::string_view filter, std::string_view topic);
+
+/// 编码 PUBLISH 报文（qos > 0 时带 packet_id）
+std::string encode_publish(std::string_view topic, std::string_view payload, int qos, bool retain,
+                           uint16_t packet_id = 0);
+
+/**
+ * 最小 MQTT broker
+ *
+ * 一个接受线程加每连接一个读线程；转发在发布者的读线程中同步完成（按订阅者加写锁），
+ * 订阅者读得慢时直接反压发布者，不在 broker 内排队。
+ */
+class FakeBroker {
+ public:
+    FakeBroker() = default;
+    ~FakeBroker();
+
+    FakeBroker(const FakeBroker&) = delete;
+    FakeBroker& operator=(const FakeBroker&) = delete;
+
+    /// 在 127.0.0.1:port 上监听，port 为 0 时由系统分配；失败返回 false
+    bool start(uint16_t port = 0);
+    /// 断开所有连接并等待线程退出，可重复调用
+    void stop();
+
+    uint16_t port() const { return bound_port; }
+    /// paho 可用的服务器地址，形如 tcp://127.0.0.1:18831
+    std::string address() const;
+
+    /// 以 broker 自身身份发布消息（如预置保留消息），与收到客户端的 PUBLISH 走同一转发逻辑
+    void inject(std::string_view topic, std::string_view payload, int qos = 0, bool retain = false);
+
+    FakeBrokerStats stats() const;
+
+ private:
+    struct Client {
+        int fd = -1;
+        std::mutex write_mtx;
+        uint16_t next_packet_id = 0;                      // 受 write_mtx 保护
+        std::vector<std::pair<std::string, int>> subs;    // 订阅过滤器与授予的 QoS，受 FakeBroker::mtx 保护
+    };
+
+    int listen_fd = -1;
+    uint16_t bound_port = 0;
+    std::thread acceptor;
+    std::atomic<bool> running{false};
+
+    mutable std::mutex mtx;
+    std::vector<std::shared_ptr<Client>> clients;
+    std::vector<std::thread> workers;
+    std::map<std::string, std::string, std::less<>> retained;
+
+    std::atomic<uint64_t> n_connections{0};
+    std::atomic<uint64_t> n_publishes_in{0};
+    std::atomic<uint64_t> n_publishes_out{0};
+
+    void accept_loop();
+    void serve(std::shared_ptr<Client> client);
+    /// 处理一个完整报文，返回 false 表示应断开连接
+    bool handle(Client& client, uint8_t header, std::string_view body, bool& connected);
+    void route(std::string_view topic, std::string_view payload, int qos, bool retain);
+    void deliver(Client& client, std::string_view topic, std::string_view payload, int qos, bool retain);
+    void drop(const std::shared_ptr<Client>& client);
+
+    static bool send_all(Client& client, std::string_view data);
+};
+
+}  // namespace ahohs::bench
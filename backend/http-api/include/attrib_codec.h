@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "state_store.h"
+#include "telemetry.h"
+
+namespace ahohs::codec {
+
+using json = nlohmann::json;
+
+/**
+ * 属性负载编码版本，由设备元数据中的 attrib_schema 字段声明
+ *
+ * v1：JSON，单个属性为 {"value":x}，批量为 {"temperature":23.4,"alert":false}。
+ * v2：定长小端二进制，见 mqtt_fake_code.md 中的说明：
+ *   值     = 类型标签(u8) [数据]
+ *   单个属性 /device/{id}/attrib/{name} 的负载即一个值；
+ *   批量   /device/{id}/attrib 的负载为 个数(u8) { 属性下标(u8) 值 }*，
+ *   属性下标为该属性在元数据 attrib 数组中的位置。
+ */
+enum class SchemaVersion : uint8_t { V1, V2 };
+
+/// v2 值类型标签
+enum class Tag : uint8_t {
+    Null = 0x00,
+    False = 0x01,
+    True = 0x02,
+    F32 = 0x03,
+    F64 = 0x04,
+    I32 = 0x05,
+    Str = 0x06,   // 长度(u8) + UTF-8 字节
+};
+
+/// 单个设备的属性编码方式，由元数据生成后不再修改
+struct DeviceSchema {
+    SchemaVersion version = SchemaVersion::V1;
+    std::vector<std::string> attribs;  // 属性下标 -> 属性 topic（带前导 '/'）
+
+    /// 从元数据读取 attrib_schema 与 attrib 列表；未声明或无法识别的版本按 v1 处理
+    static DeviceSchema from_meta(const json& meta);
+};
+
+/// 解码 v2 的单个值，成功时从 in 的开头消耗相应字节
+std::optional<telemetry::AttribValue> decode_value_v2(std::string_view& in);
+
+/// 解码 v2 单个属性负载，负载必须恰好是一个值
+std::optional<telemetry::AttribValue> decode_attrib_v2(std::string_view payload);
+
+/**
+ * 解码 v2 批量负载
+ *
+ * 每解出一个属性调用 fn(attrib, value)。负载截断、下标越界或有多余字节时返回 false，
+ * 此前已解出的属性仍会回调。
+ */
+template <typename Fn>
+bool decode_batch_v2(std::string_view payload, const DeviceSchema& schema, Fn&& fn);
+
+/// 编码 v2 值：数值若可无损表示为 i32 / f32 则使用较短的形式
+void encode_value_v2(const telemetry::AttribValue& value, std::string& out);
+
+/**
+ * 编码下发给单个属性 topic 的命令负载
+ *
+ * 按设备声明的编码方式：v2 为一个值（同 encode_value_v2），v1 与未登记（schema 为 nullptr）的设备为 {"value":x}。
+ * 数组 / 对象无法用 v2 表示，仍按 v1 编码。
+ */
+std::string encode_command(const DeviceSchema* schema, const json& value);
+
+/// 编码 v2 批量负载，下标与值一一对应；超过 255 个属性时返回空串
+std::string encode_batch_v2(const std::vector<std::pair<uint8_t, telemetry::AttribValue>>& values);
+
+/**
+ * 设备编码方式登记表
+ *
+ * 元数据写入（MQTT 上报、HTTP 接口、启动时从数据库加载）后调用 set()，
+ * 摄取线程按设备查询；未登记的设备按 v1 处理。
+ */
+class SchemaRegistry {
+ public:
+    void set(std::string_view device_id, const json& meta);
+    void forget(std::string_view device_id);
+
+    /// 设备的编码方式，未登记时返回 nullptr
+    std::shared_ptr<const DeviceSchema> get(std::string_view device_id) const;
+
+ private:
+    mutable std::shared_mutex mtx;
+    state::StringMap<std::shared_ptr<const DeviceSchema>> schemas;
+};
+
+// ===== decode_batch_v2 实现 =====
+
+template <typename Fn>
+bool decode_batch_v2(std::string_view payload, const DeviceSchema& schema, Fn&& fn) {
+    if (payload.empty()) {
+        return false;
+    }
+    std::size_t count = static_cast<unsigned char>(payload.front());
+    payload.remove_prefix(1);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (payload.empty()) {
+            return false;
+        }
+        std::size_t index = static_cast<unsigned char>(payload.front());
+        payload.remove_prefix(1);
+        auto value = decode_value_v2(payload);
+        if (!value || index >= schema.attribs.size()) {
+            return false;
+        }
+        fn(std::string_view(schema.attribs[index]), std::move(*value));
+    }
+    return payload.empty();
+}
+
+}  // namespace ahohs::codec
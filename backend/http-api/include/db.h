@@ -5,6 +5,7 @@
 #include <optional>
 #include <memory>
 #include <functional>
+#include <utility>
 #include <pqxx/pqxx>
 #include <spdlog/spdlog.h>
 #include <spdlog/spdlog.h>
@@ -33,6 +34,14 @@ class PostgresDB {
     // 启动事务
     std::unique_ptr<pqxx::work> begin_transaction();
 
+    /**
+     * 确保连接可用
+     *
+     * 连接已断开（如数据库重启）时重新建立连接，并重新注册此前注册过的全部预处理语句。
+     * 重连失败返回 false，可稍后再次调用。
+     */
+    bool ensure_connected();
+
     /**
      * 模板化查询函数
      *
@@ -67,9 +76,12 @@ class PostgresDB {
     void register_prepared_statement(const std::string& stmt_name, const std::string& sql);  // 注册预处理语句
     bool exec_prepared(const std::string& stmt_name, const std::vector<std::string>& params);    // 执行无结果预处理语句
     std::optional<pqxx::result> query_prepared(const std::string& stmt_name, const std::vector<std::string>& params);  // 查询预处理语句
+    bool exec_prepared_batch(const std::string& stmt_name, const std::vector<std::vector<std::string>>& rows);  // 在单个事务内批量执行预处理语句
 
  private:
     std::unique_ptr<pqxx::connection> conn;  // 数据库连接对象
+    std::string connstr;                     // 重连时使用
+    std::vector<std::pair<std::string, std::string>> statements;  // 已注册的预处理语句（名称，SQL），重连后重新注册
 
     // 独立的静态日志对象，所有日志均使用该对象输出
     inline static std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("postgres_db");
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include "state_store.h"
+
+// 每个 topic 保留的最近负载摘要个数（无序号的设备用于识别重投）
+#ifndef DEDUP_HASH_WINDOW
+#define DEDUP_HASH_WINDOW 8
+#endif
+
+namespace ahohs::ingest {
+
+enum class DedupResult { Fresh, DuplicateSeq, DuplicateHash };
+
+/// 从 JSON 对象负载中取出顶层的可选 "seq" 序号（非负整数），没有时返回 std::nullopt；嵌套对象中的同名键不算
+std::optional<uint64_t> find_sequence(std::string_view payload);
+
+/**
+ * QoS 1 / 2 重投去重
+ *
+ * 按设备、再按 topic 保存状态：
+ * - 属性消息（/device/{id}/attrib/{name}）的负载顶层带 "seq" 时使用序号滑动窗口（最近 64 个序号的位图）。
+ *   固件的序号每次启动从 0 计数，因此只有 broker 标记为重投（DUP）且窗口内已见过的序号才判为重复；
+ *   未标记重投却不新于已见序号的消息视为设备重启，重置窗口并接受。
+ * - 其余消息保存最近 DEDUP_HASH_WINDOW 条负载的摘要，同样只有标记为重投且摘要命中的消息才判为重复，
+ *   设备正常上报的相同数值不受影响。
+ * - 设备重新上线（收到 meta 或 will）时清空该设备所有 topic 的状态。
+ *
+ * 非线程安全：每个摄取分片持有一个实例，只由该分片的工作线程访问；
+ * 同一设备总是落在同一分片，因此无需加锁。
+ */
+class Deduplicator {
+ public:
+    DedupResult check(std::string_view topic, std::string_view payload, bool redelivered);
+
+    /// 当前跟踪的 topic 数
+    std::size_t tracked() const { return n_entries; }
+
+ private:
+    struct Entry {
+        bool has_seq = false;
+        uint64_t max_seq = 0;
+        uint64_t seq_window = 0;  // 第 i 位表示 max_seq - i 已出现
+        std::array<uint64_t, DEDUP_HASH_WINDOW> hashes{};
+        uint32_t n_hashes = 0;    // 已写入的摘要总数，取模得到下一个写入位置
+    };
+
+    state::StringMap<state::StringMap<Entry>> devices;  // device_id（无法识别的 topic 为 topic 本身）-> topic -> 状态
+    std::size_t n_entries = 0;
+
+    static DedupResult check_seq(Entry& entry, uint64_t seq, bool redelivered);
+    static DedupResult check_hash(Entry& entry, std::string_view payload, bool redelivered);
+};
+
+}  // namespace ahohs::ingest
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "series.h"
+
+namespace ahohs::http_server {
+
+/**
+ * HTTP 设备接口的请求解析与响应构建
+ *
+ * 与 Crow 和数据库无关，HttpServer 的路由处理函数只负责查询与写库，
+ * 基准测试可以直接测量这部分开销。
+ */
+
+/// 一行设备记录，字段引用查询结果中的文本
+struct DeviceRow {
+    std::string_view device_id;
+    std::string_view meta;
+};
+
+/// GET /devices 的响应体 {"devices":[{"device_id":..,"meta":..},...]}；meta 不是合法 JSON 时按字符串返回
+std::string devices_json(const std::vector<DeviceRow>& rows);
+
+/// POST /device 请求体中的设备元数据
+struct DeviceUpsert {
+    std::string device_id;
+    std::string meta;          // 写库的文本：meta 为字符串时原样使用，否则为序列化结果
+    nlohmann::json meta_value; // 请求中 meta 字段的原值
+};
+
+/// 解析 POST /device 的请求体，JSON 非法、缺少字段或 meta 字符串不是合法 JSON 时抛出 std::invalid_argument（消息即返回给客户端的错误）
+DeviceUpsert parse_device_upsert(std::string_view body);
+
+/// GET /device/<device_id>/history 由内存给出时的响应体，points 为 [[ts, value],...]，布尔属性的值为 true / false
+std::string history_json(std::string_view device_id, std::string_view attrib, const series::Range& range);
+
+}  // namespace ahohs::http_server
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "db.h"
+#include "state_store.h"
+
+#ifndef DEVICE_REGISTRY_FLUSH_INTERVAL_MS
+#define DEVICE_REGISTRY_FLUSH_INTERVAL_MS 500
+#endif
+
+// 待写库（脏）设备数上限；同一设备的多次修改只占一项
+#ifndef DEVICE_REGISTRY_MAX_DIRTY
+#define DEVICE_REGISTRY_MAX_DIRTY 16384
+#endif
+
+namespace ahohs::registry {
+
+/// 一台设备的元数据（写库时使用）
+struct DeviceRecord {
+    std::string device_id;
+    std::string meta;  // JSON 文本
+};
+
+/**
+ * 设备表的持久化接口
+ *
+ * 登记表只依赖该接口，便于在基准测试中替换为空实现。
+ * 各方法只由登记表的刷新线程（或启动时的 load()）调用，无需线程安全。
+ */
+class DevicePersistence {
+ public:
+    virtual ~DevicePersistence() = default;
+    /// 逐行回调已持久化的全部设备，查询失败返回 false
+    virtual bool load(const std::function<void(std::string_view device_id, std::string_view meta)>& row) = 0;
+    /// 在单个事务内 upsert 一批设备
+    virtual bool upsert(const std::vector<DeviceRecord>& devices) = 0;
+    /// 在单个事务内删除一批设备
+    virtual bool remove(const std::vector<std::string>& device_ids) = 0;
+};
+
+/**
+ * 以 PostgreSQL devices 表持久化
+ *
+ * 使用预处理语句 get_all_devices / upsert_device_meta / delete_device，需事先注册；每次读写前经
+ * PostgresDB::ensure_connected() 确认连接可用，数据库重启后自动重连并恢复预处理语句；
+ * db 应为登记表独占的连接（pqxx::connection 不是线程安全的）。
+ */
+class PostgresDevicePersistence : public DevicePersistence {
+ public:
+    explicit PostgresDevicePersistence(ahohs::db::PostgresDB& db) : db(db) {}
+
+    bool load(const std::function<void(std::string_view device_id, std::string_view meta)>& row) override;
+    bool upsert(const std::vector<DeviceRecord>& devices) override;
+    bool remove(const std::vector<std::string>& device_ids) override;
+
+ private:
+    ahohs::db::PostgresDB& db;
+};
+
+/// 登记表计数，均为单调递增
+struct RegistryStats {
+    std::atomic<uint64_t> writes{0};     // put / remove 调用次数
+    std::atomic<uint64_t> coalesced{0};  // 写库前被同一设备的后续修改覆盖
+    std::atomic<uint64_t> rejected{0};   // 脏集已满而拒绝的修改
+    std::atomic<uint64_t> flushed{0};    // 已写库的设备数（upsert 与删除）
+    std::atomic<uint64_t> failed{0};     // 写库失败的刷新轮次，脏项留待下一轮重试
+};
+
+/**
+ * 内存中的设备登记表（devices 表的权威副本）
+ *
+ * 启动时 load() 载入 devices 表，此后 HTTP 与 MQTT 的所有读取都由内存提供，
+ * 修改立即生效并记入脏集，由后台线程每 flush_interval 批量写库（write-behind），
+ * 数据库只承担持久化：
+ * - 同一设备在两次刷新之间的多次修改合并为一次写入（最后一次为准，删除也参与合并）。
+ * - 脏集以设备计，超过 max_dirty 时拒绝新设备的修改（已在脏集中的设备仍可合并），
+ *   调用方按写库失败处理；数据库长时间不可用时内存占用因此有界。
+ * - 写库失败的脏项保留到下一轮重试，期间被新修改覆盖的以新值为准。
+ * - stop() 停止刷新线程前把剩余脏集同步写库。
+ *
+ * 设备按 device_id 存于开放寻址的扁平哈希表（线性探测，负载因子不超过 1/2），
+ * device_id 文本集中存放在分块的字符串竞技场中，查找不产生堆分配。
+ * 读多写少，整表一把读写锁。
+ */
+class DeviceRegistry {
+ public:
+    explicit DeviceRegistry(DevicePersistence& persistence,
+                            std::chrono::milliseconds flush_interval = std::chrono::milliseconds(DEVICE_REGISTRY_FLUSH_INTERVAL_MS),
+                            std::size_t max_dirty = DEVICE_REGISTRY_MAX_DIRTY);
+    ~DeviceRegistry();
+
+    DeviceRegistry(const DeviceRegistry&) = delete;
+    DeviceRegistry& operator=(const DeviceRegistry&) = delete;
+
+    /// 从持久层载入全部设备（不产生写库），应在开始服务前调用一次
+    bool load();
+
+    /// 设备的元数据文本，不存在时返回 std::nullopt
+    std::optional<std::string> get(std::string_view device_id) const;
+    bool contains(std::string_view device_id) const;
+
+    /// 持读锁逐个访问设备，fn(device_id, meta)；回调内不得修改登记表
+    template <typename F>
+    void for_each(F&& fn) const {
+        std::shared_lock<std::shared_mutex> lock(mtx);
+        for (const auto& record : records) {
+            fn(record.id, std::string_view(record.meta));
+        }
+    }
+
+    /// 全部设备的副本，只在复制期间持有读锁
+    std::vector<DeviceRecord> snapshot() const;
+
+    /// 新增或更新设备，立即可见；脏集已满时返回 false 且不修改
+    bool put(std::string_view device_id, std::string meta);
+    /// 删除设备，立即可见；脏集已满时返回 false 且不修改
+    bool remove(std::string_view device_id);
+
+    /// 停止刷新线程，并把剩余脏集同步写库
+    void stop();
+
+    std::size_t size() const;
+    std::size_t dirty() const;
+    const RegistryStats& stats() const { return counters; }
+
+ private:
+    /// 分块的只追加字符串存储，块地址稳定
+    class StringArena {
+     public:
+        std::string_view store(std::string_view s);
+        std::size_t allocated() const { return n_allocated; }
+
+     private:
+        static constexpr std::size_t BLOCK_SIZE = 16384;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        std::size_t block_used = BLOCK_SIZE;
+        std::size_t n_allocated = 0;
+    };
+
+    struct Record {
+        std::string_view id;  // 指向 ids
+        std::string meta;
+        uint64_t hash;
+    };
+
+    /// 脏集中一台设备待写库的最终状态
+    struct Pending {
+        bool removed = false;
+        std::string meta;
+    };
+
+    DevicePersistence& persistence;
+    std::chrono::milliseconds flush_interval;
+    std::size_t max_dirty;
+    RegistryStats counters;
+
+    mutable std::shared_mutex mtx;
+    std::vector<Record> records;  // 紧凑存放，删除时以末尾元素填补
+    std::vector<uint32_t> slots;  // 开放寻址表，值为 records 下标 + 1，0 表示空槽；容量为 2 的幂
+    StringArena ids;
+    std::size_t id_bytes = 0;     // 存活设备的 device_id 总长度，竞技场空洞过多时据此压缩
+
+    mutable std::mutex dirty_mtx;  // 锁顺序：mtx -> dirty_mtx
+    std::condition_variable cv;
+    state::StringMap<Pending> pending;
+    bool flush_requested = false;  // 脏集达到 max_dirty 的一半，提前刷新
+    bool stopping = false;
+    std::thread worker;
+
+    static uint64_t hash_of(std::string_view device_id);
+    std::optional<std::size_t> find_slot(std::string_view device_id, uint64_t hash) const;
+    void insert(std::string_view device_id, uint64_t hash, std::string meta);
+    void erase_at(std::size_t slot);
+    void rehash(std::size_t capacity);
+    void compact_ids();
+    bool mark_dirty(std::string_view device_id, Pending change);
+
+    void run();
+    void flush(state::StringMap<Pending>& batch);
+
+    inline static std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("device_registry");
+};
+
+}  // namespace ahohs::registry
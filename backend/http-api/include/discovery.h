@@ -0,0 +1,205 @@
+#pragma once
+
+// 局域网服务发现协议（header-only，仅依赖标准库）
+//
+// 服务端（ahohs::udp_server）与 App 端（ahohc::udp::Context）共用本文件；
+// Hi3861 固件为 C 代码，按下述格式自行编解码（见 udp_discovery.c）。
+//
+// v1：请求为文本 "AHOH_DISCOVER_SERVER"（可带结尾 '\0'），回复为 JSON：
+//     {"server_ip":"..", "server_port":"..", "mqtt_broker_ip":"..", "mqtt_broker_port":".."}
+// v2：定长二进制，多字节字段均为网络字节序。
+//     请求 DISCOVER（12 字节）：
+//         magic "AHOH" | version u8 = 2 | type u8 = 1 | flags u16 = 0 | nonce u32
+//     回复 OFFER（26 字节 + server_id）：
+//         magic "AHOH" | version u8 = 2 | type u8 = 2 | flags u16 | nonce u32（原样回显请求）
+//         | http_ip[4] | http_port u16 | mqtt_ip[4] | mqtt_port u16
+//         | schemas u8 | server_id_len u8 | server_id[server_id_len]
+//     IP 为 0.0.0.0 表示与回复报文的来源地址相同。
+//     v1 请求第 5 个字节是 '_'，v2 是版本号，服务端据此区分两种请求。
+// 请求可发往 MULTICAST_GROUP 或广播地址，端口均为 PORT；服务端同时应答两种版本。
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace ahoh::discovery {
+
+inline constexpr uint16_t PORT = 8888;
+inline constexpr std::string_view MULTICAST_GROUP = "239.255.88.88";
+inline constexpr std::string_view V1_REQUEST = "AHOH_DISCOVER_SERVER";
+
+inline constexpr std::string_view MAGIC = "AHOH";
+inline constexpr uint8_t VERSION = 2;
+
+enum class MessageType : uint8_t {
+    Discover = 1,
+    Offer = 2,
+};
+
+/// OFFER.flags
+enum OfferFlags : uint16_t {
+    HTTP_TLS = 1u << 0,
+    MQTT_TLS = 1u << 1,
+};
+
+/// OFFER.schemas：服务端接受的属性负载编码（元数据 attrib_schema，按位）
+enum SchemaVersions : uint8_t {
+    SCHEMA_V1 = 1u << 0,  // JSON
+    SCHEMA_V2 = 1u << 1,  // 定长二进制
+};
+
+inline constexpr std::size_t REQUEST_SIZE = 12;
+inline constexpr std::size_t OFFER_HEADER_SIZE = 26;
+inline constexpr std::size_t MAX_SERVER_ID = 32;
+inline constexpr std::size_t MAX_OFFER_SIZE = OFFER_HEADER_SIZE + MAX_SERVER_ID;
+
+using Ipv4 = std::array<uint8_t, 4>;
+
+struct Offer {
+    uint32_t nonce = 0;
+    uint16_t flags = 0;
+    Ipv4 http_ip{};
+    uint16_t http_port = 0;
+    Ipv4 mqtt_ip{};
+    uint16_t mqtt_port = 0;
+    uint8_t schemas = SCHEMA_V1;
+    std::string server_id;  // 超过 MAX_SERVER_ID 的部分编码时被截断
+};
+
+namespace detail {
+
+inline void put_u16(std::string& out, uint16_t v) {
+    out.push_back(static_cast<char>(v >> 8));
+    out.push_back(static_cast<char>(v & 0xff));
+}
+
+inline void put_u32(std::string& out, uint32_t v) {
+    put_u16(out, static_cast<uint16_t>(v >> 16));
+    put_u16(out, static_cast<uint16_t>(v & 0xffff));
+}
+
+inline uint8_t u8(std::string_view in, std::size_t at) {
+    return static_cast<uint8_t>(in[at]);
+}
+
+inline uint16_t u16(std::string_view in, std::size_t at) {
+    return static_cast<uint16_t>(u8(in, at) << 8 | u8(in, at + 1));
+}
+
+inline uint32_t u32(std::string_view in, std::size_t at) {
+    return static_cast<uint32_t>(u16(in, at)) << 16 | u16(in, at + 2);
+}
+
+inline void put_header(std::string& out, MessageType type, uint16_t flags, uint32_t nonce) {
+    out.append(MAGIC);
+    out.push_back(static_cast<char>(VERSION));
+    out.push_back(static_cast<char>(type));
+    put_u16(out, flags);
+    put_u32(out, nonce);
+}
+
+/// 校验 magic 与类型；版本号大于 2 的报文按 v2 的前缀解析，便于以后在末尾追加字段
+inline bool check_header(std::string_view in, MessageType type, std::size_t min_size) {
+    return in.size() >= min_size && in.substr(0, MAGIC.size()) == MAGIC &&
+           u8(in, 4) >= VERSION && u8(in, 5) == static_cast<uint8_t>(type);
+}
+
+}  // namespace detail
+
+/// v1 请求（文本）还是 v2 请求（二进制）：只看第 5 个字节，调用前需已确认是发现请求
+inline bool is_v1_request(std::string_view msg) {
+    return msg.size() > MAGIC.size() && msg[MAGIC.size()] == '_';
+}
+
+inline std::string encode_request(uint32_t nonce) {
+    std::string out;
+    out.reserve(REQUEST_SIZE);
+    detail::put_header(out, MessageType::Discover, 0, nonce);
+    return out;
+}
+
+/// 解析 v2 请求，返回 nonce；不是 v2 请求时返回空
+inline std::optional<uint32_t> decode_request(std::string_view msg) {
+    if (!detail::check_header(msg, MessageType::Discover, REQUEST_SIZE)) {
+        return std::nullopt;
+    }
+    return detail::u32(msg, 8);
+}
+
+inline std::string encode_offer(const Offer& offer) {
+    const std::string_view id = std::string_view(offer.server_id).substr(0, MAX_SERVER_ID);
+    std::string out;
+    out.reserve(OFFER_HEADER_SIZE + id.size());
+    detail::put_header(out, MessageType::Offer, offer.flags, offer.nonce);
+    out.append(offer.http_ip.begin(), offer.http_ip.end());
+    detail::put_u16(out, offer.http_port);
+    out.append(offer.mqtt_ip.begin(), offer.mqtt_ip.end());
+    detail::put_u16(out, offer.mqtt_port);
+    out.push_back(static_cast<char>(offer.schemas));
+    out.push_back(static_cast<char>(id.size()));
+    out.append(id);
+    return out;
+}
+
+inline std::optional<Offer> decode_offer(std::string_view msg) {
+    if (!detail::check_header(msg, MessageType::Offer, OFFER_HEADER_SIZE)) {
+        return std::nullopt;
+    }
+    const std::size_t id_len = detail::u8(msg, 25);
+    if (msg.size() < OFFER_HEADER_SIZE + id_len) {
+        return std::nullopt;
+    }
+    Offer offer;
+    offer.flags = detail::u16(msg, 6);
+    offer.nonce = detail::u32(msg, 8);
+    for (std::size_t i = 0; i < 4; ++i) {
+        offer.http_ip[i] = detail::u8(msg, 12 + i);
+        offer.mqtt_ip[i] = detail::u8(msg, 18 + i);
+    }
+    offer.http_port = detail::u16(msg, 16);
+    offer.mqtt_port = detail::u16(msg, 22);
+    offer.schemas = detail::u8(msg, 24);
+    offer.server_id = std::string(msg.substr(OFFER_HEADER_SIZE, id_len));
+    return offer;
+}
+
+/// 解析点分十进制 IPv4 地址；主机名等其他形式返回空
+inline std::optional<Ipv4> parse_ipv4(std::string_view text) {
+    Ipv4 ip{};
+    const char* p = text.data();
+    const char* end = text.data() + text.size();
+    for (std::size_t i = 0; i < ip.size(); ++i) {
+        if (i > 0) {
+            if (p == end || *p != '.') {
+                return std::nullopt;
+            }
+            ++p;
+        }
+        unsigned octet = 0;
+        auto [next, ec] = std::from_chars(p, end, octet);
+        if (ec != std::errc() || next == p || next - p > 3 || octet > 255) {
+            return std::nullopt;
+        }
+        ip[i] = static_cast<uint8_t>(octet);
+        p = next;
+    }
+    if (p != end) {
+        return std::nullopt;
+    }
+    return ip;
+}
+
+inline std::string format_ipv4(const Ipv4& ip) {
+    return std::to_string(ip[0]) + '.' + std::to_string(ip[1]) + '.' + std::to_string(ip[2]) + '.' +
+           std::to_string(ip[3]);
+}
+
+inline bool is_unspecified(const Ipv4& ip) {
+    return ip == Ipv4{};
+}
+
+}  // namespace ahoh::discovery
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 #include <crow.h>
 #include <nlohmann/json.hpp>
 #include "db.h"
+#include "device_registry.h"
+#include "scheduler.h"
+#include "series.h"
 
 namespace ahohs::http_server {
 
@@ -13,7 +18,8 @@ using json = nlohmann::json;
 
 class HttpServer {
  public:
-    explicit HttpServer(ahohs::db::PostgresDB& database);
+    /// 设备接口读写 devices（由其异步写库），定时任务接口直接读写 database
+    HttpServer(ahohs::db::PostgresDB& database, ahohs::registry::DeviceRegistry& devices);
 
     HttpServer(const HttpServer&) = delete;
     HttpServer& operator=(const HttpServer&) = delete;
@@ -21,10 +27,38 @@ class HttpServer {
     HttpServer& operator=(HttpServer&&) noexcept = default;
     ~HttpServer() = default;
 
-    void run(uint16_t port = 18080);
+    /**
+     * 运行 Crow 事件循环直到 stop()
+     *
+     * Crow 的 Server 自行创建 io_context 与线程，无法接入共享事件循环，
+     * 因此只把线程数与之对齐；n_threads 为 0 时取 CPU 核数。
+     */
+    void run(uint16_t port = 18080, std::size_t n_threads = 0);
+    /// 停止 run() 中的 Crow 事件循环，可在任意线程调用
+    void stop();
+
+    /// 设备元数据写入登记表后的回调，用于同步心跳间隔等运行期状态
+    using MetaListener = std::function<void(const std::string& device_id, const json& meta)>;
+    void set_meta_listener(MetaListener listener);
+
+    /// 设备从登记表删除后的回调
+    using DeleteListener = std::function<void(const std::string& device_id)>;
+    void set_delete_listener(DeleteListener listener);
+
+    /// 定时任务增删在写库成功后同步到调度器；未设置时定时任务接口只读写数据库
+    void set_scheduler(ahohs::scheduler::Scheduler& scheduler);
+
+    /// 历史查询优先由内存时序存储给出；未设置或不能完整覆盖查询区间时查库
+    void set_series_store(ahohs::series::SeriesStore& store);
 
  private:
     ahohs::db::PostgresDB& database;  // 通过依赖注入 (DI) 的数据库实例
+    ahohs::registry::DeviceRegistry& devices;
+    MetaListener meta_listener;
+    DeleteListener delete_listener;
+    ahohs::scheduler::Scheduler* scheduler = nullptr;
+    ahohs::series::SeriesStore* series_store = nullptr;
+    crow::App<> app;
 
     void setup_routes(crow::App<>& app);
 
@@ -34,6 +68,10 @@ class HttpServer {
     crow::response handle_create_or_update_device(const crow::request& req);  // 新增/更新设备：POST /device
     crow::response handle_update_device(const crow::request& req, const std::string& device_id); // 更新设备信息：PUT /device/<device_id>
     crow::response handle_delete_device(const std::string& device_id); // 删除设备：DELETE /device/<device_id>
+    crow::response handle_get_device_history(const crow::request& req, const std::string& device_id); // 属性历史：GET /device/<device_id>/history
+    crow::response handle_get_schedules();                            // 查询所有定时任务：GET /schedules
+    crow::response handle_create_or_update_schedule(const crow::request& req);  // 新增/更新定时任务：POST /schedule
+    crow::response handle_delete_schedule(const std::string& schedule_id);     // 删除定时任务：DELETE /schedule/<id>
 };
 
 }  // namespace ahohs::http_server
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "attrib_codec.h"
+#include "dedup.h"
+#include "liveness.h"
+#include "ring_buffer.h"
+#include "runtime.h"
+#include "state_store.h"
+#include "telemetry.h"
+
+// 每个分片的队列容量（向上取整为 2 的幂）
+#ifndef INGEST_QUEUE_CAPACITY
+#define INGEST_QUEUE_CAPACITY 16384
+#endif
+
+// 摄取工作线程（分片）数量，0 表示取 std::thread::hardware_concurrency()
+#ifndef INGEST_WORKERS
+#define INGEST_WORKERS 0
+#endif
+
+// 摄取前按 topic 去除 QoS 1 / 2 重投的重复消息（见 dedup.h）
+#ifndef INGEST_DEDUP
+#define INGEST_DEDUP 1
+#endif
+
+// 共享事件循环下每个排空任务最多处理的消息数，用完后重新投递，让出线程给其他分片与任务
+#ifndef INGEST_DRAIN_BUDGET
+#define INGEST_DRAIN_BUDGET 256
+#endif
+
+#ifndef INGEST_OVERFLOW_POLICY
+#define INGEST_OVERFLOW_POLICY ahohs::ingest::OverflowPolicy::DropNewest
+#endif
+
+namespace ahohs::ingest {
+
+using Clock = std::chrono::system_clock;
+
+/// 设备 topic 的种类，对应 mqtt_fake_code.md 中的 /device/{device_id}/ 子树
+enum class TopicKind {
+    Attrib,       // /device/{id}/attrib/{name}
+    AttribBatch,  // /device/{id}/attrib，一条消息携带多个属性
+    Heartbeat,    // /device/{id}/heartbeat
+    Meta,         // /device/{id}/meta
+    Will,         // /device/{id}/will
+    Unknown,
+};
+
+/// topic 解析结果，所有字段都是原 topic 的切片，不持有内存
+struct TopicInfo {
+    TopicKind kind = TopicKind::Unknown;
+    std::string_view device_id;
+    std::string_view attrib;  // 仅 Attrib 有效，带前导 '/'，与元数据中的 attrib.topic 一致
+};
+
+/// 解析设备 topic（基于 topic_router.h 的预编译前缀树），不产生堆分配
+TopicInfo classify_topic(std::string_view topic);
+
+/// 解析属性负载 {"value":x}，格式不符时返回 std::nullopt；先走快速路径，不认识的形式回退到完整解析
+std::optional<telemetry::AttribValue> parse_attrib_payload(std::string_view payload);
+
+/**
+ * 属性负载快速路径
+ *
+ * 只识别固件实际发送的形式：{"value":数字 | true | false | null}，其后可带去重序号 ,"seq":n（允许空白），
+ * 数字按 JSON 语法校验后用 std::from_chars 转换，不产生堆分配。
+ * 返回 std::nullopt 只表示不是该形式（如字符串值、多余字段），不代表负载非法。
+ */
+std::optional<telemetry::AttribValue> parse_attrib_payload_fast(std::string_view payload);
+
+/// 属性负载完整解析（nlohmann），接受任意 JSON 对象中的 value 字段
+std::optional<telemetry::AttribValue> parse_attrib_payload_json(std::string_view payload);
+
+/// 摄取计数，均为单调递增
+struct IngestStats {
+    std::atomic<uint64_t> attrib{0};
+    std::atomic<uint64_t> heartbeat{0};
+    std::atomic<uint64_t> meta{0};
+    std::atomic<uint64_t> will{0};
+    std::atomic<uint64_t> unknown{0};
+    std::atomic<uint64_t> malformed{0};
+    std::atomic<uint64_t> slow_path{0};   // 未命中快速路径、回退到完整解析的属性负载
+};
+
+/**
+ * 单条消息的处理逻辑
+ *
+ * 负责 topic 分类、负载解析，并把结果写入最新值存储与遥测输出；心跳转交存活跟踪器。
+ * 本身不持有线程，可被任意工作线程调用。
+ */
+class Ingestor {
+ public:
+    Ingestor(state::DeviceStateStore& store,
+             telemetry::TelemetrySink& sink,
+             liveness::LivenessTracker& liveness);
+
+    Ingestor(const Ingestor&) = delete;
+    Ingestor& operator=(const Ingestor&) = delete;
+
+    void ingest(std::string_view topic, std::string_view payload, Clock::time_point received_at);
+
+    /// 元数据消息处理函数，负载格式不符时返回 false；需在摄取流水线启动前设置
+    using MetaHandler = std::function<bool(std::string_view device_id, std::string_view payload)>;
+    void set_meta_handler(MetaHandler handler);
+
+    /// 属性值写入最新值存储后的回调（如规则引擎）；需在摄取流水线启动前设置
+    using AttribListener = std::function<void(std::string_view device_id, std::string_view attrib,
+                                              const telemetry::AttribValue& value)>;
+    void set_attrib_listener(AttribListener listener);
+
+    /// 按设备选择属性负载的解码方式（attrib_schema v1 / v2）；未设置时所有设备按 v1 处理
+    void set_schema_registry(const codec::SchemaRegistry& registry);
+
+    const IngestStats& stats() const { return counters; }
+
+ private:
+    state::DeviceStateStore& store;
+    telemetry::TelemetrySink& sink;
+    liveness::LivenessTracker& liveness;
+    MetaHandler meta_handler;
+    AttribListener attrib_listener;
+    const codec::SchemaRegistry* schemas = nullptr;
+    IngestStats counters;
+
+    std::shared_ptr<const codec::DeviceSchema> schema_for(std::string_view device_id) const;
+    void handle_attrib(const TopicInfo& info, std::string_view payload, Clock::time_point ts);
+    void handle_attrib_batch(const TopicInfo& info, std::string_view payload, Clock::time_point ts);
+    void apply_attrib(std::string_view device_id, std::string_view attrib,
+                      telemetry::AttribValue value, Clock::time_point ts);
+
+    inline static std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("ingestor");
+};
+
+/// 从 paho 回调线程投递过来的原始消息
+struct RawMessage {
+    std::string topic;
+    std::string payload;
+    Clock::time_point received_at;
+    bool redelivered = false;  // broker 设置了 DUP 标志
+};
+
+/// 分片队列满时的处理策略
+enum class OverflowPolicy {
+    DropNewest,  // 丢弃新到的消息（默认，回调线程零等待）
+    DropOldest,  // 挤掉队首最旧的消息，保留最新数据
+    Block,       // 回调线程让出 CPU 等待空位，不丢消息但会反压 broker 连接
+};
+
+/// 单个分片的队列指标
+struct ShardMetrics {
+    std::size_t depth = 0;           // 当前积压
+    std::size_t capacity = 0;
+    std::size_t high_watermark = 0;  // 历史最大积压
+    uint64_t enqueued = 0;
+    uint64_t processed = 0;
+    uint64_t dropped_newest = 0;
+    uint64_t dropped_oldest = 0;
+    uint64_t blocked = 0;            // Block 策略下发生等待的次数
+    uint64_t duplicates_seq = 0;     // 按序号判定的重复消息
+    uint64_t duplicates_hash = 0;    // 按重投标志 + 负载摘要判定的重复消息
+};
+
+/**
+ * 摄取流水线
+ *
+ * 按 device_id 哈希分成 n_workers 个分片，每个分片是一个无锁有界环形队列，
+ * 由专属工作线程消费，因此同一设备的消息始终按到达顺序处理。
+ * paho 回调线程调用 submit 时只做一次 topic 切片与一次 CAS 入队，不加锁、不阻塞
+ * （Block 策略除外）。工作线程空闲时通过 std::atomic::wait 休眠，不会忙等。
+ *
+ * 也可以运行在共享事件循环上：分片没有专属线程，队列由空变为非空时投递一个排空任务，
+ * 同一分片同一时刻最多一个排空任务，因此顺序保证不变。
+ */
+class IngestPipeline {
+ public:
+    IngestPipeline(Ingestor& ingestor,
+                   std::size_t n_workers = INGEST_WORKERS,
+                   std::size_t capacity = INGEST_QUEUE_CAPACITY,
+                   OverflowPolicy policy = INGEST_OVERFLOW_POLICY);
+    /// 在共享事件循环上运行；n_shards 为 0 时取事件循环线程数。runtime 必须在 stop() 之后才停止
+    IngestPipeline(Ingestor& ingestor,
+                   runtime::Runtime& runtime,
+                   std::size_t n_shards = INGEST_WORKERS,
+                   std::size_t capacity = INGEST_QUEUE_CAPACITY,
+                   OverflowPolicy policy = INGEST_OVERFLOW_POLICY);
+    ~IngestPipeline();
+
+    IngestPipeline(const IngestPipeline&) = delete;
+    IngestPipeline& operator=(const IngestPipeline&) = delete;
+
+    bool submit(RawMessage&& msg);  // 消息被接受时返回 true
+    void stop();                    // 处理完队列中剩余消息后停止所有工作线程
+
+    std::size_t shard_count() const { return n_shards; }
+    std::vector<ShardMetrics> metrics() const;
+    uint64_t dropped() const;
+    uint64_t duplicates() const;
+
+ private:
+    struct alignas(64) Shard {
+        explicit Shard(std::size_t capacity) : ring(capacity) {}
+
+        util::BoundedRing<RawMessage> ring;
+        std::atomic<uint32_t> signal{0};     // 唤醒序号，配合 atomic::wait 使用
+        std::atomic<bool> sleeping{false};
+        std::atomic<bool> scheduled{false};  // 共享事件循环下：已投递或正在执行排空任务
+        std::atomic<std::size_t> high_watermark{0};
+        std::atomic<uint64_t> enqueued{0};
+        std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> dropped_newest{0};
+        std::atomic<uint64_t> dropped_oldest{0};
+        std::atomic<uint64_t> blocked{0};
+        std::atomic<uint64_t> duplicates_seq{0};
+        std::atomic<uint64_t> duplicates_hash{0};
+        Deduplicator dedup;                  // 只由本分片的工作线程访问
+        std::thread worker;
+    };
+
+    Ingestor& ingestor;
+    runtime::Runtime* runtime = nullptr;  // 为空时每个分片一个工作线程
+    OverflowPolicy policy;
+    std::size_t n_shards;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<bool> stopping{false};
+    std::atomic<uint32_t> drained{0};  // 停止期间每个排空任务结束时递增，stop() 在其上等待
+
+    void create_shards(std::size_t capacity);
+    Shard& shard_for(std::string_view topic) const;
+    /// 唤醒分片的工作线程；共享事件循环下改为投递排空任务（已投递时不重复投递）
+    void wake(Shard& shard);
+    void process(Shard& shard, RawMessage& msg);
+    void run(Shard& shard);
+    void drain(Shard& shard);
+
+    inline static std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("ingest_pipeline");
+};
+
+}  // namespace ahohs::ingest
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+namespace ahohs::lifecycle {
+
+/**
+ * 进程生命周期控制器
+ *
+ * 各服务共享同一个实例：阻塞型循环通过 wait() / wait_for() 等待停止请求，
+ * 基于 poll 的循环可以监听 event_fd()（请求停止后一直可读）。
+ * request_stop() 只生效一次，之后所有等待者同时被唤醒。
+ */
+class Lifecycle {
+ public:
+    Lifecycle();
+    ~Lifecycle();
+
+    Lifecycle(const Lifecycle&) = delete;
+    Lifecycle& operator=(const Lifecycle&) = delete;
+
+    /**
+     * 由专用线程同步接收 SIGTERM / SIGINT 并转为 request_stop()
+     *
+     * 必须在主线程创建其他线程之前调用，新线程会继承对这两个信号的屏蔽；
+     * 停止过程中再次收到信号时立即退出进程。
+     */
+    void install_signal_handler();
+
+    void request_stop();
+    bool stop_requested() const { return stopping.load(std::memory_order_acquire); }
+
+    /// 阻塞直到请求停止
+    void wait() const;
+    /// 最多等待 timeout，返回是否已请求停止
+    bool wait_for(std::chrono::milliseconds timeout) const;
+
+    /// 请求停止后可读的 eventfd
+    int event_fd() const { return efd; }
+
+ private:
+    std::atomic<bool> stopping{false};
+    mutable std::mutex mtx;
+    mutable std::condition_variable cv;
+    int efd = -1;
+    std::thread signal_thread;
+    std::atomic<bool> signal_thread_exiting{false};
+
+    inline static std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("lifecycle");
+};
+
+}  // namespace ahohs::lifecycle
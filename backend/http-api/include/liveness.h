@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "runtime.h"
+#include "state_store.h"
+#include "telemetry.h"
+#include "timing_wheel.h"
+
+// 元数据中未声明 heartbeat_interval 时使用的默认心跳间隔（秒），与固件和 mqtt_dummy.py 一致
+#ifndef HEARTBEAT_DEFAULT_INTERVAL_S
+#define HEARTBEAT_DEFAULT_INTERVAL_S 30
+#endif
+
+// 超过 心跳间隔 × 该倍数 未收到心跳即判定离线
+#ifndef HEARTBEAT_TIMEOUT_FACTOR
+#define HEARTBEAT_TIMEOUT_FACTOR 2
+#endif
+
+#ifndef HEARTBEAT_WHEEL_TICK_MS
+#define HEARTBEAT_WHEEL_TICK_MS 500
+#endif
+
+namespace ahohs::liveness {
+
+/**
+ * 设备在线状态跟踪器
+ *
+ * 每个设备在分层时间轮上只占一个定时器，到期时间为 最近心跳 + HEARTBEAT_TIMEOUT_FACTOR × 心跳间隔；
+ * 每次心跳只做一次 O(1) 的重新 arm，不为设备创建定时器线程。
+ * 单个后台线程（或共享事件循环上的定时器）按 tick 推进时间轮，到期即判定离线。
+ *
+ * 遗嘱消息（/device/{id}/will）视为立即离线。
+ *
+ * 上线 / 离线状态变化会同时写入最新值存储（DeviceState::online）
+ * 与遥测输出（device_events 表，事件类型 "online" / "offline"）。
+ */
+class LivenessTracker {
+ public:
+    using SteadyClock = util::TimingWheel::Clock;
+
+    LivenessTracker(state::DeviceStateStore& store,
+                    telemetry::TelemetrySink& sink,
+                    std::chrono::milliseconds tick = std::chrono::milliseconds(HEARTBEAT_WHEEL_TICK_MS));
+    /// 由共享事件循环上的定时器推进时间轮，不创建后台线程
+    LivenessTracker(state::DeviceStateStore& store,
+                    telemetry::TelemetrySink& sink,
+                    runtime::Runtime& runtime,
+                    std::chrono::milliseconds tick = std::chrono::milliseconds(HEARTBEAT_WHEEL_TICK_MS));
+    ~LivenessTracker();
+
+    LivenessTracker(const LivenessTracker&) = delete;
+    LivenessTracker& operator=(const LivenessTracker&) = delete;
+
+    /// 设置设备的心跳间隔（来自元数据 heartbeat_interval）
+    void set_interval(std::string_view device_id, std::chrono::seconds interval);
+
+    /// 收到心跳：重新 arm 该设备的超时定时器，必要时产生上线事件
+    void on_heartbeat(std::string_view device_id, state::Clock::time_point ts);
+
+    /// 收到遗嘱消息：立即判定离线并取消超时定时器
+    void on_will(std::string_view device_id, std::string_view payload, state::Clock::time_point ts);
+
+    /// 推进时间轮并处理超时设备；后台线程周期调用，基准测试中也可直接调用
+    void advance(SteadyClock::time_point now);
+
+    void stop();
+
+    std::size_t tracked() const;
+    std::size_t online_count() const;
+
+ private:
+    struct Entry {
+        util::TimingWheel::TimerId timer = util::TimingWheel::INVALID_TIMER;
+        std::chrono::seconds interval{HEARTBEAT_DEFAULT_INTERVAL_S};
+        SteadyClock::time_point last_heartbeat{};
+        bool online = false;
+    };
+
+    state::DeviceStateStore& store;
+    telemetry::TelemetrySink& sink;
+    std::chrono::milliseconds tick;
+
+    mutable std::mutex mtx;
+    util::TimingWheel wheel;
+    state::StringMap<Entry> devices;
+    std::vector<state::StringMap<Entry>::value_type*> timer_owners;  // TimerId -> devices 中的节点（节点地址稳定）
+    std::size_t n_online = 0;
+
+    std::condition_variable cv;
+    bool stopping = false;
+    std::thread ticker;
+    std::unique_ptr<runtime::Timer> timer;  // 共享事件循环下代替 ticker
+    SteadyClock::time_point next_tick;      // 只由 timer 的回调访问
+
+    Entry& get_or_create(std::string_view device_id);
+    void publish(std::string_view device_id, bool online, std::string detail, state::Clock::time_point ts);
+    void run();
+    void on_tick();
+
+    inline static std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("liveness");
+};
+
+}  // namespace ahohs::liveness
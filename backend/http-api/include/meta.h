@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "device_registry.h"
+#include "state_store.h"
+
+namespace ahohs::meta {
+
+using json = nlohmann::json;
+
+/// 元数据计数，均为单调递增
+struct MetaStats {
+    std::atomic<uint64_t> received{0};
+    std::atomic<uint64_t> unchanged{0};  // 与已知内容相同，未写入登记表
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> malformed{0};
+    std::atomic<uint64_t> failed{0};     // 登记表拒绝（脏集已满）
+};
+
+/**
+ * 设备元数据登记表（MQTT 上报路径）
+ *
+ * 对每个设备保存其元数据规范化文本（键有序、无多余空白）的摘要。
+ * 收到元数据时先比较摘要，只有内容真正变化时才写入设备登记表（由其合并后写库），
+ * 因此设备批量重启、重复发送相同元数据不会产生数据库写入。
+ *
+ * 启动时应以登记表中已有的元数据 prime()，HTTP 接口修改 / 删除设备后也需同步摘要。
+ */
+class MetaRegistry {
+ public:
+    enum class Result { Unchanged, Written, Malformed, Failed };
+
+    /// 元数据写入登记表后的回调，用于同步心跳间隔等运行期状态
+    using Listener = std::function<void(const std::string& device_id, const json& meta)>;
+
+    explicit MetaRegistry(ahohs::registry::DeviceRegistry& devices);
+
+    MetaRegistry(const MetaRegistry&) = delete;
+    MetaRegistry& operator=(const MetaRegistry&) = delete;
+
+    void set_listener(Listener listener);
+
+    /// 处理一条 MQTT 元数据消息，可被多个摄取线程并发调用
+    Result update(std::string_view device_id, std::string_view payload);
+
+    /// 记录设备当前的元数据（不写入登记表）
+    void prime(std::string_view device_id, const json& meta);
+    /// 设备被删除后丢弃其摘要，下次上报会重新写入
+    void forget(std::string_view device_id);
+
+    const MetaStats& stats() const { return counters; }
+
+    /// 规范化文本的摘要
+    static uint64_t digest(const json& meta);
+
+ private:
+    ahohs::registry::DeviceRegistry& devices;
+    Listener listener;
+    MetaStats counters;
+
+    std::mutex mtx;
+    state::StringMap<uint64_t> digests;  // device_id -> 摘要
+
+    inline static std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("meta_registry");
+};
+
+}  // namespace ahohs::meta
@@ -6,10 +6,15 @@
 #include <functional>
 #include <thread>
 #include <chrono>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <random>
 #include <mqtt/async_client.h>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
-#include "db.h"
+#include "ingest.h"
+#include "outbound_buffer.h"
 
 #ifndef MQTT_CLIENT_ID
 #define MQTT_CLIENT_ID "paho_cpp_demo_client"
@@ -23,21 +28,113 @@
 #define MQTT_QOS 1
 #endif
 
-#ifndef MQTT_N_RETRY_ATTEMPTS
-#define MQTT_N_RETRY_ATTEMPTS 5
+// 摄取客户端数量；每个客户端一条连接、一个回调线程，客户端 ID 为 MQTT_CLIENT_ID-<序号>
+#ifndef MQTT_INGEST_CLIENTS
+#define MQTT_INGEST_CLIENTS 1
+#endif
+
+// 多客户端时优先使用 MQTT v5 共享订阅（$share/<组名>/<topic>），由 broker 在组内分发消息
+#ifndef MQTT_SHARED_SUBSCRIPTION
+#define MQTT_SHARED_SUBSCRIPTION 1
+#endif
+
+#ifndef MQTT_SHARE_GROUP
+#define MQTT_SHARE_GROUP "ahoh"
+#endif
+
+// broker 不支持共享订阅时，按以下主题分区轮流分配给各客户端（同一分区只由一个客户端订阅）。
+// 注意该回退方案不能扩展属性摄取：MQTT 通配符只能匹配整段，无法按 device_id 哈希或前缀拆分订阅，
+// 占绝大部分流量的属性消息（/device/+/attrib/#）仍全部落在同一个客户端上，多于分区数的客户端则空闲。
+// 它只把心跳 / 元数据 / 遗嘱从属性客户端的回调线程中分出去；需要多客户端扩展时应使用支持 MQTT v5 共享订阅的 broker
+#ifndef MQTT_PARTITION_TOPICS
+#define MQTT_PARTITION_TOPICS {"/device/+/attrib/#", "/device/+/heartbeat", "/device/+/meta", "/device/+/will"}
+#endif
+
+// 持久会话（clean_session=false）：断线期间 broker 按固定客户端 ID 保留订阅与 QoS >= 1 的消息
+#ifndef MQTT_PERSISTENT_SESSION
+#define MQTT_PERSISTENT_SESSION 1
+#endif
+
+// MQTT v5 连接的会话过期时间（秒）
+#ifndef MQTT_SESSION_EXPIRY_S
+#define MQTT_SESSION_EXPIRY_S 3600
+#endif
+
+// 断线重连的指数退避：上限为 min(MAX, MIN × 2^n)，实际等待在 [上限/2, 上限] 内随机
+#ifndef MQTT_RECONNECT_MIN_MS
+#define MQTT_RECONNECT_MIN_MS 500
+#endif
+
+#ifndef MQTT_RECONNECT_MAX_MS
+#define MQTT_RECONNECT_MAX_MS 30000
+#endif
+
+// 下行消息缓冲：内存中的条数上限，超出后溢写到磁盘文件（路径为空则直接丢弃）
+#ifndef MQTT_OUTBOUND_BUFFER
+#define MQTT_OUTBOUND_BUFFER 1024
+#endif
+
+#ifndef MQTT_OUTBOUND_SPILL_PATH
+#define MQTT_OUTBOUND_SPILL_PATH "mqtt_outbound.spool"
+#endif
+
+#ifndef MQTT_OUTBOUND_SPILL_MAX_BYTES
+#define MQTT_OUTBOUND_SPILL_MAX_BYTES (64 * 1024 * 1024)
+#endif
+
+// 等待 broker 确认一条下行消息的最长时间（毫秒），超时后消息留在队首重发
+#ifndef MQTT_OUTBOUND_ACK_TIMEOUT_MS
+#define MQTT_OUTBOUND_ACK_TIMEOUT_MS 2000
 #endif
 
 namespace ahohs::mqtt_server {
 
+/// 连接与下行消息计数快照
+struct MqttStats {
+    uint64_t connection_losses = 0;
+    uint64_t reconnects = 0;                      // 断线后重新连上的次数
+    uint64_t connect_failures = 0;
+    std::chrono::milliseconds last_reconnect_time{0};  // 最近一次从断线到重新连上的耗时
+    std::chrono::milliseconds max_reconnect_time{0};
+    uint64_t outbound_published = 0;
+    uint64_t outbound_dropped = 0;                // 缓冲（含溢写文件）已满被丢弃的下行消息
+    std::size_t outbound_pending = 0;
+    std::size_t outbound_spilled = 0;
+};
+
 class MqttServer {
  public:
     MqttServer(const std::string& server_address,
                const std::string& client_id,
                const std::vector<std::string>& topics,
-               ahohs::db::PostgresDB& db);
+               ahohs::ingest::IngestPipeline& pipeline,
+               std::size_t n_clients = MQTT_INGEST_CLIENTS,
+               const std::vector<std::string>& partition_topics = MQTT_PARTITION_TOPICS);
 
-    ~MqttServer() = default;
-    void start();
+    ~MqttServer();
+
+    /// 发起所有客户端的连接（不阻塞），订阅在各自连接成功后进行
+    void connect();
+    /// 断开所有客户端
+    void disconnect();
+
+    /**
+     * 发布下行消息（如设备命令）
+     *
+     * 消息先进入有界缓冲，由后台线程经任一已连接的客户端按序发出，broker 确认送达后才出队
+     * （未确认的消息会重发，设备可能收到重复命令）；断线期间继续缓冲，内存满后溢写到
+     * MQTT_OUTBOUND_SPILL_PATH，停止时内存中未发出的消息也写入该文件，重启后继续发送。
+     *
+     * @return false 表示缓冲已满，消息被丢弃
+     */
+    bool publish(std::string topic, std::string payload, int qos = MQTT_QOS, bool retained = false);
+
+    MqttStats stats() const;
+
+    std::size_t client_count() const { return sessions.size(); }
+
+    /// 将主题分区轮流分配给 n 个客户端，第 i 个元素为第 i 个客户端订阅的主题
+    static std::vector<std::vector<std::string>> partition(const std::vector<std::string>& topics, std::size_t n);
 
     /**
      * 模板化消息处理函数
@@ -61,21 +158,62 @@ class MqttServer {
     }
 
  private:
-    mqtt::async_client client;
-    mqtt::connect_options conn_opts;
-    std::vector<std::string> topics;
-    ahohs::db::PostgresDB& db;
+    class Callback;
+
+    /**
+     * 单个摄取客户端
+     *
+     * 所有客户端共用同一条摄取流水线（多生产者），流水线按 device_id 分片，
+     * 因此同一设备的消息无论从哪个客户端到达都由同一个工作线程处理。
+     */
+    struct Session {
+        Session(const std::string& server_address, const std::string& client_id, bool v5);
+
+        mqtt::async_client client;
+        mqtt::connect_options conn_opts;
+        std::vector<std::string> partition;  // 不使用共享订阅时该客户端负责的主题
+        std::shared_ptr<Callback> callback;
+        std::atomic<bool> connected{false};
+    };
 
-    static constexpr int N_RETRYATTEMPTS = 3;
+    struct Counters {
+        std::atomic<uint64_t> connection_losses{0};
+        std::atomic<uint64_t> reconnects{0};
+        std::atomic<uint64_t> connect_failures{0};
+        std::atomic<int64_t> last_reconnect_ms{0};
+        std::atomic<int64_t> max_reconnect_ms{0};
+        std::atomic<uint64_t> outbound_published{0};
+        std::atomic<uint64_t> outbound_dropped{0};
+    };
+
+    std::vector<std::unique_ptr<Session>> sessions;
+    std::vector<std::string> topics;
+    bool shared;  // 是否请求共享订阅（仅多客户端时）
+    ahohs::ingest::IngestPipeline& pipeline;  // 收到的消息全部投递给摄取流水线
+    Counters counters;
+
+    // 下行消息缓冲，由 flusher 线程经任一已连接的客户端发出；
+    // stopping 同时用于打断回调线程中的重连等待
+    mutable std::mutex outbound_mtx;
+    std::condition_variable outbound_cv;
+    OutboundBuffer outbound;
+    bool stopping = false;
+    std::thread flusher;
+
+    void flush_outbound();
+    /// 停止 flusher 线程，并把内存中未发出的下行消息写入溢写文件
+    void stop_flusher();
+    /// 第一个已连接的客户端，全部断开时返回 nullptr
+    Session* connected_session() const;
 
     /**
      * 嵌套回调类
      *
-     * 用于处理 MQTT 的各种回调事件。
+     * 用于处理 MQTT 的各种回调事件，每个客户端一个实例。
      */
     class Callback : public mqtt::callback, public mqtt::iaction_listener {
      public:
-        explicit Callback(MqttServer& server);
+        Callback(MqttServer& server, Session& session);
 
         // mqtt::callback 的重载
         void connected(const std::string& cause) override;
@@ -88,14 +226,18 @@ class MqttServer {
         void on_success(const mqtt::token& token) override;
 
      private:
-        void reconnect();  // 断线重连
+        void reconnect();  // 按指数退避加随机抖动等待后重连，不会放弃
+        void subscribe(const mqtt::token& connect_token);  // 连接成功后按 broker 能力选择订阅方式
 
         MqttServer& server;  // 外部服务器引用
-        int n_retry;         // 重试次数
+        Session& session;    // 所属客户端
+        int n_retry;         // 连续失败次数，连上后清零
+        bool lost = false;   // 是否处于断线重连中
+        std::chrono::steady_clock::time_point lost_at;
+        std::mt19937 rng{std::random_device{}()};
         inline static std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("mqtt_callback");
     };
 
-    std::shared_ptr<Callback> callback;  // 回调对象
     inline static std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("mqtt_server");
 };
 
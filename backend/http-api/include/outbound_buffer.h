@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+namespace ahohs::mqtt_server {
+
+/// 待发布的下行消息
+struct OutboundMessage {
+    std::string topic;
+    std::string payload;
+    int qos = 1;
+    bool retained = false;
+};
+
+/**
+ * 有界下行消息缓冲
+ *
+ * 先进先出。内存中最多保留 memory_capacity 条，超出部分按到达顺序追加写入溢写文件，
+ * 溢写文件超过 spill_max_bytes（或未配置路径）时丢弃新消息。
+ * 溢写文件在构造时会被重新加载；内存中的消息只有在停止前调用 persist() 后才会写入文件。
+ * 文件只 flush 到操作系统、不 fsync，因此能跨越进程重启，但掉电时最近写入的消息可能丢失。
+ * 出队由调用方决定：应在 broker 确认送达后再 pop()，未确认的消息留在队首重发（至少一次）。
+ *
+ * 非线程安全，由调用方加锁。
+ */
+class OutboundBuffer {
+ public:
+    OutboundBuffer(std::size_t memory_capacity, std::string spill_path, std::size_t spill_max_bytes);
+
+    OutboundBuffer(const OutboundBuffer&) = delete;
+    OutboundBuffer& operator=(const OutboundBuffer&) = delete;
+
+    /// 入队；返回 false 表示缓冲已满，消息被丢弃
+    bool push(OutboundMessage msg);
+
+    /// 队首消息，队列为空时返回 nullptr；指针在下一次 push / pop 前有效
+    const OutboundMessage* front();
+
+    void pop();
+
+    /**
+     * 把内存中的消息写入溢写文件（排在已溢写的消息之前，保持先进先出），停止前调用
+     *
+     * 返回因未配置路径、超过 spill_max_bytes 或写入失败而丢弃的条数。
+     */
+    std::size_t persist();
+
+    bool empty() const { return memory.empty() && spill_count == 0; }
+    std::size_t size() const { return memory.size() + spill_count; }
+    std::size_t spilled() const { return spill_count; }
+
+ private:
+    std::deque<OutboundMessage> memory;
+    std::size_t memory_capacity;
+
+    std::string spill_path;
+    std::size_t spill_max_bytes;
+    std::fstream spill;
+    std::size_t spill_read = 0;   // 下一条待读记录的偏移，同时记录在文件头中
+    std::size_t spill_write = 0;  // 文件末尾偏移
+    std::size_t spill_count = 0;
+    std::optional<OutboundMessage> spill_front;  // 已从文件读出的队首记录
+    std::size_t spill_front_bytes = 0;
+
+    bool open_spill(bool truncate);
+    bool append_spill(const OutboundMessage& msg);
+    void load_spill();
+    void store_read_offset();
+    std::optional<OutboundMessage> read_record(std::size_t offset, std::size_t& bytes);
+
+    inline static std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("mqtt_outbound");
+};
+
+}  // namespace ahohs::mqtt_server
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace ahohs::util {
+
+/**
+ * 有界无锁环形队列（Dmitry Vyukov 的 bounded MPMC 算法）
+ *
+ * 每个槽位带一个序号，生产者与消费者各自通过 CAS 推进 enqueue_pos / dequeue_pos，
+ * 不使用任何互斥锁，也不在运行期分配内存。
+ * 摄取流水线里按 MPSC 使用：多个 paho 回调线程入队，每个分片一个工作线程出队；
+ * "丢弃最旧" 策略下生产者也会出队，因此保留了完整的 MPMC 语义。
+ *
+ * @tparam T 元素类型，需可默认构造与移动赋值
+ */
+template <typename T>
+class BoundedRing {
+ public:
+    /// capacity 会向上取整为 2 的幂
+    explicit BoundedRing(std::size_t capacity)
+        : mask(std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity) - 1),
+          cells(std::make_unique<Cell[]>(mask + 1)) {
+        for (std::size_t i = 0; i <= mask; ++i) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedRing(const BoundedRing&) = delete;
+    BoundedRing& operator=(const BoundedRing&) = delete;
+
+    /// 入队；队列满时返回 false，且不会移动 value
+    bool try_push(T&& value) {
+        std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            std::size_t seq = cell->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // 满
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(value);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// 出队；队列空时返回 false
+    bool try_pop(T& out) {
+        std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            std::size_t seq = cell->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // 空
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        out = std::move(cell->data);
+        cell->seq.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// 近似长度（并发下仅用于指标与休眠判断）
+    std::size_t size_approx() const {
+        std::size_t head = dequeue_pos.load(std::memory_order_relaxed);
+        std::size_t tail = enqueue_pos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool empty_approx() const { return size_approx() == 0; }
+    std::size_t capacity() const { return mask + 1; }
+
+ private:
+    struct Cell {
+        std::atomic<std::size_t> seq;
+        T data;
+    };
+
+    const std::size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<std::size_t> enqueue_pos{0};
+    alignas(64) std::atomic<std::size_t> dequeue_pos{0};
+};
+
+}  // namespace ahohs::util
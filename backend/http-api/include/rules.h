@@ -0,0 +1,230 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "attrib_codec.h"
+#include "state_store.h"
+#include "telemetry.h"
+
+// 启动时加载的规则文件（JSON 数组），不存在时不加载任何规则
+#ifndef RULES_FILE
+#define RULES_FILE "rules.json"
+#endif
+
+// 条件表达式编译后允许的最大求值栈深度
+#ifndef RULES_MAX_STACK
+#define RULES_MAX_STACK 16
+#endif
+
+namespace ahohs::rules {
+
+using json = nlohmann::json;
+
+/**
+ * 编译后的条件表达式
+ *
+ * 语法：属性引用（以 '/' 开头，如 /temperature）、数值、true / false / null、
+ * 带引号的字符串，比较运算 > >= < <= == !=，逻辑运算 && || !，以及括号。
+ * 例：/temperature > 28 && /humidity < 80
+ *
+ * 编译为后缀形式的字节码，求值时只使用定长栈，不分配内存（字符串属性除外）。
+ */
+class Condition {
+ public:
+    /// 编译表达式，语法错误时抛出 std::invalid_argument
+    static Condition compile(std::string_view expr);
+
+    /// 表达式引用到的属性 topic（去重）
+    const std::vector<std::string>& attribs() const { return attrib_names; }
+
+    /**
+     * 求值
+     *
+     * @param lookup 按属性序号（attribs() 中的下标）取当前值，返回 nullptr 表示无值
+     */
+    template <typename Lookup>
+    bool evaluate(Lookup&& lookup) const;
+
+ private:
+    enum class Op : uint8_t { PushConst, PushAttrib, Gt, Ge, Lt, Le, Eq, Ne, And, Or, Not };
+
+    struct Instr {
+        Op op;
+        uint16_t arg;  // PushConst：常量下标；PushAttrib：属性下标
+    };
+
+    std::vector<Instr> code;
+    std::vector<telemetry::AttribValue> constants;
+    std::vector<std::string> attrib_names;
+
+    friend class Compiler;
+};
+
+/// 规则触发的动作：向目标设备的属性 topic 发布命令（v1 为 {"value":x}，v2 为二进制值，见 codec::encode_command）
+struct Action {
+    std::string device;  // 为空时取触发规则的设备
+    std::string attrib;
+    json value;
+};
+
+/**
+ * 一条自动化规则
+ *
+ * JSON 形式：
+ *   {"id":"fan", "device":"21fvs93432j", "when":"/temperature > 28",
+ *    "then":[{"attrib":"/power_on","value":true}]}
+ * device 为 "+" 时对所有设备生效。条件由假变真时触发一次（边沿触发），
+ * 条件保持为真期间不会重复发布命令。
+ */
+struct Rule {
+    std::string id;
+    std::string device;
+    Condition condition;
+    std::vector<Action> actions;
+
+    std::mutex mtx;                  // 保护 last（通配规则可能被多个摄取线程同时求值）
+    state::StringMap<bool> last;     // device_id -> 上次求值结果
+};
+
+/// 命令发布函数，返回 false 表示发布失败（如缓冲已满）
+using Publisher = std::function<bool(std::string topic, std::string payload)>;
+
+/// 规则引擎计数，均为单调递增
+struct RuleStats {
+    std::atomic<uint64_t> evaluated{0};
+    std::atomic<uint64_t> fired{0};
+    std::atomic<uint64_t> publish_failed{0};
+};
+
+/**
+ * 规则引擎
+ *
+ * 规则在加载时编译，并按 (设备, 属性) 建立索引：每条属性消息只查一次索引，
+ * 只对引用了该属性的规则求值，开销为 O(匹配的规则数)，与规则总数无关。
+ * 条件中引用的其他属性从最新值存储读取。
+ *
+ * on_attrib 由摄取工作线程并发调用；增删规则持有写锁。
+ */
+class RuleEngine {
+ public:
+    explicit RuleEngine(const state::DeviceStateStore& store);
+
+    RuleEngine(const RuleEngine&) = delete;
+    RuleEngine& operator=(const RuleEngine&) = delete;
+
+    void set_publisher(Publisher publisher);
+    /// 按目标设备的 attrib_schema 编码命令负载；未设置时所有命令按 v1（{"value":x}）发布
+    void set_schema_registry(const codec::SchemaRegistry& registry);
+
+    /// 添加（或按 id 替换）规则，格式非法时抛出 std::invalid_argument
+    void add_rule(const json& rule);
+    bool remove_rule(std::string_view id);
+    /// 从 JSON 数组文件加载规则，返回加载的条数；文件不存在时返回 0
+    std::size_t load_file(const std::string& path);
+
+    std::size_t size() const;
+
+    /// 属性更新后调用
+    void on_attrib(std::string_view device_id, std::string_view attrib,
+                   const telemetry::AttribValue& value);
+
+    const RuleStats& stats() const { return counters; }
+
+ private:
+    using RuleList = std::vector<std::shared_ptr<Rule>>;
+
+    const state::DeviceStateStore& store;
+    Publisher publisher;
+    const codec::SchemaRegistry* schemas = nullptr;
+    RuleStats counters;
+
+    mutable std::shared_mutex mtx;
+    state::StringMap<std::shared_ptr<Rule>> rules;            // id -> 规则
+    state::StringMap<state::StringMap<RuleList>> index;       // 设备 -> 属性 -> 规则
+
+    void index_rule(const std::shared_ptr<Rule>& rule);
+    void unindex_rule(const std::shared_ptr<Rule>& rule);
+    void evaluate(Rule& rule, std::string_view device_id, std::string_view attrib,
+                  const telemetry::AttribValue& value);
+    void fire(const Rule& rule, std::string_view device_id);
+
+    inline static std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("rule_engine");
+};
+
+// ===== Condition::evaluate 实现 =====
+
+namespace detail {
+
+/// 两个属性值比较：数值与布尔按数值比较，字符串按字典序，null 只与 null 相等；类型不兼容时 comparable 置 false
+int compare(const telemetry::AttribValue& a, const telemetry::AttribValue& b, bool& comparable);
+bool truthy(const telemetry::AttribValue& v);
+
+}  // namespace detail
+
+template <typename Lookup>
+bool Condition::evaluate(Lookup&& lookup) const {
+    // 栈上只存指针，常量与属性值的生命周期覆盖整个求值过程
+    const telemetry::AttribValue* stack[RULES_MAX_STACK];
+    static const telemetry::AttribValue NULL_VALUE{};
+    static const telemetry::AttribValue TRUE_VALUE{true};
+    static const telemetry::AttribValue FALSE_VALUE{false};
+    std::size_t sp = 0;
+    for (const Instr& in : code) {
+        switch (in.op) {
+            case Op::PushConst:
+                stack[sp++] = &constants[in.arg];
+                break;
+            case Op::PushAttrib: {
+                const telemetry::AttribValue* v = lookup(in.arg);
+                stack[sp++] = v ? v : &NULL_VALUE;
+                break;
+            }
+            case Op::Not:
+                stack[sp - 1] = detail::truthy(*stack[sp - 1]) ? &FALSE_VALUE : &TRUE_VALUE;
+                break;
+            case Op::And:
+            case Op::Or: {
+                bool rhs = detail::truthy(*stack[--sp]);
+                bool lhs = detail::truthy(*stack[sp - 1]);
+                bool r = in.op == Op::And ? (lhs && rhs) : (lhs || rhs);
+                stack[sp - 1] = r ? &TRUE_VALUE : &FALSE_VALUE;
+                break;
+            }
+            default: {
+                const telemetry::AttribValue& rhs = *stack[--sp];
+                const telemetry::AttribValue& lhs = *stack[sp - 1];
+                bool comparable = false;
+                int c = detail::compare(lhs, rhs, comparable);
+                bool r = false;
+                if (comparable) {
+                    switch (in.op) {
+                        case Op::Gt: r = c > 0; break;
+                        case Op::Ge: r = c >= 0; break;
+                        case Op::Lt: r = c < 0; break;
+                        case Op::Le: r = c <= 0; break;
+                        case Op::Eq: r = c == 0; break;
+                        case Op::Ne: r = c != 0; break;
+                        default: break;
+                    }
+                } else {
+                    r = in.op == Op::Ne;  // 类型不兼容的值互不相等
+                }
+                stack[sp - 1] = r ? &TRUE_VALUE : &FALSE_VALUE;
+                break;
+            }
+        }
+    }
+    return sp == 1 && detail::truthy(*stack[0]);
+}
+
+}  // namespace ahohs::rules
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+// 共享事件循环的线程数，0 表示取 std::thread::hardware_concurrency()
+#ifndef RUNTIME_THREADS
+#define RUNTIME_THREADS 0
+#endif
+
+// 是否把第 i 个事件循环线程绑定到进程可用 CPU 中的第 i 个（按 sched_getaffinity 的顺序循环取）
+#ifndef RUNTIME_PIN_CPUS
+#define RUNTIME_PIN_CPUS 0
+#endif
+
+namespace boost::asio {
+class io_context;
+}
+
+namespace ahohs::runtime {
+
+/**
+ * 进程共享的事件循环
+ *
+ * 一个 boost::asio::io_context 由固定数量的线程共同运行（Crow 在 CROW_USE_BOOST 下使用同一套 asio），
+ * UDP 发现、摄取分片、存活跟踪与定时任务的计时都作为异步任务投递到这里，
+ * 而不是各自持有阻塞或休眠的线程；并发度只在此处调整。
+ * 会阻塞的数据库调用仍留在各自的写入线程中，不占用事件循环。
+ *
+ * 构造后立即启动线程；其他组件持有引用，必须先于它们停止前保持存活。
+ */
+class Runtime {
+ public:
+    explicit Runtime(std::size_t n_threads = RUNTIME_THREADS, bool pin_cpus = RUNTIME_PIN_CPUS);
+    ~Runtime();
+
+    Runtime(const Runtime&) = delete;
+    Runtime& operator=(const Runtime&) = delete;
+
+    boost::asio::io_context& context();
+    std::size_t thread_count() const { return n_threads; }
+
+    /// 投递任务到任意一个事件循环线程，可在任意线程调用
+    void post(std::function<void()> task);
+
+    /// 各服务停止后调用：丢弃未执行的任务并等待所有线程退出
+    void stop();
+    bool stopped() const;
+
+ private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+    std::size_t n_threads;
+
+    inline static std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("runtime");
+};
+
+/**
+ * 事件循环上的单次定时器
+ *
+ * 回调在 arm_at() 指定的时刻执行一次，周期任务在回调中再次 arm_at()；
+ * 重复 arm_at() 以最后一次为准，可以提前也可以推后。同一定时器的回调不会并发执行。
+ */
+class Timer {
+ public:
+    using Callback = std::function<void()>;
+
+    Timer(Runtime& runtime, Callback callback);
+    ~Timer();
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+    /// 可在任意线程（包括回调中）调用
+    void arm_at(std::chrono::steady_clock::time_point when);
+    /// 按调用时两个时钟的差值换算为 steady_clock，之后的系统时间跳变不会改变等待时长
+    void arm_at(std::chrono::system_clock::time_point when);
+
+    /// 取消定时器并等待正在执行的回调返回，之后回调不会再执行；不能在回调中调用
+    void stop();
+
+ private:
+    struct State;
+    std::shared_ptr<State> state;
+    Runtime& runtime;
+};
+
+}  // namespace ahohs::runtime
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "rules.h"
+#include "runtime.h"
+#include "state_store.h"
+
+namespace ahohs::scheduler {
+
+using json = nlohmann::json;
+using WallClock = std::chrono::system_clock;
+
+/**
+ * 五段式 cron 表达式：分 时 日 月 周
+ *
+ * 每段支持星号、数字、范围 a-b、步长后缀 /n（如 0-30/10，星号加 /15 即每 15 个单位），
+ * 以及逗号分隔的列表。周日可写作 0 或 7。日与周两段都不以星号开头时满足其一即可，
+ * 任一段以星号开头（包括星号加步长）时两段都须满足（与 Vixie cron 一致）。
+ * 按本地时区（TZ 环境变量）计算。
+ */
+class CronExpr {
+ public:
+    /// 解析表达式，格式错误时抛出 std::invalid_argument
+    static CronExpr parse(std::string_view expr);
+
+    /// after 之后（不含）第一个匹配的整分钟；两年内没有匹配时返回空（如 2 月 30 日）
+    std::optional<WallClock::time_point> next(WallClock::time_point after) const;
+
+ private:
+    std::bitset<60> minutes;
+    std::bitset<24> hours;
+    std::bitset<32> days;      // 1 ~ 31
+    std::bitset<12> months;    // 0 ~ 11，与 std::tm::tm_mon 一致
+    std::bitset<7> weekdays;   // 0 为周日
+    bool any_day = true;       // 日段以星号开头
+    bool any_weekday = true;   // 周段以星号开头
+
+    bool day_matches(int mday, int wday) const;
+};
+
+/**
+ * 一条定时任务
+ *
+ * JSON 形式（三种触发方式任选其一）：
+ *   {"id":"ac-off", "at":"23:00", "then":[{"device":"ac1","attrib":"/power_on","value":false}]}
+ *   {"id":"ac-off", "cron":"0 23 * * 1-5", "then":[...]}
+ *   {"id":"ir-poll", "every":300, "then":{"device":"ir1","attrib":"/poll","value":true}}
+ * every 的单位为秒，触发时刻对齐到 Unix 时间的整数倍（every 为 300 时在每个整 5 分钟触发），
+ * 重启后不会漂移。动作格式与规则相同，但必须指明 device。
+ */
+struct Schedule {
+    std::string id;
+    std::optional<CronExpr> cron;     // 为空时按 every 固定间隔触发
+    std::chrono::seconds every{0};
+    std::vector<rules::Action> actions;
+    json definition;                  // 原始定义，用于持久化与查询
+
+    /// 校验并解析定义，格式非法时抛出 std::invalid_argument
+    static Schedule parse(const json& def);
+
+    /// after 之后（不含）的下一次触发时刻，不再触发时返回空
+    std::optional<WallClock::time_point> next(WallClock::time_point after) const;
+};
+
+/// 调度器计数，均为单调递增
+struct SchedulerStats {
+    std::atomic<uint64_t> fired{0};
+    std::atomic<uint64_t> publish_failed{0};
+    std::atomic<uint64_t> wakeups{0};   // 调度线程从等待中返回（共享事件循环下为定时器到期）的次数
+};
+
+/**
+ * 定时任务调度器
+ *
+ * 所有任务的下一次触发时刻放在一个最小堆中，由单个线程 wait_until 到堆顶时刻，
+ * 没有任务到期时不会被唤醒（不同于存活跟踪按 tick 推进的时间轮）。
+ * 增删任务为 O(log n)：被替换或删除的任务只作废其堆项（代数不匹配），
+ * 弹出时丢弃，作废项过多时整体重建堆。
+ * 只有新任务早于当前堆顶时才唤醒调度线程重新计算等待时刻。
+ * 运行在共享事件循环上时，调度线程换成一个始终指向堆顶时刻的定时器。
+ *
+ * 调度器本身不访问数据库：任务定义由 HTTP 接口写入 schedules 表，启动时由 main 读出并 add。
+ */
+class Scheduler {
+ public:
+    Scheduler();
+    /// 由共享事件循环上的定时器触发，不创建调度线程
+    explicit Scheduler(runtime::Runtime& runtime);
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    void set_publisher(rules::Publisher publisher);
+    /// 按目标设备的 attrib_schema 编码命令负载；未设置时所有命令按 v1（{"value":x}）发布
+    void set_schema_registry(const codec::SchemaRegistry& registry);
+
+    /// 添加（或按 id 替换）任务
+    void add(Schedule schedule);
+    /// 解析并添加，格式非法时抛出 std::invalid_argument
+    void add(const json& def) { add(Schedule::parse(def)); }
+    bool remove(std::string_view id);
+
+    std::size_t size() const;
+    /// 任务的下一次触发时刻，任务不存在时返回空
+    std::optional<WallClock::time_point> next_due(std::string_view id) const;
+
+    void stop();
+
+    const SchedulerStats& stats() const { return counters; }
+
+ private:
+    struct Slot {
+        Schedule schedule;
+        uint64_t generation = 0;          // 0 表示不在堆中
+        WallClock::time_point due{};
+    };
+
+    struct Entry {
+        WallClock::time_point due;
+        uint64_t generation;
+        std::shared_ptr<Slot> slot;
+
+        bool operator>(const Entry& other) const { return due > other.due; }
+    };
+
+    using Heap = std::priority_queue<Entry, std::vector<Entry>, std::greater<>>;
+
+    rules::Publisher publisher;
+    const codec::SchemaRegistry* schemas = nullptr;
+    SchedulerStats counters;
+
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    state::StringMap<std::shared_ptr<Slot>> slots;  // id -> 任务
+    Heap heap;
+    uint64_t next_generation = 0;
+    std::size_t n_stale = 0;   // 堆中已作废的项数
+    bool rescheduled = false;  // 堆顶提前，调度线程需要重新计算等待时刻
+    bool stopping = false;
+    std::thread worker;
+    std::unique_ptr<runtime::Timer> timer;  // 共享事件循环下代替 worker
+
+    bool stale(const Entry& entry) const { return entry.generation != entry.slot->generation; }
+    void push(const std::shared_ptr<Slot>& slot, WallClock::time_point due);
+    void invalidate(Slot& slot);
+    void compact();
+    void fire(const Schedule& schedule, const rules::Publisher& publisher);
+    /// 发布所有在 now 之前到期的任务（发布时释放锁），返回此后的堆顶时刻，没有任务时为空
+    std::optional<WallClock::time_point> fire_due(std::unique_lock<std::mutex>& lock, WallClock::time_point now);
+    void run();
+    void on_timer();
+
+    inline static std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("scheduler");
+};
+
+}  // namespace ahohs::scheduler
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+#include "runtime.h"
+#include "state_store.h"
+#include "telemetry.h"
+
+// 内存中保留的最近遥测时长（小时），更早的历史查询走数据库
+#ifndef SERIES_RETENTION_HOURS
+#define SERIES_RETENTION_HOURS 24
+#endif
+
+// 时间戳精度（毫秒）；规律上报的设备抖动在精度以内时，时间戳只占 1 bit
+#ifndef SERIES_TS_RESOLUTION_MS
+#define SERIES_TS_RESOLUTION_MS 1000
+#endif
+
+// 压缩块大小（字节），须为 8 的倍数
+#ifndef SERIES_CHUNK_BYTES
+#define SERIES_CHUNK_BYTES 1024
+#endif
+
+// 清理长期无新采样的序列中过期块的间隔（毫秒）；有新采样的序列在写入时即丢弃过期块
+#ifndef SERIES_SWEEP_INTERVAL_MS
+#define SERIES_SWEEP_INTERVAL_MS 60000
+#endif
+
+#ifndef SERIES_STORE_SHARDS
+#define SERIES_STORE_SHARDS 64
+#endif
+
+namespace ahohs::series {
+
+/**
+ * Gorilla 压缩块（定长）
+ *
+ * 时间戳以精度为单位，首个写在块头，其后按二阶差分（delta-of-delta）变长编码：
+ * '0' 表示与上一间隔相同，'10' / '110' / '1110' 后接 7 / 9 / 12 bit，'1111' 后接 64 bit。
+ * 数值为 double 的位模式，首个原样写 64 bit，其后与前一个异或：
+ * '0' 表示相同，'10' 沿用上一次的前导零 / 尾随零窗口只写有效位，
+ * '11' 后接前导零个数（5 bit）、有效位长度（6 bit）与有效位。
+ * 剩余空间不足以容纳最坏情况的一个采样时视为已满。
+ */
+class Chunk {
+ public:
+    static constexpr std::size_t WORDS = SERIES_CHUNK_BYTES / 8;
+
+    /// 追加一个采样，t 不得小于上一个；块已满时返回 false
+    bool append(int64_t t, double value);
+
+    /// 按时间顺序解码，fn(t, value) 返回 false 时提前结束
+    template <typename F>
+    void decode(F&& fn) const;
+
+    bool empty() const { return count == 0; }
+    uint32_t size() const { return count; }
+    int64_t first_time() const { return first_t; }
+    int64_t last_time() const { return last_t; }
+    std::size_t used_bytes() const { return (bit_pos + 7) / 8; }
+
+ private:
+    static constexpr uint32_t CAPACITY_BITS = WORDS * 64;
+    static constexpr uint32_t MAX_SAMPLE_BITS = (4 + 64) + (2 + 5 + 6 + 64);
+    static constexpr uint8_t NO_WINDOW = 0xFF;
+
+    std::array<uint64_t, WORDS> words{};
+    uint32_t bit_pos = 0;
+    uint32_t count = 0;
+    int64_t first_t = 0;
+    int64_t last_t = 0;
+    int64_t last_delta = 0;
+    uint64_t last_bits = 0;
+    uint8_t leading = NO_WINDOW;  // 上一次 '11' 编码的前导零个数
+    uint8_t trailing = 0;
+
+    void write(uint64_t value, unsigned n);
+};
+
+/// 时间点（毫秒时间戳）与数值；布尔属性以 0 / 1 表示
+struct Point {
+    int64_t ts;
+    double value;
+};
+
+/// 一次区间查询的结果
+struct Range {
+    bool boolean = false;  // 属性为布尔类型
+    std::vector<Point> points;
+};
+
+/// 存储计数
+struct SeriesStats {
+    std::size_t series = 0;
+    std::size_t chunks = 0;
+    uint64_t samples = 0;        // 当前保留的采样数
+    uint64_t used_bytes = 0;     // 块中已写入的压缩数据
+    uint64_t allocated_bytes = 0;  // 块占用的内存（含未写满部分与块头）
+};
+
+/**
+ * 最近遥测的内存时序存储
+ *
+ * 每个 (device_id, attrib) 一条时间序列，由若干 Gorilla 压缩块组成，保留最近 retention 的数据：
+ * 写满的块只读，最新采样超出最旧块 retention 后整块丢弃。
+ * 只保存数值与布尔属性；字符串属性记为不支持，查询时交给数据库；null 采样不占空间，查询时即为空缺。
+ *
+ * 每条序列记录自身完整覆盖的起点（存储创建时刻，或最近丢弃块之后），
+ * 查询区间的起点不早于该时刻时由内存给出，否则返回 std::nullopt 由调用方查库。
+ * 时间戳按精度向下取整保存，查询按精度区间比较：采样所在的精度区间与查询区间相交即返回。
+ * 时间戳早于序列最新采样的（乱序）采样不写入内存，只进入数据库。
+ * 长期无新采样的序列由 sweep() 定期丢弃过期块，块全部丢弃后整条删除；设备删除时由 forget() 删除。
+ *
+ * 按 device_id 哈希分片，每个分片一把读写锁；摄取线程写、HTTP 线程读。
+ */
+class SeriesStore {
+ public:
+    using Clock = std::chrono::system_clock;
+
+    explicit SeriesStore(std::chrono::hours retention = std::chrono::hours(SERIES_RETENTION_HOURS),
+                         std::chrono::milliseconds resolution = std::chrono::milliseconds(SERIES_TS_RESOLUTION_MS),
+                         std::size_t n_shards = SERIES_STORE_SHARDS);
+
+    ~SeriesStore();
+
+    SeriesStore(const SeriesStore&) = delete;
+    SeriesStore& operator=(const SeriesStore&) = delete;
+
+    /// 记录一个采样，null / 字符串 / 乱序时返回 false；null 直接跳过（查询结果中表现为空缺），字符串使序列记为不支持
+    bool record(std::string_view device_id, std::string_view attrib,
+                const telemetry::AttribValue& value, Clock::time_point ts);
+
+    /// [from, to]（毫秒时间戳，含两端）内的采样；内存不能完整覆盖该区间时返回 std::nullopt
+    std::optional<Range> range(std::string_view device_id, std::string_view attrib,
+                               int64_t from, int64_t to) const;
+
+    /// 丢弃所有序列中早于 now - retention 的块，不再有块的序列整条删除；返回丢弃的块数
+    std::size_t sweep(Clock::time_point now);
+    /// 删除设备的全部序列，设备删除后调用
+    void forget(std::string_view device_id);
+
+    /// 在共享事件循环上每隔 interval 执行一次 sweep()，由 stop() 停止
+    void start(runtime::Runtime& runtime,
+               std::chrono::milliseconds interval = std::chrono::milliseconds(SERIES_SWEEP_INTERVAL_MS));
+    void stop();
+
+    /// 时间戳精度（毫秒）；查库返回的时间戳也应按此取整，与内存给出的结果一致
+    int64_t resolution() const { return resolution_ms; }
+
+    SeriesStats stats() const;
+
+ private:
+    struct Series {
+        bool boolean = false;
+        bool unsupported = false;  // 出现过字符串采样
+        int64_t complete_since;    // 毫秒时间戳，此后的采样都在内存中
+        std::deque<Chunk> chunks;
+    };
+
+    struct Shard {
+        mutable std::shared_mutex mtx;
+        state::StringMap<state::StringMap<Series>> devices;  // device_id -> attrib -> 序列
+    };
+
+    int64_t retention_ms;
+    int64_t resolution_ms;
+    int64_t started_at;  // 存储创建时刻（毫秒，按精度向上取整），此前的数据只在数据库中
+    std::size_t n_shards;
+    std::unique_ptr<Shard[]> shards;
+    // 已整条删除的序列可能有数据的最晚时刻（毫秒），内存中没有的序列只有查询起点不早于此才能判定为无数据
+    std::atomic<int64_t> erased_before{0};
+    std::unique_ptr<runtime::Timer> sweeper;
+    std::chrono::milliseconds sweep_interval{SERIES_SWEEP_INTERVAL_MS};
+    std::chrono::steady_clock::time_point next_sweep;  // 只由 sweeper 的回调访问
+
+    /// 内存中没有的序列的覆盖起点
+    int64_t missing_since() const { return std::max(started_at, erased_before.load(std::memory_order_acquire)); }
+    void raise_erased_before(int64_t ms);
+    void on_sweep();
+
+    Shard& shard_for(std::string_view device_id) const {
+        return shards[state::StringHash{}(device_id) % n_shards];
+    }
+};
+
+/**
+ * 遥测输出的分流：把采样写入内存时序存储，再原样转发给下游（如 TelemetryWriter）
+ */
+class RecordingSink : public telemetry::TelemetrySink {
+ public:
+    RecordingSink(SeriesStore& store, telemetry::TelemetrySink& next) : store(store), next(next) {}
+
+    void append(telemetry::Sample sample) override;
+    void append_event(telemetry::DeviceEvent event) override;
+
+ private:
+    SeriesStore& store;
+    telemetry::TelemetrySink& next;
+};
+
+//////////////////////
+// Chunk 解码（模板实现）
+//////////////////////
+
+template <typename F>
+void Chunk::decode(F&& fn) const {
+    if (count == 0) {
+        return;
+    }
+    uint32_t pos = 0;
+    auto read = [this, &pos](unsigned n) -> uint64_t {
+        if (n == 0) {
+            return 0;
+        }
+        const uint32_t word = pos / 64;
+        const unsigned free = 64 - pos % 64;
+        uint64_t value;
+        if (n <= free) {
+            value = words[word] >> (free - n);
+        } else {
+            value = (words[word] << (n - free)) | (words[word + 1] >> (64 - (n - free)));
+        }
+        pos += n;
+        return n < 64 ? value & ((uint64_t{1} << n) - 1) : value;
+    };
+    auto sign_extend = [](uint64_t value, unsigned n) {
+        return static_cast<int64_t>(value << (64 - n)) >> (64 - n);
+    };
+
+    int64_t t = first_t;
+    int64_t delta = 0;
+    uint64_t bits = read(64);
+    unsigned lead = 0;
+    unsigned sig = 0;
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    if (!fn(t, value)) {
+        return;
+    }
+    for (uint32_t i = 1; i < count; ++i) {
+        // 时间戳：二阶差分
+        int64_t dod;
+        if (read(1) == 0) {
+            dod = 0;
+        } else if (read(1) == 0) {
+            dod = sign_extend(read(7), 7);
+        } else if (read(1) == 0) {
+            dod = sign_extend(read(9), 9);
+        } else if (read(1) == 0) {
+            dod = sign_extend(read(12), 12);
+        } else {
+            dod = static_cast<int64_t>(read(64));
+        }
+        delta += dod;
+        t += delta;
+
+        // 数值：与前一个异或
+        if (read(1) != 0) {
+            if (read(1) != 0) {
+                lead = static_cast<unsigned>(read(5));
+                sig = static_cast<unsigned>(read(6));
+                if (sig == 0) {
+                    sig = 64;
+                }
+            }
+            bits ^= read(sig) << (64 - lead - sig);
+            std::memcpy(&value, &bits, sizeof(value));
+        }
+        if (!fn(t, value)) {
+            return;
+        }
+    }
+}
+
+}  // namespace ahohs::series
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "telemetry.h"
+
+#ifndef STATE_STORE_SHARDS
+#define STATE_STORE_SHARDS 64
+#endif
+
+namespace ahohs::state {
+
+using Clock = std::chrono::system_clock;
+
+/// 支持以 std::string_view 异构查找的字符串哈希
+struct StringHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view sv) const noexcept {
+        return std::hash<std::string_view>{}(sv);
+    }
+};
+
+template <typename V>
+using StringMap = std::unordered_map<std::string, V, StringHash, std::equal_to<>>;
+
+/// 单个属性的最新值
+struct AttribState {
+    telemetry::AttribValue value;
+    Clock::time_point updated_at{};
+};
+
+/// 单个设备的最新状态
+struct DeviceState {
+    StringMap<AttribState> attribs;   // 属性 topic -> 最新值
+    Clock::time_point last_seen{};    // 最近一次收到该设备任意消息的时间
+    bool online = false;              // 由心跳存活跟踪器维护
+    Clock::time_point online_changed_at{};
+};
+
+/**
+ * 设备最新值存储（last-value store）
+ *
+ * 按 device_id 哈希分片，每个分片一把读写锁；摄取线程写、HTTP 线程读。
+ * 查询接口均接受 std::string_view，命中已有设备时不产生堆分配。
+ */
+class DeviceStateStore {
+ public:
+    explicit DeviceStateStore(std::size_t n_shards = STATE_STORE_SHARDS);
+
+    DeviceStateStore(const DeviceStateStore&) = delete;
+    DeviceStateStore& operator=(const DeviceStateStore&) = delete;
+
+    void update_attrib(std::string_view device_id, std::string_view attrib,
+                       const telemetry::AttribValue& value, Clock::time_point ts);
+    void touch(std::string_view device_id, Clock::time_point ts);  // 仅刷新 last_seen
+    void set_online(std::string_view device_id, bool online, Clock::time_point ts);
+
+    std::optional<AttribState> get_attrib(std::string_view device_id, std::string_view attrib) const;
+    std::optional<DeviceState> get_device(std::string_view device_id) const;
+    std::size_t size() const;
+
+ private:
+    struct Shard {
+        mutable std::shared_mutex mtx;
+        StringMap<DeviceState> devices;
+    };
+
+    std::size_t n_shards;
+    std::unique_ptr<Shard[]> shards;
+
+    Shard& shard_for(std::string_view device_id) const {
+        return shards[StringHash{}(device_id) % n_shards];
+    }
+    static DeviceState& get_or_create(Shard& shard, std::string_view device_id);
+};
+
+}  // namespace ahohs::state
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "db.h"
+#include "wal.h"
+
+#ifndef TELEMETRY_BATCH_SIZE
+#define TELEMETRY_BATCH_SIZE 512
+#endif
+
+#ifndef TELEMETRY_FLUSH_INTERVAL_MS
+#define TELEMETRY_FLUSH_INTERVAL_MS 200
+#endif
+
+#ifndef TELEMETRY_MAX_PENDING
+#define TELEMETRY_MAX_PENDING 65536
+#endif
+
+// 遥测预写日志目录，为空时不启用（数据库不可用时采样被丢弃）
+#ifndef TELEMETRY_WAL_DIR
+#define TELEMETRY_WAL_DIR "telemetry-wal"
+#endif
+
+// 启用预写日志时，回放单个事务最多写入的行数
+#ifndef TELEMETRY_REPLAY_MAX_ROWS
+#define TELEMETRY_REPLAY_MAX_ROWS 4096
+#endif
+
+// 启用预写日志时，写库失败后重试（含重连）的间隔
+#ifndef TELEMETRY_RETRY_INTERVAL_MS
+#define TELEMETRY_RETRY_INTERVAL_MS 1000
+#endif
+
+namespace ahohs::telemetry {
+
+/// 属性值：null / bool / 数值 / 字符串，与固件上报的 {"value":x} 一一对应
+using AttribValue = std::variant<std::monostate, bool, double, std::string>;
+
+/// 将属性值序列化为 JSON 文本（写入 JSONB 列）
+std::string to_json_text(const AttribValue& value);
+
+/// 一条遥测采样
+struct Sample {
+    std::string device_id;
+    std::string attrib;                             // 属性 topic，形如 "/temperature"
+    AttribValue value;
+    std::chrono::system_clock::time_point ts;
+};
+
+/// 设备事件（上线、离线等状态变化），写入 device_events 表
+struct DeviceEvent {
+    std::string device_id;
+    std::string event;                              // 事件类型，如 "online" / "offline"
+    std::string detail;                             // JSON 文本，可为空
+    std::chrono::system_clock::time_point ts;
+};
+
+/**
+ * 遥测输出接口
+ *
+ * 摄取流水线只依赖该接口，便于在基准测试中替换为空实现。
+ * append / append_event 必须是非阻塞的（或仅持有极短的锁）。
+ */
+class TelemetrySink {
+ public:
+    virtual ~TelemetrySink() = default;
+    virtual void append(Sample sample) = 0;
+    virtual void append_event(DeviceEvent event) = 0;
+};
+
+/**
+ * 批量遥测写入器
+ *
+ * append 仅把采样放入内存缓冲区；后台线程按 batch_size 或 flush_interval
+ * 把缓冲区整体换出，并在单个事务内写入 telemetry 表。
+ * 缓冲区超过 max_pending 时丢弃新采样并计数，避免数据库故障拖垮摄取。
+ * 设备事件量很小，单独缓冲，不受 max_pending 限制，与采样在同一轮刷新中写入。
+ *
+ * 传入预写日志时，后台线程只把每批采样追加到本地日志（组提交），不再等待数据库；
+ * 另一个回放线程按日志顺序合并写库，成功后确认。数据库变慢或不可用时采样留在日志中，
+ * 回放线程每 TELEMETRY_RETRY_INTERVAL_MS 重连重试，恢复后按序补写，摄取不受影响；
+ * 停止时未能写库的部分留在日志中，下次启动后继续回放。设备事件不进日志，由回放线程写库，失败时丢弃。
+ *
+ * 注意：db 应为写入器独占的连接（pqxx::connection 不是线程安全的）。
+ */
+class TelemetryWriter : public TelemetrySink {
+ public:
+    explicit TelemetryWriter(ahohs::db::PostgresDB& db,
+                             ahohs::wal::WriteAheadLog* wal = nullptr,
+                             std::size_t batch_size = TELEMETRY_BATCH_SIZE,
+                             std::chrono::milliseconds flush_interval = std::chrono::milliseconds(TELEMETRY_FLUSH_INTERVAL_MS),
+                             std::size_t max_pending = TELEMETRY_MAX_PENDING);
+    ~TelemetryWriter() override;
+
+    TelemetryWriter(const TelemetryWriter&) = delete;
+    TelemetryWriter& operator=(const TelemetryWriter&) = delete;
+
+    void append(Sample sample) override;
+    void append_event(DeviceEvent event) override;
+
+    /// 停止后台线程，并把剩余缓冲写入数据库（启用日志时写入日志，并尽量回放完）
+    void stop();
+
+    uint64_t written() const { return n_written.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return n_dropped.load(std::memory_order_relaxed); }
+
+ private:
+    ahohs::db::PostgresDB& db;
+    ahohs::wal::WriteAheadLog* wal;
+    std::size_t batch_size;
+    std::chrono::milliseconds flush_interval;
+    std::size_t max_pending;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<Sample> pending;
+    std::vector<DeviceEvent> pending_events;
+    bool stopping = false;
+    std::thread worker;
+
+    // 回放线程（仅启用日志时）
+    std::mutex replay_mtx;
+    std::condition_variable replay_cv;
+    std::vector<DeviceEvent> replay_events;  // 写线程转交的设备事件
+    bool replay_ready = false;               // 日志有新记录
+    bool replay_stopping = false;
+    std::thread replayer;
+
+    std::atomic<uint64_t> n_written{0};
+    std::atomic<uint64_t> n_dropped{0};
+
+    void run();
+    void replay();
+    static ahohs::wal::Rows to_rows(const std::vector<Sample>& batch);
+    bool write_batch(const std::vector<Sample>& batch);
+    bool write_events(const std::vector<DeviceEvent>& events);
+
+    inline static std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("telemetry_writer");
+};
+
+}  // namespace ahohs::telemetry
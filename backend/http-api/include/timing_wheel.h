@@ -0,0 +1,202 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ahohs::util {
+
+/**
+ * 分层时间轮
+ *
+ * 4 层、每层 64 个槽，tick 为最小时间粒度，可表示 64^4 个 tick 内的到期时间
+ * （tick = 500ms 时约 97 天），更远的到期时间会被截断到最高层并在级联时重新放置。
+ *
+ * 定时器以 TimerId（条目池下标）标识，条目通过下标组成槽内双向链表：
+ * arm / cancel / 重新 arm 都是 O(1)，不为单个定时器分配内存或创建线程。
+ * advance 每经过一个 tick 只处理一个槽，空槽开销可忽略。
+ *
+ * 非线程安全，由调用方加锁。
+ */
+class TimingWheel {
+ public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = uint32_t;
+    static constexpr TimerId INVALID_TIMER = UINT32_MAX;
+
+    explicit TimingWheel(std::chrono::milliseconds tick, Clock::time_point start = Clock::now())
+        : tick(tick), start(start) {
+        for (auto& level : buckets) {
+            level.fill(INVALID_TIMER);
+        }
+    }
+
+    /// 分配一个未启动的定时器，user_data 会在到期回调中原样传回
+    TimerId create(uint64_t user_data) {
+        TimerId id;
+        if (free_head != INVALID_TIMER) {
+            id = free_head;
+            free_head = entries[id].next;
+            entries[id] = Entry{};
+        } else {
+            id = static_cast<TimerId>(entries.size());
+            entries.emplace_back();
+        }
+        entries[id].user_data = user_data;
+        return id;
+    }
+
+    /// 释放定时器（若已启动则先取消）
+    void release(TimerId id) {
+        cancel(id);
+        entries[id].next = free_head;
+        free_head = id;
+    }
+
+    /// 启动或重新设置到期时间，O(1)
+    void arm(TimerId id, Clock::time_point deadline) {
+        cancel(id);
+        auto since_start = deadline - start;
+        uint64_t expires = since_start.count() <= 0 ? 0 : static_cast<uint64_t>(since_start / tick);
+        entries[id].expires = expires <= current ? current + 1 : expires;
+        link(id);
+        ++n_armed;
+    }
+
+    /// 取消定时器，O(1)；未启动时无操作
+    void cancel(TimerId id) {
+        Entry& e = entries[id];
+        if (!e.armed) {
+            return;
+        }
+        unlink(id);
+        --n_armed;
+    }
+
+    bool armed(TimerId id) const { return entries[id].armed; }
+    std::size_t armed_count() const { return n_armed; }
+
+    /**
+     * 推进时间轮到 now，对每个到期的定时器调用 on_expire(TimerId, user_data)
+     *
+     * 回调中可以对任意定时器（包括刚到期的这个）调用 arm / cancel。
+     */
+    template <typename OnExpire>
+    void advance(Clock::time_point now, OnExpire&& on_expire) {
+        auto since_start = now - start;
+        if (since_start.count() <= 0) {
+            return;
+        }
+        uint64_t target = static_cast<uint64_t>(since_start / tick);
+        if (n_armed == 0) {
+            current = target;  // 没有定时器时直接跳到目标 tick
+            return;
+        }
+        while (current < target) {
+            ++current;
+            cascade();
+            std::size_t slot = current & SLOT_MASK;
+            TimerId id = buckets[0][slot];
+            while (id != INVALID_TIMER) {
+                TimerId next = entries[id].next;
+                unlink(id);
+                --n_armed;
+                on_expire(id, entries[id].user_data);
+                id = next;
+                // 回调可能把 next 重新挂到别处，遇到这种情况从槽头重新开始
+                if (id != INVALID_TIMER && (!entries[id].armed || entries[id].level != 0 || entries[id].slot != slot)) {
+                    id = buckets[0][slot];
+                }
+            }
+            if (n_armed == 0) {
+                current = target;
+            }
+        }
+    }
+
+ private:
+    static constexpr std::size_t LEVELS = 4;
+    static constexpr std::size_t SLOT_BITS = 6;
+    static constexpr std::size_t SLOTS = std::size_t{1} << SLOT_BITS;
+    static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+
+    struct Entry {
+        uint64_t expires = 0;  // 绝对 tick
+        uint64_t user_data = 0;
+        TimerId prev = INVALID_TIMER;
+        TimerId next = INVALID_TIMER;
+        uint8_t level = 0;
+        uint8_t slot = 0;
+        bool armed = false;
+    };
+
+    std::chrono::milliseconds tick;
+    Clock::time_point start;
+    uint64_t current = 0;  // 已处理到的 tick
+    std::size_t n_armed = 0;
+    std::vector<Entry> entries;
+    TimerId free_head = INVALID_TIMER;
+    std::array<std::array<TimerId, SLOTS>, LEVELS> buckets;
+
+    void link(TimerId id) {
+        Entry& e = entries[id];
+        uint64_t delta = e.expires - current;
+        std::size_t level = 0;
+        while (level + 1 < LEVELS && delta >= (uint64_t{1} << (SLOT_BITS * (level + 1)))) {
+            ++level;
+        }
+        uint64_t expires = e.expires;
+        if (level == LEVELS - 1 && delta >= (uint64_t{1} << (SLOT_BITS * LEVELS))) {
+            expires = current + (uint64_t{1} << (SLOT_BITS * LEVELS)) - 1;  // 超出范围，先放到最远处
+        }
+        auto slot = static_cast<std::size_t>((expires >> (SLOT_BITS * level)) & SLOT_MASK);
+        e.level = static_cast<uint8_t>(level);
+        e.slot = static_cast<uint8_t>(slot);
+        e.prev = INVALID_TIMER;
+        e.next = buckets[level][slot];
+        if (e.next != INVALID_TIMER) {
+            entries[e.next].prev = id;
+        }
+        buckets[level][slot] = id;
+        e.armed = true;
+    }
+
+    void unlink(TimerId id) {
+        Entry& e = entries[id];
+        if (e.prev != INVALID_TIMER) {
+            entries[e.prev].next = e.next;
+        } else {
+            buckets[e.level][e.slot] = e.next;
+        }
+        if (e.next != INVALID_TIMER) {
+            entries[e.next].prev = e.prev;
+        }
+        e.prev = e.next = INVALID_TIMER;
+        e.armed = false;
+    }
+
+    /// 低层转完一圈时，把高层对应槽里的定时器重新放置到更低的层
+    void cascade() {
+        for (std::size_t level = 1; level < LEVELS; ++level) {
+            if ((current & ((uint64_t{1} << (SLOT_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            std::size_t slot = (current >> (SLOT_BITS * level)) & SLOT_MASK;
+            TimerId id = buckets[level][slot];
+            buckets[level][slot] = INVALID_TIMER;
+            while (id != INVALID_TIMER) {
+                TimerId next = entries[id].next;
+                entries[id].armed = false;
+                if (entries[id].expires < current) {
+                    entries[id].expires = current;
+                }
+                link(id);
+                id = next;
+            }
+        }
+    }
+};
+
+}  // namespace ahohs::util
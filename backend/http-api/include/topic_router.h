@@ -0,0 +1,293 @@
+#pragma once
+
+// MQTT topic 路由器（header-only，仅依赖标准库）
+//
+// 服务端（ahohs::ingest）与 App 端（ahohc::mqtt::Context）共用本文件，
+// 因此不引入 spdlog / paho 等任何第三方依赖。
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ahoh::mqtt {
+
+/**
+ * 通配符捕获结果
+ *
+ * 定长数组，按模式中通配符出现的顺序保存 '+' 匹配到的层级和 '#' 匹配到的剩余部分。
+ * 所有 string_view 都指向被匹配的 topic 本身，不持有内存。
+ */
+template <std::size_t N>
+class TopicCaptures {
+ public:
+    std::string_view operator[](std::size_t i) const { return values[i]; }
+    std::size_t size() const { return count; }
+
+ private:
+    template <typename, std::size_t> friend class TopicRouter;
+
+    std::array<std::string_view, N> values{};
+    std::size_t count = 0;
+};
+
+/**
+ * 基于前缀树的 MQTT topic 路由器
+ *
+ * 按 MQTT 3.1.1 语义在模式上注册处理器：'+' 匹配单个层级，'#' 匹配其后任意层级（须位于末尾），
+ * 以 '$' 开头的 topic 不会被首层通配符匹配。
+ *
+ * add() 只构建可变的前缀树；compile() 把它压平成连续的节点/边数组，边按字面量排序后二分查找。
+ * 匹配过程只做切片与比较，捕获存放在栈上的 TopicCaptures 中，每条消息零堆分配。
+ * 同一模式重复注册时覆盖旧处理器。add() 之后必须重新 compile() 才会生效。
+ *
+ * @tparam Handler      处理器类型（函数对象、枚举等任意可拷贝类型）
+ * @tparam MaxCaptures  单个模式允许的最大通配符数量
+ */
+template <typename Handler, std::size_t MaxCaptures = 8>
+class TopicRouter {
+ public:
+    using Captures = TopicCaptures<MaxCaptures>;
+
+    /// 注册模式，模式非法时抛出 std::invalid_argument
+    void add(std::string_view pattern, Handler handler) {
+        std::size_t n_wildcards = 0;
+        uint32_t node = 0;
+        if (build.empty()) {
+            build.emplace_back();
+        }
+        std::size_t pos = 0;
+        while (true) {
+            std::size_t slash = pattern.find('/', pos);
+            std::string_view level = pattern.substr(pos, slash == std::string_view::npos ? std::string_view::npos : slash - pos);
+            bool last = slash == std::string_view::npos;
+            if (level == "#") {
+                if (!last) {
+                    throw std::invalid_argument("'#' must be the last level of a topic filter");
+                }
+                ++n_wildcards;
+                node = child(node, &BuildNode::hash);
+            } else if (level == "+") {
+                ++n_wildcards;
+                node = child(node, &BuildNode::plus);
+            } else {
+                if (level.find_first_of("+#") != std::string_view::npos) {
+                    throw std::invalid_argument("wildcards must occupy an entire topic level");
+                }
+                node = literal_child(node, level);
+            }
+            if (last) {
+                break;
+            }
+            pos = slash + 1;
+        }
+        if (n_wildcards > MaxCaptures) {
+            throw std::invalid_argument("too many wildcards in topic filter");
+        }
+        if (build[node].route == NONE) {
+            build[node].route = static_cast<uint32_t>(handlers.size());
+            handlers.push_back(std::move(handler));
+        } else {
+            handlers[build[node].route] = std::move(handler);
+        }
+        dirty = true;
+    }
+
+    /// 把前缀树压平为只读数组；注册完成后调用一次
+    void compile() {
+        nodes.clear();
+        edges.clear();
+        labels.clear();
+        nodes.reserve(build.size());
+        for (const auto& b : build) {
+            Node n;
+            n.edge_begin = static_cast<uint32_t>(edges.size());
+            n.edge_count = static_cast<uint32_t>(b.children.size());
+            n.plus = b.plus;
+            n.hash = b.hash;
+            n.route = b.route;
+            for (const auto& [label, target] : b.children) {  // children 已按字面量有序
+                edges.push_back({static_cast<uint32_t>(labels.size()), static_cast<uint32_t>(label.size()), target});
+                labels += label;
+            }
+            nodes.push_back(n);
+        }
+        dirty = false;
+    }
+
+    bool compiled() const { return !dirty && !nodes.empty(); }
+    std::size_t size() const { return handlers.size(); }
+
+    /**
+     * 匹配 topic，对每个命中的模式调用 visitor(const Handler&, const Captures&)
+     *
+     * 命中顺序为：字面量优先，其次 '+'，最后 '#'。
+     * visitor 返回 bool 时，返回 false 表示停止后续匹配。
+     *
+     * @return 命中的模式数量
+     */
+    template <typename Visitor>
+    std::size_t match(std::string_view topic, Visitor&& visitor) const {
+        if (!compiled()) {
+            return 0;
+        }
+        Captures captures;
+        std::size_t n_matched = 0;
+        bool stop = false;
+        walk(0, topic, true, captures, visitor, n_matched, stop);
+        return n_matched;
+    }
+
+    /// 返回第一个命中的处理器（按上述优先级），未命中返回 nullptr
+    const Handler* match_one(std::string_view topic, Captures& captures) const {
+        const Handler* found = nullptr;
+        match(topic, [&](const Handler& handler, const Captures& caps) {
+            found = &handler;
+            captures = caps;
+            return false;
+        });
+        return found;
+    }
+
+ private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    static constexpr uint32_t LINEAR_SCAN_EDGES = 8;
+
+    struct BuildNode {
+        std::vector<std::pair<std::string, uint32_t>> children;  // 按字面量有序
+        uint32_t plus = NONE;
+        uint32_t hash = NONE;
+        uint32_t route = NONE;
+    };
+
+    struct Node {
+        uint32_t edge_begin = 0;
+        uint32_t edge_count = 0;
+        uint32_t plus = NONE;
+        uint32_t hash = NONE;
+        uint32_t route = NONE;
+    };
+
+    struct Edge {
+        uint32_t label_offset;
+        uint32_t label_length;
+        uint32_t target;
+    };
+
+    std::vector<BuildNode> build;
+    std::vector<Handler> handlers;
+    std::vector<Node> nodes;
+    std::vector<Edge> edges;
+    std::string labels;  // 所有字面量层级连续存放
+    bool dirty = true;
+
+    uint32_t child(uint32_t node, uint32_t BuildNode::*slot) {
+        if (build[node].*slot == NONE) {
+            auto created = static_cast<uint32_t>(build.size());
+            build.emplace_back();
+            build[node].*slot = created;
+        }
+        return build[node].*slot;
+    }
+
+    uint32_t literal_child(uint32_t node, std::string_view level) {
+        auto& children = build[node].children;
+        auto it = std::lower_bound(children.begin(), children.end(), level,
+                                   [](const auto& c, std::string_view l) { return std::string_view(c.first) < l; });
+        if (it != children.end() && it->first == level) {
+            return it->second;
+        }
+        auto created = static_cast<uint32_t>(build.size());
+        children.insert(it, {std::string(level), created});
+        build.emplace_back();
+        return created;
+    }
+
+    uint32_t find_edge(const Node& node, std::string_view level) const {
+        const Edge* first = edges.data() + node.edge_begin;
+        const Edge* last = first + node.edge_count;
+        if (node.edge_count <= LINEAR_SCAN_EDGES) {
+            // 分支较少时先比长度再比内容，比二分查找更快
+            for (const Edge* it = first; it != last; ++it) {
+                if (it->label_length == level.size()
+                    && std::char_traits<char>::compare(labels.data() + it->label_offset, level.data(), level.size()) == 0) {
+                    return it->target;
+                }
+            }
+            return NONE;
+        }
+        const Edge* it = std::lower_bound(first, last, level, [this](const Edge& e, std::string_view l) {
+            return std::string_view(labels.data() + e.label_offset, e.label_length) < l;
+        });
+        if (it != last && std::string_view(labels.data() + it->label_offset, it->label_length) == level) {
+            return it->target;
+        }
+        return NONE;
+    }
+
+    template <typename Visitor>
+    void emit(uint32_t route, Captures& captures, Visitor& visitor, std::size_t& n_matched, bool& stop) const {
+        ++n_matched;
+        if constexpr (std::is_same_v<std::invoke_result_t<Visitor&, const Handler&, const Captures&>, bool>) {
+            stop = !visitor(handlers[route], static_cast<const Captures&>(captures));
+        } else {
+            visitor(handlers[route], static_cast<const Captures&>(captures));
+        }
+    }
+
+    /// rest 为尚未匹配的 topic 部分（至少还有一个层级）
+    template <typename Visitor>
+    void walk(uint32_t index, std::string_view rest, bool first_level, Captures& captures,
+              Visitor& visitor, std::size_t& n_matched, bool& stop) const {
+        const Node& node = nodes[index];
+        std::size_t slash = rest.find('/');
+        std::string_view level = rest.substr(0, slash);
+        bool last = slash == std::string_view::npos;
+        bool wildcard_ok = !(first_level && level.starts_with('$'));
+
+        uint32_t next = find_edge(node, level);
+        if (next != NONE) {
+            descend(next, last, rest.substr(last ? rest.size() : slash + 1), captures, visitor, n_matched, stop);
+            if (stop) return;
+        }
+        if (wildcard_ok && node.plus != NONE) {
+            captures.values[captures.count++] = level;
+            descend(node.plus, last, rest.substr(last ? rest.size() : slash + 1), captures, visitor, n_matched, stop);
+            --captures.count;
+            if (stop) return;
+        }
+        if (wildcard_ok && node.hash != NONE && nodes[node.hash].route != NONE) {
+            captures.values[captures.count++] = rest;
+            emit(nodes[node.hash].route, captures, visitor, n_matched, stop);
+            --captures.count;
+        }
+    }
+
+    template <typename Visitor>
+    void descend(uint32_t index, bool consumed, std::string_view rest, Captures& captures,
+                 Visitor& visitor, std::size_t& n_matched, bool& stop) const {
+        if (!consumed) {
+            walk(index, rest, false, captures, visitor, n_matched, stop);
+            return;
+        }
+        // topic 已全部匹配：命中当前节点；"a/#" 同样匹配 "a"（'#' 匹配零个层级）
+        const Node& node = nodes[index];
+        if (node.route != NONE) {
+            emit(node.route, captures, visitor, n_matched, stop);
+            if (stop) return;
+        }
+        if (node.hash != NONE && nodes[node.hash].route != NONE) {
+            captures.values[captures.count++] = std::string_view();
+            emit(nodes[node.hash].route, captures, visitor, n_matched, stop);
+            --captures.count;
+        }
+    }
+};
+
+}  // namespace ahoh::mqtt
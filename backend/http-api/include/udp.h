@@ -1,48 +1,243 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
+#include "discovery.h"
+#include "lifecycle.h"
+#include "runtime.h"
+
+// 每次 recvmmsg / sendmmsg 系统调用最多处理的报文数
+#ifndef UDP_BATCH_SIZE
+#define UDP_BATCH_SIZE 64
+#endif
+
+// 每个套接字的接收缓冲区大小（字节）：断电恢复后大量设备同时广播，系统默认的缓冲区会溢出丢包；
+// 实际上限受 net.core.rmem_max 限制
+#ifndef UDP_RCVBUF_BYTES
+#define UDP_RCVBUF_BYTES (1024 * 1024)
+#endif
+
+// 收发路径的日志间隔：期间的请求与错误只计数，每个间隔最多输出一条汇总
+#ifndef UDP_LOG_INTERVAL_MS
+#define UDP_LOG_INTERVAL_MS 5000
+#endif
+
+// 响应工作线程数，每个线程一个 SO_REUSEPORT 套接字；0 表示取 std::thread::hardware_concurrency()
+#ifndef UDP_WORKERS
+#define UDP_WORKERS 0
+#endif
+
+// 每个来源 IP 在 UDP_LIMIT_WINDOW_MS 内最多回复的次数（令牌桶容量，按窗口长度匀速补充）；
+// 0 表示不限速。设备正常启动只需一次回复，上限只约束广播风暴与伪造来源的泛洪。
+// 默认关闭：仓库自带的部署经 nginx（backend/nginx.conf 的 stream 代理）转发发现请求，
+// 本服务看到的来源都是 nginx 的地址，按来源限速会让整个设备群共用一个配额。
+// 只有设备直接访问本服务（或 nginx 配置了 proxy_bind $remote_addr transparent）时才应开启
+#ifndef UDP_LIMIT_REPLIES
+#define UDP_LIMIT_REPLIES 0
+#endif
+
+#ifndef UDP_LIMIT_WINDOW_MS
+#define UDP_LIMIT_WINDOW_MS 10000
+#endif
+
+// 每个工作线程的限速表槽位数（向上取整为 2 的幂，每 4 个槽位一组占一个缓存行）
+#ifndef UDP_LIMIT_SLOTS
+#define UDP_LIMIT_SLOTS 4096
+#endif
+
+// 是否加入发现协议的组播组（ahoh::discovery::MULTICAST_GROUP）；加入失败时仍应答广播与单播
+#ifndef UDP_JOIN_MULTICAST
+#define UDP_JOIN_MULTICAST 1
+#endif
 
 namespace ahohs::udp_server {
 
+/// 累计计数快照（所有工作线程之和）
+struct UdpStats {
+    uint64_t received = 0;     // 收到的报文
+    uint64_t replied = 0;      // 成功发出的回复
+    uint64_t ignored = 0;      // 非发现请求的报文
+    uint64_t send_failed = 0;  // 发送失败（如发送缓冲区已满）而未回复的请求
+    uint64_t rate_limited = 0; // 来源超过回复上限而被丢弃的请求
+    uint64_t cached = 0;       // 同一来源窗口内的重复请求，未重新校验内容直接回复（含被限速的）
+    uint64_t v2 = 0;           // 按 v2（二进制）格式回复的请求
+};
+
+/// v2 回复中声明的服务端能力，v1 回复不包含这些字段
+struct ServerCapabilities {
+    bool http_tls = false;
+    bool mqtt_tls = false;
+    uint8_t schemas = ahoh::discovery::SCHEMA_V1 | ahoh::discovery::SCHEMA_V2;  // 接受的属性负载编码
+    std::string server_id;  // 同一网段有多个服务端时供设备区分，最多 ahoh::discovery::MAX_SERVER_ID 字节
+};
+
+/**
+ * 按来源 IP 的回复限速表
+ *
+ * 定长组相联表：IP 哈希到一组 4 个槽位（一个缓存行），组内找不到时淘汰最久未活动的槽位，
+ * 因此内存固定、查找只访问一个缓存行，伪造来源的泛洪最多冲掉其他来源的状态
+ * （被冲掉的来源重新获得满额令牌，只会多回复，不会误拒）。
+ * 每个槽位是一个令牌桶：容量 replies，每 window_ms 补满，空闲越久令牌恢复越多。
+ *
+ * 非线程安全：每个工作线程持有一个实例，同一来源总是由同一工作线程处理。
+ */
+class SourceLimiter {
+ public:
+    struct Entry {
+        uint32_t ip = 0;               // 网络字节序，0 表示空槽位
+        uint32_t last_ms = 0;          // 上次补充令牌的时刻
+        float tokens = 0;
+        uint16_t request_len = 0;      // 本窗口内已校验过的请求长度，0 表示尚未校验
+        uint16_t validated_window = 0; // 校验时的窗口序号（取低 16 位）
+    };
+
+    explicit SourceLimiter(std::size_t slots = UDP_LIMIT_SLOTS,
+                           uint32_t replies = UDP_LIMIT_REPLIES,
+                           uint32_t window_ms = UDP_LIMIT_WINDOW_MS);
+
+    bool enabled() const { return replies > 0; }
+
+    /// 查找来源对应的槽位，不存在时占用所在组中最久未活动的槽位（满额令牌）
+    Entry& find(uint32_t ip, uint32_t now_ms);
+
+    /// 按经过的时间补充令牌后尝试消耗一个，返回是否允许回复
+    bool allow(Entry& entry, uint32_t now_ms) const;
+
+    /// 该来源在当前窗口内是否已发过同样长度且通过校验的请求
+    bool validated(const Entry& entry, std::size_t len, uint32_t now_ms) const {
+        return entry.request_len == len && entry.validated_window == window_of(now_ms);
+    }
+    void mark_validated(Entry& entry, std::size_t len, uint32_t now_ms) const {
+        entry.request_len = static_cast<uint16_t>(len);
+        entry.validated_window = window_of(now_ms);
+    }
+
+ private:
+    struct alignas(64) Group {
+        Entry ways[4];
+    };
+
+    std::vector<Group> groups;
+    std::size_t mask;  // 组数为 2 的幂，mask = 组数 - 1
+    uint32_t replies;
+    uint32_t window_ms;
+
+    uint16_t window_of(uint32_t now_ms) const { return static_cast<uint16_t>(now_ms / window_ms); }
+};
+
+/**
+ * UDP 发现响应器
+ *
+ * 每个工作线程持有一个绑定在同一端口上的 SO_REUSEPORT 套接字，用各自的 epoll 等待
+ * 套接字与生命周期停止事件。单播请求由内核在套接字间分发；广播报文内核会复制给
+ * 组内每个套接字，因此每个套接字挂一个按来源 IP 取模的 BPF 过滤器，只保留属于自己的那份，
+ * 并用同样的规则选择单播的目标套接字，保证每个请求只被回复一次。
+ * 过滤器无法挂载时退回单线程。
+ *
+ * 同时应答 v1（文本请求、JSON 回复）与 v2（二进制，见 discovery.h）两种请求，
+ * 并加入 v2 的组播组，设备可以只向组播地址发送请求而不依赖子网广播。
+ */
 class UdpResponder {
  public:
     /**
      * 构造函数
      *
+     * 回复内容只与以下参数有关，在此一次序列化完成，之后每个请求原样发送（v2 回复只需填入请求的 nonce）。
+     * IP 不是点分十进制地址（如主机名）时，v2 回复中该字段为 0.0.0.0，设备使用回复的来源地址。
+     *
      * @param server_ip         服务器自身的 IP 地址，用于回复
      * @param server_port       服务器 HTTP 服务端口，用于回复
      * @param mqtt_broker_ip    MQTT Broker 的 IP 地址，用于回复
      * @param mqtt_broker_port  MQTT Broker 的端口，用于回复
-     * @param port              监听的 UDP 端口（默认 8888）
+     * @param port              监听的 UDP 端口（默认 8888，为 0 时由系统分配）
+     * @param n_workers         工作线程数，0 表示取 CPU 核数
+     * @param limit_replies     每个来源 IP 每个限速窗口内最多回复的次数，0 表示不限速
      */
     UdpResponder(const std::string& server_ip,
                  uint16_t server_port,
                  const std::string& mqtt_broker_ip,
                  uint16_t mqtt_broker_port,
-                 uint16_t port = 8888);
+                 uint16_t port = 8888,
+                 std::size_t n_workers = UDP_WORKERS,
+                 uint32_t limit_replies = UDP_LIMIT_REPLIES);
     ~UdpResponder();
 
+    // 工作线程持有指向本对象的指针，不可复制或移动
     UdpResponder(const UdpResponder&) = delete;
     UdpResponder& operator=(const UdpResponder&) = delete;
-    UdpResponder(UdpResponder&&) noexcept = default;
-    UdpResponder& operator=(UdpResponder&&) noexcept = default;
 
-    /// 启动 UDP 监听与回复，循环处理接收到的广播消息
-    void start();
+    /**
+     * 启动所有工作线程并阻塞，直到生命周期控制器请求停止
+     *
+     * 调用线程自身充当第 0 个工作线程；返回前等待其余工作线程退出。
+     */
+    void start(const ahohs::lifecycle::Lifecycle& lifecycle);
+
+    /**
+     * 在共享事件循环上等待所有套接字可读后立即返回，由 stop() 停止
+     *
+     * 每个套接字同一时刻只有一个等待，处理函数之间不会并发访问同一个 Worker；
+     * 可读后的处理与 start(lifecycle) 相同（按批读空并回复）。
+     */
+    void start(ahohs::runtime::Runtime& runtime);
+    /// 停止 start(runtime)：取消所有等待，返回时不再有处理函数在运行
+    void stop();
+
+    /// 在调用线程上读空所有套接字一次并回复，返回收到的报文数；用于不启动工作线程的场景（如基准测试）
+    std::size_t poll();
+
+    /// 设置 v2 回复中的能力字段，需在 start() 之前调用
+    void set_capabilities(const ServerCapabilities& caps);
+
+    /// 实际监听的端口
+    uint16_t local_port() const { return port; }
+
+    /// 实际启用的工作线程（套接字）数
+    std::size_t worker_count() const { return workers.size(); }
+
+    /// 可在其他线程调用
+    UdpStats stats() const;
 
  private:
-    std::string server_ip;
-    uint16_t server_port;
-    std::string mqtt_broker_ip;
-    uint16_t mqtt_broker_port;
+    struct Worker;  // 一个套接字及其批量收发的报文头、缓冲区与计数器
+
     uint16_t port;  // UDP 监听端口
-    int sock_fd;
+    std::string reply;  // 预先序列化的 v1 回复
+    ahoh::discovery::Offer offer;  // v2 回复的字段
+    std::string offer_template;    // 预先序列化的 v2 回复，nonce 为 0
+    uint32_t limit_replies;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();  // 限速表的时间起点
+
+    // start(runtime) 时使用
+    ahohs::runtime::Runtime* runtime = nullptr;
+    std::unique_ptr<ahohs::runtime::Timer> report_timer;
+    std::atomic<bool> stopping{false};
 
-    static constexpr std::string_view UDP_DISCOVER_MSG = "AHOH_DISCOVER_SERVER";
+    // 日志汇总，只由第 0 个工作线程（共享事件循环下为 report_timer）访问
+    std::chrono::steady_clock::time_point last_report;
+    UdpStats reported;
+    uint64_t reported_errors = 0;
 
-    bool init_socket();
-    void listen_and_respond();
+    /// 创建并绑定 n 个套接字，返回实际可用的个数
+    std::size_t init_sockets(std::size_t n);
+    int open_socket(std::size_t index, std::size_t n);
+    /// 工作线程主循环：等待套接字可读或停止事件
+    void run(Worker& worker, const ahohs::lifecycle::Lifecycle& lifecycle);
+    /// 在共享事件循环上等待套接字可读，处理后再次等待
+    void watch(Worker& worker);
+    /// 读空套接字：按批接收，筛出发现请求后按批回复（第 i 个回复使用第 i 个发送缓冲区）
+    void listen_and_respond(Worker& worker);
+    /// 发出 send_hdrs 中前 n 个回复
+    void send_replies(Worker& worker, unsigned n);
+    /// 距上次汇总超过 UDP_LOG_INTERVAL_MS 时输出本间隔内的计数与错误
+    void report();
 };
 
 }  // namespace ahohs::udp_server
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+// 单个段文件写满该大小后切换到新段
+#ifndef WAL_SEGMENT_BYTES
+#define WAL_SEGMENT_BYTES (64u << 20)
+#endif
+
+// 日志总大小上限，超过时丢弃最旧的段（即使尚未回放）
+#ifndef WAL_MAX_BYTES
+#define WAL_MAX_BYTES (1024ull << 20)
+#endif
+
+// 组提交间隔：追加后最多经过该时间才 fdatasync，期间的多次追加共用一次
+#ifndef WAL_SYNC_INTERVAL_MS
+#define WAL_SYNC_INTERVAL_MS 50
+#endif
+
+namespace ahohs::wal {
+
+/// 一条记录为一批行，每行若干文本字段（与 PostgresDB::exec_prepared_batch 的参数一致）
+using Rows = std::vector<std::vector<std::string>>;
+
+/// 日志计数，均为单调递增
+struct WalStats {
+    uint64_t appended = 0;          // 追加的记录数
+    uint64_t appended_bytes = 0;
+    uint64_t syncs = 0;             // fdatasync 次数
+    uint64_t consumed = 0;          // 已确认（回放成功）的记录数
+    uint64_t corrupt = 0;           // 校验失败而跳过剩余部分的段
+    uint64_t dropped_segments = 0;  // 超过大小上限而丢弃的段
+    uint64_t dropped_bytes = 0;
+};
+
+/// CRC-32C（Castagnoli）
+uint32_t crc32c(const void* data, std::size_t size, uint32_t crc = 0);
+
+/**
+ * 本地预写日志（write-ahead log）
+ *
+ * 目录下按序号命名的段文件（0000000000000001.wal ...）只追加写入，每条记录为
+ * [长度 u32][CRC-32C u32][负载]，负载是一批行的二进制编码（主机字节序，仅供本机回放）。
+ * - 组提交：append() 只 write()，距上次 fdatasync 超过 sync_interval 时才同步，
+ *   调用方空闲时再以 sync() 补齐；崩溃最多丢失最近 sync_interval 内的记录。
+ * - 有序回放：read() 从已确认位置起按写入顺序读取，consume() 确认后前移，
+ *   读完的段随即删除。确认位置记入 checkpoint 文件（不 fsync），
+ *   因此崩溃重启后最近确认的少量记录可能被再次回放（至少一次）。
+ * - 大小上限：总大小超过 max_bytes 时丢弃最旧的段并计数。
+ * - 启动时扫描已有段，截断最后一段末尾不完整的记录，未确认的记录在重启后继续回放。
+ *
+ * append() / sync() 由一个写线程调用，read() / consume() 由一个回放线程调用，两者可以并发。
+ * 目录无法创建或打开时构造函数抛出 std::runtime_error。
+ */
+class WriteAheadLog {
+ public:
+    explicit WriteAheadLog(std::string dir,
+                           std::size_t segment_bytes = WAL_SEGMENT_BYTES,
+                           std::size_t max_bytes = WAL_MAX_BYTES,
+                           std::chrono::milliseconds sync_interval = std::chrono::milliseconds(WAL_SYNC_INTERVAL_MS));
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    /// 追加一条记录，写入失败（如磁盘已满）返回 false
+    bool append(const Rows& rows);
+    /// 有未同步的追加时 fdatasync；force 为 false 时只在距上次同步超过 sync_interval 时执行
+    void sync(bool force = false);
+
+    /// 从已确认位置起读取至少一条、累计不超过 max_rows 行的完整记录追加到 rows，返回读到的记录数
+    std::size_t read(Rows& rows, std::size_t max_rows);
+    /// 确认上一次 read() 读到的全部记录
+    void consume();
+
+    /// 尚未确认的字节数（近似，含段头）
+    uint64_t backlog_bytes() const;
+    WalStats stats() const;
+
+    static void encode(const Rows& rows, std::string& out);
+    static bool decode(std::string_view payload, Rows& rows);
+
+ private:
+    struct Segment {
+        uint64_t seq;
+        uint64_t size;
+    };
+
+    /// 日志中的位置：段序号 + 段内偏移
+    struct Position {
+        uint64_t seq = 0;
+        uint64_t offset = 0;
+    };
+
+    std::string dir;
+    std::size_t segment_bytes;
+    std::size_t max_bytes;
+    std::chrono::milliseconds sync_interval;
+
+    mutable std::mutex mtx;
+    std::deque<Segment> segments;  // 按序号递增，最后一个为当前写入段
+    uint64_t total_bytes = 0;
+    int write_fd = -1;
+    bool unsynced = false;
+    std::chrono::steady_clock::time_point last_sync;
+    std::string buffer;            // 编码缓冲，复用以免每次分配
+
+    Position cursor;               // 已确认位置
+    Position read_end;             // 上一次 read() 的结束位置
+    std::size_t read_count = 0;    // 上一次 read() 读到的记录数
+    int read_fd = -1;
+    uint64_t read_seq = 0;         // read_fd 对应的段
+    int checkpoint_fd = -1;
+    WalStats counters;
+
+    std::string segment_path(uint64_t seq) const;
+    void recover();
+    uint64_t scan_valid(int fd, uint64_t size) const;
+    bool open_segment(uint64_t seq);
+    void drop_oldest();
+    void commit();
+    void save_checkpoint();
+
+    inline static std::shared_ptr<spdlog::logger> logger = spdlog::stdout_color_mt("wal");
+};
+
+}  // namespace ahohs::wal
@@ -0,0 +1,601 @@
+#include "device.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string_view>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/write.hpp>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "discovery.h"
+
+namespace ahohs::loadgen {
+
+namespace asio = boost::asio;
+using asio::awaitable;
+using asio::ip::tcp;
+using asio::ip::udp;
+using boost::system::error_code;
+
+static auto logger = spdlog::stdout_color_mt("loadgen_device");
+
+// 与固件一致：各阶段失败后等待 3 秒重试
+static constexpr auto RETRY_DELAY = std::chrono::seconds(3);
+// PUBACK 按 packet id 取模记录发送时刻，同时未确认的发布超过此数时延迟样本不准确
+static constexpr std::size_t INFLIGHT_SLOTS = 16;
+
+namespace {
+
+auto with_ec(error_code& ec) {
+    return asio::redirect_error(asio::use_awaitable, ec);
+}
+
+/**
+ * 到期时取消 socket 上所有未完成的操作
+ *
+ * 析构时撤销；到期回调可能在 socket 销毁后才执行，因此通过共享标志判断是否仍然有效。
+ */
+template <typename Socket>
+class Deadline {
+ public:
+    Deadline(Socket& socket, Clock::time_point at)
+        : timer(socket.get_executor(), at),
+          armed(std::make_shared<bool>(true)) {
+        timer.async_wait([&socket, armed = armed](const error_code& ec) {
+            if (!ec && *armed) {
+                error_code ignored;
+                socket.cancel(ignored);
+            }
+        });
+    }
+    Deadline(Socket& socket, std::chrono::milliseconds timeout) : Deadline(socket, Clock::now() + timeout) {}
+
+    ~Deadline() {
+        *armed = false;
+        timer.cancel();
+    }
+
+    Deadline(const Deadline&) = delete;
+    Deadline& operator=(const Deadline&) = delete;
+
+ private:
+    asio::steady_timer timer;
+    std::shared_ptr<bool> armed;
+};
+
+awaitable<void> sleep_until(Clock::time_point at) {
+    asio::steady_timer timer(co_await asio::this_coro::executor, at);
+    error_code ec;
+    co_await timer.async_wait(with_ec(ec));
+}
+
+uint32_t random_nonce() {
+    thread_local std::mt19937 rng{std::random_device{}()};
+    return static_cast<uint32_t>(rng());
+}
+
+/// 打开 socket，目标为本机时绑定该设备的来源地址
+template <typename Socket, typename Endpoint>
+bool open_bound(Socket& socket, const Fleet& fleet, std::size_t index, const Endpoint& target) {
+    error_code ec;
+    socket.open(target.protocol(), ec);
+    if (ec) {
+        logger->debug("open socket for device {} failed: {}", index, ec.message());
+        return false;
+    }
+    const auto source = fleet.source_address(index, target.address());
+    if (!source.is_unspecified()) {
+        socket.bind(Endpoint(source, 0), ec);
+        if (ec) {
+            logger->debug("bind {} for device {} failed: {}", source.to_string(), index, ec.message());
+            return false;
+        }
+    }
+    return true;
+}
+
+// ===== MQTT 3.1.1 报文 =====
+
+void put_u16(std::string& out, uint16_t v) {
+    out.push_back(static_cast<char>(v >> 8));
+    out.push_back(static_cast<char>(v & 0xff));
+}
+
+void put_str(std::string& out, std::string_view s) {
+    put_u16(out, static_cast<uint16_t>(s.size()));
+    out.append(s);
+}
+
+std::string packet(uint8_t header, std::string_view body) {
+    std::string out;
+    out.reserve(body.size() + 5);
+    out.push_back(static_cast<char>(header));
+    std::size_t len = body.size();
+    do {
+        uint8_t b = len & 0x7f;
+        len >>= 7;
+        out.push_back(static_cast<char>(len > 0 ? b | 0x80 : b));
+    } while (len > 0);
+    out.append(body);
+    return out;
+}
+
+/// CONNECT：clean session，遗嘱与固件相同（QoS 1 的 /device/{id}/will）
+std::string encode_connect(const std::string& client_id, std::chrono::seconds keepalive, bool will) {
+    std::string body;
+    put_str(body, "MQTT");
+    body.push_back(4);  // 3.1.1
+    body.push_back(static_cast<char>(will ? 0x02 | 0x04 | 0x08 : 0x02));
+    put_u16(body, static_cast<uint16_t>(std::min<int64_t>(keepalive.count(), 0xffff)));
+    put_str(body, client_id);
+    if (will) {
+        put_str(body, "/device/" + client_id + "/will");
+        put_str(body, R"({"status":"offline","will":"connection lost"})");
+    }
+    return packet(0x10, body);
+}
+
+std::string encode_publish(std::string_view topic, std::string_view payload, int qos, uint16_t packet_id) {
+    std::string body;
+    body.reserve(topic.size() + payload.size() + 4);
+    put_str(body, topic);
+    if (qos > 0) {
+        put_u16(body, packet_id);
+    }
+    body.append(payload);
+    return packet(static_cast<uint8_t>(0x30 | (qos << 1)), body);
+}
+
+uint16_t read_u16(std::string_view in, std::size_t at) {
+    return static_cast<uint16_t>(static_cast<uint8_t>(in[at]) << 8 | static_cast<uint8_t>(in[at + 1]));
+}
+
+/// 从 TCP 流中切分 MQTT 报文，缓冲区定长
+class PacketReader {
+ public:
+    explicit PacketReader(std::size_t capacity) : buf(capacity) {}
+
+    /// 读取下一个报文，body 在下次调用前有效；连接关闭、出错或报文超过缓冲区时返回 false
+    awaitable<bool> next(tcp::socket& socket, uint8_t& header, std::string_view& body) {
+        if (consumed > 0) {
+            std::memmove(buf.data(), buf.data() + consumed, have - consumed);
+            have -= consumed;
+            consumed = 0;
+        }
+        while (true) {
+            std::size_t len = 0;
+            std::size_t pos = 1;
+            bool complete = false;
+            while (pos < have && pos < 5) {
+                const auto b = static_cast<uint8_t>(buf[pos]);
+                len |= static_cast<std::size_t>(b & 0x7f) << (7 * (pos - 1));
+                ++pos;
+                if (!(b & 0x80)) {
+                    complete = true;
+                    break;
+                }
+            }
+            if (!complete && pos >= 5) {
+                co_return false;  // 剩余长度字段超过 4 字节
+            }
+            if (complete) {
+                if (pos + len > buf.size()) {
+                    co_return false;
+                }
+                if (have >= pos + len) {
+                    header = static_cast<uint8_t>(buf[0]);
+                    body = std::string_view(buf.data() + pos, len);
+                    consumed = pos + len;
+                    co_return true;
+                }
+            }
+            error_code ec;
+            const std::size_t n = co_await socket.async_read_some(asio::buffer(buf.data() + have, buf.size() - have),
+                                                                  with_ec(ec));
+            if (ec) {
+                co_return false;
+            }
+            have += n;
+        }
+    }
+
+ private:
+    std::vector<char> buf;
+    std::size_t have = 0;
+    std::size_t consumed = 0;
+};
+
+/// 一条 MQTT 连接：主协程负责全部写操作，读协程只处理 PUBACK / PINGRESP
+struct Session {
+    tcp::socket socket;
+    PacketReader reader;
+    Stats& stats;
+    bool closed = false;
+    Clock::time_point last_write;
+    uint16_t next_packet_id = 1;
+    std::array<Clock::time_point, INFLIGHT_SLOTS> inflight{};
+
+    Session(const asio::any_io_executor& ex, Stats& stats, std::size_t buffer_size)
+        : socket(ex), reader(buffer_size), stats(stats) {}
+
+    uint16_t take_packet_id() {
+        const uint16_t id = next_packet_id;
+        next_packet_id = next_packet_id == 0xffff ? 1 : next_packet_id + 1;
+        return id;
+    }
+
+    awaitable<bool> send(std::string data) {
+        error_code ec;
+        co_await asio::async_write(socket, asio::buffer(data), with_ec(ec));
+        if (ec) {
+            closed = true;
+            co_return false;
+        }
+        last_write = Clock::now();
+        co_return true;
+    }
+};
+
+/// 建立 MQTT 连接并等待 CONNACK
+awaitable<std::shared_ptr<Session>> mqtt_connect(const Fleet& fleet, std::size_t index, const tcp::endpoint& broker,
+                                                 const std::string& client_id, bool will, std::size_t buffer_size) {
+    auto session = std::make_shared<Session>(co_await asio::this_coro::executor, fleet.stats, buffer_size);
+    if (!open_bound(session->socket, fleet, index, broker)) {
+        co_return nullptr;
+    }
+    Deadline deadline(session->socket, fleet.config.timeout);
+    const auto begin = Clock::now();
+    error_code ec;
+    co_await session->socket.async_connect(broker, with_ec(ec));
+    if (ec) {
+        logger->debug("device {} connect to broker failed: {}", index, ec.message());
+        co_return nullptr;
+    }
+    if (!co_await session->send(encode_connect(client_id, fleet.config.keepalive, will))) {
+        co_return nullptr;
+    }
+    uint8_t header = 0;
+    std::string_view body;
+    if (!co_await session->reader.next(session->socket, header, body)) {
+        logger->debug("device {} got no CONNACK", index);
+        co_return nullptr;
+    }
+    if (header >> 4 != 2 || body.size() < 2 || body[1] != 0) {
+        logger->debug("device {} connection refused, return code {}", index, body.size() < 2 ? -1 : body[1]);
+        co_return nullptr;
+    }
+    fleet.stats.connect.record(Clock::now() - begin);
+    co_return session;
+}
+
+awaitable<void> read_acks(std::shared_ptr<Session> session) {
+    uint8_t header = 0;
+    std::string_view body;
+    while (co_await session->reader.next(session->socket, header, body)) {
+        if (header >> 4 == 4 && body.size() >= 2) {  // PUBACK
+            const uint16_t id = read_u16(body, 0);
+            session->stats.publish_ack.record(Clock::now() - session->inflight[id % INFLIGHT_SLOTS]);
+            session->stats.acked.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    session->closed = true;
+}
+
+// ===== 元数据 =====
+
+/// 与 mqtt_dummy.py 相同的温湿度传感器；v2 批量负载中的属性下标即 attrib 数组中的位置
+struct Attrib {
+    const char* topic;
+    bool is_bool;
+};
+constexpr Attrib ATTRIBS[] = {
+    {"/temperature", false},
+    {"/humidity", false},
+    {"/alert", true},
+};
+
+std::string meta_body(const std::string& device_id, const Config& config) {
+    const auto heartbeat = std::chrono::duration_cast<std::chrono::seconds>(config.heartbeat).count();
+    return R"({"device_id":")" + device_id + R"(","meta":{"type":["thermometer","hygrometer"],)" +
+           R"("desc":"load generator device","heartbeat_interval":)" + std::to_string(heartbeat) +
+           R"(,"attrib_schema":")" + config.schema + R"(","attrib":[)" +
+           R"({"topic":"/temperature","type":"float","desc":"temperature","rw":"r"},)" +
+           R"({"topic":"/humidity","type":"float","desc":"humidity","rw":"r"},)" +
+           R"({"topic":"/alert","type":"bool","desc":"alert","rw":"rw"}]}})";
+}
+
+/// 与固件 http_upload_meta() 相同：POST /api/device，响应状态为 200 / 201 即成功
+awaitable<bool> upload_meta_once(const Fleet& fleet, std::size_t index, const tcp::endpoint& server) {
+    tcp::socket socket(co_await asio::this_coro::executor);
+    if (!open_bound(socket, fleet, index, server)) {
+        co_return false;
+    }
+    Deadline deadline(socket, fleet.config.timeout);
+    const auto begin = Clock::now();
+    error_code ec;
+    co_await socket.async_connect(server, with_ec(ec));
+    if (ec) {
+        logger->debug("device {} connect to http server failed: {}", index, ec.message());
+        co_return false;
+    }
+    const std::string body = meta_body(fleet.device_id(index), fleet.config);
+    const std::string request = "POST /api/device HTTP/1.1\r\nHost: " + server.address().to_string() +
+                                "\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) +
+                                "\r\nConnection: close\r\n\r\n" + body;
+    co_await asio::async_write(socket, asio::buffer(request), with_ec(ec));
+    if (ec) {
+        co_return false;
+    }
+    std::string response;
+    co_await asio::async_read_until(socket, asio::dynamic_buffer(response, 1024), "\r\n", with_ec(ec));
+    if (ec) {
+        logger->debug("device {} got no http response: {}", index, ec.message());
+        co_return false;
+    }
+    // 状态行形如 "HTTP/1.1 200 OK"
+    const auto space = response.find(' ');
+    const std::string_view status = space == std::string::npos ? "" : std::string_view(response).substr(space + 1, 3);
+    if (status != "200" && status != "201") {
+        logger->debug("device {} meta upload rejected: {}", index, response.substr(0, response.find('\r')));
+        co_return false;
+    }
+    fleet.stats.meta_upload.record(Clock::now() - begin);
+    co_return true;
+}
+
+awaitable<bool> discover_once(const Fleet& fleet, std::size_t index, Endpoints& out) {
+    namespace discovery = ahoh::discovery;
+    const udp::endpoint& target = fleet.config.discovery_target;
+    udp::socket socket(co_await asio::this_coro::executor);
+    if (!open_bound(socket, fleet, index, target)) {
+        co_return false;
+    }
+    error_code ec;
+    socket.set_option(asio::socket_base::broadcast(true), ec);
+
+    const uint32_t nonce = random_nonce();
+    const std::string request = discovery::encode_request(nonce);
+    const auto begin = Clock::now();
+    co_await socket.async_send_to(asio::buffer(request), target, with_ec(ec));
+    if (ec) {
+        logger->debug("device {} discovery request failed: {}", index, ec.message());
+        co_return false;
+    }
+    Deadline deadline(socket, fleet.config.timeout);
+    std::array<char, discovery::MAX_OFFER_SIZE> buf;
+    udp::endpoint from;
+    while (true) {
+        const std::size_t n = co_await socket.async_receive_from(asio::buffer(buf), from, with_ec(ec));
+        if (ec) {
+            co_return false;
+        }
+        const auto offer = discovery::decode_offer(std::string_view(buf.data(), n));
+        if (!offer || offer->nonce != nonce) {
+            continue;
+        }
+        fleet.stats.discovery.record(Clock::now() - begin);
+        auto address = [&from](const discovery::Ipv4& ip) {
+            return discovery::is_unspecified(ip) ? from.address() : asio::ip::address(asio::ip::address_v4(ip));
+        };
+        out.http = tcp::endpoint(address(offer->http_ip), offer->http_port);
+        out.mqtt = tcp::endpoint(address(offer->mqtt_ip), offer->mqtt_port);
+        co_return true;
+    }
+}
+
+/// 重复 attempt 直到成功、重试次数用尽或整体停止
+template <typename Attempt>
+awaitable<bool> with_retries(const Fleet& fleet, Attempt attempt) {
+    for (int i = 0; i <= fleet.config.retries && !fleet.stopping.load(std::memory_order_relaxed); ++i) {
+        if (i > 0) {
+            co_await sleep_until(Clock::now() + RETRY_DELAY);
+        }
+        if (co_await attempt()) {
+            co_return true;
+        }
+    }
+    co_return false;
+}
+
+/// 与固件 mqtt_publish_task() 相同的单属性负载；v2 为 类型标签 + 小端数据，不带 seq
+std::string attrib_payload(const Attrib& attrib, std::mt19937& rng, uint32_t seq, bool v2) {
+    std::uniform_real_distribution<float> reading(20.0f, 30.0f);
+    if (v2) {
+        if (attrib.is_bool) {
+            return std::string(1, static_cast<char>(rng() % 10 == 0 ? 0x02 : 0x01));
+        }
+        const float value = reading(rng);
+        std::string out(1, static_cast<char>(0x03));
+        char bytes[4];
+        std::memcpy(bytes, &value, sizeof(bytes));  // 目标平台均为小端
+        out.append(bytes, sizeof(bytes));
+        return out;
+    }
+    char buf[64];
+    if (attrib.is_bool) {
+        std::snprintf(buf, sizeof(buf), R"({"value":%s,"seq":%u})", rng() % 10 == 0 ? "true" : "false", seq);
+    } else {
+        std::snprintf(buf, sizeof(buf), R"({"value":%.2f,"seq":%u})", reading(rng), seq);
+    }
+    return buf;
+}
+
+}  // namespace
+
+Fleet::Fleet(const Config& config, Stats& stats, Clock::time_point started)
+    : config(config),
+      stats(stats),
+      started(started),
+      ends(started + config.ramp + config.duration),
+      send_logs(config.devices) {}
+
+std::string Fleet::device_id(std::size_t index) const {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "%06zu", index);
+    return config.id_prefix + buf;
+}
+
+asio::ip::address_v4 Fleet::source_address(std::size_t index, const asio::ip::address& target) const {
+    if (!config.spread_loopback_sources || !target.is_loopback() || !target.is_v4()) {
+        return asio::ip::address_v4::any();
+    }
+    // 127.1.0.1 起连续分配，与 UDP 基准测试相同
+    return asio::ip::address_v4(0x7f010000u + static_cast<uint32_t>(index % 0xfe0000u) + 1);
+}
+
+awaitable<bool> discover(const Fleet& fleet, std::size_t index, Endpoints& out) {
+    co_return co_await with_retries(fleet, [&]() { return discover_once(fleet, index, out); });
+}
+
+awaitable<void> run_device(Fleet& fleet, std::size_t index) {
+    const Config& config = fleet.config;
+    Stats& stats = fleet.stats;
+    co_await sleep_until(fleet.started + config.ramp * index / std::max<std::size_t>(config.devices, 1));
+
+    Endpoints endpoints = config.endpoints;
+    if (config.discovery == DiscoveryMode::Every && !co_await discover(fleet, index, endpoints)) {
+        stats.failed_discovery.fetch_add(1, std::memory_order_relaxed);
+        co_return;
+    }
+    if (config.upload_meta &&
+        !co_await with_retries(fleet, [&]() { return upload_meta_once(fleet, index, endpoints.http); })) {
+        stats.failed_meta.fetch_add(1, std::memory_order_relaxed);
+        co_return;
+    }
+
+    const std::string id = fleet.device_id(index);
+    std::shared_ptr<Session> session;
+    co_await with_retries(fleet, [&]() -> awaitable<bool> {
+        session = co_await mqtt_connect(fleet, index, endpoints.mqtt, id, true, 256);
+        co_return session != nullptr;
+    });
+    if (!session) {
+        stats.failed_connect.fetch_add(1, std::memory_order_relaxed);
+        co_return;
+    }
+    stats.online.fetch_add(1, std::memory_order_relaxed);
+    asio::co_spawn(session->socket.get_executor(), read_acks(session), asio::detached);
+
+    // 属性发布时刻在一个间隔内随机错开，避免所有设备同时发布
+    std::mt19937 rng(static_cast<uint32_t>(index));
+    const bool v2 = config.schema == "v2";
+    const std::string heartbeat_topic = "/device/" + id + "/heartbeat";
+    const std::string attrib_prefix = "/device/" + id + "/attrib";
+    const auto ping_interval = std::chrono::duration_cast<Clock::duration>(config.keepalive) / 2;
+    auto next_heartbeat = Clock::now();
+    auto next_attrib = Clock::now() + std::chrono::milliseconds(rng() % std::max<int64_t>(config.attrib_interval.count(), 1));
+    uint32_t seq = 0;
+    std::size_t attrib_index = 0;
+
+    auto publish = [&](const std::string& topic, const std::string& payload) -> awaitable<bool> {
+        const uint16_t packet_id = config.qos > 0 ? session->take_packet_id() : 0;
+        session->inflight[packet_id % INFLIGHT_SLOTS] = Clock::now();
+        if (!co_await session->send(encode_publish(topic, payload, config.qos, packet_id))) {
+            co_return false;
+        }
+        stats.published.fetch_add(1, std::memory_order_relaxed);
+        co_return true;
+    };
+
+    while (!session->closed && !fleet.stopping.load(std::memory_order_relaxed)) {
+        const auto next = std::min({next_heartbeat, next_attrib, session->last_write + ping_interval, fleet.ends});
+        co_await sleep_until(next);
+        const auto now = Clock::now();
+        if (now >= fleet.ends || session->closed) {
+            break;
+        }
+        if (now >= next_heartbeat) {
+            const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - fleet.started).count();
+            if (!co_await publish(heartbeat_topic, R"({"timestamp":)" + std::to_string(ms) + R"(,"status":"online"})")) {
+                break;
+            }
+            next_heartbeat += config.heartbeat;
+        }
+        if (now >= next_attrib) {
+            const Attrib& attrib = ATTRIBS[attrib_index++ % std::size(ATTRIBS)];
+            ++seq;
+            fleet.send_logs[index].record(seq, Clock::now());
+            if (!co_await publish(attrib_prefix + attrib.topic, attrib_payload(attrib, rng, seq, v2))) {
+                break;
+            }
+            next_attrib += config.attrib_interval;
+        }
+        if (Clock::now() - session->last_write >= ping_interval && !co_await session->send(packet(0xc0, {}))) {
+            break;
+        }
+    }
+
+    stats.online.fetch_sub(1, std::memory_order_relaxed);
+    if (session->closed) {
+        stats.dropped.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        co_await session->send(packet(0xe0, {}));  // DISCONNECT：正常下线，broker 不发布遗嘱
+        stats.finished.fetch_add(1, std::memory_order_relaxed);
+    }
+    error_code ec;
+    session->socket.close(ec);
+}
+
+awaitable<void> run_observer(Fleet& fleet) {
+    const Config& config = fleet.config;
+    const std::string filter = "/device/+/attrib/#";
+    auto session = co_await mqtt_connect(fleet, config.devices, config.endpoints.mqtt, config.id_prefix + "observer",
+                                         false, 64 * 1024);
+    if (!session) {
+        logger->error("Observer failed to connect to {}:{}", config.endpoints.mqtt.address().to_string(),
+                      config.endpoints.mqtt.port());
+        co_return;
+    }
+    std::string subscribe;
+    put_u16(subscribe, 1);
+    put_str(subscribe, filter);
+    subscribe.push_back(0);  // QoS 0
+    if (!co_await session->send(packet(0x82, subscribe))) {
+        co_return;
+    }
+    // 所有设备断开后再多等一会儿收尾，然后结束读取
+    Deadline deadline(session->socket, fleet.ends + std::chrono::seconds(2));
+
+    const std::string prefix = "/device/" + config.id_prefix;
+    uint8_t header = 0;
+    std::string_view body;
+    while (co_await session->reader.next(session->socket, header, body)) {
+        if (header >> 4 != 3 || body.size() < 2) {
+            continue;
+        }
+        const auto now = Clock::now();
+        const std::size_t topic_len = read_u16(body, 0);
+        const std::string_view topic = body.substr(2, topic_len);
+        const std::size_t payload_at = 2 + topic_len + ((header & 0x06) ? 2 : 0);
+        if (!topic.starts_with(prefix) || payload_at > body.size()) {
+            continue;
+        }
+        std::size_t index = 0;
+        for (std::size_t i = prefix.size(); i < topic.size() && topic[i] >= '0' && topic[i] <= '9'; ++i) {
+            index = index * 10 + static_cast<std::size_t>(topic[i] - '0');
+        }
+        const std::string_view payload = body.substr(payload_at);
+        const auto seq_at = payload.find(R"("seq":)");
+        if (index >= fleet.send_logs.size() || seq_at == std::string_view::npos) {
+            continue;
+        }
+        const auto seq = static_cast<uint32_t>(std::strtoul(std::string(payload.substr(seq_at + 6, 10)).c_str(), nullptr, 10));
+        const SendLog::Entry& entry = fleet.send_logs[index].entries[seq % SendLog::SLOTS];
+        if (entry.seq.load(std::memory_order_acquire) != seq) {
+            continue;
+        }
+        const Clock::time_point sent{Clock::duration(entry.sent_ns.load(std::memory_order_relaxed))};
+        fleet.stats.delivery.record(now - sent);
+        fleet.stats.delivered.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+}  // namespace ahohs::loadgen
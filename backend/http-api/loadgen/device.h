@@ -0,0 +1,130 @@
+#pragma once
+
+// 模拟设备：按 Hi3861 固件的流程完成 UDP 发现 -> HTTP 上传元数据 -> MQTT 连接，
+// 之后按配置的间隔发布心跳与属性。每个设备是运行在某个事件循环线程上的一组协程，
+// 不占用独立线程，因此单机可以模拟数万台设备。
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include "latency_histogram.h"
+
+namespace ahohs::loadgen {
+
+using Clock = std::chrono::steady_clock;
+
+enum class DiscoveryMode {
+    Every,  // 每台设备各自发现（与真实设备一致）
+    Once,   // 启动时发现一次，所有设备共用结果
+    Off,    // 不发现，使用 --http / --mqtt 指定的地址
+};
+
+/// HTTP 与 MQTT 服务地址
+struct Endpoints {
+    boost::asio::ip::tcp::endpoint http;
+    boost::asio::ip::tcp::endpoint mqtt;
+};
+
+struct Config {
+    std::size_t devices = 1000;
+    std::size_t threads = 0;  // 事件循环线程数，0 表示取 CPU 核数
+    std::string id_prefix = "loadgen-";
+
+    DiscoveryMode discovery = DiscoveryMode::Every;
+    boost::asio::ip::udp::endpoint discovery_target;  // 发现请求的目标（广播、组播或服务端地址）
+    Endpoints endpoints;  // DiscoveryMode::Off 时使用，Once 时由启动阶段填入
+
+    bool upload_meta = true;
+    std::string schema = "v1";  // 元数据中声明的 attrib_schema，决定属性负载的编码
+    int qos = 1;
+
+    std::chrono::milliseconds ramp{10000};        // 所有设备在这段时间内均匀上线
+    std::chrono::milliseconds duration{60000};    // 全部上线后继续运行的时间
+    std::chrono::milliseconds heartbeat{30000};   // 与元数据中的 heartbeat_interval 一致
+    std::chrono::milliseconds attrib_interval{5000};
+    std::chrono::seconds keepalive{60};
+    std::chrono::milliseconds timeout{5000};      // 单次发现 / HTTP / CONNECT 的超时
+    int retries = 3;                              // 各阶段失败后的重试次数，间隔 3 秒（与固件一致）
+
+    /// 目标为本机时每台设备绑定不同的 127.x.y.z 来源地址：避免发现请求被按来源 IP 限速，
+    /// 也避免数万条连接耗尽同一对地址间的临时端口
+    bool spread_loopback_sources = true;
+};
+
+/// 各阶段的计数与延迟，由所有事件循环线程共同更新
+struct Stats {
+    LatencyHistogram discovery;    // 发出请求到收到回复
+    LatencyHistogram meta_upload;  // 建立连接到收到 HTTP 响应状态行
+    LatencyHistogram connect;      // 建立 TCP 连接到收到 CONNACK
+    LatencyHistogram publish_ack;  // QoS 1 PUBLISH 到 PUBACK
+    LatencyHistogram delivery;     // PUBLISH 到观察者收到同一条消息（需 --observe）
+
+    std::atomic<uint64_t> online{0};
+    std::atomic<uint64_t> finished{0};  // 正常运行到结束并断开的设备
+    std::atomic<uint64_t> failed_discovery{0};
+    std::atomic<uint64_t> failed_meta{0};
+    std::atomic<uint64_t> failed_connect{0};
+    std::atomic<uint64_t> dropped{0};  // 运行中连接被断开
+    std::atomic<uint64_t> published{0};
+    std::atomic<uint64_t> acked{0};
+    std::atomic<uint64_t> delivered{0};
+};
+
+/**
+ * 每台设备最近发布的属性的发送时刻，供观察者计算投递延迟
+ *
+ * 按 seq 取模存放，观察者按 topic 中的设备序号与负载中的 seq 查找；
+ * 相隔 SLOTS 条以上的迟到消息会查到错误的时刻，此时丢弃该样本。
+ */
+struct SendLog {
+    static constexpr std::size_t SLOTS = 16;
+
+    struct Entry {
+        std::atomic<uint32_t> seq{0};
+        std::atomic<int64_t> sent_ns{0};
+    };
+    std::array<Entry, SLOTS> entries;
+
+    void record(uint32_t seq, Clock::time_point sent) {
+        Entry& e = entries[seq % SLOTS];
+        e.sent_ns.store(sent.time_since_epoch().count(), std::memory_order_relaxed);
+        e.seq.store(seq, std::memory_order_release);
+    }
+};
+
+/// 所有设备共享的运行时状态
+struct Fleet {
+    const Config& config;
+    Stats& stats;
+    Clock::time_point started;  // 第 0 台设备的上线时刻
+    Clock::time_point ends;     // 所有设备在此时刻断开
+    std::vector<SendLog> send_logs;
+    std::atomic<bool> stopping{false};
+
+    Fleet(const Config& config, Stats& stats, Clock::time_point started);
+
+    std::string device_id(std::size_t index) const;
+    /// 目标为本机时第 index 台设备的来源地址，否则为 0.0.0.0
+    boost::asio::ip::address_v4 source_address(std::size_t index, const boost::asio::ip::address& target) const;
+};
+
+/// 发现一次服务地址（带超时与重试），失败时返回 false
+boost::asio::awaitable<bool> discover(const Fleet& fleet, std::size_t index, Endpoints& out);
+
+/// 第 index 台设备的完整生命周期
+boost::asio::awaitable<void> run_device(Fleet& fleet, std::size_t index);
+
+/// 订阅所有模拟设备的属性 topic，按 seq 计算投递延迟；只支持 v1（JSON）负载
+boost::asio::awaitable<void> run_observer(Fleet& fleet);
+
+}  // namespace ahohs::loadgen
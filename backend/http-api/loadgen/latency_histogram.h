@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace ahohs::loadgen {
+
+/**
+ * 对数分桶的延迟直方图（微秒）
+ *
+ * 每个 2 的幂区间再均分为 16 个子桶，相对误差不超过 1/16；内存固定，
+ * 可由多个事件循环线程并发 record()，读取时不加锁（只需近似一致）。
+ */
+class LatencyHistogram {
+ public:
+    void record(std::chrono::nanoseconds latency) {
+        const auto us = static_cast<uint64_t>(std::max<int64_t>(latency.count() / 1000, 0));
+        buckets[index_of(us)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        uint64_t seen = max_us.load(std::memory_order_relaxed);
+        while (us > seen && !max_us.compare_exchange_weak(seen, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_us.load(std::memory_order_relaxed); }
+
+    /// 第 p（0~1）分位所在桶的上界，没有样本时为 0
+    uint64_t percentile(double p) const {
+        const uint64_t n = count();
+        if (n == 0) {
+            return 0;
+        }
+        const auto rank = static_cast<uint64_t>(p * static_cast<double>(n - 1)) + 1;
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < N_BUCKETS; ++i) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return std::min(upper_bound_of(i), max());
+            }
+        }
+        return max();
+    }
+
+ private:
+    static constexpr unsigned SUB_BITS = 4;
+    static constexpr std::size_t N_BUCKETS = (64 - SUB_BITS + 1) << SUB_BITS;
+
+    std::array<std::atomic<uint64_t>, N_BUCKETS> buckets{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> max_us{0};
+
+    static std::size_t index_of(uint64_t us) {
+        if (us < (1u << SUB_BITS)) {
+            return us;
+        }
+        const unsigned shift = static_cast<unsigned>(std::bit_width(us)) - 1 - SUB_BITS;
+        return ((shift + 1) << SUB_BITS) + ((us >> shift) & ((1u << SUB_BITS) - 1));
+    }
+
+    static uint64_t upper_bound_of(std::size_t index) {
+        const std::size_t group = index >> SUB_BITS;
+        const uint64_t sub = index & ((1u << SUB_BITS) - 1);
+        if (group == 0) {
+            return sub;
+        }
+        const unsigned shift = static_cast<unsigned>(group - 1);
+        return (((1u << SUB_BITS) + sub + 1) << shift) - 1;
+    }
+};
+
+}  // namespace ahohs::loadgen
@@ -0,0 +1,281 @@
+// ahoh-loadgen：模拟大量设备的端到端负载生成器
+//
+// 每台模拟设备按固件流程执行 UDP 发现（v2）-> POST /api/device 上传元数据 -> MQTT 连接，
+// 之后按间隔发布心跳与属性，结束时正常断开。所有设备以协程形式分布在少量事件循环线程上。
+// 运行期间每隔 --report 秒输出在线数与发布速率，结束时输出各阶段的延迟分位数。
+//
+// 示例：./ahoh-loadgen --devices 50000 --threads 4 --discover 127.0.0.1 --ramp 60 --duration 120 --observe
+//
+// 目标为本机时每台设备使用不同的 127.x.y.z 来源地址；模拟数万台设备需要相应调高
+// ulimit -n（每台设备一个长连接，另有发现与上传阶段的短暂 socket）。
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/io_context.hpp>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "device.h"
+#include "discovery.h"
+#include "lifecycle.h"
+
+namespace {
+
+namespace asio = boost::asio;
+using namespace ahohs::loadgen;
+
+auto logger = spdlog::stdout_color_mt("loadgen");
+
+constexpr std::string_view USAGE = R"(usage: ahoh-loadgen [options]
+  --devices N            simulated devices (default 1000)
+  --threads N            event loop threads, 0 = CPU cores (default 0)
+  --discover HOST[:PORT] discovery target: server IP, 239.255.88.88 or 255.255.255.255 (default 127.0.0.1)
+  --discovery MODE       every | once | off (default every)
+  --http HOST:PORT       HTTP server when discovery is off (default 127.0.0.1:18080)
+  --mqtt HOST:PORT       MQTT broker when discovery is off (default 127.0.0.1:1883)
+  --no-meta              skip the HTTP meta upload
+  --schema v1|v2         attrib_schema declared in the meta and used for payloads (default v1)
+  --qos 0|1              QoS of heartbeat and attrib publishes (default 1)
+  --ramp SEC             spread device start-up over this many seconds (default 10)
+  --duration SEC         keep running this long after the ramp (default 60)
+  --heartbeat SEC        heartbeat interval (default 30)
+  --attrib-interval MS   interval between attrib publishes of one device (default 5000)
+  --timeout MS           per-attempt discovery / HTTP / CONNECT timeout (default 5000)
+  --retries N            retries per phase (default 3)
+  --observe              subscribe to all attrib topics and measure delivery latency (v1 only)
+  --report SEC           progress report interval (default 5)
+  --id-prefix STR        device id prefix (default loadgen-)
+)";
+
+/// 解析 HOST[:PORT]，HOST 须为 IPv4 地址
+template <typename Endpoint>
+Endpoint parse_endpoint(std::string_view text, uint16_t default_port) {
+    const auto colon = text.rfind(':');
+    const std::string host(text.substr(0, colon));
+    const uint16_t port = colon == std::string_view::npos
+                              ? default_port
+                              : static_cast<uint16_t>(std::stoul(std::string(text.substr(colon + 1))));
+    return Endpoint(asio::ip::make_address(host), port);
+}
+
+Config parse_args(int argc, char** argv, std::size_t& report_seconds, bool& observe) {
+    Config config;
+    config.discovery_target = asio::ip::udp::endpoint(asio::ip::make_address("127.0.0.1"), ahoh::discovery::PORT);
+    config.endpoints.http = asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), 18080);
+    config.endpoints.mqtt = asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), 1883);
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("missing value for " + std::string(arg));
+            }
+            return argv[++i];
+        };
+        if (arg == "--devices") {
+            config.devices = std::stoul(value());
+        } else if (arg == "--threads") {
+            config.threads = std::stoul(value());
+        } else if (arg == "--discover") {
+            config.discovery_target = parse_endpoint<asio::ip::udp::endpoint>(value(), ahoh::discovery::PORT);
+        } else if (arg == "--discovery") {
+            const std::string mode = value();
+            if (mode == "every") {
+                config.discovery = DiscoveryMode::Every;
+            } else if (mode == "once") {
+                config.discovery = DiscoveryMode::Once;
+            } else if (mode == "off") {
+                config.discovery = DiscoveryMode::Off;
+            } else {
+                throw std::invalid_argument("unknown discovery mode: " + mode);
+            }
+        } else if (arg == "--http") {
+            config.endpoints.http = parse_endpoint<asio::ip::tcp::endpoint>(value(), 18080);
+        } else if (arg == "--mqtt") {
+            config.endpoints.mqtt = parse_endpoint<asio::ip::tcp::endpoint>(value(), 1883);
+        } else if (arg == "--no-meta") {
+            config.upload_meta = false;
+        } else if (arg == "--schema") {
+            config.schema = value();
+            if (config.schema != "v1" && config.schema != "v2") {
+                throw std::invalid_argument("unknown schema: " + config.schema);
+            }
+        } else if (arg == "--qos") {
+            config.qos = std::stoi(value());
+            if (config.qos != 0 && config.qos != 1) {
+                throw std::invalid_argument("qos must be 0 or 1");
+            }
+        } else if (arg == "--ramp") {
+            config.ramp = std::chrono::seconds(std::stoul(value()));
+        } else if (arg == "--duration") {
+            config.duration = std::chrono::seconds(std::stoul(value()));
+        } else if (arg == "--heartbeat") {
+            config.heartbeat = std::chrono::seconds(std::max(1ul, std::stoul(value())));
+        } else if (arg == "--attrib-interval") {
+            config.attrib_interval = std::chrono::milliseconds(std::max(1ul, std::stoul(value())));
+        } else if (arg == "--timeout") {
+            config.timeout = std::chrono::milliseconds(std::stoul(value()));
+        } else if (arg == "--retries") {
+            config.retries = std::stoi(value());
+        } else if (arg == "--observe") {
+            observe = true;
+        } else if (arg == "--report") {
+            report_seconds = std::max(1ul, std::stoul(value()));
+        } else if (arg == "--id-prefix") {
+            config.id_prefix = value();
+        } else {
+            throw std::invalid_argument("unknown option: " + std::string(arg));
+        }
+    }
+    if (config.threads == 0) {
+        config.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return config;
+}
+
+/// 每台设备至少一个长连接，再留出短暂 socket 与余量；软限制不够时尽量提高到硬限制
+void raise_fd_limit(std::size_t devices) {
+    const rlim_t wanted = devices * 2 + 256;
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return;
+    }
+    if (limit.rlim_cur < wanted) {
+        limit.rlim_cur = std::min(wanted, limit.rlim_max);
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (limit.rlim_cur < wanted) {
+        logger->warn("Open file limit {} may be too low for {} devices (want {}), raise ulimit -n",
+                     limit.rlim_cur, devices, wanted);
+    }
+}
+
+void log_histogram(std::string_view name, const LatencyHistogram& h) {
+    if (h.count() == 0) {
+        logger->info("{:<12} no samples", name);
+        return;
+    }
+    logger->info("{:<12} n={:<10} p50={}us p90={}us p99={}us p99.9={}us max={}us", name, h.count(),
+                 h.percentile(0.50), h.percentile(0.90), h.percentile(0.99), h.percentile(0.999), h.max());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::size_t report_seconds = 5;
+    bool observe = false;
+    Config config;
+    try {
+        config = parse_args(argc, argv, report_seconds, observe);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n" << USAGE;
+        return 2;
+    }
+
+    ahohs::lifecycle::Lifecycle lifecycle;
+    lifecycle.install_signal_handler();
+    raise_fd_limit(config.devices);
+    Stats stats;
+
+    // 共用一次发现结果：discovery once，或 every 模式下观察者需要事先知道 broker 地址
+    if (config.discovery == DiscoveryMode::Once || (config.discovery == DiscoveryMode::Every && observe)) {
+        asio::io_context ctx;
+        Fleet probe(config, stats, Clock::now());
+        bool found = false;
+        asio::co_spawn(ctx, [&]() -> asio::awaitable<void> {
+            found = co_await discover(probe, config.devices + 1, config.endpoints);
+        }, asio::detached);
+        ctx.run();
+        if (!found) {
+            logger->error("No discovery reply from {}:{}", config.discovery_target.address().to_string(),
+                          config.discovery_target.port());
+            return 1;
+        }
+        logger->info("Discovered HTTP {}:{}, MQTT {}:{}", config.endpoints.http.address().to_string(),
+                     config.endpoints.http.port(), config.endpoints.mqtt.address().to_string(),
+                     config.endpoints.mqtt.port());
+    }
+
+    logger->info("Simulating {} devices on {} threads: ramp {} s, run {} s, attrib every {} ms, qos {}, schema {}",
+                 config.devices, config.threads, config.ramp.count() / 1000, config.duration.count() / 1000,
+                 config.attrib_interval.count(), config.qos, config.schema);
+
+    // 每个线程一个 io_context，设备按序号轮流分配，同一设备的协程始终在同一线程上运行
+    Fleet fleet(config, stats, Clock::now() + std::chrono::milliseconds(100));
+    std::vector<std::unique_ptr<asio::io_context>> contexts;
+    for (std::size_t t = 0; t < config.threads; ++t) {
+        contexts.push_back(std::make_unique<asio::io_context>(1));
+    }
+    for (std::size_t i = 0; i < config.devices; ++i) {
+        asio::co_spawn(*contexts[i % contexts.size()], run_device(fleet, i), asio::detached);
+    }
+    if (observe) {
+        asio::co_spawn(*contexts.front(), run_observer(fleet), asio::detached);
+    }
+    std::atomic<std::size_t> running{contexts.size()};
+    std::vector<std::thread> threads;
+    for (auto& ctx : contexts) {
+        threads.emplace_back([&ctx, &running]() {
+            ctx->run();
+            running.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    // 定期输出进度；收到 SIGINT / SIGTERM 时通知设备下线，超过一个发布间隔仍未退出则强制停止
+    const auto begin = Clock::now();
+    uint64_t last_published = 0;
+    auto last_report = begin;
+    std::optional<Clock::time_point> force_stop_at;
+    while (running.load(std::memory_order_acquire) > 0) {
+        const bool stop = lifecycle.wait_for(std::chrono::milliseconds(200));
+        const auto now = Clock::now();
+        if (stop && !force_stop_at) {
+            logger->info("Stop requested, disconnecting devices");
+            fleet.stopping.store(true, std::memory_order_relaxed);
+            force_stop_at = now + config.attrib_interval + config.timeout;
+        }
+        if (force_stop_at && now >= *force_stop_at) {
+            for (auto& ctx : contexts) {
+                ctx->stop();
+            }
+        }
+        if (now - last_report >= std::chrono::seconds(report_seconds)) {
+            const uint64_t published = stats.published.load(std::memory_order_relaxed);
+            logger->info("t={}s online={} published={} ({:.0f}/s) acked={} puback_p99={}us failed discovery/meta/connect={}/{}/{} dropped={}",
+                         std::chrono::duration_cast<std::chrono::seconds>(now - begin).count(),
+                         stats.online.load(), published,
+                         static_cast<double>(published - last_published) /
+                             std::chrono::duration<double>(now - last_report).count(),
+                         stats.acked.load(), stats.publish_ack.percentile(0.99), stats.failed_discovery.load(),
+                         stats.failed_meta.load(), stats.failed_connect.load(), stats.dropped.load());
+            last_published = published;
+            last_report = now;
+        }
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    const double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+    logger->info("Finished in {:.1f} s: {} devices completed, {} dropped, failed discovery/meta/connect {}/{}/{}",
+                 elapsed, stats.finished.load(), stats.dropped.load(), stats.failed_discovery.load(),
+                 stats.failed_meta.load(), stats.failed_connect.load());
+    logger->info("Published {} messages, {} acknowledged, {} observed", stats.published.load(), stats.acked.load(),
+                 stats.delivered.load());
+    log_histogram("discovery", stats.discovery);
+    log_histogram("meta_upload", stats.meta_upload);
+    log_histogram("connect", stats.connect);
+    log_histogram("publish_ack", stats.publish_ack);
+    log_histogram("delivery", stats.delivery);
+    return stats.finished.load() == config.devices ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+#include "attrib_codec.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+
+namespace ahohs::codec {
+
+namespace {
+
+/// 按小端读取 sizeof(T) 字节并按位解释为 T（T 为 4 或 8 字节的整数 / 浮点）
+template <typename T>
+T load_le(const char* in) {
+    using U = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+    U v = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        v |= static_cast<U>(static_cast<unsigned char>(in[i])) << (8 * i);
+    }
+    return std::bit_cast<T>(v);
+}
+
+template <typename T>
+void store_le(T value, std::string& out) {
+    using U = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+    U v = std::bit_cast<U>(value);
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+}
+
+}  // namespace
+
+DeviceSchema DeviceSchema::from_meta(const json& meta) {
+    DeviceSchema schema;
+    if (!meta.is_object()) {
+        return schema;
+    }
+    auto version = meta.find("attrib_schema");
+    if (version != meta.end() && version->is_string() && *version == "v2") {
+        schema.version = SchemaVersion::V2;
+    }
+    auto it = meta.find("attrib");
+    if (it != meta.end() && it->is_array()) {
+        for (const auto& attrib : *it) {
+            std::string topic;
+            if (attrib.is_object() && attrib.contains("topic") && attrib["topic"].is_string()) {
+                topic = attrib["topic"].get<std::string>();
+            }
+            if (!topic.empty() && topic.front() != '/') {
+                topic.insert(topic.begin(), '/');
+            }
+            // 下标必须与元数据中的位置一致，缺少 topic 的项也占位
+            schema.attribs.push_back(std::move(topic));
+        }
+    }
+    return schema;
+}
+
+std::optional<telemetry::AttribValue> decode_value_v2(std::string_view& in) {
+    if (in.empty()) {
+        return std::nullopt;
+    }
+    const auto tag = static_cast<Tag>(in.front());
+    std::size_t size = 1;
+    telemetry::AttribValue value;
+    switch (tag) {
+        case Tag::Null:
+            break;
+        case Tag::False:
+            value = false;
+            break;
+        case Tag::True:
+            value = true;
+            break;
+        case Tag::F32:
+            size += 4;
+            if (in.size() < size) {
+                return std::nullopt;
+            }
+            value = static_cast<double>(load_le<float>(in.data() + 1));
+            break;
+        case Tag::F64:
+            size += 8;
+            if (in.size() < size) {
+                return std::nullopt;
+            }
+            value = load_le<double>(in.data() + 1);
+            break;
+        case Tag::I32:
+            size += 4;
+            if (in.size() < size) {
+                return std::nullopt;
+            }
+            value = static_cast<double>(load_le<int32_t>(in.data() + 1));
+            break;
+        case Tag::Str: {
+            if (in.size() < 2) {
+                return std::nullopt;
+            }
+            size += 1 + static_cast<unsigned char>(in[1]);
+            if (in.size() < size) {
+                return std::nullopt;
+            }
+            value = std::string(in.substr(2, size - 2));
+            break;
+        }
+        default:
+            return std::nullopt;
+    }
+    in.remove_prefix(size);
+    return value;
+}
+
+std::optional<telemetry::AttribValue> decode_attrib_v2(std::string_view payload) {
+    auto value = decode_value_v2(payload);
+    if (!value || !payload.empty()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+void encode_value_v2(const telemetry::AttribValue& value, std::string& out) {
+    if (std::holds_alternative<std::monostate>(value)) {
+        out.push_back(static_cast<char>(Tag::Null));
+    } else if (const bool* b = std::get_if<bool>(&value)) {
+        out.push_back(static_cast<char>(*b ? Tag::True : Tag::False));
+    } else if (const double* d = std::get_if<double>(&value)) {
+        const double v = *d;
+        if (v == std::trunc(v) && v >= std::numeric_limits<int32_t>::min() &&
+            v <= std::numeric_limits<int32_t>::max() && !(v == 0 && std::signbit(v))) {
+            out.push_back(static_cast<char>(Tag::I32));
+            store_le(static_cast<int32_t>(v), out);
+        } else if (static_cast<double>(static_cast<float>(v)) == v || std::isnan(v)) {
+            out.push_back(static_cast<char>(Tag::F32));
+            store_le(static_cast<float>(v), out);
+        } else {
+            out.push_back(static_cast<char>(Tag::F64));
+            store_le(v, out);
+        }
+    } else {
+        const std::string& s = std::get<std::string>(value);
+        const std::size_t len = std::min<std::size_t>(s.size(), 255);
+        out.push_back(static_cast<char>(Tag::Str));
+        out.push_back(static_cast<char>(len));
+        out.append(s, 0, len);
+    }
+}
+
+std::string encode_command(const DeviceSchema* schema, const json& value) {
+    if (schema && schema->version == SchemaVersion::V2) {
+        std::string out;
+        if (value.is_null()) {
+            encode_value_v2(telemetry::AttribValue{}, out);
+            return out;
+        }
+        if (value.is_boolean()) {
+            encode_value_v2(value.get<bool>(), out);
+            return out;
+        }
+        if (value.is_number()) {
+            encode_value_v2(value.get<double>(), out);
+            return out;
+        }
+        if (value.is_string()) {
+            encode_value_v2(value.get<std::string>(), out);
+            return out;
+        }
+    }
+    return json{{"value", value}}.dump();
+}
+
+std::string encode_batch_v2(const std::vector<std::pair<uint8_t, telemetry::AttribValue>>& values) {
+    std::string out;
+    if (values.size() > 255) {
+        return out;
+    }
+    out.push_back(static_cast<char>(values.size()));
+    for (const auto& [index, value] : values) {
+        out.push_back(static_cast<char>(index));
+        encode_value_v2(value, out);
+    }
+    return out;
+}
+
+std::shared_ptr<const DeviceSchema> SchemaRegistry::get(std::string_view device_id) const {
+    std::shared_lock lock(mtx);
+    auto it = schemas.find(device_id);
+    return it == schemas.end() ? nullptr : it->second;
+}
+
+void SchemaRegistry::set(std::string_view device_id, const json& meta) {
+    auto schema = std::make_shared<const DeviceSchema>(DeviceSchema::from_meta(meta));
+    std::unique_lock lock(mtx);
+    auto it = schemas.find(device_id);
+    if (it != schemas.end()) {
+        it->second = std::move(schema);
+    } else {
+        schemas.emplace(std::string(device_id), std::move(schema));
+    }
+}
+
+void SchemaRegistry::forget(std::string_view device_id) {
+    std::unique_lock lock(mtx);
+    auto it = schemas.find(device_id);
+    if (it != schemas.end()) {
+        schemas.erase(it);
+    }
+}
+
+}  // namespace ahohs::codec
@@ -1,9 +1,10 @@
 #include "db.h"
+#include <algorithm>
 #include <stdexcept>
 
 namespace ahohs::db {
 
-PostgresDB::PostgresDB(const std::string& connstr) {
+PostgresDB::PostgresDB(const std::string& connstr) : connstr(connstr) {
     try {
         conn = std::make_unique<pqxx::connection>(connstr);
         if (!conn || !conn->is_open()) {
@@ -90,8 +91,34 @@ std::unique_ptr<pqxx::work> PostgresDB::begin_transaction() {
     }
 }
 
+bool PostgresDB::ensure_connected() {
+    if (conn && conn->is_open()) {
+        return true;
+    }
+    try {
+        auto fresh = std::make_unique<pqxx::connection>(connstr);
+        for (const auto& [stmt_name, sql] : statements) {
+            fresh->prepare(stmt_name, sql);
+        }
+        conn = std::move(fresh);
+        PostgresDB::logger->info("PostgreSQL connection re-established, {} prepared statement(s) restored.", statements.size());
+        return true;
+    }
+    catch (const std::exception& e) {
+        PostgresDB::logger->error("PostgreSQL reconnect failed: {}", e.what());
+        return false;
+    }
+}
+
 // 注册和调用预处理语句的 API
 void PostgresDB::register_prepared_statement(const std::string& stmt_name, const std::string& sql) {
+    auto it = std::find_if(statements.begin(), statements.end(),
+                           [&stmt_name](const auto& stmt) { return stmt.first == stmt_name; });
+    if (it != statements.end()) {
+        it->second = sql;
+    } else {
+        statements.emplace_back(stmt_name, sql);
+    }
     try {
         conn->prepare(stmt_name, sql);
         PostgresDB::logger->info("Prepared statement '{}' registered.", stmt_name);
@@ -149,4 +176,26 @@ std::optional<pqxx::result> PostgresDB::query_prepared(const std::string& stmt_n
     }
 }
 
+bool PostgresDB::exec_prepared_batch(const std::string& stmt_name,
+                                     const std::vector<std::vector<std::string>>& rows) {
+    try {
+        pqxx::work txn(*conn);
+        for (const auto& row : rows) {
+            pqxx::params pq_params;
+            pq_params.reserve(row.size());
+            for (const auto& param : row) {
+                pq_params.append(param);
+            }
+            txn.exec(pqxx::prepped(stmt_name), pq_params);
+        }
+        txn.commit();
+        PostgresDB::logger->debug("Prepared statement '{}' executed for {} rows.", stmt_name, rows.size());
+        return true;
+    }
+    catch (const std::exception& e) {
+        PostgresDB::logger->error("Batch execution of prepared statement '{}' failed: {}", stmt_name, e.what());
+        return false;
+    }
+}
+
 }  // namespace ahohs::db
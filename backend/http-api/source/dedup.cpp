@@ -0,0 +1,138 @@
+#include "dedup.h"
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include <string>
+#include "ingest.h"
+
+namespace ahohs::ingest {
+
+namespace {
+
+constexpr uint64_t SEQ_WINDOW = 64;
+
+}  // namespace
+
+std::optional<uint64_t> find_sequence(std::string_view payload) {
+    if (payload.empty() || payload.front() != '{') {
+        return std::nullopt;  // 二进制（attrib_schema v2）或非对象负载
+    }
+    const char* p = payload.data();
+    const char* end = p + payload.size();
+    auto skip_space = [&p, end]() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+            ++p;
+        }
+    };
+    // 跳过字符串与嵌套层级，只在顶层对象的键位置匹配 "seq"
+    int depth = 0;
+    bool key_position = false;
+    while (p < end) {
+        const char c = *p;
+        if (c == '"') {
+            const char* token = p;
+            for (++p; p < end && *p != '"'; ++p) {
+                if (*p == '\\') {
+                    ++p;
+                }
+            }
+            if (p == end) {
+                return std::nullopt;
+            }
+            ++p;
+            if (depth == 1 && key_position && std::string_view(token, p - token) == R"("seq")") {
+                skip_space();
+                if (p == end || *p != ':') {
+                    return std::nullopt;
+                }
+                ++p;
+                skip_space();
+                uint64_t seq = 0;
+                auto [ptr, ec] = std::from_chars(p, end, seq);
+                if (ec != std::errc() || ptr == p) {
+                    return std::nullopt;
+                }
+                return seq;
+            }
+            key_position = false;
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            ++depth;
+            key_position = c == '{';
+        } else if (c == '}' || c == ']') {
+            --depth;
+        } else if (c == ',') {
+            key_position = true;
+        }
+        ++p;
+    }
+    return std::nullopt;
+}
+
+DedupResult Deduplicator::check(std::string_view topic, std::string_view payload, bool redelivered) {
+    const TopicInfo info = classify_topic(topic);
+    const std::string_view device_id = info.kind == TopicKind::Unknown ? topic : info.device_id;
+    if (info.kind == TopicKind::Meta || info.kind == TopicKind::Will) {
+        // 设备重新上线：启动后的序号从头计数，之前的窗口不再有效
+        auto dev = devices.find(device_id);
+        if (dev != devices.end()) {
+            n_entries -= dev->second.size();
+            devices.erase(dev);
+        }
+    }
+    auto dev = devices.find(device_id);
+    if (dev == devices.end()) {
+        dev = devices.emplace(std::string(device_id), state::StringMap<Entry>{}).first;
+    }
+    auto it = dev->second.find(topic);
+    if (it == dev->second.end()) {
+        it = dev->second.emplace(std::string(topic), Entry{}).first;
+        ++n_entries;
+    }
+    if (info.kind == TopicKind::Attrib) {
+        if (auto seq = find_sequence(payload)) {
+            return check_seq(it->second, *seq, redelivered);
+        }
+    }
+    return check_hash(it->second, payload, redelivered);
+}
+
+DedupResult Deduplicator::check_seq(Entry& entry, uint64_t seq, bool redelivered) {
+    if (!entry.has_seq || seq > entry.max_seq) {
+        const uint64_t shift = entry.has_seq ? seq - entry.max_seq : SEQ_WINDOW;
+        entry.seq_window = shift >= SEQ_WINDOW ? 0 : entry.seq_window << shift;
+        entry.seq_window |= 1;
+        entry.max_seq = seq;
+        entry.has_seq = true;
+        return DedupResult::Fresh;
+    }
+    const uint64_t age = entry.max_seq - seq;
+    const uint64_t bit = age < SEQ_WINDOW ? uint64_t{1} << age : 0;
+    if (redelivered && (entry.seq_window & bit)) {
+        return DedupResult::DuplicateSeq;
+    }
+    if (!redelivered || bit == 0) {
+        // 不新于已见序号的首次投递，或远早于窗口的序号：设备重启后序号从头计数
+        entry.max_seq = seq;
+        entry.seq_window = 1;
+        return DedupResult::Fresh;
+    }
+    // 窗口内未见过的重投（原消息丢失），接受并记录
+    entry.seq_window |= bit;
+    return DedupResult::Fresh;
+}
+
+DedupResult Deduplicator::check_hash(Entry& entry, std::string_view payload, bool redelivered) {
+    const uint64_t h = std::hash<std::string_view>{}(payload);
+    if (redelivered) {
+        const std::size_t n = std::min<std::size_t>(entry.n_hashes, DEDUP_HASH_WINDOW);
+        if (std::find(entry.hashes.begin(), entry.hashes.begin() + n, h) != entry.hashes.begin() + n) {
+            return DedupResult::DuplicateHash;
+        }
+    }
+    entry.hashes[entry.n_hashes++ % DEDUP_HASH_WINDOW] = h;
+    return DedupResult::Fresh;
+}
+
+}  // namespace ahohs::ingest
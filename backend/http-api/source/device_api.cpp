@@ -0,0 +1,73 @@
+#include "device_api.h"
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+
+using json = nlohmann::json;
+
+namespace ahohs::http_server {
+
+std::string devices_json(const std::vector<DeviceRow>& rows) {
+    json response;
+    json device_array = json::array();
+    for (const auto& row : rows) {
+        json device;
+        device["device_id"] = std::string(row.device_id);
+        std::string meta_str = std::string(row.meta);
+        try {
+            json meta_json = json::parse(meta_str);
+            device["meta"] = meta_json;
+        } catch (const std::exception& e) {
+            spdlog::error("Failed to parse meta field as JSON: {}", e.what());
+            device["meta"] = meta_str;
+        }
+        device_array.push_back(device);
+    }
+    response["devices"] = device_array;
+    return response.dump();
+}
+
+DeviceUpsert parse_device_upsert(std::string_view body) {
+    json parsed = json::parse(body, nullptr, false);
+    if (parsed.is_discarded()) {
+        throw std::invalid_argument("Invalid JSON input.");
+    }
+    // 校验必要字段 device_id 和 meta 是否存在
+    if (!parsed.contains("device_id") || !parsed.contains("meta")) {
+        throw std::invalid_argument("Missing required field: device_id or meta.");
+    }
+    if (!parsed["device_id"].is_string() || parsed["device_id"].get_ref<const std::string&>().empty()) {
+        throw std::invalid_argument("Invalid field: device_id must be a non-empty string.");
+    }
+    DeviceUpsert upsert;
+    upsert.device_id = parsed["device_id"].get<std::string>();
+    if (parsed["meta"].is_string()) {
+        upsert.meta = parsed["meta"].get<std::string>();
+        // 写入 JSONB 列，异步写库时才会发现的非法文本在此拒绝
+        if (!json::accept(upsert.meta)) {
+            throw std::invalid_argument("Invalid JSON in field: meta.");
+        }
+    } else {
+        upsert.meta = parsed["meta"].dump();
+    }
+    upsert.meta_value = std::move(parsed["meta"]);
+    return upsert;
+}
+
+std::string history_json(std::string_view device_id, std::string_view attrib, const series::Range& range) {
+    json points = json::array();
+    for (const auto& point : range.points) {
+        if (range.boolean) {
+            points.push_back(json::array({point.ts, point.value != 0}));
+        } else {
+            points.push_back(json::array({point.ts, point.value}));
+        }
+    }
+    json response;
+    response["device_id"] = std::string(device_id);
+    response["attrib"] = std::string(attrib);
+    response["source"] = "memory";
+    response["points"] = std::move(points);
+    return response.dump();
+}
+
+}  // namespace ahohs::http_server
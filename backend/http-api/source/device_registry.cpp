@@ -0,0 +1,373 @@
+#include "device_registry.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ahohs::registry {
+
+//////////////////////
+// PostgresDevicePersistence
+//////////////////////
+
+bool PostgresDevicePersistence::load(const std::function<void(std::string_view device_id, std::string_view meta)>& row) {
+    if (!db.ensure_connected()) {
+        return false;
+    }
+    auto result = db.query_prepared("get_all_devices", {});
+    if (!result) {
+        return false;
+    }
+    for (const auto& r : *result) {
+        row(r["device_id"].c_str(), r["meta"].c_str());
+    }
+    return true;
+}
+
+bool PostgresDevicePersistence::upsert(const std::vector<DeviceRecord>& devices) {
+    std::vector<std::vector<std::string>> rows;
+    rows.reserve(devices.size());
+    for (const auto& device : devices) {
+        rows.push_back({device.device_id, device.meta});
+    }
+    // 数据库重启后连接已断开，先重连并恢复预处理语句，否则每次刷新都失败、修改一直积压
+    return db.ensure_connected() && db.exec_prepared_batch("upsert_device_meta", rows);
+}
+
+bool PostgresDevicePersistence::remove(const std::vector<std::string>& device_ids) {
+    std::vector<std::vector<std::string>> rows;
+    rows.reserve(device_ids.size());
+    for (const auto& device_id : device_ids) {
+        rows.push_back({device_id});
+    }
+    return db.ensure_connected() && db.exec_prepared_batch("delete_device", rows);
+}
+
+//////////////////////
+// DeviceRegistry
+//////////////////////
+
+std::string_view DeviceRegistry::StringArena::store(std::string_view s) {
+    if (s.empty()) {
+        return {};  // 尚未分配任何块时 blocks.back() 无效
+    }
+    char* dst;
+    if (s.size() > BLOCK_SIZE) {
+        // 超长文本单独占一块，之后从新块开始分配
+        blocks.push_back(std::make_unique<char[]>(s.size()));
+        dst = blocks.back().get();
+        block_used = BLOCK_SIZE;
+    } else {
+        if (block_used + s.size() > BLOCK_SIZE) {
+            blocks.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+            block_used = 0;
+        }
+        dst = blocks.back().get() + block_used;
+        block_used += s.size();
+    }
+    std::memcpy(dst, s.data(), s.size());
+    n_allocated += s.size();
+    return {dst, s.size()};
+}
+
+DeviceRegistry::DeviceRegistry(DevicePersistence& persistence,
+                               std::chrono::milliseconds flush_interval,
+                               std::size_t max_dirty)
+    : persistence(persistence),
+      flush_interval(flush_interval),
+      max_dirty(std::max<std::size_t>(max_dirty, 1)) {
+    worker = std::thread([this]() { run(); });
+    logger->info("DeviceRegistry started, flush interval {}ms, max dirty {}",
+                 flush_interval.count(), this->max_dirty);
+}
+
+DeviceRegistry::~DeviceRegistry() {
+    stop();
+}
+
+uint64_t DeviceRegistry::hash_of(std::string_view device_id) {
+    return state::StringHash{}(device_id);
+}
+
+bool DeviceRegistry::load() {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    records.clear();
+    slots.clear();
+    ids = StringArena{};
+    id_bytes = 0;
+    bool ok = persistence.load([this](std::string_view device_id, std::string_view meta) {
+        const uint64_t hash = hash_of(device_id);
+        if (auto slot = find_slot(device_id, hash)) {
+            records[slots[*slot] - 1].meta = meta;
+        } else {
+            insert(device_id, hash, std::string(meta));
+        }
+    });
+    if (ok) {
+        logger->info("Loaded {} device(s)", records.size());
+    } else {
+        logger->error("Failed to load devices");
+    }
+    return ok;
+}
+
+std::optional<std::string> DeviceRegistry::get(std::string_view device_id) const {
+    const uint64_t hash = hash_of(device_id);
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    auto slot = find_slot(device_id, hash);
+    if (!slot) {
+        return std::nullopt;
+    }
+    return records[slots[*slot] - 1].meta;
+}
+
+bool DeviceRegistry::contains(std::string_view device_id) const {
+    const uint64_t hash = hash_of(device_id);
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return find_slot(device_id, hash).has_value();
+}
+
+bool DeviceRegistry::put(std::string_view device_id, std::string meta) {
+    counters.writes.fetch_add(1, std::memory_order_relaxed);
+    const uint64_t hash = hash_of(device_id);
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    if (!mark_dirty(device_id, Pending{false, meta})) {
+        return false;
+    }
+    if (auto slot = find_slot(device_id, hash)) {
+        records[slots[*slot] - 1].meta = std::move(meta);
+    } else {
+        insert(device_id, hash, std::move(meta));
+    }
+    return true;
+}
+
+bool DeviceRegistry::remove(std::string_view device_id) {
+    counters.writes.fetch_add(1, std::memory_order_relaxed);
+    const uint64_t hash = hash_of(device_id);
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    auto slot = find_slot(device_id, hash);
+    if (!slot) {
+        // 不在内存中即不在库中（或删除已在脏集中），无需写库
+        return true;
+    }
+    if (!mark_dirty(device_id, Pending{true, {}})) {
+        return false;
+    }
+    erase_at(*slot);
+    return true;
+}
+
+std::vector<DeviceRecord> DeviceRegistry::snapshot() const {
+    std::vector<DeviceRecord> devices;
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    devices.reserve(records.size());
+    for (const auto& record : records) {
+        devices.push_back(DeviceRecord{std::string(record.id), record.meta});
+    }
+    return devices;
+}
+
+std::size_t DeviceRegistry::size() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return records.size();
+}
+
+std::size_t DeviceRegistry::dirty() const {
+    std::lock_guard<std::mutex> lock(dirty_mtx);
+    return pending.size();
+}
+
+std::optional<std::size_t> DeviceRegistry::find_slot(std::string_view device_id, uint64_t hash) const {
+    if (slots.empty()) {
+        return std::nullopt;
+    }
+    const std::size_t mask = slots.size() - 1;
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+        const uint32_t index = slots[i];
+        if (index == 0) {
+            return std::nullopt;
+        }
+        const Record& record = records[index - 1];
+        if (record.hash == hash && record.id == device_id) {
+            return i;
+        }
+    }
+}
+
+void DeviceRegistry::insert(std::string_view device_id, uint64_t hash, std::string meta) {
+    if ((records.size() + 1) * 2 > slots.size()) {
+        rehash(std::max<std::size_t>(16, slots.size() * 2));
+    }
+    records.push_back(Record{ids.store(device_id), std::move(meta), hash});
+    id_bytes += device_id.size();
+    const std::size_t mask = slots.size() - 1;
+    std::size_t i = hash & mask;
+    while (slots[i] != 0) {
+        i = (i + 1) & mask;
+    }
+    slots[i] = static_cast<uint32_t>(records.size());
+}
+
+void DeviceRegistry::erase_at(std::size_t slot) {
+    const std::size_t index = slots[slot] - 1;
+    id_bytes -= records[index].id.size();
+
+    // 线性探测的回移删除：把后续探测链上可以前移的槽位依次填入空洞，不留墓碑
+    const std::size_t mask = slots.size() - 1;
+    std::size_t hole = slot;
+    slots[hole] = 0;
+    for (std::size_t j = (hole + 1) & mask; slots[j] != 0; j = (j + 1) & mask) {
+        const std::size_t home = records[slots[j] - 1].hash & mask;
+        // 空洞位于 [home, j) 之间时，j 处的设备可以移到空洞
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            slots[hole] = slots[j];
+            slots[j] = 0;
+            hole = j;
+        }
+    }
+
+    // 以末尾记录填补 records 中的空位，并修正指向它的槽位
+    const std::size_t last = records.size() - 1;
+    if (index != last) {
+        auto moved = find_slot(records[last].id, records[last].hash);
+        slots[*moved] = static_cast<uint32_t>(index + 1);
+        records[index] = std::move(records[last]);
+    }
+    records.pop_back();
+
+    // 删除的 device_id 仍占用竞技场，空洞超过存活部分时整体重排
+    if (ids.allocated() > 2 * id_bytes + 65536) {
+        compact_ids();
+    }
+}
+
+void DeviceRegistry::rehash(std::size_t capacity) {
+    slots.assign(capacity, 0);
+    const std::size_t mask = capacity - 1;
+    for (std::size_t index = 0; index < records.size(); ++index) {
+        std::size_t i = records[index].hash & mask;
+        while (slots[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = static_cast<uint32_t>(index + 1);
+    }
+}
+
+void DeviceRegistry::compact_ids() {
+    StringArena compacted;
+    for (auto& record : records) {
+        record.id = compacted.store(record.id);
+    }
+    ids = std::move(compacted);
+}
+
+bool DeviceRegistry::mark_dirty(std::string_view device_id, Pending change) {
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> lock(dirty_mtx);
+        auto it = pending.find(device_id);
+        if (it != pending.end()) {
+            it->second = std::move(change);
+            counters.coalesced.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        if (pending.size() >= max_dirty) {
+            counters.rejected.fetch_add(1, std::memory_order_relaxed);
+            logger->warn("Dirty set full ({} devices), rejecting change to {}", pending.size(), device_id);
+            return false;
+        }
+        pending.emplace(std::string(device_id), std::move(change));
+        if (!flush_requested && pending.size() >= max_dirty / 2) {
+            flush_requested = true;
+            notify = true;
+        }
+    }
+    if (notify) {
+        cv.notify_one();
+    }
+    return true;
+}
+
+void DeviceRegistry::stop() {
+    {
+        std::lock_guard<std::mutex> lock(dirty_mtx);
+        if (stopping) {
+            return;
+        }
+        stopping = true;
+    }
+    cv.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    logger->info("DeviceRegistry stopped, {} change(s) written, {} coalesced",
+                 counters.flushed.load(std::memory_order_relaxed),
+                 counters.coalesced.load(std::memory_order_relaxed));
+}
+
+void DeviceRegistry::run() {
+    state::StringMap<Pending> batch;
+    while (true) {
+        bool exiting;
+        {
+            std::unique_lock<std::mutex> lock(dirty_mtx);
+            cv.wait_for(lock, flush_interval, [this]() { return stopping || flush_requested; });
+            // 整体换出脏集，写库期间不持有锁
+            batch.swap(pending);
+            flush_requested = false;
+            exiting = stopping;
+        }
+        if (!batch.empty()) {
+            flush(batch);
+        }
+        if (exiting) {
+            break;
+        }
+    }
+    std::lock_guard<std::mutex> lock(dirty_mtx);
+    if (!pending.empty()) {
+        logger->error("{} device change(s) could not be written before shutdown", pending.size());
+    }
+}
+
+void DeviceRegistry::flush(state::StringMap<Pending>& batch) {
+    std::vector<DeviceRecord> upserts;
+    std::vector<std::string> removals;
+    for (auto& [device_id, change] : batch) {
+        if (change.removed) {
+            removals.push_back(device_id);
+        } else {
+            upserts.push_back(DeviceRecord{device_id, std::move(change.meta)});
+        }
+    }
+    batch.clear();
+
+    const bool upserted = upserts.empty() || persistence.upsert(upserts);
+    const bool removed = removals.empty() || persistence.remove(removals);
+    if (upserted) {
+        counters.flushed.fetch_add(upserts.size(), std::memory_order_relaxed);
+    }
+    if (removed) {
+        counters.flushed.fetch_add(removals.size(), std::memory_order_relaxed);
+    }
+    if (upserted && removed) {
+        return;
+    }
+
+    // 失败的脏项放回脏集；写库期间同一设备已有新修改的，以新修改为准
+    counters.failed.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(dirty_mtx);
+    if (!upserted) {
+        logger->error("Failed to write {} device(s), will retry", upserts.size());
+        for (auto& device : upserts) {
+            pending.try_emplace(std::move(device.device_id), Pending{false, std::move(device.meta)});
+        }
+    }
+    if (!removed) {
+        logger->error("Failed to delete {} device(s), will retry", removals.size());
+        for (auto& device_id : removals) {
+            pending.try_emplace(std::move(device_id), Pending{true, {}});
+        }
+    }
+}
+
+}  // namespace ahohs::registry
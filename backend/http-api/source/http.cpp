@@ -1,4 +1,8 @@
 #include <crow.h>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <optional>
 #include <thread>
 #include <chrono>
 #include <fstream>
@@ -8,6 +12,7 @@
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include "http.h"
+#include "device_api.h"
 
 /*
 TODO: 提供一个WebSocket API，当有任何元数据更新时，通过WebSocket发送新的元数据
@@ -45,11 +50,27 @@ static CrowLogHandler crow_log_handler;
 // HttpServer 类实现
 //////////////////////
 
-HttpServer::HttpServer(ahohs::db::PostgresDB& database)
-    : database(database) {
+HttpServer::HttpServer(ahohs::db::PostgresDB& database, ahohs::registry::DeviceRegistry& devices)
+    : database(database), devices(devices) {
     logger->info("HttpServer initialized.");
 }
 
+void HttpServer::set_meta_listener(MetaListener listener) {
+    meta_listener = std::move(listener);
+}
+
+void HttpServer::set_delete_listener(DeleteListener listener) {
+    delete_listener = std::move(listener);
+}
+
+void HttpServer::set_scheduler(ahohs::scheduler::Scheduler& scheduler) {
+    this->scheduler = &scheduler;
+}
+
+void HttpServer::set_series_store(ahohs::series::SeriesStore& store) {
+    series_store = &store;
+}
+
 void HttpServer::setup_routes(crow::App<>& app) {
     // 首页路由：显示硬件线程信息
     CROW_ROUTE(app, "/")
@@ -103,6 +124,32 @@ void HttpServer::setup_routes(crow::App<>& app) {
         return this->handle_delete_device(device_id);
     });
 
+    // 查询属性历史：GET /device/<device_id>/history?attrib=/temperature&from=<ms>&to=<ms>
+    // to 缺省为当前时刻，from 缺省为 to 之前 24 小时；返回的时间戳按 SERIES_TS_RESOLUTION_MS 向下取整
+    CROW_ROUTE(app, "/device/<string>/history").methods("GET"_method)
+    ([this](const crow::request& req, const std::string& device_id) {
+        return this->handle_get_device_history(req, device_id);
+    });
+
+    // 查询所有定时任务：GET /schedules
+    CROW_ROUTE(app, "/schedules").methods("GET"_method)
+    ([this]() {
+        return this->handle_get_schedules();
+    });
+
+    // 新增/更新定时任务：POST /schedule
+    // JSON Body 即任务定义，如 {"id":"ac-off","at":"23:00","then":[{"device":"ac1","attrib":"/power_on","value":false}]}
+    CROW_ROUTE(app, "/schedule").methods("POST"_method)
+    ([this](const crow::request& req) {
+        return this->handle_create_or_update_schedule(req);
+    });
+
+    // 删除定时任务：DELETE /schedule/<schedule_id>
+    CROW_ROUTE(app, "/schedule/<string>").methods("DELETE"_method)
+    ([this](const std::string& schedule_id) {
+        return this->handle_delete_schedule(schedule_id);
+    });
+
     CROW_CATCHALL_ROUTE(app)
     ([]() {
         return "404 Not Found";
@@ -110,39 +157,23 @@ void HttpServer::setup_routes(crow::App<>& app) {
 }
 
 crow::response HttpServer::handle_get_devices() {
-    json response;
-    auto result_opt = database.query_prepared("get_all_devices", {});
-    json device_array = json::array();
-    if (result_opt) {
-        for (const auto& row : *result_opt) {
-            json device;
-            device["device_id"] = std::string(row["device_id"].c_str());
-            std::string meta_str = std::string(row["meta"].c_str());
-            try {
-                json meta_json = json::parse(meta_str);
-                device["meta"] = meta_json;
-            } catch (const std::exception& e) {
-                spdlog::error("Failed to parse meta field as JSON: {}", e.what());
-                device["meta"] = meta_str;
-            }
-            device_array.push_back(device);
-        }
-        response["devices"] = device_array;
-    } else {
-        response["error"] = "Failed to query devices.";
+    // 只在复制快照时持有登记表的读锁，构建响应（解析每台设备的 meta）不阻塞写入
+    auto snapshot = devices.snapshot();
+    std::vector<DeviceRow> rows;
+    rows.reserve(snapshot.size());
+    for (const auto& device : snapshot) {
+        rows.push_back({device.device_id, device.meta});
     }
-    crow::response resp(response.dump());
+    crow::response resp(devices_json(rows));
     resp.add_header("Content-Type", "application/json");
     return resp;
 }
 
 crow::response HttpServer::handle_get_device(const std::string& device_id) {
     json response;
-    auto result_opt = database.query_prepared("get_device", {device_id});
-    if (result_opt && result_opt->size() > 0) {
-        const auto& row = (*result_opt)[0];
-        response["device_id"] = std::string(row["device_id"].c_str());
-        std::string meta_str = std::string(row["meta"].c_str());
+    if (auto meta = devices.get(device_id)) {
+        response["device_id"] = device_id;
+        std::string meta_str = std::move(*meta);
         try {
             json meta_json = json::parse(meta_str);
             response["meta"] = meta_json;
@@ -160,25 +191,19 @@ crow::response HttpServer::handle_get_device(const std::string& device_id) {
 
 crow::response HttpServer::handle_create_or_update_device(const crow::request& req) {
     json response;
-    json body = json::parse(req.body, nullptr, false);
-    if (body.is_discarded()) {
-        response["error"] = "Invalid JSON input.";
-        return crow::response(response.dump());
-    }
-    // 校验必要字段 device_id 和 meta 是否存在
-    if (!body.contains("device_id") || !body.contains("meta")) {
-        response["error"] = "Missing required field: device_id or meta.";
+    DeviceUpsert upsert;
+    try {
+        upsert = parse_device_upsert(req.body);
+    } catch (const std::invalid_argument& ex) {
+        response["error"] = ex.what();
         return crow::response(response.dump());
     }
-    std::string device_id = body["device_id"].get<std::string>();
-    std::string meta;
-    if (body["meta"].is_string()) {
-        meta = body["meta"].get<std::string>();
-    } else {
-        meta = body["meta"].dump();
+    // 写入登记表后立即可见，由其合并后异步写库
+    bool success = devices.put(upsert.device_id, upsert.meta);
+    if (success && meta_listener) {
+        meta_listener(upsert.device_id,
+                      upsert.meta_value.is_string() ? json::parse(upsert.meta, nullptr, false) : upsert.meta_value);
     }
-    // 使用数据库接口进行 upsert 操作（新增或更新设备元数据）
-    bool success = database.exec_prepared("upsert_device_meta", {device_id, meta});
     response["message"] = success ? "Device added/updated successfully." 
                                   : "Failed to add/update device.";
     crow::response resp(response.dump());
@@ -198,7 +223,14 @@ crow::response HttpServer::handle_update_device(const crow::request& req, const
         return crow::response(response.dump());
     }
     std::string meta = body["meta"].is_string() ? body["meta"].get<std::string>() : body["meta"].dump();
-    bool success = database.exec_prepared("upsert_device_meta", {device_id, meta});
+    if (body["meta"].is_string() && !json::accept(meta)) {
+        response["error"] = "Invalid JSON in field: meta.";
+        return crow::response(response.dump());
+    }
+    bool success = devices.put(device_id, meta);
+    if (success && meta_listener) {
+        meta_listener(device_id, body["meta"].is_string() ? json::parse(meta, nullptr, false) : body["meta"]);
+    }
     response["message"] = success ? "Device updated successfully." 
                                   : "Failed to update device.";
     crow::response resp(response.dump());
@@ -208,7 +240,10 @@ crow::response HttpServer::handle_update_device(const crow::request& req, const
 
 crow::response HttpServer::handle_delete_device(const std::string& device_id) {
     json response;
-    bool success = database.exec_prepared("delete_device", {device_id});
+    bool success = devices.remove(device_id);
+    if (success && delete_listener) {
+        delete_listener(device_id);
+    }
     response["message"] = success ? "Device deleted successfully." 
                                   : "Failed to delete device.";
     crow::response resp(response.dump());
@@ -216,15 +251,152 @@ crow::response HttpServer::handle_delete_device(const std::string& device_id) {
     return resp;
 }
 
-void HttpServer::run(uint16_t port) {
+crow::response HttpServer::handle_get_device_history(const crow::request& req, const std::string& device_id) {
+    json response;
+    const char* attrib = req.url_params.get("attrib");
+    if (attrib == nullptr || *attrib == '\0') {
+        response["error"] = "Missing required query parameter: attrib.";
+        return crow::response(response.dump());
+    }
+    auto parse_ms = [&req](const char* name, int64_t fallback) -> std::optional<int64_t> {
+        const char* text = req.url_params.get(name);
+        if (text == nullptr) {
+            return fallback;
+        }
+        int64_t value = 0;
+        const char* end = text + std::strlen(text);
+        auto [ptr, ec] = std::from_chars(text, end, value);
+        if (ec != std::errc() || ptr != end) {
+            return std::nullopt;
+        }
+        return value;
+    };
+    const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    auto to = parse_ms("to", now);
+    if (!to) {
+        response["error"] = "Invalid query parameter: to.";
+        return crow::response(response.dump());
+    }
+    auto from = parse_ms("from", *to - std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::hours(24)).count());
+    if (!from) {
+        response["error"] = "Invalid query parameter: from.";
+        return crow::response(response.dump());
+    }
+
+    // 最近的区间直接解码内存中的压缩块，不访问数据库
+    if (series_store) {
+        if (auto range = series_store->range(device_id, attrib, *from, *to)) {
+            crow::response resp(history_json(device_id, attrib, *range));
+            resp.add_header("Content-Type", "application/json");
+            return resp;
+        }
+    }
+
+    // 时间戳与内存路径一样按精度向下取整，区间起点对齐到所在精度区间，同一区间无论由哪条路径给出结果都一致
+    const int64_t resolution = series_store ? series_store->resolution() : 1;
+    const int64_t from_unit = *from - *from % resolution;
+    auto result_opt = database.query_prepared("get_telemetry_range",
+                                              {device_id, attrib, std::to_string(from_unit), std::to_string(*to)});
+    if (result_opt) {
+        json points = json::array();
+        for (const auto& row : *result_opt) {
+            const int64_t ts = row["ts"].as<int64_t>();
+            points.push_back(json::array({ts - ts % resolution, json::parse(row["value"].c_str(), nullptr, false)}));
+        }
+        response["device_id"] = device_id;
+        response["attrib"] = attrib;
+        response["source"] = "database";
+        response["points"] = std::move(points);
+    } else {
+        response["error"] = "Failed to query telemetry.";
+    }
+    crow::response resp(response.dump());
+    resp.add_header("Content-Type", "application/json");
+    return resp;
+}
+
+crow::response HttpServer::handle_get_schedules() {
+    json response;
+    auto result_opt = database.query_prepared("get_all_schedules", {});
+    if (result_opt) {
+        json schedules = json::array();
+        for (const auto& row : *result_opt) {
+            json schedule = json::parse(row["spec"].c_str(), nullptr, false);
+            if (scheduler && !schedule.is_discarded()) {
+                if (auto due = scheduler->next_due(row["id"].c_str())) {
+                    schedule["next_due"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        due->time_since_epoch()).count();
+                }
+            }
+            schedules.push_back(schedule);
+        }
+        response["schedules"] = schedules;
+    } else {
+        response["error"] = "Failed to query schedules.";
+    }
+    crow::response resp(response.dump());
+    resp.add_header("Content-Type", "application/json");
+    return resp;
+}
+
+crow::response HttpServer::handle_create_or_update_schedule(const crow::request& req) {
+    json response;
+    json body = json::parse(req.body, nullptr, false);
+    if (body.is_discarded()) {
+        response["error"] = "Invalid JSON input.";
+        return crow::response(response.dump());
+    }
+    // 先校验定义，非法定义不写库
+    ahohs::scheduler::Schedule schedule;
+    try {
+        schedule = ahohs::scheduler::Schedule::parse(body);
+    } catch (const std::invalid_argument& ex) {
+        response["error"] = ex.what();
+        return crow::response(response.dump());
+    }
+    bool success = database.exec_prepared("upsert_schedule", {schedule.id, body.dump()});
+    if (success && scheduler) {
+        scheduler->add(std::move(schedule));
+    }
+    response["message"] = success ? "Schedule added/updated successfully."
+                                  : "Failed to add/update schedule.";
+    crow::response resp(response.dump());
+    resp.add_header("Content-Type", "application/json");
+    return resp;
+}
+
+crow::response HttpServer::handle_delete_schedule(const std::string& schedule_id) {
+    json response;
+    bool success = database.exec_prepared("delete_schedule", {schedule_id});
+    if (success && scheduler) {
+        scheduler->remove(schedule_id);
+    }
+    response["message"] = success ? "Schedule deleted successfully."
+                                  : "Failed to delete schedule.";
+    crow::response resp(response.dump());
+    resp.add_header("Content-Type", "application/json");
+    return resp;
+}
+
+void HttpServer::run(uint16_t port, std::size_t n_threads) {
     crow::logger::setHandler(&crow_log_handler);
-    crow::App<> app;
     setup_routes(app);
-    logger->info("Starting HTTP server on port {}", port);
+    if (n_threads == 0) {
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    logger->info("Starting HTTP server on port {} with {} thread(s)", port, n_threads);
+    // 信号由生命周期控制器统一处理，Crow 不再自行注册 SIGINT / SIGTERM
     app.port(port)
-       .multithreaded()
+       .concurrency(static_cast<std::uint16_t>(n_threads))
+       .signal_clear()
        .run();
     logger->info("HTTP server shutdown.");
 }
 
+void HttpServer::stop() {
+    app.wait_for_server_start();
+    app.stop();
+}
+
 }  // namespace ahohs::http_server
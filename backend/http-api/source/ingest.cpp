@@ -0,0 +1,573 @@
+#include "ingest.h"
+#include <algorithm>
+#include <charconv>
+#include <nlohmann/json.hpp>
+#include "topic_router.h"
+
+namespace ahohs::ingest {
+
+using json = nlohmann::json;
+
+namespace {
+
+using DeviceTopicRouter = ahoh::mqtt::TopicRouter<TopicKind, 2>;
+
+/// 设备 topic 路由表，首次使用时编译一次
+const DeviceTopicRouter& device_topic_router() {
+    static const DeviceTopicRouter router = [] {
+        DeviceTopicRouter r;
+        r.add("/device/+/attrib/+", TopicKind::Attrib);
+        r.add("/device/+/attrib", TopicKind::AttribBatch);
+        r.add("/device/+/heartbeat", TopicKind::Heartbeat);
+        r.add("/device/+/meta", TopicKind::Meta);
+        r.add("/device/+/will", TopicKind::Will);
+        r.compile();
+        return r;
+    }();
+    return router;
+}
+
+}  // namespace
+
+TopicInfo classify_topic(std::string_view topic) {
+    TopicInfo info;
+    DeviceTopicRouter::Captures captures;
+    const TopicKind* kind = device_topic_router().match_one(topic, captures);
+    if (kind == nullptr || captures[0].empty()) {
+        return info;
+    }
+    if (*kind == TopicKind::Attrib) {
+        if (captures[1].empty()) {
+            return info;
+        }
+        // 捕获是原 topic 的切片，向前扩展一个字符即可带上前导 '/'
+        info.attrib = std::string_view(captures[1].data() - 1, captures[1].size() + 1);
+    }
+    info.kind = *kind;
+    info.device_id = captures[0];
+    return info;
+}
+
+namespace {
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/// 按 JSON 语法扫描一个数字，返回其长度，不是合法数字时返回 0
+/// （std::from_chars 还接受 inf、nan、前导零、".5" 等 JSON 不允许的写法）
+std::size_t scan_json_number(const char* p, const char* end) {
+    const char* q = p;
+    if (q < end && *q == '-') {
+        ++q;
+    }
+    if (q == end || !is_digit(*q)) {
+        return 0;
+    }
+    if (*q == '0') {
+        ++q;
+    } else {
+        while (q < end && is_digit(*q)) {
+            ++q;
+        }
+    }
+    if (q < end && *q == '.') {
+        ++q;
+        if (q == end || !is_digit(*q)) {
+            return 0;
+        }
+        while (q < end && is_digit(*q)) {
+            ++q;
+        }
+    }
+    if (q < end && (*q == 'e' || *q == 'E')) {
+        ++q;
+        if (q < end && (*q == '+' || *q == '-')) {
+            ++q;
+        }
+        if (q == end || !is_digit(*q)) {
+            return 0;
+        }
+        while (q < end && is_digit(*q)) {
+            ++q;
+        }
+    }
+    return static_cast<std::size_t>(q - p);
+}
+
+/// JSON 标量转为属性值，数组 / 对象返回 std::nullopt
+std::optional<telemetry::AttribValue> to_attrib_value(const json& v) {
+    if (v.is_null()) {
+        return telemetry::AttribValue{};
+    }
+    if (v.is_boolean()) {
+        return telemetry::AttribValue{v.get<bool>()};
+    }
+    if (v.is_number()) {
+        return telemetry::AttribValue{v.get<double>()};
+    }
+    if (v.is_string()) {
+        return telemetry::AttribValue{v.get<std::string>()};
+    }
+    return std::nullopt;
+}
+
+}  // namespace
+
+std::optional<telemetry::AttribValue> parse_attrib_payload_fast(std::string_view payload) {
+    const char* p = payload.data();
+    const char* end = p + payload.size();
+    auto skip_space = [&]() {
+        while (p < end && is_space(*p)) {
+            ++p;
+        }
+    };
+    auto consume = [&](std::string_view token) {
+        if (static_cast<std::size_t>(end - p) < token.size() || std::string_view(p, token.size()) != token) {
+            return false;
+        }
+        p += token.size();
+        return true;
+    };
+
+    skip_space();
+    if (!consume("{")) {
+        return std::nullopt;
+    }
+    skip_space();
+    if (!consume(R"("value")")) {
+        return std::nullopt;
+    }
+    skip_space();
+    if (!consume(":")) {
+        return std::nullopt;
+    }
+    skip_space();
+
+    telemetry::AttribValue value;
+    const char first = p < end ? *p : '\0';
+    if (first == 't' || first == 'f' || first == 'n') {
+        if (consume("true")) {
+            value = true;
+        } else if (consume("false")) {
+            value = false;
+        } else if (consume("null")) {
+            value = std::monostate{};
+        } else {
+            return std::nullopt;
+        }
+    } else {
+        std::size_t len = scan_json_number(p, end);
+        double number = 0;
+        if (len == 0 || std::from_chars(p, p + len, number).ec != std::errc()) {
+            return std::nullopt;  // 字符串等其他值，或超出 double 范围
+        }
+        p += len;
+        value = number;
+    }
+
+    // 可选的去重序号 ,"seq":n（见 dedup.h），此处只校验格式
+    skip_space();
+    if (consume(",")) {
+        skip_space();
+        if (!consume(R"("seq")")) {
+            return std::nullopt;
+        }
+        skip_space();
+        if (!consume(":")) {
+            return std::nullopt;
+        }
+        skip_space();
+        const char* digits = p;
+        while (p < end && is_digit(*p)) {
+            ++p;
+        }
+        if (p == digits) {
+            return std::nullopt;
+        }
+    }
+
+    skip_space();
+    if (!consume("}")) {
+        return std::nullopt;
+    }
+    skip_space();
+    if (p != end) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::optional<telemetry::AttribValue> parse_attrib_payload_json(std::string_view payload) {
+    json body = json::parse(payload, nullptr, false);
+    if (body.is_discarded() || !body.is_object()) {
+        return std::nullopt;
+    }
+    auto it = body.find("value");
+    if (it == body.end()) {
+        return std::nullopt;
+    }
+    return to_attrib_value(*it);
+}
+
+std::optional<telemetry::AttribValue> parse_attrib_payload(std::string_view payload) {
+    if (auto value = parse_attrib_payload_fast(payload)) {
+        return value;
+    }
+    return parse_attrib_payload_json(payload);
+}
+
+// ===== Ingestor 实现 =====
+
+Ingestor::Ingestor(state::DeviceStateStore& store,
+                   telemetry::TelemetrySink& sink,
+                   liveness::LivenessTracker& liveness)
+    : store(store), sink(sink), liveness(liveness) {}
+
+void Ingestor::set_meta_handler(MetaHandler handler) {
+    meta_handler = std::move(handler);
+}
+
+void Ingestor::set_attrib_listener(AttribListener listener) {
+    attrib_listener = std::move(listener);
+}
+
+void Ingestor::set_schema_registry(const codec::SchemaRegistry& registry) {
+    schemas = &registry;
+}
+
+std::shared_ptr<const codec::DeviceSchema> Ingestor::schema_for(std::string_view device_id) const {
+    return schemas ? schemas->get(device_id) : nullptr;
+}
+
+void Ingestor::ingest(std::string_view topic, std::string_view payload, Clock::time_point received_at) {
+    TopicInfo info = classify_topic(topic);
+    switch (info.kind) {
+        case TopicKind::Attrib:
+            handle_attrib(info, payload, received_at);
+            break;
+        case TopicKind::AttribBatch:
+            handle_attrib_batch(info, payload, received_at);
+            break;
+        case TopicKind::Heartbeat:
+            counters.heartbeat.fetch_add(1, std::memory_order_relaxed);
+            store.touch(info.device_id, received_at);
+            liveness.on_heartbeat(info.device_id, received_at);
+            break;
+        case TopicKind::Meta:
+            counters.meta.fetch_add(1, std::memory_order_relaxed);
+            if (meta_handler && !meta_handler(info.device_id, payload)) {
+                counters.malformed.fetch_add(1, std::memory_order_relaxed);
+            }
+            break;
+        case TopicKind::Will:
+            // 与心跳落在同一分片，按到达顺序处理
+            counters.will.fetch_add(1, std::memory_order_relaxed);
+            liveness.on_will(info.device_id, payload, received_at);
+            break;
+        case TopicKind::Unknown:
+            counters.unknown.fetch_add(1, std::memory_order_relaxed);
+            logger->trace("Unknown topic: {}", topic);
+            break;
+    }
+}
+
+void Ingestor::handle_attrib(const TopicInfo& info, std::string_view payload, Clock::time_point ts) {
+    std::optional<telemetry::AttribValue> value;
+    auto schema = schema_for(info.device_id);
+    if (schema && schema->version == codec::SchemaVersion::V2) {
+        value = codec::decode_attrib_v2(payload);
+    } else {
+        value = parse_attrib_payload_fast(payload);
+        if (!value) {
+            counters.slow_path.fetch_add(1, std::memory_order_relaxed);
+            value = parse_attrib_payload_json(payload);
+        }
+    }
+    if (!value) {
+        counters.malformed.fetch_add(1, std::memory_order_relaxed);
+        logger->debug("Malformed attrib payload from {}{}", info.device_id, info.attrib);
+        return;
+    }
+    apply_attrib(info.device_id, info.attrib, std::move(*value), ts);
+}
+
+void Ingestor::handle_attrib_batch(const TopicInfo& info, std::string_view payload, Clock::time_point ts) {
+    auto schema = schema_for(info.device_id);
+    bool ok = true;
+    if (schema && schema->version == codec::SchemaVersion::V2) {
+        ok = codec::decode_batch_v2(payload, *schema, [&](std::string_view attrib, telemetry::AttribValue value) {
+            if (!attrib.empty()) {
+                apply_attrib(info.device_id, attrib, std::move(value), ts);
+            }
+        });
+    } else {
+        // v1 批量负载：{"temperature":23.4,"alert":false}，键即属性名（可省略前导 '/'）
+        json body = json::parse(payload, nullptr, false);
+        ok = !body.is_discarded() && body.is_object();
+        if (ok) {
+            counters.slow_path.fetch_add(1, std::memory_order_relaxed);
+            std::string attrib;
+            for (const auto& [key, v] : body.items()) {
+                auto value = to_attrib_value(v);
+                if (!value || key.empty()) {
+                    ok = false;
+                    continue;
+                }
+                attrib.assign(key.front() == '/' ? "" : "/").append(key);
+                apply_attrib(info.device_id, attrib, std::move(*value), ts);
+            }
+        }
+    }
+    if (!ok) {
+        counters.malformed.fetch_add(1, std::memory_order_relaxed);
+        logger->debug("Malformed attrib batch from {}", info.device_id);
+    }
+}
+
+void Ingestor::apply_attrib(std::string_view device_id, std::string_view attrib,
+                            telemetry::AttribValue value, Clock::time_point ts) {
+    counters.attrib.fetch_add(1, std::memory_order_relaxed);
+    store.update_attrib(device_id, attrib, value, ts);
+    if (attrib_listener) {
+        attrib_listener(device_id, attrib, value);
+    }
+    sink.append({std::string(device_id), std::string(attrib), std::move(value), ts});
+}
+
+// ===== IngestPipeline 实现 =====
+
+IngestPipeline::IngestPipeline(Ingestor& ingestor,
+                               std::size_t n_workers,
+                               std::size_t capacity,
+                               OverflowPolicy policy)
+    : ingestor(ingestor),
+      policy(policy),
+      n_shards(n_workers != 0 ? n_workers : std::max(1u, std::thread::hardware_concurrency())) {
+    create_shards(capacity);
+    for (auto& shard : shards) {
+        shard->worker = std::thread([this, s = shard.get()]() { run(*s); });
+    }
+    logger->info("IngestPipeline started, {} shards, queue capacity {} per shard",
+                 n_shards, shards.front()->ring.capacity());
+}
+
+IngestPipeline::IngestPipeline(Ingestor& ingestor,
+                               runtime::Runtime& runtime,
+                               std::size_t n_shards,
+                               std::size_t capacity,
+                               OverflowPolicy policy)
+    : ingestor(ingestor),
+      runtime(&runtime),
+      policy(policy),
+      n_shards(n_shards != 0 ? n_shards : runtime.thread_count()) {
+    create_shards(capacity);
+    logger->info("IngestPipeline started on the shared runtime, {} shards, queue capacity {} per shard",
+                 this->n_shards, shards.front()->ring.capacity());
+}
+
+void IngestPipeline::create_shards(std::size_t capacity) {
+    shards.reserve(n_shards);
+    for (std::size_t i = 0; i < n_shards; ++i) {
+        shards.push_back(std::make_unique<Shard>(capacity));
+    }
+}
+
+IngestPipeline::~IngestPipeline() {
+    stop();
+}
+
+IngestPipeline::Shard& IngestPipeline::shard_for(std::string_view topic) const {
+    // 按 device_id 分片以保证同一设备的消息有序；无法识别的 topic 按整个 topic 分片
+    TopicInfo info = classify_topic(topic);
+    std::string_view key = info.kind == TopicKind::Unknown ? topic : info.device_id;
+    return *shards[state::StringHash{}(key) % n_shards];
+}
+
+bool IngestPipeline::submit(RawMessage&& msg) {
+    if (stopping.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    Shard& shard = shard_for(msg.topic);
+    bool waited = false;
+    while (!shard.ring.try_push(std::move(msg))) {
+        if (policy == OverflowPolicy::DropNewest) {
+            shard.dropped_newest.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (policy == OverflowPolicy::DropOldest) {
+            RawMessage oldest;
+            if (shard.ring.try_pop(oldest)) {
+                shard.dropped_oldest.fetch_add(1, std::memory_order_relaxed);
+            }
+            continue;
+        }
+        // Block：让出 CPU 等待工作线程腾出空位
+        if (!waited) {
+            waited = true;
+            shard.blocked.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (stopping.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        wake(shard);
+        std::this_thread::yield();
+    }
+    shard.enqueued.fetch_add(1, std::memory_order_relaxed);
+    std::size_t depth = shard.ring.size_approx();
+    if (depth > shard.high_watermark.load(std::memory_order_relaxed)) {
+        shard.high_watermark.store(depth, std::memory_order_relaxed);
+    }
+    // 与 run() / drain() 中的 fence 配对：要么工作线程（排空任务）看到新消息，要么这里看到 sleeping（未投递）
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (runtime ? !shard.scheduled.load(std::memory_order_relaxed) : shard.sleeping.load(std::memory_order_relaxed)) {
+        wake(shard);
+    }
+    return true;
+}
+
+void IngestPipeline::wake(Shard& shard) {
+    if (runtime) {
+        if (!shard.scheduled.exchange(true, std::memory_order_acq_rel)) {
+            runtime->post([this, &shard]() { drain(shard); });
+        }
+        return;
+    }
+    shard.signal.fetch_add(1, std::memory_order_release);
+    shard.signal.notify_one();
+}
+
+void IngestPipeline::stop() {
+    if (stopping.exchange(true)) {
+        return;
+    }
+    for (auto& shard : shards) {
+        wake(*shard);
+    }
+    for (auto& shard : shards) {
+        if (shard->worker.joinable()) {
+            shard->worker.join();
+        }
+    }
+    // 共享事件循环下等待每个分片的排空任务处理完剩余消息；事件循环已停止时剩余消息直接丢弃
+    while (runtime && !runtime->stopped()) {
+        const uint32_t seen = drained.load(std::memory_order_acquire);
+        bool idle = true;
+        for (const auto& shard : shards) {
+            idle = idle && !shard->scheduled.load(std::memory_order_acquire) && shard->ring.empty_approx();
+        }
+        if (idle) {
+            break;
+        }
+        drained.wait(seen, std::memory_order_acquire);
+    }
+    logger->info("IngestPipeline stopped, {} messages dropped, {} duplicates suppressed", dropped(), duplicates());
+}
+
+void IngestPipeline::process(Shard& shard, RawMessage& msg) {
+    DedupResult dedup = INGEST_DEDUP ? shard.dedup.check(msg.topic, msg.payload, msg.redelivered)
+                                     : DedupResult::Fresh;
+    if (dedup == DedupResult::Fresh) {
+        ingestor.ingest(msg.topic, msg.payload, msg.received_at);
+    } else {
+        auto& counter = dedup == DedupResult::DuplicateSeq ? shard.duplicates_seq : shard.duplicates_hash;
+        counter.fetch_add(1, std::memory_order_relaxed);
+    }
+    shard.processed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void IngestPipeline::run(Shard& shard) {
+    static constexpr int SPIN_BEFORE_SLEEP = 64;
+    RawMessage msg;
+    int idle = 0;
+    while (true) {
+        if (shard.ring.try_pop(msg)) {
+            process(shard, msg);
+            idle = 0;
+            continue;
+        }
+        if (stopping.load(std::memory_order_acquire) && shard.ring.empty_approx()) {
+            break;
+        }
+        if (++idle < SPIN_BEFORE_SLEEP) {
+            std::this_thread::yield();
+            continue;
+        }
+        // 先记下唤醒序号再声明休眠，随后复查队列，避免丢失唤醒
+        uint32_t seen = shard.signal.load(std::memory_order_acquire);
+        shard.sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (shard.ring.empty_approx() && !stopping.load(std::memory_order_relaxed)) {
+            shard.signal.wait(seen, std::memory_order_acquire);
+        }
+        shard.sleeping.store(false, std::memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+void IngestPipeline::drain(Shard& shard) {
+    RawMessage msg;
+    for (int i = 0; i < INGEST_DRAIN_BUDGET; ++i) {
+        if (shard.ring.try_pop(msg)) {
+            process(shard, msg);
+            continue;
+        }
+        // 先撤销投递标志再复查队列，与 submit() 中的 fence 配对：要么这里看到新消息，要么 submit() 重新投递
+        shard.scheduled.store(false, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!shard.ring.empty_approx()) {
+            wake(shard);
+        }
+        if (stopping.load(std::memory_order_relaxed)) {
+            drained.fetch_add(1, std::memory_order_release);
+            drained.notify_all();
+        }
+        return;
+    }
+    // 预算用完时保留投递标志，排到其他任务之后继续
+    runtime->post([this, &shard]() { drain(shard); });
+}
+
+std::vector<ShardMetrics> IngestPipeline::metrics() const {
+    std::vector<ShardMetrics> result;
+    result.reserve(n_shards);
+    for (const auto& shard : shards) {
+        ShardMetrics m;
+        m.depth = shard->ring.size_approx();
+        m.capacity = shard->ring.capacity();
+        m.high_watermark = shard->high_watermark.load(std::memory_order_relaxed);
+        m.enqueued = shard->enqueued.load(std::memory_order_relaxed);
+        m.processed = shard->processed.load(std::memory_order_relaxed);
+        m.dropped_newest = shard->dropped_newest.load(std::memory_order_relaxed);
+        m.dropped_oldest = shard->dropped_oldest.load(std::memory_order_relaxed);
+        m.blocked = shard->blocked.load(std::memory_order_relaxed);
+        m.duplicates_seq = shard->duplicates_seq.load(std::memory_order_relaxed);
+        m.duplicates_hash = shard->duplicates_hash.load(std::memory_order_relaxed);
+        result.push_back(m);
+    }
+    return result;
+}
+
+uint64_t IngestPipeline::dropped() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard->dropped_newest.load(std::memory_order_relaxed)
+               + shard->dropped_oldest.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t IngestPipeline::duplicates() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard->duplicates_seq.load(std::memory_order_relaxed)
+               + shard->duplicates_hash.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+}  // namespace ahohs::ingest
@@ -0,0 +1,83 @@
+#include "lifecycle.h"
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace ahohs::lifecycle {
+
+Lifecycle::Lifecycle() {
+    efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (efd < 0) {
+        logger->error("eventfd failed: {}", strerror(errno));
+    }
+}
+
+Lifecycle::~Lifecycle() {
+    if (signal_thread.joinable()) {
+        // 信号在所有线程中都被屏蔽，发给信号线程的 SIGTERM 只会被其 sigwait 取走
+        signal_thread_exiting.store(true, std::memory_order_release);
+        pthread_kill(signal_thread.native_handle(), SIGTERM);
+        signal_thread.join();
+    }
+    if (efd >= 0) {
+        close(efd);
+    }
+}
+
+void Lifecycle::install_signal_handler() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGTERM);
+    sigaddset(&set, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    signal_thread = std::thread([this, set]() {
+        while (true) {
+            int sig = 0;
+            if (sigwait(&set, &sig) != 0) {
+                continue;
+            }
+            if (signal_thread_exiting.load(std::memory_order_acquire)) {
+                return;
+            }
+            if (stop_requested()) {
+                logger->warn("Received signal {} during shutdown, exiting immediately", sig);
+                std::_Exit(1);
+            }
+            logger->info("Received signal {}, shutting down", sig);
+            request_stop();
+        }
+    });
+}
+
+void Lifecycle::request_stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stopping.exchange(true, std::memory_order_acq_rel)) {
+            return;
+        }
+    }
+    cv.notify_all();
+    if (efd >= 0) {
+        uint64_t one = 1;
+        if (write(efd, &one, sizeof(one)) < 0) {
+            logger->error("eventfd write failed: {}", strerror(errno));
+        }
+    }
+}
+
+void Lifecycle::wait() const {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this]() { return stop_requested(); });
+}
+
+bool Lifecycle::wait_for(std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(mtx);
+    return cv.wait_for(lock, timeout, [this]() { return stop_requested(); });
+}
+
+}  // namespace ahohs::lifecycle
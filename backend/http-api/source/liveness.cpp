@@ -0,0 +1,162 @@
+#include "liveness.h"
+#include <format>
+#include <nlohmann/json.hpp>
+
+namespace ahohs::liveness {
+
+LivenessTracker::LivenessTracker(state::DeviceStateStore& store,
+                                 telemetry::TelemetrySink& sink,
+                                 std::chrono::milliseconds tick)
+    : store(store),
+      sink(sink),
+      tick(tick),
+      wheel(tick) {
+    ticker = std::thread([this]() { run(); });
+    logger->info("LivenessTracker started, tick {}ms, timeout factor {}", tick.count(), HEARTBEAT_TIMEOUT_FACTOR);
+}
+
+LivenessTracker::LivenessTracker(state::DeviceStateStore& store,
+                                 telemetry::TelemetrySink& sink,
+                                 runtime::Runtime& runtime,
+                                 std::chrono::milliseconds tick)
+    : store(store),
+      sink(sink),
+      tick(tick),
+      wheel(tick) {
+    timer = std::make_unique<runtime::Timer>(runtime, [this]() { on_tick(); });
+    next_tick = SteadyClock::now() + tick;
+    timer->arm_at(next_tick);
+    logger->info("LivenessTracker started on the shared runtime, tick {}ms, timeout factor {}",
+                 tick.count(), HEARTBEAT_TIMEOUT_FACTOR);
+}
+
+LivenessTracker::~LivenessTracker() {
+    stop();
+}
+
+LivenessTracker::Entry& LivenessTracker::get_or_create(std::string_view device_id) {
+    auto it = devices.find(device_id);
+    if (it == devices.end()) {
+        it = devices.emplace(std::string(device_id), Entry{}).first;
+        it->second.timer = wheel.create(0);
+        if (timer_owners.size() <= it->second.timer) {
+            timer_owners.resize(it->second.timer + 1, nullptr);
+        }
+        timer_owners[it->second.timer] = &*it;
+    }
+    return it->second;
+}
+
+void LivenessTracker::set_interval(std::string_view device_id, std::chrono::seconds interval) {
+    if (interval.count() <= 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    Entry& entry = get_or_create(device_id);
+    entry.interval = interval;
+    if (wheel.armed(entry.timer)) {
+        wheel.arm(entry.timer, entry.last_heartbeat + HEARTBEAT_TIMEOUT_FACTOR * interval);
+    }
+}
+
+// 状态变化均在持有 mtx 时发布，同一设备的上线 / 离线事件与状态转换顺序一致
+
+void LivenessTracker::on_heartbeat(std::string_view device_id, state::Clock::time_point ts) {
+    std::lock_guard<std::mutex> lock(mtx);
+    Entry& entry = get_or_create(device_id);
+    entry.last_heartbeat = SteadyClock::now();
+    wheel.arm(entry.timer, entry.last_heartbeat + HEARTBEAT_TIMEOUT_FACTOR * entry.interval);
+    if (!entry.online) {
+        entry.online = true;
+        ++n_online;
+        publish(device_id, true, R"({"reason":"heartbeat"})", ts);
+    }
+}
+
+void LivenessTracker::on_will(std::string_view device_id, std::string_view payload, state::Clock::time_point ts) {
+    // 遗嘱由 broker 在设备异常断开（keep-alive 超时）时代发，无需等待心跳超时
+    nlohmann::json detail = {{"reason", "will"}};
+    auto will = nlohmann::json::parse(payload, nullptr, false);
+    detail["will"] = will.is_discarded() ? nlohmann::json(std::string(payload)) : std::move(will);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    Entry& entry = get_or_create(device_id);
+    wheel.cancel(entry.timer);
+    if (entry.online) {
+        entry.online = false;
+        --n_online;
+    }
+    // 即使设备已被判定离线也记录遗嘱事件
+    publish(device_id, false, detail.dump(), ts);
+}
+
+void LivenessTracker::advance(SteadyClock::time_point now) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto ts = state::Clock::now();
+    wheel.advance(now, [this, ts](util::TimingWheel::TimerId id, uint64_t) {
+        auto& [device_id, entry] = *timer_owners[id];
+        if (entry.online) {
+            entry.online = false;
+            --n_online;
+            publish(device_id, false,
+                    std::format(R"({{"reason":"heartbeat_timeout","heartbeat_interval":{}}})", entry.interval.count()),
+                    ts);
+        }
+    });
+}
+
+void LivenessTracker::publish(std::string_view device_id, bool online, std::string detail, state::Clock::time_point ts) {
+    store.set_online(device_id, online, ts);
+    sink.append_event({std::string(device_id), online ? "online" : "offline", std::move(detail), ts});
+    logger->debug("Device {} is now {}", device_id, online ? "online" : "offline");
+}
+
+void LivenessTracker::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stopping) {
+            return;
+        }
+        stopping = true;
+    }
+    cv.notify_one();
+    if (ticker.joinable()) {
+        ticker.join();
+    }
+    if (timer) {
+        timer->stop();  // 不能持有 mtx：回调中的 advance() 需要加锁
+    }
+    logger->info("LivenessTracker stopped");
+}
+
+void LivenessTracker::run() {
+    auto next = SteadyClock::now() + tick;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            if (cv.wait_until(lock, next, [this]() { return stopping; })) {
+                break;
+            }
+        }
+        advance(SteadyClock::now());
+        next += tick;
+    }
+}
+
+void LivenessTracker::on_tick() {
+    advance(SteadyClock::now());
+    next_tick += tick;
+    timer->arm_at(next_tick);
+}
+
+std::size_t LivenessTracker::tracked() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return devices.size();
+}
+
+std::size_t LivenessTracker::online_count() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return n_online;
+}
+
+}  // namespace ahohs::liveness
@@ -3,11 +3,25 @@
 #include <thread>
 #include <exception>
 #include <spdlog/spdlog.h>
+#include <unistd.h>
 
 #include "http.h"    // HTTP 服务模块
 #include "mqtt.h"    // MQTT 服务模块
 #include "udp.h"     // UDP 响应模块
 #include "db.h"      // 数据库接口
+#include "device_registry.h" // 内存设备登记表
+#include "attrib_codec.h" // 属性负载编码（attrib_schema v1 / v2）
+#include "ingest.h"       // MQTT 消息摄取流水线
+#include "lifecycle.h"    // 进程生命周期与信号处理
+#include "liveness.h"     // 设备心跳存活跟踪
+#include "meta.h"         // MQTT 元数据变更检测
+#include "rules.h"        // 属性自动化规则
+#include "runtime.h"      // 共享事件循环
+#include "scheduler.h"    // 定时任务调度
+#include "series.h"       // 最近遥测的内存时序存储
+#include "state_store.h"  // 设备最新值存储
+#include "telemetry.h"    // 遥测批量写入
+#include "wal.h"          // 遥测预写日志
 
 #ifndef MQTT_SERVER_ADDRESS
 #define MQTT_SERVER_ADDRESS "tcp://mqtt-broker:1883"
@@ -33,6 +47,25 @@
 #define AUTO_DISCOVERY_MQTT_BROKER_PORT 1883
 #endif
 
+// 以下字段只出现在 v2 发现回复中
+#ifndef AUTO_DISCOVERY_HTTP_TLS
+#define AUTO_DISCOVERY_HTTP_TLS 0
+#endif
+
+#ifndef AUTO_DISCOVERY_MQTT_TLS
+#define AUTO_DISCOVERY_MQTT_TLS 0
+#endif
+
+// 为空时使用主机名
+#ifndef AUTO_DISCOVERY_SERVER_ID
+#define AUTO_DISCOVERY_SERVER_ID ""
+#endif
+
+// HTTP（Crow）线程数，0 表示与共享事件循环的线程数（RUNTIME_THREADS）相同
+#ifndef HTTP_THREADS
+#define HTTP_THREADS 0
+#endif
+
 // APP 启动时展示的标题
 static const std::string_view TITLE { R"(
  █████╗ ██╗  ██╗ ██████╗ ██╗  ██╗       █████╗ ██████╗ ██╗      ███████╗███████╗██████╗ ██╗   ██╗███████╗██████╗ 
@@ -47,57 +80,221 @@ int main() {
         // 输出标题
         std::cout << TITLE << "\n";
 
+        // 必须先于任何线程创建，使所有线程继承对 SIGTERM / SIGINT 的屏蔽
+        ahohs::lifecycle::Lifecycle lifecycle;
+        lifecycle.install_signal_handler();
+
+        // 共享事件循环：UDP 发现、摄取分片、存活跟踪与定时任务都作为异步任务运行在同一组线程上。
+        // 先于所有使用它的组件创建，保证最后析构
+        ahohs::runtime::Runtime runtime;
+
         // 创建数据库实例，使用项目中定义的连接字符串
         ahohs::db::PostgresDB database(PG_CONNECTION_STRING);
 
         // 统一注册所有预处理语句，避免重复注册
         try {
             database.register_prepared_statement(
+                "upsert_schedule",
+                "INSERT INTO schedules (id, spec) VALUES ($1, $2) "
+                "ON CONFLICT (id) DO UPDATE SET spec = EXCLUDED.spec, updated_at = CURRENT_TIMESTAMP;");
+            database.register_prepared_statement(
+                "delete_schedule",
+                "DELETE FROM schedules WHERE id = $1;");
+            database.register_prepared_statement(
+                "get_all_schedules",
+                "SELECT id, spec FROM schedules;");
+            database.register_prepared_statement(
+                "get_telemetry_range",
+                "SELECT (extract(epoch FROM ts) * 1000)::bigint AS ts, value FROM telemetry "
+                "WHERE device_id = $1 AND attrib = $2 "
+                "AND ts >= to_timestamp($3::double precision / 1000.0) "
+                "AND ts <= to_timestamp($4::double precision / 1000.0) "
+                "ORDER BY ts;");
+        } catch (const std::exception &ex) {
+            spdlog::error("Register prepared statements failed: {}", ex.what());
+            return 1;
+        }
+
+        // 遥测写入器使用独立的数据库连接，避免与 HTTP 请求争用同一个 pqxx::connection
+        ahohs::db::PostgresDB telemetry_database(PG_CONNECTION_STRING);
+        try {
+            telemetry_database.register_prepared_statement(
+                "insert_telemetry",
+                "INSERT INTO telemetry (device_id, attrib, value, ts) "
+                "VALUES ($1, $2, $3::jsonb, to_timestamp($4::double precision / 1000.0));");
+            telemetry_database.register_prepared_statement(
+                "insert_device_event",
+                "INSERT INTO device_events (device_id, event, detail, ts) "
+                "VALUES ($1, $2, $3::jsonb, to_timestamp($4::double precision / 1000.0));");
+        } catch (const std::exception &ex) {
+            spdlog::error("Register telemetry prepared statements failed: {}", ex.what());
+            return 1;
+        }
+
+        // 设备登记表的刷新线程使用独立连接，HTTP 与 MQTT 对设备的读写都只经过内存
+        ahohs::db::PostgresDB registry_database(PG_CONNECTION_STRING);
+        try {
+            registry_database.register_prepared_statement(
                 "upsert_device_meta",
                 "INSERT INTO devices (device_id, meta) VALUES ($1, $2) "
                 "ON CONFLICT (device_id) DO UPDATE SET meta = EXCLUDED.meta, updated_at = CURRENT_TIMESTAMP;");
-            database.register_prepared_statement(
+            registry_database.register_prepared_statement(
                 "delete_device",
                 "DELETE FROM devices WHERE device_id = $1;");
-            database.register_prepared_statement(
-                "get_device",
-                "SELECT device_id, meta FROM devices WHERE device_id = $1;");
-            database.register_prepared_statement(
+            registry_database.register_prepared_statement(
                 "get_all_devices",
                 "SELECT device_id, meta FROM devices;");
         } catch (const std::exception &ex) {
-            spdlog::error("Register prepared statements failed: {}", ex.what());
+            spdlog::error("Register device registry prepared statements failed: {}", ex.what());
+            return 1;
+        }
+        ahohs::registry::PostgresDevicePersistence device_persistence(registry_database);
+        ahohs::registry::DeviceRegistry device_registry(device_persistence);
+        if (!device_registry.load()) {
+            spdlog::error("Load devices failed");
             return 1;
         }
 
+        // 创建摄取流水线：最新值存储 + 遥测写入器 + 心跳存活跟踪 + 工作线程
+        ahohs::state::DeviceStateStore state_store;
+        // 遥测先写本地预写日志再异步写库，数据库故障期间摄取不受影响；日志不可用时直接写库
+        std::unique_ptr<ahohs::wal::WriteAheadLog> telemetry_wal;
+        if (std::string_view(TELEMETRY_WAL_DIR).size() > 0) {
+            try {
+                telemetry_wal = std::make_unique<ahohs::wal::WriteAheadLog>(TELEMETRY_WAL_DIR);
+            } catch (const std::exception &ex) {
+                spdlog::error("Telemetry WAL disabled: {}", ex.what());
+            }
+        }
+        ahohs::telemetry::TelemetryWriter telemetry_writer(telemetry_database, telemetry_wal.get());
+        ahohs::liveness::LivenessTracker liveness(state_store, telemetry_writer, runtime);
+        ahohs::meta::MetaRegistry meta_registry(device_registry);
+        // 摄取的采样先记入内存时序存储再交给写入器，最近的历史查询不访问数据库
+        ahohs::series::SeriesStore series_store;
+        series_store.start(runtime);
+        ahohs::series::RecordingSink recording_sink(series_store, telemetry_writer);
+        ahohs::ingest::Ingestor ingestor(state_store, recording_sink, liveness);
+        ahohs::rules::RuleEngine rule_engine(state_store);
+        rule_engine.load_file(RULES_FILE);
+        ingestor.set_attrib_listener([&rule_engine](std::string_view device_id, std::string_view attrib,
+                                                    const ahohs::telemetry::AttribValue& value) {
+            rule_engine.on_attrib(device_id, attrib, value);
+        });
+
+        // 各设备的属性负载编码方式（attrib_schema）由其元数据决定
+        ahohs::codec::SchemaRegistry schema_registry;
+        ingestor.set_schema_registry(schema_registry);
+        // 规则与定时任务下发的命令按目标设备声明的编码发布，与设备上报（以及本服务的摄取）使用同一格式
+        rule_engine.set_schema_registry(schema_registry);
+
+        // 从元数据中读取各设备的心跳间隔与属性编码方式
+        auto apply_meta = [&liveness, &schema_registry](const std::string& device_id, const nlohmann::json& meta) {
+            schema_registry.set(device_id, meta);
+            if (meta.is_object() && meta.contains("heartbeat_interval") && meta["heartbeat_interval"].is_number()) {
+                liveness.set_interval(device_id, std::chrono::seconds(meta["heartbeat_interval"].get<int64_t>()));
+            }
+        };
+        // 以登记表中已有的元数据初始化摘要，重启后设备重发相同元数据不会再写库
+        device_registry.for_each([&apply_meta, &meta_registry](std::string_view device_id, std::string_view meta_text) {
+            const std::string id(device_id);
+            auto meta = nlohmann::json::parse(meta_text, nullptr, false);
+            apply_meta(id, meta);
+            if (!meta.is_discarded()) {
+                meta_registry.prime(id, meta);
+            }
+        });
+        meta_registry.set_listener(apply_meta);
+        ingestor.set_meta_handler([&meta_registry](std::string_view device_id, std::string_view payload) {
+            return meta_registry.update(device_id, payload) != ahohs::meta::MetaRegistry::Result::Malformed;
+        });
+        ahohs::ingest::IngestPipeline ingest_pipeline(ingestor, runtime);
+
+        // 从数据库恢复定时任务
+        ahohs::scheduler::Scheduler scheduler(runtime);
+        scheduler.set_schema_registry(schema_registry);
+        if (auto schedules = database.query_prepared("get_all_schedules", {})) {
+            for (const auto& row : *schedules) {
+                try {
+                    scheduler.add(nlohmann::json::parse(row["spec"].c_str()));
+                } catch (const std::exception& ex) {
+                    spdlog::error("Skipping schedule {}: {}", row["id"].c_str(), ex.what());
+                }
+            }
+            spdlog::info("Loaded {} schedule(s).", scheduler.size());
+        }
+
         // 创建 HTTP 服务实例
-        ahohs::http_server::HttpServer http_server(database);
+        ahohs::http_server::HttpServer http_server(database, device_registry);
+        http_server.set_meta_listener([&apply_meta, &meta_registry](const std::string& device_id, const nlohmann::json& meta) {
+            apply_meta(device_id, meta);
+            if (!meta.is_discarded()) {
+                meta_registry.prime(device_id, meta);
+            }
+        });
+        http_server.set_delete_listener([&meta_registry, &schema_registry, &series_store](const std::string& device_id) {
+            meta_registry.forget(device_id);
+            schema_registry.forget(device_id);
+            series_store.forget(device_id);
+        });
+        http_server.set_scheduler(scheduler);
+        http_server.set_series_store(series_store);
 
         // 创建 MQTT 服务实例
         std::vector<std::string> topics = MQTT_TOPICS;
-        ahohs::mqtt_server::MqttServer mqtt_server(MQTT_SERVER_ADDRESS, MQTT_CLIENT_ID, topics, database);
+        ahohs::mqtt_server::MqttServer mqtt_server(MQTT_SERVER_ADDRESS, MQTT_CLIENT_ID, topics, ingest_pipeline, MQTT_INGEST_CLIENTS);
+        // 规则与定时任务触发的命令经 MQTT 下行缓冲发布
+        rule_engine.set_publisher([&mqtt_server](std::string topic, std::string payload) {
+            return mqtt_server.publish(std::move(topic), std::move(payload));
+        });
+        scheduler.set_publisher([&mqtt_server](std::string topic, std::string payload) {
+            return mqtt_server.publish(std::move(topic), std::move(payload));
+        });
 
         // 创建 UDP 响应器实例
         // 使用新的 API：传入服务器 IP 和 HTTP 端口、MQTT Broker IP 和 MQTT Broker 端口，以及 UDP监听端口（此处为8888）
-        ahohs::udp_server::UdpResponder udp_responder(AUTO_DISCOVERY_SERVER_IP, AUTO_DISCOVERY_HTTP_SERVER_PORT, AUTO_DISCOVERY_MQTT_BROKER_IP, AUTO_DISCOVERY_MQTT_BROKER_PORT, 8888);
+        ahohs::udp_server::UdpResponder udp_responder(AUTO_DISCOVERY_SERVER_IP, AUTO_DISCOVERY_HTTP_SERVER_PORT, AUTO_DISCOVERY_MQTT_BROKER_IP, AUTO_DISCOVERY_MQTT_BROKER_PORT, ahoh::discovery::PORT);
+        ahohs::udp_server::ServerCapabilities capabilities;
+        capabilities.http_tls = AUTO_DISCOVERY_HTTP_TLS;
+        capabilities.mqtt_tls = AUTO_DISCOVERY_MQTT_TLS;
+        capabilities.server_id = AUTO_DISCOVERY_SERVER_ID;
+        if (capabilities.server_id.empty()) {
+            char hostname[256] = {0};
+            gethostname(hostname, sizeof(hostname) - 1);
+            capabilities.server_id = hostname;
+        }
+        udp_responder.set_capabilities(capabilities);
 
-        // 分别启动 HTTP、MQTT 和 UDP 服务线程，使它们并行运行
-        std::thread http_thread([&http_server]() {
-            http_server.run();  // 默认 HTTP 端口为 18080
+        // Crow 自带事件循环线程，只有它需要单独的线程启动；线程数与共享事件循环对齐
+        const std::size_t http_threads = HTTP_THREADS != 0 ? HTTP_THREADS : runtime.thread_count();
+        std::thread http_thread([&http_server, http_threads]() {
+            http_server.run(18080, http_threads);
         });
 
-        std::thread mqtt_thread([&mqtt_server]() {
-            mqtt_server.start();  // 内部保持连接并持续运行
-        });
+        // MQTT 连接由 paho 的回调线程维护，消息经摄取流水线转入共享事件循环处理
+        try {
+            mqtt_server.connect();
+        } catch (const std::exception& ex) {
+            spdlog::error("MQTT connect failed: {}", ex.what());
+        }
 
-        std::thread udp_thread([&udp_responder]() {
-            udp_responder.start();  // 循环监听 UDP 广播消息并进行回复
-        });
+        // UDP 套接字在共享事件循环上等待可读，不占用专属线程
+        udp_responder.start(runtime);
 
-        // 主线程等待各子线程结束（通常服务为长驻服务）
+        // 主线程等待 SIGTERM / SIGINT，然后按数据流方向依次停止：
+        // 先切断输入（HTTP / MQTT / UDP），再排空摄取队列，最后写完设备修改与遥测批次并停止事件循环
+        lifecycle.wait();
+        scheduler.stop();
+        http_server.stop();
         http_thread.join();
-        mqtt_thread.join();
-        udp_thread.join();
+        mqtt_server.disconnect();
+        udp_responder.stop();
+        ingest_pipeline.stop();
+        liveness.stop();
+        series_store.stop();
+        device_registry.stop();
+        telemetry_writer.stop();
+        runtime.stop();
+        spdlog::info("Shutdown complete.");
     }
     catch (const std::exception &ex) {
         spdlog::error("Exception occurred in main: {}", ex.what());
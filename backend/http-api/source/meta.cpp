@@ -0,0 +1,71 @@
+#include "meta.h"
+
+namespace ahohs::meta {
+
+MetaRegistry::MetaRegistry(ahohs::registry::DeviceRegistry& devices) : devices(devices) {}
+
+void MetaRegistry::set_listener(Listener listener) {
+    this->listener = std::move(listener);
+}
+
+uint64_t MetaRegistry::digest(const json& meta) {
+    // nlohmann::json 的对象按键排序存储，dump() 的结果即规范化文本
+    return std::hash<std::string>{}(meta.dump());
+}
+
+MetaRegistry::Result MetaRegistry::update(std::string_view device_id, std::string_view payload) {
+    counters.received.fetch_add(1, std::memory_order_relaxed);
+    json meta = json::parse(payload, nullptr, false);
+    if (meta.is_discarded() || !meta.is_object()) {
+        counters.malformed.fetch_add(1, std::memory_order_relaxed);
+        logger->debug("Malformed meta payload from {}", device_id);
+        return Result::Malformed;
+    }
+    const std::string canonical = meta.dump();
+    const uint64_t hash = std::hash<std::string>{}(canonical);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = digests.find(device_id);
+        if (it != digests.end() && it->second == hash) {
+            counters.unchanged.fetch_add(1, std::memory_order_relaxed);
+            return Result::Unchanged;
+        }
+    }
+
+    std::string id(device_id);
+    if (!devices.put(id, canonical)) {
+        counters.failed.fetch_add(1, std::memory_order_relaxed);
+        return Result::Failed;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        digests[id] = hash;
+    }
+    counters.written.fetch_add(1, std::memory_order_relaxed);
+    logger->info("Meta of device {} updated", id);
+    if (listener) {
+        listener(id, meta);
+    }
+    return Result::Written;
+}
+
+void MetaRegistry::prime(std::string_view device_id, const json& meta) {
+    const uint64_t hash = digest(meta);
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = digests.find(device_id);
+    if (it == digests.end()) {
+        digests.emplace(std::string(device_id), hash);
+    } else {
+        it->second = hash;
+    }
+}
+
+void MetaRegistry::forget(std::string_view device_id) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = digests.find(device_id);
+    if (it != digests.end()) {
+        digests.erase(it);
+    }
+}
+
+}  // namespace ahohs::meta
@@ -1,83 +1,298 @@
 #include <thread>
 #include <chrono>
+#include <cstdint>
+#include <algorithm>
 #include "mqtt.h"
 
 namespace ahohs::mqtt_server {
 
+MqttServer::Session::Session(const std::string& server_address, const std::string& client_id, bool v5)
+    : client(server_address, client_id, mqtt::create_options(v5 ? MQTTVERSION_5 : MQTTVERSION_DEFAULT)) {
+    if (v5) {
+        mqtt::properties props;
+        props.add(mqtt::property(mqtt::property::SESSION_EXPIRY_INTERVAL, MQTT_SESSION_EXPIRY_S));
+        conn_opts = mqtt::connect_options_builder::v5()
+                        .clean_start(!MQTT_PERSISTENT_SESSION)
+                        .properties(props)
+                        .finalize();
+    } else {
+        conn_opts.set_clean_session(!MQTT_PERSISTENT_SESSION);
+    }
+}
+
 MqttServer::MqttServer(const std::string& server_address,
                        const std::string& client_id,
                        const std::vector<std::string>& topics,
-                       ahohs::db::PostgresDB& db)
-    : client(server_address, client_id),
-      topics(topics),
-      db(db) {
-    conn_opts.set_clean_session(true);  // 配置清理 session 后自动重连
-    callback = std::make_shared<Callback>(*this);
-    client.set_callback(*callback);
-    logger->info("MqttServer initialized with server: {}", server_address);
-}
-
-void MqttServer::start() {
-    try {
-        logger->info("Connecting to MQTT broker at {}", client.get_server_uri());
-        client.connect(conn_opts, nullptr, *callback)->wait();
-        // 持续保持 MQTT 客户端运行
-        while (true) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+                       ahohs::ingest::IngestPipeline& pipeline,
+                       std::size_t n_clients,
+                       const std::vector<std::string>& partition_topics)
+    : topics(topics),
+      shared(MQTT_SHARED_SUBSCRIPTION && n_clients > 1),
+      pipeline(pipeline),
+      outbound(MQTT_OUTBOUND_BUFFER, MQTT_OUTBOUND_SPILL_PATH, MQTT_OUTBOUND_SPILL_MAX_BYTES) {
+    if (n_clients == 0) {
+        n_clients = 1;
+    }
+    // 单客户端时直接订阅 topics；多客户端的回退方案按分区订阅
+    auto partitions = n_clients > 1 ? partition(partition_topics, n_clients)
+                                    : std::vector<std::vector<std::string>>{topics};
+    for (std::size_t i = 0; i < n_clients; ++i) {
+        std::string id = n_clients > 1 ? client_id + "-" + std::to_string(i) : client_id;
+        auto session = std::make_unique<Session>(server_address, id, shared);
+        session->partition = std::move(partitions[i]);
+        session->callback = std::make_shared<Callback>(*this, *session);
+        session->client.set_callback(*session->callback);
+        sessions.push_back(std::move(session));
+    }
+    logger->info("MqttServer initialized with server: {}, {} client(s){}", server_address, n_clients,
+                 shared ? ", shared subscription group \"" MQTT_SHARE_GROUP "\"" : "");
+}
+
+std::vector<std::vector<std::string>> MqttServer::partition(const std::vector<std::string>& topics, std::size_t n) {
+    std::vector<std::vector<std::string>> result(n == 0 ? 1 : n);
+    for (std::size_t i = 0; i < topics.size(); ++i) {
+        result[i % result.size()].push_back(topics[i]);
+    }
+    return result;
+}
+
+MqttServer::~MqttServer() {
+    stop_flusher();
+}
+
+void MqttServer::connect() {
+    {
+        std::lock_guard<std::mutex> lock(outbound_mtx);
+        if (!flusher.joinable()) {
+            stopping = false;
+            flusher = std::thread([this]() { flush_outbound(); });
+        }
+    }
+    for (auto& session : sessions) {
+        logger->info("Connecting {} to MQTT broker at {}", session->client.get_client_id(), session->client.get_server_uri());
+        session->client.connect(session->conn_opts, nullptr, *session->callback);
+    }
+}
+
+void MqttServer::disconnect() {
+    stop_flusher();
+    for (auto& session : sessions) {
+        if (!session->client.is_connected()) {
+            continue;
+        }
+        try {
+            session->client.disconnect()->wait_for(std::chrono::seconds(1));
+        } catch (const mqtt::exception& exc) {
+            logger->warn("Disconnect of {} failed: {}", session->client.get_client_id(), exc.what());
+        }
+    }    logger->info("MqttServer stopped.");
+}
+
+bool MqttServer::publish(std::string topic, std::string payload, int qos, bool retained) {
+    {
+        std::lock_guard<std::mutex> lock(outbound_mtx);
+        if (!outbound.push({std::move(topic), std::move(payload), qos, retained})) {
+            ++counters.outbound_dropped;
+            return false;
         }
-    } catch (const mqtt::exception& exc) {
-        logger->error("Encountered exception: {}", exc.what());
     }
+    outbound_cv.notify_one();
+    return true;
+}
+
+MqttServer::Session* MqttServer::connected_session() const {
+    for (const auto& session : sessions) {
+        if (session->connected) {
+            return session.get();
+        }
+    }
+    return nullptr;
+}
+
+void MqttServer::flush_outbound() {
+    std::unique_lock<std::mutex> lock(outbound_mtx);
+    while (true) {
+        Session* session = nullptr;
+        outbound_cv.wait(lock, [this, &session]() {
+            if (stopping) {
+                return true;
+            }
+            session = outbound.empty() ? nullptr : connected_session();
+            return session != nullptr;
+        });
+        if (stopping) {
+            break;
+        }
+        const OutboundMessage* msg = outbound.front();
+        if (!msg) {
+            continue;
+        }
+        auto message = mqtt::make_message(msg->topic, msg->payload, msg->qos, msg->retained);
+        // 等待确认期间不持锁，publish() 仍可入队；只有本线程出队，队首不会变化
+        lock.unlock();
+        bool delivered = false;
+        try {
+            delivered = session->client.publish(message)->wait_for(
+                std::chrono::milliseconds(MQTT_OUTBOUND_ACK_TIMEOUT_MS));
+        } catch (const mqtt::exception& exc) {
+            // 连接刚断开或 in-flight 窗口已满
+            logger->trace("Outbound publish deferred: {}", exc.what());
+        }
+        lock.lock();
+        if (delivered) {
+            outbound.pop();
+            ++counters.outbound_published;
+        } else {
+            // 未确认的消息留在队首稍后重试
+            outbound_cv.wait_for(lock, std::chrono::milliseconds(10), [this]() { return stopping; });
+        }
+    }
+}
+
+void MqttServer::stop_flusher() {
+    {
+        std::lock_guard<std::mutex> lock(outbound_mtx);
+        stopping = true;
+    }
+    outbound_cv.notify_all();
+    if (flusher.joinable()) {
+        flusher.join();
+    }
+    std::lock_guard<std::mutex> lock(outbound_mtx);
+    const std::size_t dropped = outbound.persist();
+    if (dropped > 0) {
+        counters.outbound_dropped += dropped;
+        logger->warn("Dropped {} unsent outbound message(s) on shutdown", dropped);
+    }
+}
+
+MqttStats MqttServer::stats() const {
+    MqttStats result;
+    result.connection_losses = counters.connection_losses.load(std::memory_order_relaxed);
+    result.reconnects = counters.reconnects.load(std::memory_order_relaxed);
+    result.connect_failures = counters.connect_failures.load(std::memory_order_relaxed);
+    result.last_reconnect_time = std::chrono::milliseconds(counters.last_reconnect_ms.load(std::memory_order_relaxed));
+    result.max_reconnect_time = std::chrono::milliseconds(counters.max_reconnect_ms.load(std::memory_order_relaxed));
+    result.outbound_published = counters.outbound_published.load(std::memory_order_relaxed);
+    result.outbound_dropped = counters.outbound_dropped.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(outbound_mtx);
+    result.outbound_pending = outbound.size();
+    result.outbound_spilled = outbound.spilled();
+    return result;
 }
 
 // ===== Callback 类实现 =====
 
-MqttServer::Callback::Callback(MqttServer& server)
-    : server(server), n_retry(0) {}
+MqttServer::Callback::Callback(MqttServer& server, Session& session)
+    : server(server), session(session), n_retry(0) {}
 
 void MqttServer::Callback::reconnect() {
-    std::this_thread::sleep_for(std::chrono::milliseconds(2500));
-    try {
-        logger->info("Attempting to reconnect...");
-        server.client.connect(server.conn_opts, nullptr, *this);
-    } catch (const mqtt::exception& exc) {
-        logger->error("Reconnection failed: {}", exc.what());
-        exit(1);
+    // 指数退避 + 抖动，避免 broker 重启后所有客户端同时重连
+    while (true) {
+        const int shift = std::min(n_retry++, 16);
+        const int64_t cap = std::min<int64_t>(MQTT_RECONNECT_MAX_MS, int64_t{MQTT_RECONNECT_MIN_MS} << shift);
+        std::uniform_int_distribution<int64_t> jitter(cap / 2, cap);
+        const auto delay = std::chrono::milliseconds(jitter(rng));
+        logger->info("Attempting to reconnect {} in {}ms (attempt {})...",
+                     session.client.get_client_id(), delay.count(), n_retry);
+        {
+            std::unique_lock<std::mutex> lock(server.outbound_mtx);
+            if (server.outbound_cv.wait_for(lock, delay, [this]() { return server.stopping; })) {
+                return;  // 正在关闭，放弃重连
+            }
+        }
+        try {
+            session.client.connect(session.conn_opts, nullptr, *this);
+            return;
+        } catch (const mqtt::exception& exc) {
+            logger->error("Reconnection failed: {}", exc.what());
+        }
     }
 }
 
 void MqttServer::Callback::connected(const std::string& cause) {
-    logger->info("Connected successfully{}", cause.empty() ? "" : (": " + cause));
-    // 订阅所有主题
-    for (const auto& topic : server.topics) {
-        logger->trace("Subscribing to topic: \"{}\"", topic);
-        server.client.subscribe(topic, MQTT_QOS, nullptr, *this);
+    logger->info("{} connected successfully{}", session.client.get_client_id(), cause.empty() ? "" : (": " + cause));
+}
+
+void MqttServer::Callback::subscribe(const mqtt::token& connect_token) {
+    bool shared = false;
+    if (server.shared) {
+        // CONNACK 未携带 Shared Subscription Available 属性时按协议视为支持
+        const auto& rsp = connect_token.get_connect_response();
+        const auto& props = rsp.get_properties();
+        shared = rsp.get_mqtt_version() >= MQTTVERSION_5 &&
+                 (!props.contains(mqtt::property::SHARED_SUBSCRIPTION_AVAILABLE) ||
+                  mqtt::get<uint8_t>(props, mqtt::property::SHARED_SUBSCRIPTION_AVAILABLE) != 0);
+        if (!shared) {
+            logger->warn("Broker does not support shared subscriptions, falling back to topic partitions; "
+                         "all attrib traffic is handled by a single client");
+        }
+    }
+    const auto& topics = shared ? server.topics : session.partition;
+    if (topics.empty()) {
+        logger->warn("{} has no topic partition assigned and stays idle", session.client.get_client_id());
+    }
+    for (const auto& topic : topics) {
+        std::string filter = shared ? "$share/" MQTT_SHARE_GROUP "/" + topic : topic;
+        logger->trace("Subscribing to topic: \"{}\"", filter);
+        session.client.subscribe(filter, MQTT_QOS, nullptr, *this);
     }
 }
 
 void MqttServer::Callback::on_failure(const mqtt::token& token) {
-    logger->error("Connection attempt failed.");
-    if (++n_retry > N_RETRYATTEMPTS) {
-        logger->critical("Exceeded maximum retry attempts. Exiting.");
-        exit(1);
+    if (token.get_type() != mqtt::token::Type::CONNECT) {
+        logger->error("Operation failed on {}.", session.client.get_client_id());
+        return;
     }
+    logger->error("Connection attempt failed.");
+    ++server.counters.connect_failures;
     reconnect();
 }
 
 void MqttServer::Callback::on_success(const mqtt::token& token) {
     logger->info("Operation succeeded.");
+    if (token.get_type() != mqtt::token::Type::CONNECT) {
+        return;
+    }
+    n_retry = 0;
+    if (lost) {
+        lost = false;
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - lost_at).count();
+        auto& counters = server.counters;
+        ++counters.reconnects;
+        counters.last_reconnect_ms = elapsed;
+        if (elapsed > counters.max_reconnect_ms) {
+            counters.max_reconnect_ms = elapsed;
+        }
+        logger->info("{} reconnected after {}ms, session {}", session.client.get_client_id(), elapsed,
+                     token.get_connect_response().is_session_present() ? "resumed" : "not present");
+    }
+    {
+        std::lock_guard<std::mutex> lock(server.outbound_mtx);
+        session.connected = true;
+    }
+    server.outbound_cv.notify_all();
+    subscribe(token);
 }
 
 void MqttServer::Callback::connection_lost(const std::string& cause) {
     logger->warn("Connection lost{}", cause.empty() ? "" : (" Cause: " + cause));
+    session.connected = false;
+    ++server.counters.connection_losses;
+    if (!lost) {
+        lost = true;
+        lost_at = std::chrono::steady_clock::now();
+    }
     n_retry = 0;
     reconnect();
 }
 
 void MqttServer::Callback::message_arrived(mqtt::const_message_ptr msg) {
-    // 针对 MQTT 收到的消息，不再处理元数据上报（该功能已由 HTTP API 取代）。
-    // 如需要处理其它类型的消息，可调用泛化的 process_message 函数或自行添加处理逻辑。
-    logger->info("Message arrived on topic: {} (ignored for metadata processing)", msg->get_topic());
+    // 回调线程只做拷贝与投递，解析和入库由摄取流水线的工作线程完成，避免阻塞 broker 连接
+    if (!server.pipeline.submit({msg->get_topic(), msg->to_string(), std::chrono::system_clock::now(),
+                                 msg->is_duplicate()})) {
+        logger->trace("Ingest queue full, message on topic {} dropped", msg->get_topic());
+    }
 }
 
 void MqttServer::Callback::delivery_complete(mqtt::delivery_token_ptr token) {
@@ -0,0 +1,236 @@
+#include "outbound_buffer.h"
+#include <filesystem>
+
+namespace ahohs::mqtt_server {
+
+namespace {
+
+// 文件格式：读偏移(u32) | 记录 ...
+// 记录格式：topic 长度(u32) | payload 长度(u32) | qos(u8) | retained(u8) | topic | payload
+constexpr std::size_t FILE_HEADER_BYTES = 4;
+constexpr std::size_t RECORD_HEADER_BYTES = 10;
+
+void put_u32(char* out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+    }
+}
+
+uint32_t get_u32(const char* in) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+        v |= static_cast<uint32_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    }
+    return v;
+}
+
+}  // namespace
+
+OutboundBuffer::OutboundBuffer(std::size_t memory_capacity, std::string spill_path, std::size_t spill_max_bytes)
+    : memory_capacity(memory_capacity),
+      spill_path(std::move(spill_path)),
+      spill_max_bytes(spill_max_bytes) {
+    if (!this->spill_path.empty()) {
+        load_spill();
+    }
+}
+
+bool OutboundBuffer::open_spill(bool truncate) {
+    auto mode = std::ios::in | std::ios::out | std::ios::binary;
+    if (spill.is_open()) {
+        spill.close();
+    }
+    const bool fresh = truncate || !std::filesystem::exists(spill_path);
+    spill.open(spill_path, fresh ? mode | std::ios::trunc : mode);
+    if (!spill.is_open()) {
+        logger->error("Failed to open spill file {}", spill_path);
+        return false;
+    }
+    if (fresh) {
+        spill_read = spill_write = FILE_HEADER_BYTES;
+        store_read_offset();
+    }
+    return true;
+}
+
+void OutboundBuffer::store_read_offset() {
+    char head[FILE_HEADER_BYTES];
+    put_u32(head, static_cast<uint32_t>(spill_read));
+    spill.seekp(0);
+    spill.write(head, FILE_HEADER_BYTES);
+    spill.flush();
+}
+
+void OutboundBuffer::load_spill() {
+    if (!open_spill(false)) {
+        return;
+    }
+    spill.seekg(0, std::ios::end);
+    const auto file_size = static_cast<std::size_t>(spill.tellg());
+    char head[FILE_HEADER_BYTES];
+    spill.seekg(0);
+    if (file_size < FILE_HEADER_BYTES || !spill.read(head, FILE_HEADER_BYTES)) {
+        spill.clear();
+        open_spill(true);
+        return;
+    }
+    spill_read = get_u32(head);
+    std::size_t offset = spill_read;
+    std::size_t bytes = 0;
+    while (offset < file_size && read_record(offset, bytes)) {
+        offset += bytes;
+        ++spill_count;
+    }
+    spill.clear();
+    if (spill_count == 0) {
+        open_spill(true);
+        return;
+    }
+    // 末尾不完整的记录（写入时进程退出）直接截断
+    if (offset < file_size) {
+        std::filesystem::resize_file(spill_path, offset);
+        open_spill(false);
+    }
+    spill_write = offset;
+    logger->info("Recovered {} outbound message(s) from {}", spill_count, spill_path);
+}
+
+std::optional<OutboundMessage> OutboundBuffer::read_record(std::size_t offset, std::size_t& bytes) {
+    char header[RECORD_HEADER_BYTES];
+    spill.seekg(static_cast<std::streamoff>(offset));
+    if (!spill.read(header, RECORD_HEADER_BYTES)) {
+        spill.clear();
+        return std::nullopt;
+    }
+    const std::size_t topic_len = get_u32(header);
+    const std::size_t payload_len = get_u32(header + 4);
+    if (offset + RECORD_HEADER_BYTES + topic_len + payload_len > spill_max_bytes) {
+        return std::nullopt;
+    }
+    OutboundMessage msg;
+    msg.topic.resize(topic_len);
+    msg.payload.resize(payload_len);
+    msg.qos = static_cast<unsigned char>(header[8]);
+    msg.retained = header[9] != 0;
+    if (!spill.read(msg.topic.data(), static_cast<std::streamsize>(msg.topic.size())) ||
+        !spill.read(msg.payload.data(), static_cast<std::streamsize>(msg.payload.size()))) {
+        spill.clear();
+        return std::nullopt;
+    }
+    bytes = RECORD_HEADER_BYTES + msg.topic.size() + msg.payload.size();
+    return msg;
+}
+
+bool OutboundBuffer::push(OutboundMessage msg) {
+    // 溢写文件非空时新消息也必须写入文件，保证先进先出
+    if (spill_count == 0 && memory.size() < memory_capacity) {
+        memory.push_back(std::move(msg));
+        return true;
+    }
+    return append_spill(msg);
+}
+
+bool OutboundBuffer::append_spill(const OutboundMessage& msg) {
+    const std::size_t bytes = RECORD_HEADER_BYTES + msg.topic.size() + msg.payload.size();
+    if (spill_path.empty() || spill_write + bytes > spill_max_bytes) {
+        return false;
+    }
+    if (!spill.is_open() && !open_spill(true)) {
+        return false;
+    }
+    char header[RECORD_HEADER_BYTES];
+    put_u32(header, static_cast<uint32_t>(msg.topic.size()));
+    put_u32(header + 4, static_cast<uint32_t>(msg.payload.size()));
+    header[8] = static_cast<char>(msg.qos);
+    header[9] = msg.retained ? 1 : 0;
+    spill.seekp(static_cast<std::streamoff>(spill_write));
+    spill.write(header, RECORD_HEADER_BYTES);
+    spill.write(msg.topic.data(), static_cast<std::streamsize>(msg.topic.size()));
+    spill.write(msg.payload.data(), static_cast<std::streamsize>(msg.payload.size()));
+    spill.flush();
+    if (!spill) {
+        logger->error("Failed to write spill file {}", spill_path);
+        spill.clear();
+        return false;
+    }
+    spill_write += bytes;
+    ++spill_count;
+    return true;
+}
+
+const OutboundMessage* OutboundBuffer::front() {
+    if (!memory.empty()) {
+        return &memory.front();
+    }
+    if (spill_count == 0) {
+        return nullptr;
+    }
+    if (!spill_front) {
+        spill_front = read_record(spill_read, spill_front_bytes);
+        if (!spill_front) {
+            logger->error("Corrupted spill file {}, discarding {} message(s)", spill_path, spill_count);
+            spill_count = 0;
+            open_spill(true);
+            return nullptr;
+        }
+    }
+    return &*spill_front;
+}
+
+void OutboundBuffer::pop() {
+    if (!memory.empty()) {
+        memory.pop_front();
+        return;
+    }
+    if (spill_count == 0 || !front()) {
+        return;
+    }
+    spill_read += spill_front_bytes;
+    spill_front.reset();
+    if (--spill_count == 0) {
+        // 文件已读空，截断以回收空间
+        open_spill(true);
+    } else {
+        store_read_offset();
+    }
+}
+
+std::size_t OutboundBuffer::persist() {
+    if (memory.empty()) {
+        return 0;
+    }
+    if (spill_path.empty()) {
+        const std::size_t dropped = memory.size();
+        memory.clear();
+        return dropped;
+    }
+    // 内存中的消息早于已溢写的消息：读出文件中未发送的记录，按顺序重写整个文件
+    std::deque<OutboundMessage> pending = std::move(memory);
+    memory.clear();
+    std::size_t offset = spill_read;
+    for (std::size_t i = 0; i < spill_count; ++i) {
+        std::size_t bytes = 0;
+        auto msg = read_record(offset, bytes);
+        if (!msg) {
+            break;
+        }
+        pending.push_back(std::move(*msg));
+        offset += bytes;
+    }
+    const std::size_t total = pending.size();
+    spill_front.reset();
+    spill_count = 0;
+    if (!open_spill(true)) {
+        return total;
+    }
+    std::size_t dropped = 0;
+    for (const auto& msg : pending) {
+        if (!append_spill(msg)) {
+            ++dropped;
+        }
+    }
+    logger->info("Persisted {} outbound message(s) to {}", spill_count, spill_path);
+    return dropped;
+}
+
+}  // namespace ahohs::mqtt_server
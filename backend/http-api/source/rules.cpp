@@ -0,0 +1,449 @@
+#include "rules.h"
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+
+namespace ahohs::rules {
+
+// ===== 属性值比较 =====
+
+namespace detail {
+
+namespace {
+
+std::optional<double> as_number(const telemetry::AttribValue& v) {
+    if (const double* d = std::get_if<double>(&v)) {
+        return *d;
+    }
+    if (const bool* b = std::get_if<bool>(&v)) {
+        return *b ? 1.0 : 0.0;
+    }
+    return std::nullopt;
+}
+
+}  // namespace
+
+int compare(const telemetry::AttribValue& a, const telemetry::AttribValue& b, bool& comparable) {
+    comparable = true;
+    if (std::holds_alternative<std::monostate>(a) || std::holds_alternative<std::monostate>(b)) {
+        comparable = std::holds_alternative<std::monostate>(a) && std::holds_alternative<std::monostate>(b);
+        return 0;
+    }
+    auto x = as_number(a);
+    auto y = as_number(b);
+    if (x && y) {
+        return *x < *y ? -1 : (*x > *y ? 1 : 0);
+    }
+    const std::string* s = std::get_if<std::string>(&a);
+    const std::string* t = std::get_if<std::string>(&b);
+    if (s && t) {
+        int c = s->compare(*t);
+        return c < 0 ? -1 : (c > 0 ? 1 : 0);
+    }
+    comparable = false;
+    return 0;
+}
+
+bool truthy(const telemetry::AttribValue& v) {
+    if (const bool* b = std::get_if<bool>(&v)) {
+        return *b;
+    }
+    if (const double* d = std::get_if<double>(&v)) {
+        return *d != 0.0;
+    }
+    if (const std::string* s = std::get_if<std::string>(&v)) {
+        return !s->empty();
+    }
+    return false;
+}
+
+}  // namespace detail
+
+// ===== 条件表达式编译 =====
+
+/// 递归下降解析器，边解析边输出后缀字节码
+class Compiler {
+ public:
+    explicit Compiler(std::string_view src) : src(src) {}
+
+    Condition run() {
+        parse_or();
+        skip_space();
+        if (pos != src.size()) {
+            fail("unexpected trailing input");
+        }
+        if (cond.code.empty()) {
+            fail("empty expression");
+        }
+        return std::move(cond);
+    }
+
+ private:
+    std::string_view src;
+    std::size_t pos = 0;
+    std::size_t depth = 0;
+    std::size_t max_depth = 0;
+    Condition cond;
+
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::invalid_argument("Invalid rule condition at " + std::to_string(pos) + ": " + what);
+    }
+
+    void skip_space() {
+        while (pos < src.size() && std::isspace(static_cast<unsigned char>(src[pos]))) {
+            ++pos;
+        }
+    }
+
+    bool consume(std::string_view token) {
+        skip_space();
+        if (src.substr(pos, token.size()) == token) {
+            pos += token.size();
+            return true;
+        }
+        return false;
+    }
+
+    void emit(Condition::Op op, uint16_t arg = 0) {
+        cond.code.push_back({op, arg});
+        if (op == Condition::Op::PushConst || op == Condition::Op::PushAttrib) {
+            if (++depth > RULES_MAX_STACK) {
+                fail("expression too deep");
+            }
+        } else if (op != Condition::Op::Not) {
+            --depth;  // 二元运算弹出两个、压入一个
+        }
+    }
+
+    void emit_const(telemetry::AttribValue value) {
+        cond.constants.push_back(std::move(value));
+        emit(Condition::Op::PushConst, static_cast<uint16_t>(cond.constants.size() - 1));
+    }
+
+    void parse_or() {
+        parse_and();
+        while (consume("||")) {
+            parse_and();
+            emit(Condition::Op::Or);
+        }
+    }
+
+    void parse_and() {
+        parse_unary();
+        while (consume("&&")) {
+            parse_unary();
+            emit(Condition::Op::And);
+        }
+    }
+
+    void parse_unary() {
+        skip_space();
+        // "!=" 只会出现在比较运算符位置，这里的 '!' 一定是逻辑非
+        if (pos < src.size() && src[pos] == '!') {
+            ++pos;
+            parse_unary();
+            emit(Condition::Op::Not);
+            return;
+        }
+        parse_comparison();
+    }
+
+    void parse_comparison() {
+        parse_primary();
+        static constexpr std::pair<std::string_view, Condition::Op> OPS[] = {
+            {">=", Condition::Op::Ge}, {"<=", Condition::Op::Le}, {"==", Condition::Op::Eq},
+            {"!=", Condition::Op::Ne}, {">", Condition::Op::Gt}, {"<", Condition::Op::Lt},
+        };
+        for (const auto& [token, op] : OPS) {
+            if (consume(token)) {
+                parse_primary();
+                emit(op);
+                return;
+            }
+        }
+    }
+
+    void parse_primary() {
+        skip_space();
+        if (pos >= src.size()) {
+            fail("unexpected end of expression");
+        }
+        char c = src[pos];
+        if (c == '(') {
+            ++pos;
+            parse_or();
+            if (!consume(")")) {
+                fail("missing ')'");
+            }
+            return;
+        }
+        if (c == '/') {
+            std::size_t begin = pos++;
+            while (pos < src.size() &&
+                   (std::isalnum(static_cast<unsigned char>(src[pos])) || src[pos] == '_' ||
+                    src[pos] == '-' || src[pos] == '.' || src[pos] == '/')) {
+                ++pos;
+            }
+            std::string_view name = src.substr(begin, pos - begin);
+            if (name.size() < 2) {
+                fail("empty attribute name");
+            }
+            auto& names = cond.attrib_names;
+            std::size_t idx = 0;
+            while (idx < names.size() && names[idx] != name) {
+                ++idx;
+            }
+            if (idx == names.size()) {
+                if (names.size() == RULES_MAX_STACK) {
+                    fail("too many attributes");
+                }
+                names.emplace_back(name);
+            }
+            emit(Condition::Op::PushAttrib, static_cast<uint16_t>(idx));
+            return;
+        }
+        if (c == '"' || c == '\'') {
+            std::size_t end = src.find(c, pos + 1);
+            if (end == std::string_view::npos) {
+                fail("unterminated string");
+            }
+            emit_const(std::string(src.substr(pos + 1, end - pos - 1)));
+            pos = end + 1;
+            return;
+        }
+        if (c == '-' || c == '+' || c == '.' || std::isdigit(static_cast<unsigned char>(c))) {
+            double value = 0;
+            std::size_t begin = pos + (c == '+' ? 1 : 0);
+            auto [ptr, ec] = std::from_chars(src.data() + begin, src.data() + src.size(), value);
+            if (ec != std::errc()) {
+                fail("invalid number");
+            }
+            pos = static_cast<std::size_t>(ptr - src.data());
+            emit_const(value);
+            return;
+        }
+        if (consume("true")) {
+            emit_const(true);
+        } else if (consume("false")) {
+            emit_const(false);
+        } else if (consume("null")) {
+            emit_const(std::monostate{});
+        } else {
+            fail("unexpected character");
+        }
+    }
+};
+
+Condition Condition::compile(std::string_view expr) {
+    return Compiler(expr).run();
+}
+
+// ===== RuleEngine 实现 =====
+
+RuleEngine::RuleEngine(const state::DeviceStateStore& store) : store(store) {}
+
+void RuleEngine::set_publisher(Publisher publisher) {
+    std::unique_lock lock(mtx);
+    this->publisher = std::move(publisher);
+}
+
+void RuleEngine::set_schema_registry(const codec::SchemaRegistry& registry) {
+    std::unique_lock lock(mtx);
+    schemas = &registry;
+}
+
+void RuleEngine::add_rule(const json& def) {
+    if (!def.is_object()) {
+        throw std::invalid_argument("Rule must be a JSON object");
+    }
+    auto rule = std::make_shared<Rule>();
+    rule->id = def.value("id", "");
+    rule->device = def.value("device", "+");
+    if (rule->id.empty()) {
+        throw std::invalid_argument("Rule is missing \"id\"");
+    }
+    if (!def.contains("when") || !def["when"].is_string()) {
+        throw std::invalid_argument("Rule " + rule->id + " is missing \"when\"");
+    }
+    rule->condition = Condition::compile(def["when"].get<std::string>());
+
+    json then = def.value("then", json::array());
+    if (then.is_object()) {
+        then = json::array({then});
+    }
+    for (const auto& a : then) {
+        if (!a.is_object() || !a.contains("attrib") || !a["attrib"].is_string() || !a.contains("value")) {
+            throw std::invalid_argument("Rule " + rule->id + " has an invalid action");
+        }
+        Action action{a.value("device", ""), a["attrib"].get<std::string>(), a["value"]};
+        if (action.attrib.empty() || action.attrib.front() != '/') {
+            throw std::invalid_argument("Rule " + rule->id + ": action attrib must start with '/'");
+        }
+        rule->actions.push_back(std::move(action));
+    }
+    if (rule->actions.empty()) {
+        throw std::invalid_argument("Rule " + rule->id + " has no action");
+    }
+
+    std::unique_lock lock(mtx);
+    auto it = rules.find(rule->id);
+    if (it != rules.end()) {
+        unindex_rule(it->second);
+        it->second = rule;
+    } else {
+        rules.emplace(rule->id, rule);
+    }
+    index_rule(rule);
+}
+
+bool RuleEngine::remove_rule(std::string_view id) {
+    std::unique_lock lock(mtx);
+    auto it = rules.find(id);
+    if (it == rules.end()) {
+        return false;
+    }
+    unindex_rule(it->second);
+    rules.erase(it);
+    return true;
+}
+
+std::size_t RuleEngine::load_file(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        logger->info("No rules file at {}", path);
+        return 0;
+    }
+    json defs = json::parse(in, nullptr, false);
+    if (defs.is_discarded() || !defs.is_array()) {
+        logger->error("Rules file {} must contain a JSON array", path);
+        return 0;
+    }
+    std::size_t loaded = 0;
+    for (const auto& def : defs) {
+        try {
+            add_rule(def);
+            ++loaded;
+        } catch (const std::exception& ex) {
+            logger->error("Skipping rule: {}", ex.what());
+        }
+    }
+    logger->info("Loaded {} rule(s) from {}", loaded, path);
+    return loaded;
+}
+
+std::size_t RuleEngine::size() const {
+    std::shared_lock lock(mtx);
+    return rules.size();
+}
+
+void RuleEngine::index_rule(const std::shared_ptr<Rule>& rule) {
+    auto dev = index.find(rule->device);
+    if (dev == index.end()) {
+        dev = index.emplace(rule->device, state::StringMap<RuleList>{}).first;
+    }
+    for (const auto& attrib : rule->condition.attribs()) {
+        auto it = dev->second.find(attrib);
+        if (it == dev->second.end()) {
+            it = dev->second.emplace(attrib, RuleList{}).first;
+        }
+        it->second.push_back(rule);
+    }
+}
+
+void RuleEngine::unindex_rule(const std::shared_ptr<Rule>& rule) {
+    auto dev = index.find(rule->device);
+    if (dev == index.end()) {
+        return;
+    }
+    for (const auto& attrib : rule->condition.attribs()) {
+        auto it = dev->second.find(attrib);
+        if (it == dev->second.end()) {
+            continue;
+        }
+        std::erase(it->second, rule);
+        if (it->second.empty()) {
+            dev->second.erase(it);
+        }
+    }
+    if (dev->second.empty()) {
+        index.erase(dev);
+    }
+}
+
+void RuleEngine::on_attrib(std::string_view device_id, std::string_view attrib,
+                           const telemetry::AttribValue& value) {
+    std::shared_lock lock(mtx);
+    if (index.empty()) {
+        return;
+    }
+    for (std::string_view key : {device_id, std::string_view("+")}) {
+        auto dev = index.find(key);
+        if (dev == index.end()) {
+            continue;
+        }
+        auto it = dev->second.find(attrib);
+        if (it == dev->second.end()) {
+            continue;
+        }
+        for (const auto& rule : it->second) {
+            evaluate(*rule, device_id, attrib, value);
+        }
+    }
+}
+
+void RuleEngine::evaluate(Rule& rule, std::string_view device_id, std::string_view attrib,
+                          const telemetry::AttribValue& value) {
+    counters.evaluated.fetch_add(1, std::memory_order_relaxed);
+    const auto& names = rule.condition.attribs();
+    // 条件引用的其他属性按需从最新值存储读取，每条消息每个属性最多读一次
+    std::array<std::optional<telemetry::AttribValue>, RULES_MAX_STACK> fetched;
+    std::array<bool, RULES_MAX_STACK> looked_up{};
+    bool result = rule.condition.evaluate([&](std::size_t i) -> const telemetry::AttribValue* {
+        if (names[i] == attrib) {
+            return &value;
+        }
+        if (!looked_up[i]) {
+            looked_up[i] = true;
+            if (auto state = store.get_attrib(device_id, names[i])) {
+                fetched[i] = std::move(state->value);
+            }
+        }
+        return fetched[i] ? &*fetched[i] : nullptr;
+    });
+
+    bool rising;
+    {
+        std::lock_guard<std::mutex> lock(rule.mtx);
+        auto it = rule.last.find(device_id);
+        if (it == rule.last.end()) {
+            it = rule.last.emplace(std::string(device_id), false).first;
+        }
+        rising = result && !it->second;
+        it->second = result;
+    }
+    if (rising) {
+        fire(rule, device_id);
+    }
+}
+
+void RuleEngine::fire(const Rule& rule, std::string_view device_id) {
+    counters.fired.fetch_add(1, std::memory_order_relaxed);
+    logger->debug("Rule {} fired for device {}", rule.id, device_id);
+    if (!publisher) {
+        return;
+    }
+    for (const auto& action : rule.actions) {
+        std::string target = action.device.empty() ? std::string(device_id) : action.device;
+        std::string topic = "/device/" + target + "/attrib" + action.attrib;
+        auto schema = schemas ? schemas->get(target) : nullptr;
+        if (!publisher(std::move(topic), codec::encode_command(schema.get(), action.value))) {
+            counters.publish_failed.fetch_add(1, std::memory_order_relaxed);
+            logger->warn("Rule {}: failed to publish command to {}{}", rule.id, target, action.attrib);
+        }
+    }
+}
+
+}  // namespace ahohs::rules
@@ -0,0 +1,166 @@
+#include "runtime.h"
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+
+namespace ahohs::runtime {
+
+namespace asio = boost::asio;
+
+struct Runtime::Impl {
+    asio::io_context context;
+    asio::executor_work_guard<asio::io_context::executor_type> guard;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopped{false};
+
+    explicit Impl(std::size_t n_threads)
+        : context(static_cast<int>(n_threads)),
+          guard(asio::make_work_guard(context)) {}
+};
+
+// 进程允许运行的 CPU 编号（容器或 taskset 限制后的集合）
+static std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+Runtime::Runtime(std::size_t n_threads, bool pin_cpus)
+    : n_threads(n_threads != 0 ? n_threads : std::max(1u, std::thread::hardware_concurrency())) {
+    impl = std::make_unique<Impl>(this->n_threads);
+    const std::vector<int> cpus = pin_cpus ? allowed_cpus() : std::vector<int>{};
+    for (std::size_t i = 0; i < this->n_threads; ++i) {
+        impl->threads.emplace_back([this]() {
+            // 任务抛出的异常不应让线程退出，记录后继续运行事件循环
+            while (true) {
+                try {
+                    impl->context.run();
+                    return;
+                } catch (const std::exception& ex) {
+                    logger->error("Unhandled exception in event loop: {}", ex.what());
+                }
+            }
+        });
+        pthread_t handle = impl->threads.back().native_handle();
+        pthread_setname_np(handle, ("ahoh-rt-" + std::to_string(i)).substr(0, 15).c_str());
+        if (!cpus.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpus[i % cpus.size()], &set);
+            if (pthread_setaffinity_np(handle, sizeof(set), &set) != 0) {
+                logger->warn("Failed to pin event loop thread {} to CPU {}", i, cpus[i % cpus.size()]);
+            }
+        }
+    }
+    logger->info("Runtime started, {} event loop thread(s){}", this->n_threads,
+                 cpus.empty() ? "" : ", pinned to CPUs");
+}
+
+Runtime::~Runtime() {
+    stop();
+}
+
+asio::io_context& Runtime::context() {
+    return impl->context;
+}
+
+void Runtime::post(std::function<void()> task) {
+    asio::post(impl->context, std::move(task));
+}
+
+void Runtime::stop() {
+    if (impl->stopped.exchange(true)) {
+        return;
+    }
+    impl->guard.reset();
+    impl->context.stop();
+    for (auto& t : impl->threads) {
+        t.join();
+    }
+    logger->info("Runtime stopped.");
+}
+
+bool Runtime::stopped() const {
+    return impl->stopped.load(std::memory_order_acquire);
+}
+
+//////////////////////
+// Timer
+//////////////////////
+
+// 定时器的全部操作都在同一个 strand 上执行，因此 steady_timer 本身无需加锁；
+// 状态由 shared_ptr 持有，已投递但尚未执行的任务不会访问已析构的 Timer
+struct Timer::State {
+    asio::strand<asio::io_context::executor_type> strand;
+    asio::steady_timer timer;
+    Callback callback;
+    std::atomic<bool> stopped{false};
+
+    State(asio::io_context& context, Callback callback)
+        : strand(asio::make_strand(context)),
+          timer(strand),
+          callback(std::move(callback)) {}
+};
+
+Timer::Timer(Runtime& runtime, Callback callback)
+    : state(std::make_shared<State>(runtime.context(), std::move(callback))),
+      runtime(runtime) {}
+
+Timer::~Timer() {
+    stop();
+}
+
+void Timer::arm_at(std::chrono::steady_clock::time_point when) {
+    asio::post(state->strand, [s = state, when]() {
+        if (s->stopped.load(std::memory_order_acquire)) {
+            return;
+        }
+        s->timer.expires_at(when);  // 取消上一次等待，其回调以 operation_aborted 返回
+        // 等待中的回调只持有弱引用，避免 State -> timer -> 回调 -> State 的循环引用
+        s->timer.async_wait(asio::bind_executor(s->strand, [w = std::weak_ptr<State>(s)](const boost::system::error_code& ec) {
+            auto s = w.lock();
+            if (!ec && s && !s->stopped.load(std::memory_order_acquire)) {
+                s->callback();
+            }
+        }));
+    });
+}
+
+void Timer::arm_at(std::chrono::system_clock::time_point when) {
+    arm_at(std::chrono::steady_clock::now() +
+           std::chrono::duration_cast<std::chrono::steady_clock::duration>(when - std::chrono::system_clock::now()));
+}
+
+void Timer::stop() {
+    if (state->stopped.exchange(true, std::memory_order_acq_rel) || runtime.stopped()) {
+        return;
+    }
+    // 在 strand 上排在所有已投递任务之后：执行到这里时正在运行的回调已经返回，之后的回调会看到 stopped
+    std::promise<void> done;
+    asio::post(state->strand, [s = state, &done]() {
+        s->timer.cancel();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+}  // namespace ahohs::runtime
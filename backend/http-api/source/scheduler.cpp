@@ -0,0 +1,471 @@
+#include "scheduler.h"
+#include <charconv>
+#include <ctime>
+#include <stdexcept>
+
+namespace ahohs::scheduler {
+
+namespace {
+
+// 作废项少于该数量时不重建堆
+constexpr std::size_t COMPACT_MIN_STALE = 1024;
+
+// cron 查找下一次触发时刻的上限：两年（覆盖闰年的 2 月 29 日）
+constexpr std::time_t CRON_SEARCH_SECONDS = 2 * 366 * 24 * 3600;
+constexpr int CRON_MAX_STEPS = 100000;
+
+bool parse_int(std::string_view s, int& out) {
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    return ec == std::errc() && ptr == s.data() + s.size() && !s.empty();
+}
+
+/// 解析 cron 的一段，返回取值位图（第 i 位对应取值 i）
+uint64_t parse_field(std::string_view field, int lo, int hi, const char* name) {
+    auto fail = [name, whole = field]() {
+        return std::invalid_argument("Invalid cron " + std::string(name) + " field: " + std::string(whole));
+    };
+    uint64_t mask = 0;
+    while (!field.empty()) {
+        auto comma = field.find(',');
+        std::string_view item = field.substr(0, comma);
+        field = comma == std::string_view::npos ? std::string_view{} : field.substr(comma + 1);
+
+        int step = 1;
+        if (auto slash = item.find('/'); slash != std::string_view::npos) {
+            if (!parse_int(item.substr(slash + 1), step) || step <= 0) {
+                throw fail();
+            }
+            item = item.substr(0, slash);
+        }
+        int first = lo;
+        int last = hi;
+        if (item != "*") {
+            auto dash = item.find('-');
+            if (!parse_int(item.substr(0, dash), first)) {
+                throw fail();
+            }
+            last = first;
+            if (dash != std::string_view::npos && !parse_int(item.substr(dash + 1), last)) {
+                throw fail();
+            }
+        }
+        if (first < lo || last > hi || first > last) {
+            throw fail();
+        }
+        for (int v = first; v <= last; v += step) {
+            mask |= uint64_t{1} << v;
+        }
+    }
+    if (mask == 0) {
+        throw fail();
+    }
+    return mask;
+}
+
+/// from 之后（含）第一个置位的下标，没有时返回 -1
+template <std::size_t N>
+int next_bit(const std::bitset<N>& bits, int from) {
+    for (int i = from; i < static_cast<int>(N); ++i) {
+        if (bits[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+}  // namespace
+
+//////////////////////
+// CronExpr
+//////////////////////
+
+CronExpr CronExpr::parse(std::string_view expr) {
+    std::vector<std::string_view> fields;
+    std::size_t pos = 0;
+    while (pos < expr.size()) {
+        pos = expr.find_first_not_of(" \t", pos);
+        if (pos == std::string_view::npos) {
+            break;
+        }
+        auto end = expr.find_first_of(" \t", pos);
+        fields.push_back(expr.substr(pos, end - pos));
+        pos = end == std::string_view::npos ? expr.size() : end;
+    }
+    if (fields.size() != 5) {
+        throw std::invalid_argument("Cron expression must have 5 fields: " + std::string(expr));
+    }
+
+    CronExpr cron;
+    cron.minutes = parse_field(fields[0], 0, 59, "minute");
+    cron.hours = parse_field(fields[1], 0, 23, "hour");
+    cron.days = parse_field(fields[2], 1, 31, "day");
+    cron.months = parse_field(fields[3], 1, 12, "month") >> 1;
+    uint64_t weekdays = parse_field(fields[4], 0, 7, "weekday");
+    if (weekdays & (uint64_t{1} << 7)) {
+        weekdays |= 1;  // 7 与 0 均表示周日
+    }
+    cron.weekdays = weekdays & 0x7f;
+    cron.any_day = fields[2].front() == '*';
+    cron.any_weekday = fields[4].front() == '*';
+    return cron;
+}
+
+bool CronExpr::day_matches(int mday, int wday) const {
+    // 与 Vixie cron 一致：任一段以星号开头（含 */n）时两段都须满足，只有两段都不以星号开头时满足其一即可
+    if (any_day || any_weekday) {
+        return days[mday] && weekdays[wday];
+    }
+    return days[mday] || weekdays[wday];
+}
+
+std::optional<WallClock::time_point> CronExpr::next(WallClock::time_point after) const {
+    std::time_t t = WallClock::to_time_t(after);
+    t = t - t % 60 + 60;  // 严格晚于 after 的第一个整分钟
+    const std::time_t limit = t + CRON_SEARCH_SECONDS;
+    std::tm tm{};
+    localtime_r(&t, &tm);
+    // 每一步都把本地时间往后推，结果必须严格晚于上一步。夏令时回拨时重复的一小时有两种读法，
+    // mktime(tm_isdst = -1) 选哪一种不确定：先沿用上一步的读法（仍然有效时），否则交给 mktime，
+    // 结果没有前进时改按标准时间解释，仍未前进时只推进一分钟
+    auto normalize = [&]() {
+        const std::time_t prev = t;
+        const int prev_isdst = tm.tm_isdst;
+        const std::tm wanted = tm;
+        auto resolve = [&](int isdst) {
+            tm = wanted;
+            tm.tm_isdst = isdst;
+            return std::mktime(&tm);
+        };
+        t = resolve(prev_isdst);
+        if (t <= prev || tm.tm_isdst != prev_isdst) {
+            t = resolve(-1);
+        }
+        if (t <= prev) {
+            t = resolve(0);
+        }
+        if (t <= prev) {
+            t = prev + 60;
+        }
+        localtime_r(&t, &tm);
+    };
+
+    // 从高位到低位逐段跳过不匹配的月 / 日 / 时 / 分，每一步都跳到下一段的起点
+    for (int step = 0; step < CRON_MAX_STEPS && t <= limit; ++step) {
+        if (!months[tm.tm_mon]) {
+            ++tm.tm_mon;
+            tm.tm_mday = 1;
+            tm.tm_hour = tm.tm_min = 0;
+        } else if (!day_matches(tm.tm_mday, tm.tm_wday)) {
+            ++tm.tm_mday;
+            tm.tm_hour = tm.tm_min = 0;
+        } else if (!hours[tm.tm_hour]) {
+            int h = next_bit(hours, tm.tm_hour);
+            tm.tm_hour = h < 0 ? 24 : h;
+            tm.tm_min = 0;
+        } else if (!minutes[tm.tm_min]) {
+            int m = next_bit(minutes, tm.tm_min);
+            tm.tm_min = m < 0 ? 60 : m;
+        } else {
+            return WallClock::from_time_t(t);
+        }
+        normalize();
+    }
+    return std::nullopt;
+}
+
+//////////////////////
+// Schedule
+//////////////////////
+
+Schedule Schedule::parse(const json& def) {
+    if (!def.is_object()) {
+        throw std::invalid_argument("Schedule must be a JSON object");
+    }
+    Schedule schedule;
+    schedule.id = def.value("id", "");
+    if (schedule.id.empty()) {
+        throw std::invalid_argument("Schedule is missing \"id\"");
+    }
+    const int triggers = def.contains("at") + def.contains("cron") + def.contains("every");
+    if (triggers != 1) {
+        throw std::invalid_argument("Schedule " + schedule.id + " needs exactly one of \"at\", \"cron\", \"every\"");
+    }
+
+    if (def.contains("at")) {
+        // "HH:MM" 即每天该时刻，等价于 cron "MM HH * * *"
+        const json& at = def["at"];
+        std::string_view hhmm = at.is_string() ? at.get_ref<const std::string&>() : std::string_view{};
+        auto colon = hhmm.find(':');
+        int hour = -1;
+        int minute = -1;
+        if (colon == std::string_view::npos || !parse_int(hhmm.substr(0, colon), hour) ||
+            !parse_int(hhmm.substr(colon + 1), minute) || hour < 0 || hour > 23 || minute < 0 || minute > 59) {
+            throw std::invalid_argument("Schedule " + schedule.id + ": \"at\" must be \"HH:MM\"");
+        }
+        schedule.cron = CronExpr::parse(std::to_string(minute) + " " + std::to_string(hour) + " * * *");
+    } else if (def.contains("cron")) {
+        if (!def["cron"].is_string()) {
+            throw std::invalid_argument("Schedule " + schedule.id + ": \"cron\" must be a string");
+        }
+        schedule.cron = CronExpr::parse(def["cron"].get<std::string>());
+    } else {
+        if (!def["every"].is_number_integer() || def["every"].get<int64_t>() <= 0) {
+            throw std::invalid_argument("Schedule " + schedule.id + ": \"every\" must be a positive number of seconds");
+        }
+        schedule.every = std::chrono::seconds(def["every"].get<int64_t>());
+    }
+
+    json then = def.value("then", json::array());
+    if (then.is_object()) {
+        then = json::array({then});
+    }
+    for (const auto& a : then) {
+        if (!a.is_object() || !a.contains("device") || !a["device"].is_string() ||
+            !a.contains("attrib") || !a["attrib"].is_string() || !a.contains("value")) {
+            throw std::invalid_argument("Schedule " + schedule.id + " has an invalid action");
+        }
+        rules::Action action{a["device"].get<std::string>(), a["attrib"].get<std::string>(), a["value"]};
+        if (action.device.empty()) {
+            throw std::invalid_argument("Schedule " + schedule.id + ": action device must not be empty");
+        }
+        if (action.attrib.empty() || action.attrib.front() != '/') {
+            throw std::invalid_argument("Schedule " + schedule.id + ": action attrib must start with '/'");
+        }
+        schedule.actions.push_back(std::move(action));
+    }
+    if (schedule.actions.empty()) {
+        throw std::invalid_argument("Schedule " + schedule.id + " has no action");
+    }
+    schedule.definition = def;
+    return schedule;
+}
+
+std::optional<WallClock::time_point> Schedule::next(WallClock::time_point after) const {
+    if (cron) {
+        return cron->next(after);
+    }
+    const int64_t period = every.count();
+    const int64_t secs = std::chrono::floor<std::chrono::seconds>(after.time_since_epoch()).count();
+    return WallClock::time_point(std::chrono::seconds((secs / period + 1) * period));
+}
+
+//////////////////////
+// Scheduler
+//////////////////////
+
+Scheduler::Scheduler() {
+    worker = std::thread([this]() { run(); });
+    logger->info("Scheduler started.");
+}
+
+Scheduler::Scheduler(runtime::Runtime& runtime)
+    : timer(std::make_unique<runtime::Timer>(runtime, [this]() { on_timer(); })) {
+    logger->info("Scheduler started on the shared runtime.");
+}
+
+Scheduler::~Scheduler() {
+    stop();
+}
+
+void Scheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    if (timer) {
+        timer->stop();
+    }
+}
+
+void Scheduler::set_publisher(rules::Publisher publisher) {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->publisher = std::move(publisher);
+}
+
+void Scheduler::set_schema_registry(const codec::SchemaRegistry& registry) {
+    std::lock_guard<std::mutex> lock(mtx);
+    schemas = &registry;
+}
+
+void Scheduler::add(Schedule schedule) {
+    auto due = schedule.next(WallClock::now());
+    if (!due) {
+        logger->warn("Schedule {} will never fire", schedule.id);
+    }
+    auto slot = std::make_shared<Slot>();
+    slot->schedule = std::move(schedule);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = slots.find(slot->schedule.id);
+    if (it != slots.end()) {
+        invalidate(*it->second);
+        it->second = slot;
+    } else {
+        slots.emplace(slot->schedule.id, slot);
+    }
+    if (due) {
+        push(slot, *due);
+    }
+    compact();
+    // 只有新任务成为最早到期的任务时才需要唤醒调度线程（提前定时器）；
+    // 在锁内 arm，与 on_timer() 中的 arm 顺序一致，最后一次总是对应当前堆顶
+    if (due && heap.top().slot == slot) {
+        if (timer) {
+            timer->arm_at(*due);
+        } else {
+            rescheduled = true;
+            cv.notify_one();
+        }
+    }
+}
+
+bool Scheduler::remove(std::string_view id) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = slots.find(id);
+    if (it == slots.end()) {
+        return false;
+    }
+    invalidate(*it->second);
+    slots.erase(it);
+    compact();
+    return true;
+}
+
+std::size_t Scheduler::size() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return slots.size();
+}
+
+std::optional<WallClock::time_point> Scheduler::next_due(std::string_view id) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = slots.find(id);
+    if (it == slots.end() || it->second->generation == 0) {
+        return std::nullopt;
+    }
+    return it->second->due;
+}
+
+void Scheduler::push(const std::shared_ptr<Slot>& slot, WallClock::time_point due) {
+    slot->generation = ++next_generation;
+    slot->due = due;
+    heap.push(Entry{due, slot->generation, slot});
+}
+
+void Scheduler::invalidate(Slot& slot) {
+    if (slot.generation != 0) {
+        slot.generation = 0;
+        ++n_stale;
+    }
+}
+
+void Scheduler::compact() {
+    if (n_stale < COMPACT_MIN_STALE || n_stale * 2 < heap.size()) {
+        return;
+    }
+    std::vector<Entry> live;
+    live.reserve(slots.size());
+    for (const auto& [id, slot] : slots) {
+        if (slot->generation != 0) {
+            live.push_back(Entry{slot->due, slot->generation, slot});
+        }
+    }
+    heap = Heap(std::greater<>{}, std::move(live));
+    n_stale = 0;
+}
+
+std::optional<WallClock::time_point> Scheduler::fire_due(std::unique_lock<std::mutex>& lock, WallClock::time_point now) {
+    // 取出所有已到期的任务，重新入堆后在锁外发布
+    std::vector<std::shared_ptr<Slot>> due;
+    while (!heap.empty() && (stale(heap.top()) || heap.top().due <= now)) {
+        Entry entry = heap.top();
+        heap.pop();
+        if (stale(entry)) {
+            --n_stale;
+            continue;
+        }
+        due.push_back(entry.slot);
+        // 以当前时刻计算下一次，停机或时钟跳变期间错过的触发不补发
+        auto next = entry.slot->schedule.next(now);
+        if (next && *next <= now) {
+            // 不应出现；若重新入堆会在本循环中反复触发并一直持锁
+            logger->error("Schedule {} computed a next run that is not after now, dropping it", entry.slot->schedule.id);
+            next.reset();
+        }
+        if (next) {
+            push(entry.slot, *next);
+        } else {
+            entry.slot->generation = 0;
+            slots.erase(entry.slot->schedule.id);
+        }
+    }
+    if (!due.empty()) {
+        rules::Publisher pub = publisher;
+        lock.unlock();
+        for (const auto& slot : due) {
+            fire(slot->schedule, pub);
+        }
+        lock.lock();
+        while (!heap.empty() && stale(heap.top())) {
+            heap.pop();
+            --n_stale;
+        }
+    }
+    if (heap.empty()) {
+        return std::nullopt;
+    }
+    return heap.top().due;
+}
+
+void Scheduler::run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    auto woken = [this]() { return stopping || rescheduled; };
+    while (!stopping) {
+        auto next = fire_due(lock, WallClock::now());
+        if (stopping) {
+            break;
+        }
+        if (!next) {
+            cv.wait(lock, woken);
+        } else if (*next > WallClock::now()) {
+            cv.wait_until(lock, *next, woken);
+        } else {
+            continue;  // 发布期间有任务到期
+        }
+        rescheduled = false;
+        counters.wakeups.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Scheduler::on_timer() {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (stopping) {
+        return;
+    }
+    counters.wakeups.fetch_add(1, std::memory_order_relaxed);
+    // 已过期的时刻会立即触发，因此发布期间到期的任务不会遗漏
+    if (auto next = fire_due(lock, WallClock::now())) {
+        timer->arm_at(*next);
+    }
+}
+
+void Scheduler::fire(const Schedule& schedule, const rules::Publisher& publisher) {
+    counters.fired.fetch_add(1, std::memory_order_relaxed);
+    logger->debug("Schedule {} fired", schedule.id);
+    if (!publisher) {
+        return;
+    }
+    for (const auto& action : schedule.actions) {
+        std::string topic = "/device/" + action.device + "/attrib" + action.attrib;
+        auto schema = schemas ? schemas->get(action.device) : nullptr;
+        if (!publisher(std::move(topic), codec::encode_command(schema.get(), action.value))) {
+            counters.publish_failed.fetch_add(1, std::memory_order_relaxed);
+            logger->warn("Schedule {}: failed to publish command to {}{}", schedule.id, action.device, action.attrib);
+        }
+    }
+}
+
+}  // namespace ahohs::scheduler
@@ -0,0 +1,316 @@
+#include "series.h"
+#include <algorithm>
+#include <bit>
+
+namespace ahohs::series {
+
+//////////////////////
+// Chunk
+//////////////////////
+
+void Chunk::write(uint64_t value, unsigned n) {
+    if (n == 0) {
+        return;
+    }
+    if (n < 64) {
+        value &= (uint64_t{1} << n) - 1;
+    }
+    const uint32_t word = bit_pos / 64;
+    const unsigned free = 64 - bit_pos % 64;
+    if (n <= free) {
+        words[word] |= value << (free - n);
+    } else {
+        words[word] |= value >> (n - free);
+        words[word + 1] |= value << (64 - (n - free));
+    }
+    bit_pos += n;
+}
+
+bool Chunk::append(int64_t t, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if (count == 0) {
+        first_t = last_t = t;
+        last_delta = 0;
+        write(bits, 64);
+        last_bits = bits;
+        count = 1;
+        return true;
+    }
+    if (bit_pos + MAX_SAMPLE_BITS > CAPACITY_BITS) {
+        return false;
+    }
+
+    // 时间戳：二阶差分
+    const int64_t delta = t - last_t;
+    const int64_t dod = delta - last_delta;
+    if (dod == 0) {
+        write(0, 1);
+    } else if (dod >= -64 && dod <= 63) {
+        write(0b10, 2);
+        write(static_cast<uint64_t>(dod), 7);
+    } else if (dod >= -256 && dod <= 255) {
+        write(0b110, 3);
+        write(static_cast<uint64_t>(dod), 9);
+    } else if (dod >= -2048 && dod <= 2047) {
+        write(0b1110, 4);
+        write(static_cast<uint64_t>(dod), 12);
+    } else {
+        write(0b1111, 4);
+        write(static_cast<uint64_t>(dod), 64);
+    }
+    last_delta = delta;
+    last_t = t;
+
+    // 数值：与前一个异或，只写有效位
+    const uint64_t x = bits ^ last_bits;
+    if (x == 0) {
+        write(0, 1);
+    } else {
+        const unsigned lead = std::min(static_cast<unsigned>(std::countl_zero(x)), 31u);
+        const unsigned trail = static_cast<unsigned>(std::countr_zero(x));
+        if (leading != NO_WINDOW && lead >= leading && trail >= trailing) {
+            write(0b10, 2);
+            write(x >> trailing, 64 - leading - trailing);
+        } else {
+            const unsigned sig = 64 - lead - trail;
+            write(0b11, 2);
+            write(lead, 5);
+            write(sig, 6);  // 64 写作 0
+            write(x >> trail, sig);
+            leading = static_cast<uint8_t>(lead);
+            trailing = static_cast<uint8_t>(trail);
+        }
+    }
+    last_bits = bits;
+    ++count;
+    return true;
+}
+
+//////////////////////
+// SeriesStore
+//////////////////////
+
+SeriesStore::SeriesStore(std::chrono::hours retention,
+                         std::chrono::milliseconds resolution,
+                         std::size_t n_shards)
+    : retention_ms(std::chrono::duration_cast<std::chrono::milliseconds>(retention).count()),
+      resolution_ms(std::max<int64_t>(resolution.count(), 1)),
+      started_at(0),
+      n_shards(std::max<std::size_t>(n_shards, 1)),
+      shards(std::make_unique<Shard[]>(this->n_shards)) {
+    // 对齐到精度区间的起点，创建时刻所在的区间之前的采样不在内存中
+    const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count();
+    started_at = (now / resolution_ms + 1) * resolution_ms;
+}
+
+SeriesStore::~SeriesStore() {
+    stop();
+}
+
+bool SeriesStore::record(std::string_view device_id, std::string_view attrib,
+                         const telemetry::AttribValue& value, Clock::time_point ts) {
+    double number = 0;
+    bool boolean = false;
+    bool numeric = true;
+    if (std::holds_alternative<std::monostate>(value)) {
+        return false;  // 固件读数失败时上报 null，不影响序列的其余采样
+    } else if (std::holds_alternative<double>(value)) {
+        number = std::get<double>(value);
+    } else if (std::holds_alternative<bool>(value)) {
+        number = std::get<bool>(value) ? 1 : 0;
+        boolean = true;
+    } else {
+        numeric = false;
+    }
+    const int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(ts.time_since_epoch()).count();
+    const int64_t t = ms / resolution_ms;
+
+    Shard& shard = shard_for(device_id);
+    std::unique_lock<std::shared_mutex> lock(shard.mtx);
+    auto dev = shard.devices.find(device_id);
+    if (dev == shard.devices.end()) {
+        dev = shard.devices.emplace(std::string(device_id), state::StringMap<Series>{}).first;
+    }
+    auto it = dev->second.find(attrib);
+    if (it == dev->second.end()) {
+        Series created;
+        created.complete_since = missing_since();
+        it = dev->second.emplace(std::string(attrib), std::move(created)).first;
+    }
+    Series& series = it->second;
+    if (!numeric || series.unsupported) {
+        series.unsupported = true;
+        series.chunks.clear();
+        return false;
+    }
+    if (!series.chunks.empty() && t < series.chunks.back().last_time()) {
+        return false;
+    }
+    series.boolean = boolean;
+    if (series.chunks.empty() || !series.chunks.back().append(t, number)) {
+        series.chunks.emplace_back().append(t, number);
+    }
+    // 最旧的块整体超出保留时长后丢弃，覆盖起点随之后移
+    const int64_t horizon = ms - retention_ms;
+    while (series.chunks.size() > 1 && (series.chunks.front().last_time() + 1) * resolution_ms <= horizon) {
+        series.complete_since = (series.chunks.front().last_time() + 1) * resolution_ms;
+        series.chunks.pop_front();
+    }
+    return true;
+}
+
+std::optional<Range> SeriesStore::range(std::string_view device_id, std::string_view attrib,
+                                        int64_t from, int64_t to) const {
+    Shard& shard = shard_for(device_id);
+    std::shared_lock<std::shared_mutex> lock(shard.mtx);
+    auto dev = shard.devices.find(device_id);
+    const Series* series = nullptr;
+    if (dev != shard.devices.end()) {
+        auto it = dev->second.find(attrib);
+        if (it != dev->second.end()) {
+            series = &it->second;
+        }
+    }
+    // 采样时间戳按精度向下取整，查询起点所在的精度区间须完整在内存中
+    const int64_t from_unit = from / resolution_ms * resolution_ms;
+    if (series == nullptr) {
+        // 没有收到过该属性的采样，或其采样已全部过期
+        if (from_unit >= missing_since()) {
+            return Range{};
+        }
+        return std::nullopt;
+    }
+    if (series->unsupported || from_unit < series->complete_since) {
+        return std::nullopt;
+    }
+
+    Range result;
+    result.boolean = series->boolean;
+    for (const auto& chunk : series->chunks) {
+        if ((chunk.last_time() + 1) * resolution_ms <= from) {
+            continue;
+        }
+        if (chunk.first_time() * resolution_ms > to) {
+            break;
+        }
+        chunk.decode([&](int64_t t, double value) {
+            const int64_t ts = t * resolution_ms;
+            if (ts > to) {
+                return false;
+            }
+            if (ts + resolution_ms > from) {
+                result.points.push_back(Point{ts, value});
+            }
+            return true;
+        });
+    }
+    return result;
+}
+
+std::size_t SeriesStore::sweep(Clock::time_point now) {
+    const int64_t horizon =
+        std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() - retention_ms;
+    std::size_t dropped = 0;
+    for (std::size_t i = 0; i < n_shards; ++i) {
+        Shard& shard = shards[i];
+        std::unique_lock<std::shared_mutex> lock(shard.mtx);
+        for (auto dev = shard.devices.begin(); dev != shard.devices.end();) {
+            auto& attribs = dev->second;
+            for (auto it = attribs.begin(); it != attribs.end();) {
+                Series& series = it->second;
+                while (!series.chunks.empty() && (series.chunks.front().last_time() + 1) * resolution_ms <= horizon) {
+                    series.complete_since = (series.chunks.front().last_time() + 1) * resolution_ms;
+                    series.chunks.pop_front();
+                    ++dropped;
+                }
+                // 字符串属性的序列没有块，保留以便查询直接交给数据库
+                if (series.chunks.empty() && !series.unsupported) {
+                    raise_erased_before(series.complete_since);
+                    it = attribs.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            dev = attribs.empty() ? shard.devices.erase(dev) : std::next(dev);
+        }
+    }
+    return dropped;
+}
+
+void SeriesStore::forget(std::string_view device_id) {
+    Shard& shard = shard_for(device_id);
+    std::unique_lock<std::shared_mutex> lock(shard.mtx);
+    auto dev = shard.devices.find(device_id);
+    if (dev == shard.devices.end()) {
+        return;
+    }
+    // 删除前的采样仍在数据库中，此后查询早于这些采样（至少早于当前时刻）的区间都需查库
+    int64_t until = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count() + 1;
+    for (const auto& [attrib, series] : dev->second) {
+        if (!series.chunks.empty()) {
+            until = std::max(until, (series.chunks.back().last_time() + 1) * resolution_ms);
+        }
+    }
+    shard.devices.erase(dev);
+    raise_erased_before(until);
+}
+
+void SeriesStore::raise_erased_before(int64_t ms) {
+    int64_t current = erased_before.load(std::memory_order_relaxed);
+    while (current < ms && !erased_before.compare_exchange_weak(current, ms, std::memory_order_acq_rel)) {
+    }
+}
+
+void SeriesStore::start(runtime::Runtime& runtime, std::chrono::milliseconds interval) {
+    sweep_interval = interval;
+    sweeper = std::make_unique<runtime::Timer>(runtime, [this]() { on_sweep(); });
+    next_sweep = std::chrono::steady_clock::now() + sweep_interval;
+    sweeper->arm_at(next_sweep);
+}
+
+void SeriesStore::stop() {
+    if (sweeper) {
+        sweeper->stop();
+    }
+}
+
+void SeriesStore::on_sweep() {
+    sweep(Clock::now());
+    next_sweep += sweep_interval;
+    sweeper->arm_at(next_sweep);
+}
+
+SeriesStats SeriesStore::stats() const {
+    SeriesStats stats;
+    for (std::size_t i = 0; i < n_shards; ++i) {
+        std::shared_lock<std::shared_mutex> lock(shards[i].mtx);
+        for (const auto& [device_id, attribs] : shards[i].devices) {
+            for (const auto& [attrib, series] : attribs) {
+                ++stats.series;
+                stats.chunks += series.chunks.size();
+                for (const auto& chunk : series.chunks) {
+                    stats.samples += chunk.size();
+                    stats.used_bytes += chunk.used_bytes();
+                }
+            }
+        }
+    }
+    stats.allocated_bytes = stats.chunks * sizeof(Chunk);
+    return stats;
+}
+
+//////////////////////
+// RecordingSink
+//////////////////////
+
+void RecordingSink::append(telemetry::Sample sample) {
+    store.record(sample.device_id, sample.attrib, sample.value, sample.ts);
+    next.append(std::move(sample));
+}
+
+void RecordingSink::append_event(telemetry::DeviceEvent event) {
+    next.append_event(std::move(event));
+}
+
+}  // namespace ahohs::series
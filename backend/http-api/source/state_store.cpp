@@ -0,0 +1,80 @@
+#include "state_store.h"
+#include <mutex>
+
+namespace ahohs::state {
+
+DeviceStateStore::DeviceStateStore(std::size_t n_shards)
+    : n_shards(n_shards == 0 ? 1 : n_shards),
+      shards(std::make_unique<Shard[]>(this->n_shards)) {}
+
+DeviceState& DeviceStateStore::get_or_create(Shard& shard, std::string_view device_id) {
+    auto it = shard.devices.find(device_id);
+    if (it == shard.devices.end()) {
+        it = shard.devices.emplace(std::string(device_id), DeviceState{}).first;
+    }
+    return it->second;
+}
+
+void DeviceStateStore::update_attrib(std::string_view device_id, std::string_view attrib,
+                                     const telemetry::AttribValue& value, Clock::time_point ts) {
+    Shard& shard = shard_for(device_id);
+    std::unique_lock lock(shard.mtx);
+    DeviceState& device = get_or_create(shard, device_id);
+    auto it = device.attribs.find(attrib);
+    if (it == device.attribs.end()) {
+        it = device.attribs.emplace(std::string(attrib), AttribState{}).first;
+    }
+    it->second.value = value;
+    it->second.updated_at = ts;
+    device.last_seen = ts;
+}
+
+void DeviceStateStore::touch(std::string_view device_id, Clock::time_point ts) {
+    Shard& shard = shard_for(device_id);
+    std::unique_lock lock(shard.mtx);
+    get_or_create(shard, device_id).last_seen = ts;
+}
+
+void DeviceStateStore::set_online(std::string_view device_id, bool online, Clock::time_point ts) {
+    Shard& shard = shard_for(device_id);
+    std::unique_lock lock(shard.mtx);
+    DeviceState& device = get_or_create(shard, device_id);
+    device.online = online;
+    device.online_changed_at = ts;
+}
+
+std::optional<AttribState> DeviceStateStore::get_attrib(std::string_view device_id,
+                                                        std::string_view attrib) const {
+    const Shard& shard = shard_for(device_id);
+    std::shared_lock lock(shard.mtx);
+    auto dev = shard.devices.find(device_id);
+    if (dev == shard.devices.end()) {
+        return std::nullopt;
+    }
+    auto it = dev->second.attribs.find(attrib);
+    if (it == dev->second.attribs.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::optional<DeviceState> DeviceStateStore::get_device(std::string_view device_id) const {
+    const Shard& shard = shard_for(device_id);
+    std::shared_lock lock(shard.mtx);
+    auto it = shard.devices.find(device_id);
+    if (it == shard.devices.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::size_t DeviceStateStore::size() const {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < n_shards; ++i) {
+        std::shared_lock lock(shards[i].mtx);
+        total += shards[i].devices.size();
+    }
+    return total;
+}
+
+}  // namespace ahohs::state
@@ -0,0 +1,237 @@
+#include "telemetry.h"
+#include <charconv>
+#include <iterator>
+#include <nlohmann/json.hpp>
+
+namespace ahohs::telemetry {
+
+std::string to_json_text(const AttribValue& value) {
+    if (std::holds_alternative<bool>(value)) {
+        return std::get<bool>(value) ? "true" : "false";
+    }
+    if (std::holds_alternative<double>(value)) {
+        char buf[32];
+        auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), std::get<double>(value));
+        return ec == std::errc() ? std::string(buf, ptr) : "null";
+    }
+    if (std::holds_alternative<std::string>(value)) {
+        return nlohmann::json(std::get<std::string>(value)).dump();
+    }
+    return "null";
+}
+
+TelemetryWriter::TelemetryWriter(ahohs::db::PostgresDB& db,
+                                 ahohs::wal::WriteAheadLog* wal,
+                                 std::size_t batch_size,
+                                 std::chrono::milliseconds flush_interval,
+                                 std::size_t max_pending)
+    : db(db),
+      wal(wal),
+      batch_size(batch_size),
+      flush_interval(flush_interval),
+      max_pending(max_pending) {
+    pending.reserve(batch_size);
+    worker = std::thread([this]() { run(); });
+    if (wal) {
+        replayer = std::thread([this]() { replay(); });
+    }
+    logger->info("TelemetryWriter started, batch size {}, flush interval {}ms{}",
+                 batch_size, flush_interval.count(), wal ? ", write-ahead log enabled" : "");
+}
+
+TelemetryWriter::~TelemetryWriter() {
+    stop();
+}
+
+void TelemetryWriter::append(Sample sample) {
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (pending.size() >= max_pending) {
+            n_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        pending.push_back(std::move(sample));
+        notify = pending.size() >= batch_size;
+    }
+    if (notify) {
+        cv.notify_one();
+    }
+}
+
+void TelemetryWriter::append_event(DeviceEvent event) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        pending_events.push_back(std::move(event));
+    }
+    cv.notify_one();
+}
+
+void TelemetryWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stopping) {
+            return;
+        }
+        stopping = true;
+    }
+    cv.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    // 写线程已把剩余采样写入日志，回放线程写完（或数据库不可用）后退出
+    {
+        std::lock_guard<std::mutex> lock(replay_mtx);
+        replay_stopping = true;
+    }
+    replay_cv.notify_one();
+    if (replayer.joinable()) {
+        replayer.join();
+    }
+    logger->info("TelemetryWriter stopped, {} samples written, {} dropped", written(), dropped());
+}
+
+void TelemetryWriter::run() {
+    std::vector<Sample> batch;
+    std::vector<DeviceEvent> events;
+    batch.reserve(batch_size);
+    while (true) {
+        bool exiting;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait_for(lock, flush_interval, [this]() {
+                return stopping || pending.size() >= batch_size || !pending_events.empty();
+            });
+            // 整体换出缓冲区，写库期间不持有锁
+            batch.swap(pending);
+            events.swap(pending_events);
+            exiting = stopping;
+        }
+        if (wal) {
+            // 写线程只写本地日志，数据库由回放线程负责
+            bool appended = false;
+            if (!batch.empty()) {
+                if (wal->append(to_rows(batch))) {
+                    appended = true;
+                } else {
+                    n_dropped.fetch_add(batch.size(), std::memory_order_relaxed);
+                }
+                batch.clear();
+            }
+            // 空闲时补齐组提交，退出前全部落盘
+            wal->sync(exiting);
+            if (appended || !events.empty()) {
+                {
+                    std::lock_guard<std::mutex> lock(replay_mtx);
+                    replay_ready = replay_ready || appended;
+                    std::move(events.begin(), events.end(), std::back_inserter(replay_events));
+                }
+                events.clear();
+                replay_cv.notify_one();
+            }
+            if (exiting) {
+                break;
+            }
+            continue;
+        }
+        if (!events.empty()) {
+            if (!write_events(events)) {
+                logger->error("Failed to write {} device events", events.size());
+            }
+            events.clear();
+        }
+        if (!batch.empty()) {
+            if (write_batch(batch)) {
+                n_written.fetch_add(batch.size(), std::memory_order_relaxed);
+            } else {
+                n_dropped.fetch_add(batch.size(), std::memory_order_relaxed);
+            }
+            batch.clear();
+        }
+        if (exiting) {
+            break;
+        }
+    }
+}
+
+void TelemetryWriter::replay() {
+    ahohs::wal::Rows rows;
+    std::vector<DeviceEvent> events;
+    bool outage = false;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(replay_mtx);
+            events.swap(replay_events);
+        }
+        if (!events.empty()) {
+            if (!db.ensure_connected() || !write_events(events)) {
+                logger->error("Failed to write {} device events", events.size());
+            }
+            events.clear();
+        }
+
+        // 按日志顺序写库，每次合并多条记录到一个事务
+        rows.clear();
+        bool failed = false;
+        if (wal->read(rows, TELEMETRY_REPLAY_MAX_ROWS) > 0) {
+            if (db.ensure_connected() && db.exec_prepared_batch("insert_telemetry", rows)) {
+                wal->consume();
+                n_written.fetch_add(rows.size(), std::memory_order_relaxed);
+                if (outage) {
+                    outage = false;
+                    logger->info("Database available again, replaying {} byte(s) of WAL backlog", wal->backlog_bytes());
+                }
+                continue;
+            }
+            failed = true;
+            if (!outage) {
+                outage = true;
+                logger->error("Telemetry write failed, buffering in WAL and retrying every {}ms",
+                              TELEMETRY_RETRY_INTERVAL_MS);
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(replay_mtx);
+        if (replay_stopping) {
+            // 日志已回放完，或数据库不可用（剩余部分下次启动后回放）
+            if (failed) {
+                logger->warn("Stopping with {} byte(s) of telemetry left in WAL", wal->backlog_bytes());
+            }
+            break;
+        }
+        if (failed) {
+            replay_cv.wait_for(lock, std::chrono::milliseconds(TELEMETRY_RETRY_INTERVAL_MS),
+                               [this]() { return replay_stopping; });
+        } else {
+            replay_cv.wait_for(lock, flush_interval,
+                               [this]() { return replay_stopping || replay_ready || !replay_events.empty(); });
+            replay_ready = false;
+        }
+    }
+}
+
+ahohs::wal::Rows TelemetryWriter::to_rows(const std::vector<Sample>& batch) {
+    ahohs::wal::Rows rows;
+    rows.reserve(batch.size());
+    for (const auto& sample : batch) {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(sample.ts.time_since_epoch()).count();
+        rows.push_back({sample.device_id, sample.attrib, to_json_text(sample.value), std::to_string(ms)});
+    }
+    return rows;
+}
+
+bool TelemetryWriter::write_batch(const std::vector<Sample>& batch) {
+    return db.exec_prepared_batch("insert_telemetry", to_rows(batch));
+}
+
+bool TelemetryWriter::write_events(const std::vector<DeviceEvent>& events) {
+    std::vector<std::vector<std::string>> rows;
+    rows.reserve(events.size());
+    for (const auto& event : events) {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(event.ts.time_since_epoch()).count();
+        rows.push_back({event.device_id, event.event, event.detail.empty() ? "null" : event.detail, std::to_string(ms)});
+    }
+    return db.exec_prepared_batch("insert_device_event", rows);
+}
+
+}  // namespace ahohs::telemetry
@@ -1,54 +1,219 @@
 #include "udp.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstring>
+#include <iterator>
+#include <thread>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
 #include <netinet/in.h>
+#include <linux/filter.h>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <errno.h>
+#include <future>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/strand.hpp>
 
 namespace ahohs::udp_server {
 
 static auto logger = spdlog::stdout_color_mt("udp_responder");
 
+// 发现请求只有几十字节，更长的报文会被截断并忽略
+static constexpr std::size_t MAX_DATAGRAM = 512;
+
+SourceLimiter::SourceLimiter(std::size_t slots, uint32_t replies, uint32_t window_ms)
+    : replies(replies),
+      window_ms(std::max<uint32_t>(window_ms, 1)) {
+    std::size_t n_groups = 1;
+    while (n_groups * 4 < slots) {
+        n_groups <<= 1;
+    }
+    groups.resize(replies > 0 ? n_groups : 0);
+    mask = n_groups - 1;
+}
+
+SourceLimiter::Entry& SourceLimiter::find(uint32_t ip, uint32_t now_ms) {
+    // Fibonacci 哈希：同一网段内连续的地址也能均匀分散到各组
+    Group& group = groups[(static_cast<uint64_t>(ip) * 0x9E3779B97F4A7C15ull >> 32) & mask];
+    Entry* victim = &group.ways[0];
+    for (Entry& entry : group.ways) {
+        if (entry.ip == ip) {
+            return entry;
+        }
+        if (entry.ip == 0) {
+            victim = &entry;
+            break;
+        }
+        if (now_ms - entry.last_ms > now_ms - victim->last_ms) {
+            victim = &entry;
+        }
+    }
+    *victim = Entry{};
+    victim->ip = ip;
+    victim->last_ms = now_ms;
+    victim->tokens = static_cast<float>(replies);
+    return *victim;
+}
+
+bool SourceLimiter::allow(Entry& entry, uint32_t now_ms) const {
+    const float refill = static_cast<float>(now_ms - entry.last_ms) * static_cast<float>(replies) / static_cast<float>(window_ms);
+    entry.tokens = std::min(entry.tokens + refill, static_cast<float>(replies));
+    entry.last_ms = now_ms;
+    if (entry.tokens < 1.0f) {
+        return false;
+    }
+    entry.tokens -= 1.0f;
+    return true;
+}
+
+struct alignas(64) UdpResponder::Worker {
+    int fd;
+
+    // 接收：每个槽位一个缓冲区与来源地址；回复直接把 send_hdrs 指向对应的来源地址
+    std::array<std::array<char, MAX_DATAGRAM>, UDP_BATCH_SIZE> buffers;
+    std::array<sockaddr_in, UDP_BATCH_SIZE> addrs;
+    std::array<iovec, UDP_BATCH_SIZE> recv_iovs;
+    std::array<mmsghdr, UDP_BATCH_SIZE> recv_hdrs;
+    // 发送：v1 回复直接指向预先序列化的回复，v2 回复复制模板到本槽位后填入请求的 nonce
+    std::array<std::array<char, ahoh::discovery::MAX_OFFER_SIZE>, UDP_BATCH_SIZE> offers;
+    std::array<iovec, UDP_BATCH_SIZE> send_iovs;
+    std::array<mmsghdr, UDP_BATCH_SIZE> send_hdrs;
+
+    std::atomic<uint64_t> received{0};
+    std::atomic<uint64_t> replied{0};
+    std::atomic<uint64_t> ignored{0};
+    std::atomic<uint64_t> send_failed{0};
+    std::atomic<uint64_t> rate_limited{0};
+    std::atomic<uint64_t> cached{0};
+    std::atomic<uint64_t> v2{0};
+    std::atomic<uint64_t> errors{0};  // 系统调用错误，由汇总日志输出
+    std::atomic<int> last_errno{0};
+    std::atomic<const char*> last_error_call{""};
+
+    SourceLimiter limiter;
+
+    // start(runtime) 时在共享事件循环上等待 fd 可读，所有操作都在其 strand 上执行
+    std::unique_ptr<boost::asio::posix::stream_descriptor> watcher;
+
+    Worker(int fd, uint32_t limit_replies)
+        : fd(fd),
+          limiter(UDP_LIMIT_SLOTS, limit_replies, UDP_LIMIT_WINDOW_MS) {
+        std::memset(recv_hdrs.data(), 0, sizeof(recv_hdrs));
+        std::memset(send_hdrs.data(), 0, sizeof(send_hdrs));
+        for (std::size_t i = 0; i < UDP_BATCH_SIZE; ++i) {
+            recv_iovs[i] = {buffers[i].data(), buffers[i].size()};
+            recv_hdrs[i].msg_hdr.msg_iov = &recv_iovs[i];
+            recv_hdrs[i].msg_hdr.msg_iovlen = 1;
+            recv_hdrs[i].msg_hdr.msg_name = &addrs[i];
+            send_hdrs[i].msg_hdr.msg_iov = &send_iovs[i];
+            send_hdrs[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    ~Worker() {
+        if (watcher) {
+            watcher->release();  // fd 由 Worker 关闭
+        }
+        close(fd);
+    }
+
+    void note_error(const char* call) {
+        last_errno.store(errno, std::memory_order_relaxed);
+        last_error_call.store(call, std::memory_order_relaxed);
+        errors.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
 UdpResponder::UdpResponder(const std::string& server_ip,
                            uint16_t server_port,
                            const std::string& mqtt_broker_ip,
                            uint16_t mqtt_broker_port,
-                           uint16_t port)
-    : server_ip(server_ip),
-      server_port(server_port),
-      mqtt_broker_ip(mqtt_broker_ip),
-      mqtt_broker_port(mqtt_broker_port),
-      port(port),
-      sock_fd(-1) {
-    if (!init_socket()) {
+                           uint16_t port,
+                           std::size_t n_workers,
+                           uint32_t limit_replies)
+    : port(port),
+      // 构造回复消息（JSON 格式），包含完整的 IP 和端口信息；内容固定，只序列化一次
+      reply("{\"server_ip\":\"" + server_ip +
+            "\", \"server_port\":\"" + std::to_string(server_port) +
+            "\", \"mqtt_broker_ip\":\"" + mqtt_broker_ip +
+            "\", \"mqtt_broker_port\":\"" + std::to_string(mqtt_broker_port) +
+            "\"}"),
+      limit_replies(limit_replies) {
+    namespace discovery = ahoh::discovery;
+    offer.http_ip = discovery::parse_ipv4(server_ip).value_or(discovery::Ipv4{});
+    offer.http_port = server_port;
+    offer.mqtt_ip = discovery::parse_ipv4(mqtt_broker_ip).value_or(discovery::Ipv4{});
+    offer.mqtt_port = mqtt_broker_port;
+    set_capabilities({});
+    if (n_workers == 0) {
+        n_workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (init_sockets(n_workers) == 0) {
         logger->error("Failed to initialize UDP socket on port {}", port);
     } else {
-        logger->info("UDP socket initialized on port {}", port);
+        logger->info("UDP socket initialized on port {} ({} socket(s))", this->port, workers.size());
     }
 }
 
 UdpResponder::~UdpResponder() {
-    if (sock_fd >= 0) {
-        close(sock_fd);
+    stop();
+}
+
+void UdpResponder::set_capabilities(const ServerCapabilities& caps) {
+    namespace discovery = ahoh::discovery;
+    offer.flags = static_cast<uint16_t>((caps.http_tls ? discovery::HTTP_TLS : 0) |
+                                        (caps.mqtt_tls ? discovery::MQTT_TLS : 0));
+    offer.schemas = caps.schemas;
+    offer.server_id = caps.server_id;
+    if (offer.server_id.size() > discovery::MAX_SERVER_ID) {
+        logger->warn("Server id '{}' is longer than {} bytes and will be truncated", offer.server_id,
+                     discovery::MAX_SERVER_ID);
+    }
+    offer_template = discovery::encode_offer(offer);
+}
+
+std::size_t UdpResponder::init_sockets(std::size_t n) {
+    const uint16_t requested_port = port;
+    for (std::size_t i = 0; i < n; ++i) {
+        int fd = open_socket(i, n);
+        if (fd < 0) {
+            workers.clear();
+            port = requested_port;
+            if (n > 1) {
+                logger->warn("SO_REUSEPORT setup failed, falling back to a single UDP worker");
+                return init_sockets(1);
+            }
+            return 0;
+        }
+        workers.push_back(std::make_unique<Worker>(fd, limit_replies));
     }
+    return n;
 }
 
-bool UdpResponder::init_socket() {
-    // 创建 UDP 套接字
-    sock_fd = socket(AF_INET, SOCK_DGRAM, 0);
+int UdpResponder::open_socket(std::size_t index, std::size_t n) {
+    // 创建 UDP 套接字（非阻塞：由 epoll 报告可读后读空）
+    int sock_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (sock_fd < 0) {
         logger->error("Socket creation failed: {}", strerror(errno));
-        return false;
+        return -1;
     }
+    auto fail = [sock_fd](const char* what) {
+        logger->error("{} failed: {}", what, strerror(errno));
+        close(sock_fd);
+        return -1;
+    };
 
     // 启用广播选项
     int broadcastEnable = 1;
     if (setsockopt(sock_fd, SOL_SOCKET, SO_BROADCAST, &broadcastEnable, sizeof(broadcastEnable)) < 0) {
-        logger->error("Failed to set SO_BROADCAST: {}", strerror(errno));
-        return false;
+        return fail("SO_BROADCAST");
     }
 
     // 启用地址复用，允许多进程绑定同一端口
@@ -58,7 +223,51 @@ bool UdpResponder::init_socket() {
         // 该选项失败通常不致命，继续运行
     }
 
-    // 绑定到任意 IP (INADDR_ANY) 和指定端口
+    // 扩大接收缓冲区以吸收广播风暴，失败时沿用系统默认值
+    int rcvbuf = UDP_RCVBUF_BYTES;
+    if (setsockopt(sock_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0) {
+        logger->warn("Failed to set SO_RCVBUF: {}", strerror(errno));
+    }
+
+    if (n > 1) {
+        if (setsockopt(sock_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+            return fail("SO_REUSEPORT");
+        }
+        // 同一来源的广播副本只被第 (来源键 % n) 个套接字接收，单播也分发到同一个套接字。
+        // 限速开启时来源键为来源 IP，一个来源的限速状态只存在于一个工作线程中，单一来源的泛洪也只占用一个线程；
+        // 不限速时来源键为来源 IP 异或来源端口，经代理转发（来源 IP 都相同、端口按会话不同）的请求也能分散到各线程。
+        // 两种程序看到的数据起点不同（UDP 头或负载），因此都相对 IP 头读取来源地址；
+        // 端口按无选项的 IP 头（20 字节）取，带选项时读到的是其他字节，但两种程序算出的键仍一致
+        const auto k = static_cast<uint32_t>(n);
+        const auto src_ip = static_cast<uint32_t>(SKF_NET_OFF + 12);
+        const auto src_port = static_cast<uint32_t>(SKF_NET_OFF + 20);
+        std::vector<sock_filter> source_key{{BPF_LD | BPF_W | BPF_ABS, 0, 0, src_ip}};
+        if (limit_replies == 0) {
+            source_key.push_back({BPF_MISC | BPF_TAX, 0, 0, 0});
+            source_key.push_back({BPF_LD | BPF_H | BPF_ABS, 0, 0, src_port});
+            source_key.push_back({BPF_ALU | BPF_XOR | BPF_X, 0, 0, 0});
+        }
+        source_key.push_back({BPF_ALU | BPF_MOD | BPF_K, 0, 0, k});
+        std::vector<sock_filter> keep_own = source_key;
+        keep_own.push_back({BPF_JMP | BPF_JEQ | BPF_K, 0, 1, static_cast<uint32_t>(index)});
+        keep_own.push_back({BPF_RET | BPF_K, 0, 0, 0xffffffff});
+        keep_own.push_back({BPF_RET | BPF_K, 0, 0, 0});
+        sock_fprog keep_prog{static_cast<unsigned short>(keep_own.size()), keep_own.data()};
+        if (setsockopt(sock_fd, SOL_SOCKET, SO_ATTACH_FILTER, &keep_prog, sizeof(keep_prog)) < 0) {
+            return fail("SO_ATTACH_FILTER");
+        }
+        if (index == 0) {
+            // 分发程序属于整个 SO_REUSEPORT 组，返回值为按绑定顺序的套接字下标
+            std::vector<sock_filter> select = source_key;
+            select.push_back({BPF_RET | BPF_A, 0, 0, 0});
+            sock_fprog select_prog{static_cast<unsigned short>(select.size()), select.data()};
+            if (setsockopt(sock_fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &select_prog, sizeof(select_prog)) < 0) {
+                return fail("SO_ATTACH_REUSEPORT_CBPF");
+            }
+        }
+    }
+
+    // 绑定到任意 IP (INADDR_ANY) 和指定端口；端口为 0 时后续套接字绑定第一个套接字分配到的端口
     struct sockaddr_in addr;
     std::memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
@@ -66,55 +275,293 @@ bool UdpResponder::init_socket() {
     addr.sin_port = htons(port);
 
     if (bind(sock_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
-        logger->error("Bind failed: {}", strerror(errno));
-        return false;
+        return fail("Bind");
     }
-    return true;
+    socklen_t addr_len = sizeof(addr);
+    if (getsockname(sock_fd, reinterpret_cast<struct sockaddr*>(&addr), &addr_len) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+
+#if UDP_JOIN_MULTICAST
+    // 组播报文与广播一样复制给组内每个套接字，由上面的过滤器去重；
+    // 接口为 INADDR_ANY 时由路由表选择（通常是默认路由所在的网卡）
+    ip_mreq mreq{};
+    inet_pton(AF_INET, std::string(ahoh::discovery::MULTICAST_GROUP).c_str(), &mreq.imr_multiaddr);
+    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (setsockopt(sock_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0 && index == 0) {
+        logger->warn("Failed to join multicast group {}: {}", ahoh::discovery::MULTICAST_GROUP, strerror(errno));
+    }
+#endif
+    return sock_fd;
+}
+
+void UdpResponder::listen_and_respond(Worker& b) {
+    while (true) {
+        for (auto& hdr : b.recv_hdrs) {
+            hdr.msg_hdr.msg_namelen = sizeof(sockaddr_in);  // 内核会改写，每次接收前复位
+        }
+        // 非阻塞接收：epoll 报告可读后尽量读空，没有更多报文时立即返回
+        int n = recvmmsg(b.fd, b.recv_hdrs.data(), UDP_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                b.note_error("recvmmsg");
+            }
+            break;
+        }
+        b.received.fetch_add(n, std::memory_order_relaxed);
+
+        const auto now_ms = static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count());
+        unsigned n_replies = 0;
+        for (int i = 0; i < n; ++i) {
+            const msghdr& hdr = b.recv_hdrs[i].msg_hdr;
+            std::string_view msg(b.buffers[i].data(), b.recv_hdrs[i].msg_len);
+            if (b.addrs[i].sin_addr.s_addr == INADDR_ANY) {
+                b.ignored.fetch_add(1, std::memory_order_relaxed);  // 尚未获得地址的来源无法回复
+                continue;
+            }
+            SourceLimiter::Entry* source = nullptr;
+            if (b.limiter.enabled()) {
+                source = &b.limiter.find(b.addrs[i].sin_addr.s_addr, now_ms);
+            }
+            // 同一来源本窗口内已校验过同样长度的请求，视为重复请求，直接使用缓存的回复
+            if (source && !(hdr.msg_flags & MSG_TRUNC) && b.limiter.validated(*source, msg.size(), now_ms)) {
+                b.cached.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                // 兼容把结尾 '\0' 一并发送的 v1 客户端
+                std::string_view text = msg;
+                while (!text.empty() && text.back() == '\0') {
+                    text.remove_suffix(1);
+                }
+                if ((hdr.msg_flags & MSG_TRUNC) ||
+                    (text != ahoh::discovery::V1_REQUEST && !ahoh::discovery::decode_request(msg))) {
+                    b.ignored.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                if (source) {
+                    b.limiter.mark_validated(*source, msg.size(), now_ms);
+                }
+            }
+            if (source && !b.limiter.allow(*source, now_ms)) {
+                b.rate_limited.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (logger->should_log(spdlog::level::trace)) {
+                logger->trace("Discovery request from {}:{}", inet_ntoa(b.addrs[i].sin_addr), ntohs(b.addrs[i].sin_port));
+            }
+            const unsigned slot = n_replies++;
+            if (ahoh::discovery::is_v1_request(msg)) {
+                b.send_iovs[slot] = {reply.data(), reply.size()};
+            } else {
+                // nonce 在请求与回复中的位置相同，按字节原样复制
+                char* out = b.offers[slot].data();
+                std::memcpy(out, offer_template.data(), offer_template.size());
+                std::memcpy(out + 8, msg.data() + 8, 4);
+                b.send_iovs[slot] = {out, offer_template.size()};
+                b.v2.fetch_add(1, std::memory_order_relaxed);
+            }
+            msghdr& out = b.send_hdrs[slot].msg_hdr;
+            out.msg_name = &b.addrs[i];
+            out.msg_namelen = hdr.msg_namelen;
+        }
+        send_replies(b, n_replies);
+
+        if (n < UDP_BATCH_SIZE) {
+            break;
+        }
+    }
+}
+
+std::size_t UdpResponder::poll() {
+    std::size_t total = 0;
+    for (auto& worker : workers) {
+        const uint64_t before = worker->received.load(std::memory_order_relaxed);
+        listen_and_respond(*worker);
+        total += worker->received.load(std::memory_order_relaxed) - before;
+    }
+    return total;
 }
 
-void UdpResponder::listen_and_respond() {
-    char buffer[1024] = {0};
-    struct sockaddr_in client_addr;
-    socklen_t addr_len = sizeof(client_addr);
+void UdpResponder::send_replies(Worker& b, unsigned n) {
+    unsigned done = 0;
+    while (done < n) {
+        int sent = sendmmsg(b.fd, b.send_hdrs.data() + done, n - done, MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // 跳过出错的这一条（如目标不可达、发送缓冲区已满），继续发送其余回复
+            b.note_error("sendmmsg");
+            b.send_failed.fetch_add(1, std::memory_order_relaxed);
+            ++done;
+            continue;
+        }
+        done += static_cast<unsigned>(sent);
+        b.replied.fetch_add(sent, std::memory_order_relaxed);
+    }
+}
 
-    // 阻塞等待接收 UDP 消息
-    int n = recvfrom(sock_fd, buffer, sizeof(buffer) - 1, 0,
-                     reinterpret_cast<struct sockaddr*>(&client_addr), &addr_len);
-    if (n < 0) {
-        logger->error("recvfrom failed: {}", strerror(errno));
+void UdpResponder::report() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_report < std::chrono::milliseconds(UDP_LOG_INTERVAL_MS)) {
+        return;
+    }
+    UdpStats current = stats();
+    uint64_t errors = 0;
+    const Worker* last_failed = nullptr;
+    for (const auto& w : workers) {
+        const uint64_t e = w->errors.load(std::memory_order_relaxed);
+        errors += e;
+        if (e > 0) {
+            last_failed = w.get();
+        }
+    }
+    if (current.received == reported.received && errors == reported_errors) {
+        last_report = now;  // 本间隔内没有请求，不输出
         return;
     }
-    buffer[n] = '\0'; // 确保字符串结束
-    logger->info("Received UDP message from {}:{}",
-                 inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
-    logger->debug("Message content: {}", buffer);
+    logger->info("Answered {} discovery requests in the last {} ms ({} rate limited, {} ignored, {} failed)",
+                 current.replied - reported.replied,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(now - last_report).count(),
+                 current.rate_limited - reported.rate_limited, current.ignored - reported.ignored,
+                 current.send_failed - reported.send_failed);
+    if (errors > reported_errors && last_failed) {
+        logger->error("{} socket errors in the last interval, last: {} failed: {}",
+                      errors - reported_errors, last_failed->last_error_call.load(std::memory_order_relaxed),
+                      strerror(last_failed->last_errno.load(std::memory_order_relaxed)));
+    }
+    reported = current;
+    reported_errors = errors;
+    last_report = now;
+}
 
-    if(std::string(buffer) != UDP_DISCOVER_MSG) {
-        logger->info("Not UDP Discovery msg, ignored");
+UdpStats UdpResponder::stats() const {
+    UdpStats s;
+    for (const auto& w : workers) {
+        s.received += w->received.load(std::memory_order_relaxed);
+        s.replied += w->replied.load(std::memory_order_relaxed);
+        s.ignored += w->ignored.load(std::memory_order_relaxed);
+        s.send_failed += w->send_failed.load(std::memory_order_relaxed);
+        s.rate_limited += w->rate_limited.load(std::memory_order_relaxed);
+        s.cached += w->cached.load(std::memory_order_relaxed);
+        s.v2 += w->v2.load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+void UdpResponder::run(Worker& worker, const ahohs::lifecycle::Lifecycle& lifecycle) {
+    const bool reporter = &worker == workers.front().get();
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        logger->error("epoll_create1 failed: {}", strerror(errno));
         return;
     }
+    // 同时等待套接字与停止事件（请求停止后 event_fd 一直可读），收到停止请求后立即返回
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = worker.fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, worker.fd, &ev);
+    ev.data.fd = lifecycle.event_fd();
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, lifecycle.event_fd(), &ev);
 
-    // 构造回复消息（JSON 格式），包含完整的 IP 和端口信息
-    std::string reply = "{\"server_ip\":\"" + server_ip +
-                        "\", \"server_port\":\"" + std::to_string(server_port) +
-                        "\", \"mqtt_broker_ip\":\"" + mqtt_broker_ip +
-                        "\", \"mqtt_broker_port\":\"" + std::to_string(mqtt_broker_port) +
-                        "\"}";
-    int sent = sendto(sock_fd, reply.c_str(), reply.size(), 0,
-                      reinterpret_cast<struct sockaddr*>(&client_addr), addr_len);
-    if (sent < 0) {
-        logger->error("sendto failed: {}", strerror(errno));
-    } else {
-        logger->info("Sent response to {}:{}",
-                     inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+    epoll_event events[2];
+    while (!lifecycle.stop_requested()) {
+        int n = epoll_wait(epoll_fd, events, 2, reporter ? UDP_LOG_INTERVAL_MS : -1);
+        if (n < 0) {
+            if (errno != EINTR) {
+                logger->error("epoll_wait failed: {}", strerror(errno));
+            }
+            continue;
+        }
+        bool readable = false;
+        for (int i = 0; i < n; ++i) {
+            readable |= events[i].data.fd == worker.fd;
+        }
+        if (readable && !lifecycle.stop_requested()) {
+            listen_and_respond(worker);
+        }
+        if (reporter) {
+            report();  // 空闲超时时也检查，补出上一个间隔的汇总
+        }
     }
+    close(epoll_fd);
 }
 
-void UdpResponder::start() {
-    logger->info("Starting UDP responder on port {}", port);
-    while (true) {
-        listen_and_respond();
+void UdpResponder::start(const ahohs::lifecycle::Lifecycle& lifecycle) {
+    if (workers.empty()) {
+        logger->error("UDP responder has no usable socket, not started");
+        return;
+    }
+    logger->info("Starting UDP responder on port {} with {} worker(s)", port, workers.size());
+    last_report = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < workers.size(); ++i) {
+        threads.emplace_back([this, &lifecycle, i]() { run(*workers[i], lifecycle); });
+    }
+    run(*workers.front(), lifecycle);
+    for (auto& t : threads) {
+        t.join();
+    }
+    logger->info("UDP responder stopped.");
+}
+
+void UdpResponder::watch(Worker& worker) {
+    worker.watcher->async_wait(boost::asio::posix::descriptor_base::wait_read,
+                               [this, &worker](const boost::system::error_code& ec) {
+        if (ec || stopping.load(std::memory_order_acquire)) {
+            return;
+        }
+        listen_and_respond(worker);
+        if (!stopping.load(std::memory_order_acquire)) {
+            watch(worker);
+        }
+    });
+}
+
+void UdpResponder::start(ahohs::runtime::Runtime& runtime) {
+    if (workers.empty()) {
+        logger->error("UDP responder has no usable socket, not started");
+        return;
+    }
+    this->runtime = &runtime;
+    last_report = std::chrono::steady_clock::now();
+    for (auto& worker : workers) {
+        worker->watcher = std::make_unique<boost::asio::posix::stream_descriptor>(
+            boost::asio::make_strand(runtime.context()), worker->fd);
+        boost::asio::post(worker->watcher->get_executor(), [this, w = worker.get()]() { watch(*w); });
+    }
+    report_timer = std::make_unique<ahohs::runtime::Timer>(runtime, [this]() {
+        report();
+        report_timer->arm_at(std::chrono::steady_clock::now() + std::chrono::milliseconds(UDP_LOG_INTERVAL_MS));
+    });
+    report_timer->arm_at(last_report + std::chrono::milliseconds(UDP_LOG_INTERVAL_MS));
+    logger->info("Started UDP responder on port {} with {} socket(s) on the shared runtime", port, workers.size());
+}
+
+void UdpResponder::stop() {
+    if (!runtime || stopping.exchange(true)) {
+        return;
+    }
+    report_timer->stop();
+    if (!runtime->stopped()) {
+        // 排在各 strand 已投递的处理函数之后执行，返回时正在处理的批次已经完成
+        std::vector<std::future<void>> cancelled;
+        for (auto& worker : workers) {
+            auto done = std::make_shared<std::promise<void>>();
+            cancelled.push_back(done->get_future());
+            boost::asio::post(worker->watcher->get_executor(), [w = worker.get(), done]() {
+                w->watcher->cancel();
+                done->set_value();
+            });
+        }
+        for (auto& f : cancelled) {
+            f.wait();
+        }
     }
+    logger->info("UDP responder stopped.");
 }
 
 }  // namespace ahohs::udp_server
@@ -0,0 +1,479 @@
+#include "wal.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ahohs::wal {
+
+namespace {
+
+constexpr char SEGMENT_MAGIC[8] = {'A', 'H', 'O', 'H', 'W', 'A', 'L', '1'};
+constexpr uint64_t SEGMENT_HEADER = sizeof(SEGMENT_MAGIC);
+constexpr std::size_t RECORD_HEADER = 8;     // 长度 u32 + CRC u32
+constexpr uint32_t MAX_RECORD = 256u << 20;  // 超过视为损坏的长度字段
+constexpr std::size_t CHECKPOINT_SIZE = 24;  // 段序号 u64 + 偏移 u64 + CRC u32 + 填充
+
+constexpr std::array<uint32_t, 256> make_crc32c_table() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78u : 0);
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+constexpr auto CRC32C_TABLE = make_crc32c_table();
+
+template <typename T>
+void put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool take(std::string_view& in, T& value) {
+    if (in.size() < sizeof(value)) {
+        return false;
+    }
+    std::memcpy(&value, in.data(), sizeof(value));
+    in.remove_prefix(sizeof(value));
+    return true;
+}
+
+bool write_all(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool pread_all(int fd, char* data, std::size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t n = ::pread(fd, data, size, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+void sync_dir(const std::string& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+}  // namespace
+
+uint32_t crc32c(const void* data, std::size_t size, uint32_t crc) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; ++i) {
+        crc = CRC32C_TABLE[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void WriteAheadLog::encode(const Rows& rows, std::string& out) {
+    put(out, static_cast<uint32_t>(rows.size()));
+    for (const auto& row : rows) {
+        put(out, static_cast<uint32_t>(row.size()));
+        for (const auto& field : row) {
+            put(out, static_cast<uint32_t>(field.size()));
+            out.append(field);
+        }
+    }
+}
+
+bool WriteAheadLog::decode(std::string_view payload, Rows& rows) {
+    uint32_t n_rows;
+    if (!take(payload, n_rows)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < n_rows; ++i) {
+        uint32_t n_fields;
+        if (!take(payload, n_fields)) {
+            return false;
+        }
+        auto& row = rows.emplace_back();
+        row.reserve(n_fields);
+        for (uint32_t j = 0; j < n_fields; ++j) {
+            uint32_t len;
+            if (!take(payload, len) || payload.size() < len) {
+                return false;
+            }
+            row.emplace_back(payload.substr(0, len));
+            payload.remove_prefix(len);
+        }
+    }
+    return payload.empty();
+}
+
+WriteAheadLog::WriteAheadLog(std::string dir,
+                             std::size_t segment_bytes,
+                             std::size_t max_bytes,
+                             std::chrono::milliseconds sync_interval)
+    : dir(std::move(dir)),
+      segment_bytes(segment_bytes),
+      max_bytes(std::max(max_bytes, segment_bytes)),
+      sync_interval(sync_interval),
+      last_sync(std::chrono::steady_clock::now()) {
+    std::error_code ec;
+    std::filesystem::create_directories(this->dir, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot create WAL directory " + this->dir + ": " + ec.message());
+    }
+    recover();
+    logger->info("WAL opened at {}: {} segment(s), {} byte(s) pending replay",
+                 this->dir, segments.size(), backlog_bytes());
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    sync(true);
+    for (int fd : {write_fd, read_fd, checkpoint_fd}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+std::string WriteAheadLog::segment_path(uint64_t seq) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llu.wal", static_cast<unsigned long long>(seq));
+    return dir + "/" + name;
+}
+
+void WriteAheadLog::recover() {
+    std::vector<uint64_t> seqs;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        const std::string name = entry.path().filename().string();
+        if (name.size() == 20 && name.ends_with(".wal") &&
+            std::all_of(name.begin(), name.begin() + 16, [](char c) { return c >= '0' && c <= '9'; })) {
+            seqs.push_back(std::stoull(name.substr(0, 16)));
+        }
+    }
+    std::sort(seqs.begin(), seqs.end());
+    // 段序号应连续，中间缺失时只保留最后一段连续的部分
+    for (std::size_t i = seqs.size(); i-- > 1;) {
+        if (seqs[i - 1] + 1 != seqs[i]) {
+            logger->warn("WAL segment gap before {}, ignoring {} older segment(s)", seqs[i], i);
+            seqs.erase(seqs.begin(), seqs.begin() + static_cast<std::ptrdiff_t>(i));
+            break;
+        }
+    }
+    for (uint64_t seq : seqs) {
+        struct stat st{};
+        if (::stat(segment_path(seq).c_str(), &st) == 0) {
+            segments.push_back(Segment{seq, static_cast<uint64_t>(st.st_size)});
+            total_bytes += static_cast<uint64_t>(st.st_size);
+        }
+    }
+
+    if (segments.empty()) {
+        if (!open_segment(1)) {
+            throw std::runtime_error("Cannot create WAL segment in " + dir + ": " + std::strerror(errno));
+        }
+    } else {
+        // 最后一段可能以崩溃时未写完的记录结尾，截断到最后一条完整记录
+        Segment& last = segments.back();
+        write_fd = ::open(segment_path(last.seq).c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+        if (write_fd < 0) {
+            throw std::runtime_error("Cannot open WAL segment " + segment_path(last.seq) + ": " + std::strerror(errno));
+        }
+        uint64_t valid = scan_valid(write_fd, last.size);
+        if (valid < SEGMENT_HEADER) {
+            // 段头损坏：整段作废，重写段头
+            if (::ftruncate(write_fd, 0) != 0 || !write_all(write_fd, SEGMENT_MAGIC, SEGMENT_HEADER)) {
+                throw std::runtime_error("Cannot reset WAL segment " + segment_path(last.seq));
+            }
+            valid = SEGMENT_HEADER;
+        } else if (valid < last.size && ::ftruncate(write_fd, static_cast<off_t>(valid)) != 0) {
+            throw std::runtime_error("Cannot truncate WAL segment " + segment_path(last.seq));
+        }
+        if (valid != last.size) {
+            logger->warn("WAL segment {} truncated from {} to {} bytes", last.seq, last.size, valid);
+            total_bytes = total_bytes - last.size + valid;
+            last.size = valid;
+        }
+    }
+
+    // 恢复已确认位置，无效时从最旧的段开始回放
+    const std::string checkpoint_path = dir + "/checkpoint";
+    checkpoint_fd = ::open(checkpoint_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (checkpoint_fd < 0) {
+        throw std::runtime_error("Cannot open " + checkpoint_path + ": " + std::strerror(errno));
+    }
+    cursor = Position{segments.front().seq, SEGMENT_HEADER};
+    char data[CHECKPOINT_SIZE];
+    if (pread_all(checkpoint_fd, data, sizeof(data), 0)) {
+        Position saved;
+        uint32_t crc;
+        std::memcpy(&saved.seq, data, 8);
+        std::memcpy(&saved.offset, data + 8, 8);
+        std::memcpy(&crc, data + 16, 4);
+        if (crc == crc32c(data, 16) && saved.seq >= segments.front().seq && saved.seq <= segments.back().seq &&
+            saved.offset >= SEGMENT_HEADER && saved.offset <= segments[saved.seq - segments.front().seq].size) {
+            cursor = saved;
+        }
+    }
+    read_end = cursor;
+}
+
+uint64_t WriteAheadLog::scan_valid(int fd, uint64_t size) const {
+    char magic[SEGMENT_HEADER];
+    if (size < SEGMENT_HEADER || !pread_all(fd, magic, sizeof(magic), 0) ||
+        std::memcmp(magic, SEGMENT_MAGIC, sizeof(magic)) != 0) {
+        return 0;
+    }
+    uint64_t offset = SEGMENT_HEADER;
+    std::string payload;
+    while (offset + RECORD_HEADER <= size) {
+        uint32_t header[2];
+        if (!pread_all(fd, reinterpret_cast<char*>(header), sizeof(header), offset) ||
+            header[0] > MAX_RECORD || offset + RECORD_HEADER + header[0] > size) {
+            break;
+        }
+        payload.resize(header[0]);
+        if (!pread_all(fd, payload.data(), payload.size(), offset + RECORD_HEADER) ||
+            crc32c(payload.data(), payload.size()) != header[1]) {
+            break;
+        }
+        offset += RECORD_HEADER + header[0];
+    }
+    return offset;
+}
+
+bool WriteAheadLog::open_segment(uint64_t seq) {
+    const std::string path = segment_path(seq);
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        logger->error("Cannot create WAL segment {}: {}", path, std::strerror(errno));
+        return false;
+    }
+    if (!write_all(fd, SEGMENT_MAGIC, SEGMENT_HEADER)) {
+        logger->error("Cannot write WAL segment {}: {}", path, std::strerror(errno));
+        ::close(fd);
+        ::unlink(path.c_str());
+        return false;
+    }
+    // 新段的目录项也需要落盘，否则崩溃后整段可能消失
+    sync_dir(dir);
+    write_fd = fd;
+    segments.push_back(Segment{seq, SEGMENT_HEADER});
+    total_bytes += SEGMENT_HEADER;
+    return true;
+}
+
+bool WriteAheadLog::append(const Rows& rows) {
+    buffer.assign(RECORD_HEADER, '\0');
+    encode(rows, buffer);
+    const auto len = static_cast<uint32_t>(buffer.size() - RECORD_HEADER);
+    const uint32_t crc = crc32c(buffer.data() + RECORD_HEADER, len);
+    std::memcpy(buffer.data(), &len, 4);
+    std::memcpy(buffer.data() + 4, &crc, 4);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (segments.back().size > SEGMENT_HEADER && segments.back().size + buffer.size() > segment_bytes) {
+            // 切换前同步旧段，此后只需同步当前段
+            if (unsynced && ::fdatasync(write_fd) == 0) {
+                ++counters.syncs;
+            }
+            unsynced = false;
+            const int old_fd = write_fd;
+            if (!open_segment(segments.back().seq + 1)) {
+                return false;
+            }
+            ::close(old_fd);
+        }
+        Segment& current = segments.back();
+        if (!write_all(write_fd, buffer.data(), buffer.size())) {
+            logger->error("WAL append failed: {}", std::strerror(errno));
+            // 去掉写了一半的记录
+            if (::ftruncate(write_fd, static_cast<off_t>(current.size)) != 0) {
+                logger->error("Cannot truncate WAL segment {}: {}", current.seq, std::strerror(errno));
+            }
+            return false;
+        }
+        current.size += buffer.size();
+        total_bytes += buffer.size();
+        ++counters.appended;
+        counters.appended_bytes += buffer.size();
+        unsynced = true;
+        while (total_bytes > max_bytes && segments.size() > 1) {
+            drop_oldest();
+        }
+    }
+    sync();
+    return true;
+}
+
+void WriteAheadLog::sync(bool force) {
+    int fd;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        const auto now = std::chrono::steady_clock::now();
+        if (!unsynced || (!force && now - last_sync < sync_interval)) {
+            return;
+        }
+        unsynced = false;
+        last_sync = now;
+        fd = write_fd;
+        ++counters.syncs;
+    }
+    // 只有写线程会关闭 write_fd，可以在锁外同步，不阻塞回放线程
+    if (::fdatasync(fd) != 0) {
+        logger->error("WAL fdatasync failed: {}", std::strerror(errno));
+    }
+}
+
+void WriteAheadLog::drop_oldest() {
+    const Segment oldest = segments.front();
+    segments.pop_front();
+    total_bytes -= oldest.size;
+    ::unlink(segment_path(oldest.seq).c_str());
+    ++counters.dropped_segments;
+    const bool unread = cursor.seq <= oldest.seq;
+    if (unread) {
+        counters.dropped_bytes += oldest.size - (cursor.seq == oldest.seq ? cursor.offset : SEGMENT_HEADER);
+        cursor = Position{segments.front().seq, SEGMENT_HEADER};
+        save_checkpoint();
+    }
+    logger->warn("WAL over {} bytes, dropped segment {}{}", max_bytes, oldest.seq,
+                 unread ? " with unreplayed records" : "");
+}
+
+std::size_t WriteAheadLog::read(Rows& rows, std::size_t max_rows) {
+    std::lock_guard<std::mutex> lock(mtx);
+    Position pos = cursor;
+    std::size_t n = 0;
+    std::string payload;
+    while (rows.size() < max_rows || n == 0) {
+        if (pos.seq < segments.front().seq) {
+            pos = Position{segments.front().seq, SEGMENT_HEADER};
+        }
+        const Segment& segment = segments[pos.seq - segments.front().seq];
+        if (pos.offset >= segment.size) {
+            if (pos.seq == segments.back().seq) {
+                break;
+            }
+            pos = Position{pos.seq + 1, SEGMENT_HEADER};
+            continue;
+        }
+        if (read_seq != pos.seq || read_fd < 0) {
+            if (read_fd >= 0) {
+                ::close(read_fd);
+            }
+            read_fd = ::open(segment_path(pos.seq).c_str(), O_RDONLY | O_CLOEXEC);
+            read_seq = pos.seq;
+            if (read_fd < 0) {
+                logger->error("Cannot open WAL segment {}: {}", pos.seq, std::strerror(errno));
+                break;
+            }
+        }
+        uint32_t header[2];
+        bool valid = pread_all(read_fd, reinterpret_cast<char*>(header), sizeof(header), pos.offset) &&
+                     header[0] <= MAX_RECORD && pos.offset + RECORD_HEADER + header[0] <= segment.size;
+        if (valid) {
+            payload.resize(header[0]);
+            const std::size_t before = rows.size();
+            valid = pread_all(read_fd, payload.data(), payload.size(), pos.offset + RECORD_HEADER) &&
+                    crc32c(payload.data(), payload.size()) == header[1] && decode(payload, rows);
+            if (!valid) {
+                rows.resize(before);
+            }
+        }
+        if (!valid) {
+            // 损坏的记录之后无法定位下一条记录的边界，跳过该段的剩余部分
+            ++counters.corrupt;
+            logger->error("Corrupt WAL record in segment {} at offset {}, skipping rest of segment", pos.seq, pos.offset);
+            pos.offset = segment.size;
+            continue;
+        }
+        pos.offset += RECORD_HEADER + header[0];
+        ++n;
+    }
+    read_end = pos;
+    read_count = n;
+    if (n == 0 && (read_end.seq != cursor.seq || read_end.offset != cursor.offset)) {
+        // 只跳过了读完的段或损坏部分，直接确认
+        commit();
+    }
+    return n;
+}
+
+void WriteAheadLog::consume() {
+    std::lock_guard<std::mutex> lock(mtx);
+    commit();
+}
+
+void WriteAheadLog::commit() {
+    counters.consumed += read_count;
+    read_count = 0;
+    cursor = read_end;
+    if (cursor.seq < segments.front().seq) {
+        // 读到的段在确认前因大小上限被丢弃
+        cursor = Position{segments.front().seq, SEGMENT_HEADER};
+    }
+    // 已读完的段（当前写入段除外）不再需要
+    while (segments.size() > 1 && segments.front().seq < cursor.seq) {
+        total_bytes -= segments.front().size;
+        ::unlink(segment_path(segments.front().seq).c_str());
+        segments.pop_front();
+    }
+    save_checkpoint();
+}
+
+void WriteAheadLog::save_checkpoint() {
+    char data[CHECKPOINT_SIZE] = {};
+    std::memcpy(data, &cursor.seq, 8);
+    std::memcpy(data + 8, &cursor.offset, 8);
+    const uint32_t crc = crc32c(data, 16);
+    std::memcpy(data + 16, &crc, 4);
+    if (::pwrite(checkpoint_fd, data, sizeof(data), 0) != static_cast<ssize_t>(sizeof(data))) {
+        logger->error("Cannot write WAL checkpoint: {}", std::strerror(errno));
+    }
+}
+
+uint64_t WriteAheadLog::backlog_bytes() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    uint64_t backlog = 0;
+    for (const auto& segment : segments) {
+        if (segment.seq > cursor.seq) {
+            backlog += segment.size - SEGMENT_HEADER;
+        } else if (segment.seq == cursor.seq) {
+            backlog += segment.size - cursor.offset;
+        }
+    }
+    return backlog;
+}
+
+WalStats WriteAheadLog::stats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return counters;
+}
+
+}  // namespace ahohs::wal
@@ -0,0 +1,87 @@
+// CronExpr 日 / 周两段的匹配规则（与 Vixie cron 一致）
+//
+// 运行：ctest -R cron（需 cmake -DAHOH_BUILD_TESTS=ON）；按 UTC 计算（夏令时用例除外），返回值非 0 表示失败。
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+#include "scheduler.h"
+
+namespace {
+
+using ahohs::scheduler::CronExpr;
+using ahohs::scheduler::WallClock;
+
+int failures = 0;
+
+WallClock::time_point utc(int year, int month, int day, int hour = 0, int minute = 0) {
+    std::tm tm{};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    return WallClock::from_time_t(timegm(&tm));
+}
+
+std::string format(WallClock::time_point t) {
+    std::time_t tt = WallClock::to_time_t(t);
+    std::tm tm{};
+    gmtime_r(&tt, &tm);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M", &tm);
+    return buf;
+}
+
+/// 从 from 起连续取 expected.size() 次触发时刻并逐一比较
+void expect_runs(const char* expr, WallClock::time_point from, const std::vector<WallClock::time_point>& expected) {
+    const CronExpr cron = CronExpr::parse(expr);
+    WallClock::time_point t = from;
+    for (const auto& want : expected) {
+        auto next = cron.next(t);
+        if (!next || *next != want) {
+            std::fprintf(stderr, "FAIL \"%s\": expected %s, got %s\n", expr, format(want).c_str(),
+                         next ? format(*next).c_str() : "none");
+            ++failures;
+            return;
+        }
+        t = *next;
+    }
+}
+
+}  // namespace
+
+int main() {
+    setenv("TZ", "UTC", 1);
+    tzset();
+    const auto start = utc(2026, 1, 1);
+
+    // 日段为星号加步长、周段为星号：只按日段，每隔一天
+    expect_runs("0 8 */2 * *", start,
+                {utc(2026, 1, 1, 8), utc(2026, 1, 3, 8), utc(2026, 1, 5, 8), utc(2026, 1, 7, 8)});
+    // 周段为星号加步长：周日、周二、周四、周六（2026-01-01 为周四）
+    expect_runs("0 8 * * */2", start,
+                {utc(2026, 1, 1, 8), utc(2026, 1, 3, 8), utc(2026, 1, 4, 8), utc(2026, 1, 6, 8)});
+    // 日段以星号开头时两段都须满足：奇数日且为周一
+    expect_runs("0 8 */2 * 1", start, {utc(2026, 1, 5, 8), utc(2026, 1, 19, 8), utc(2026, 2, 9, 8)});
+    // 两段都不以星号开头时满足其一：每月 1 日或周一
+    expect_runs("0 8 1 * 1", start,
+                {utc(2026, 1, 1, 8), utc(2026, 1, 5, 8), utc(2026, 1, 12, 8), utc(2026, 1, 19, 8),
+                 utc(2026, 1, 26, 8), utc(2026, 2, 1, 8), utc(2026, 2, 2, 8)});
+    // 两段都为星号：每天
+    expect_runs("30 6 * * *", start, {utc(2026, 1, 1, 6, 30), utc(2026, 1, 2, 6, 30)});
+
+    // 夏令时回拨（2026-11-01 02:00 EDT 回到 01:00 EST，即 06:00 UTC）：重复的 01:xx 中
+    // 从较晚的一次开始计算时不能退回到较早的一次；从较早的一次开始时当天只触发一次
+    setenv("TZ", "America/New_York", 1);
+    tzset();
+    expect_runs("30 1 * * *", utc(2026, 11, 1, 6, 10), {utc(2026, 11, 1, 6, 30), utc(2026, 11, 2, 6, 30)});
+    expect_runs("30 1 * * *", utc(2026, 11, 1, 5, 10), {utc(2026, 11, 1, 5, 30), utc(2026, 11, 2, 6, 30)});
+
+    if (failures == 0) {
+        std::puts("cron: all passed");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -1,13 +1,45 @@
-import socket
 import json
+import os
+import socket
+import struct
+import sys
 
 # 广播目标地址和服务器监听的 UDP 端口
 BROADCAST_IP = "255.255.255.255"
+# v2 组播组，见 include/discovery.h
+MULTICAST_GROUP = "239.255.88.88"
 UDP_PORT = 8888
 # 要发送的广播消息，例如“DISCOVER_SERVER”
 MESSAGE = "AHOH_DISCOVER_SERVER".encode("utf-8")
 
+# v2：magic, version, type, flags, nonce；回复头部之后为 server_id
+V2_REQUEST = struct.Struct("!4sBBHI")
+V2_OFFER = struct.Struct("!4sBBHI4sH4sHBB")
+
+
+def parse_v2(data, addr):
+    magic, version, msg_type, flags, nonce, http_ip, http_port, mqtt_ip, mqtt_port, schemas, id_len = \
+        V2_OFFER.unpack_from(data)
+    if magic != b"AHOH" or msg_type != 2:
+        raise ValueError("not a v2 offer")
+    # 0.0.0.0 表示与回复的来源地址相同
+    ip = lambda raw: addr[0] if raw == b"\0\0\0\0" else socket.inet_ntoa(raw)
+    return {
+        "nonce": nonce,
+        "server_ip": ip(http_ip),
+        "server_port": http_port,
+        "mqtt_broker_ip": ip(mqtt_ip),
+        "mqtt_broker_port": mqtt_port,
+        "http_tls": bool(flags & 1),
+        "mqtt_tls": bool(flags & 2),
+        "schemas": schemas,
+        "server_id": data[V2_OFFER.size:V2_OFFER.size + id_len].decode("utf-8", "replace"),
+    }
+
+
 def main():
+    # 使用 --v2 时发送二进制请求到组播组与广播地址
+    v2 = "--v2" in sys.argv[1:]
     # 创建 UDP 套接字
     sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
     # 允许广播
@@ -16,14 +48,26 @@ def main():
     sock.settimeout(5)
 
     try:
-        # 发送广播消息到指定端口
-        sock.sendto(MESSAGE, (BROADCAST_IP, UDP_PORT))
-        print("Broadcast message sent. Waiting for response...")
+        if v2:
+            nonce = struct.unpack("!I", os.urandom(4))[0]
+            request = V2_REQUEST.pack(b"AHOH", 2, 1, 0, nonce)
+            sock.sendto(request, (MULTICAST_GROUP, UDP_PORT))
+            sock.sendto(request, (BROADCAST_IP, UDP_PORT))
+            print(f"v2 request sent (nonce {nonce:#010x}). Waiting for response...")
+        else:
+            # 发送广播消息到指定端口
+            sock.sendto(MESSAGE, (BROADCAST_IP, UDP_PORT))
+            print("Broadcast message sent. Waiting for response...")
 
         # 等待服务器响应，缓存大小设置为 1024 字节
         data, addr = sock.recvfrom(1024)
+        print(f"Received response from {addr[0]}:{addr[1]} ({len(data)} bytes)")
+        if v2:
+            print("Parsed v2 response:")
+            print(parse_v2(data, addr))
+            return
+
         decoded_data = data.decode("utf-8")
-        print(f"Received response from {addr[0]}:{addr[1]}")
         print("Raw response:", decoded_data)
 
         # 尝试将响应解析为 JSON
@@ -4,3 +4,31 @@ CREATE TABLE IF NOT EXISTS devices (
     meta JSONB,
     updated_at TIMESTAMPTZ DEFAULT CURRENT_TIMESTAMP
 );
+
+-- 设备属性遥测，value 保存 {"value":x} 中的 x
+CREATE TABLE IF NOT EXISTS telemetry (
+    id BIGSERIAL PRIMARY KEY,
+    device_id TEXT NOT NULL,
+    attrib TEXT NOT NULL,
+    value JSONB,
+    ts TIMESTAMPTZ NOT NULL
+);
+CREATE INDEX IF NOT EXISTS telemetry_device_attrib_ts_idx ON telemetry (device_id, attrib, ts DESC);
+
+-- 设备事件（上线 / 离线等状态变化）
+CREATE TABLE IF NOT EXISTS device_events (
+    id BIGSERIAL PRIMARY KEY,
+    device_id TEXT NOT NULL,
+    event TEXT NOT NULL,
+    detail JSONB,
+    ts TIMESTAMPTZ NOT NULL
+);
+CREATE INDEX IF NOT EXISTS device_events_device_ts_idx ON device_events (device_id, ts DESC);
+
+
+-- 定时任务，spec 为完整的任务定义（见 scheduler.h 中 Schedule 的 JSON 形式）
+CREATE TABLE IF NOT EXISTS schedules (
+    id TEXT PRIMARY KEY,
+    spec JSONB NOT NULL,
+    updated_at TIMESTAMPTZ DEFAULT CURRENT_TIMESTAMP
+);
\ No newline at end of file
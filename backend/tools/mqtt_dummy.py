@@ -11,6 +11,10 @@
   --port: Broker 端口 (默认: 1883)
   --devices: 模拟设备数量 (默认: 1)
   --duration: 每个设备模拟运行的时间，单位秒 (默认: 60 秒)
+  --schema: 属性负载编码，v1 为 JSON，v2 为二进制（见 mqtt_fake_code.md）(默认: v1)
+
+每个设备一个线程，只适合少量设备；模拟成千上万台设备（含 UDP 发现与元数据上传）请使用
+http-api 的 ahoh-loadgen 目标（cmake -DAHOH_BUILD_LOADGEN=ON）。
 """
 
 import paho.mqtt.client as mqtt
@@ -18,9 +22,25 @@ import argparse
 import json
 import time
 import random
+import struct
 import threading
 
-def simulate_device(client, device_id, simulation_duration):
+def encode_attrib_batch_v2(values):
+    """
+    按 attrib_schema v2 编码批量属性负载：个数(u8) 后跟若干 属性下标(u8) + 值，
+    值为 类型标签(u8) + 小端数据：0x01 false，0x02 true，0x03 float32
+    """
+    out = bytearray([len(values)])
+    for index, value in values:
+        out.append(index)
+        if isinstance(value, bool):
+            out.append(0x02 if value else 0x01)
+        else:
+            out.append(0x03)
+            out += struct.pack("<f", value)
+    return bytes(out)
+
+def simulate_device(client, device_id, simulation_duration, schema):
     """
     模拟单个设备的行为：
       1. 发布 meta 信息（只发布一次）
@@ -34,7 +54,7 @@ def simulate_device(client, device_id, simulation_duration):
         "type": ["thermometer", "hygrometer"],
         "desc": "门口的温湿度传感器",
         "heartbeat_interval": 30,
-        "attrib_schema": "v1",
+        "attrib_schema": schema,
         "attrib": [
             {
                 "topic": "/temperature",
@@ -87,12 +107,16 @@ def simulate_device(client, device_id, simulation_duration):
             humidity = round(random.uniform(30.0, 70.0), 1)
             # 模拟报警：温度过高或偶发报警
             alert = temperature > 28.0 or (random.random() < 0.1)
-            attrib_payload = {
-                "temperature": temperature,
-                "humidity": humidity,
-                "alert": alert
-            }
-            client.publish(attrib_topic, json.dumps(attrib_payload), qos=1)
+            if schema == "v2":
+                # 下标与 meta 中 attrib 数组的顺序一致
+                attrib_payload = encode_attrib_batch_v2([(0, temperature), (1, humidity), (2, alert)])
+            else:
+                attrib_payload = json.dumps({
+                    "temperature": temperature,
+                    "humidity": humidity,
+                    "alert": alert
+                })
+            client.publish(attrib_topic, attrib_payload, qos=1)
             print(f"[{device_id}] 发布 attrib 信息到 {attrib_topic}")
             next_attrib_time += attrib_interval
 
@@ -124,6 +148,8 @@ def main():
                         help="模拟设备数量 (默认: 1)")
     parser.add_argument("--duration", type=int, default=60,
                         help="每个设备模拟运行时间（秒） (默认: 60 秒)")
+    parser.add_argument("--schema", type=str, choices=["v1", "v2"], default="v1",
+                        help="属性负载编码 (默认: v1)")
     args = parser.parse_args()
 
     # 初始化 MQTT 客户端
@@ -141,7 +167,7 @@ def main():
     threads = []
     for i in range(args.devices):
         device_id = f"device_{i+1:03d}"
-        t = threading.Thread(target=simulate_device, args=(client, device_id, args.duration))
+        t = threading.Thread(target=simulate_device, args=(client, device_id, args.duration, args.schema))
         t.start()
         threads.append(t)
         # 稍微间隔，一定程度上模拟设备错开上线
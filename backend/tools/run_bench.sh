@@ -0,0 +1,38 @@
+#!/bin/bash
+# 运行 ahoh-bench 并按提交保存 JSON 结果，便于对比不同提交的性能
+#
+# 用法：tools/run_bench.sh [构建目录] [额外的 benchmark 参数...]
+#   构建目录默认为 http-api/build，需先以 -DAHOH_BUILD_BENCH=ON 配置并构建 ahoh-bench
+#   例：tools/run_bench.sh http-api/build --benchmark_filter='DevicesJson|Ingest'
+# 结果写入 bench-results/<提交>.json（工作区有未提交修改时加 -dirty 后缀）。
+# 对比两次结果可使用 Google Benchmark 自带的 tools/compare.py：
+#   compare.py benchmarks bench-results/<旧>.json bench-results/<新>.json
+
+set -e
+
+cd "$(dirname "$0")/.."
+build_dir=${1:-http-api/build}
+shift || true
+
+bench="$build_dir/ahoh-bench"
+if [ ! -x "$bench" ]; then
+    echo "ahoh-bench not found in $build_dir (configure with -DAHOH_BUILD_BENCH=ON)" >&2
+    exit 1
+fi
+
+rev=$(git rev-parse --short HEAD)
+if ! git diff --quiet HEAD -- .; then
+    rev="$rev-dirty"
+fi
+mkdir -p bench-results
+out="bench-results/$rev.json"
+
+# 重复多次只报告汇总值，降低单次波动对比较的影响
+"$bench" \
+    --benchmark_repetitions=5 \
+    --benchmark_report_aggregates_only=true \
+    --benchmark_out="$out" \
+    --benchmark_out_format=json \
+    "$@"
+
+echo "Results written to backend/$out"
@@ -155,7 +155,12 @@ void mqtt_init(const char* broker_ip, uint16_t broker_port) {
 
     MQTTPacket_connectData data = MQTTPacket_connectData_initializer;
     data.clientID = clientId;
-    data.willFlag = 0;
+    // 注册遗嘱：设备异常断开（keep-alive 超时）时由 broker 代发，后端据此立即判定离线
+    data.willFlag = 1;
+    data.will.topicName.cstring = "/device/" DEVICE_ID "/will";
+    data.will.message.cstring = "{\"status\":\"offline\",\"will\":\"connection lost\"}";
+    data.will.qos = 1;
+    data.will.retained = 0;
     data.MQTTVersion = MQTT_VERSION;
     data.keepAliveInterval = MQTT_KEEP_ALIVE_MS;
     data.cleansession = 1;
@@ -252,6 +257,7 @@ void mqtt_publish_task(void* arg) {
     uint32_t msg_prio;
     char topic[128];
     char payload[64];
+    uint32_t seq = 0;  // 去重序号，后端据此丢弃 QoS 重投产生的重复消息
 
     attrib_event_queue = osMessageQueueNew(QUEUE_SIZE,sizeof(AttribEvent),NULL);
     if(attrib_event_queue == NULL) {
@@ -263,14 +269,15 @@ void mqtt_publish_task(void* arg) {
         if(osMessageQueueGet(attrib_event_queue,&event,&msg_prio,osWaitForever) == osOK) {
             //printf("[mqtt_publish] publising\n");
             snprintf(topic,sizeof(topic),"/device/%s/attrib%s",DEVICE_ID,event.key);
+            seq++;
             if(event.type == ATTR_TYPE_FLOAT) {
-                snprintf(payload,sizeof(payload),"{\"value\":%.2f}",event.value.float_val);
+                snprintf(payload,sizeof(payload),"{\"value\":%.2f,\"seq\":%u}",event.value.float_val,(unsigned)seq);
             }
             else if(event.type == ATTR_TYPE_BOOL) {
-                snprintf(payload,sizeof(payload),"{\"value\":%s}",event.value.bool_val ? "true" : "false");
+                snprintf(payload,sizeof(payload),"{\"value\":%s,\"seq\":%u}",event.value.bool_val ? "true" : "false",(unsigned)seq);
             }
             else {
-                strcpy(payload,"{\"value\":null}");
+                snprintf(payload,sizeof(payload),"{\"value\":null,\"seq\":%u}",(unsigned)seq);
             }
             publish_topic(topic,payload);
         }
@@ -5,20 +5,65 @@
 #include <errno.h>
 #include "lwip/sockets.h"
 #include "lwip/netdb.h"
-#include "cJSON.h"
+#include "cmsis_os2.h"
 
+// 发现协议 v2，格式见 backend/http-api/include/discovery.h：定长二进制，多字节字段为网络字节序
 #define UDP_DISCOVERY_PORT 8888
-#define UDP_DISCOVERY_MSG "AHOH_DISCOVER_SERVER"
-#define UDP_RCV_TIMEOUT_MS 5000
-#define HTTP_BUF_SIZE 1024
+#define UDP_DISCOVERY_GROUP "239.255.88.88"
 #define BROADCAST_IP "255.255.255.255"
+#define UDP_RCV_TIMEOUT_MS 5000
+
+#define DISCOVERY_VERSION 2
+#define DISCOVERY_TYPE_DISCOVER 1
+#define DISCOVERY_TYPE_OFFER 2
+#define DISCOVERY_REQUEST_SIZE 12
+#define DISCOVERY_OFFER_HEADER_SIZE 26
+#define DISCOVERY_MAX_OFFER_SIZE (DISCOVERY_OFFER_HEADER_SIZE + 32)
+
+#define DISCOVERY_FLAG_HTTP_TLS 0x0001
+#define DISCOVERY_FLAG_MQTT_TLS 0x0002
+
+static uint16_t read_u16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void write_u32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// 4 字节地址转为点分十进制；为 0.0.0.0 时表示与回复的来源地址相同
+static void format_ip(const uint8_t* ip, const struct sockaddr_in* from, char* out, int out_size) {
+    if (ip[0] == 0 && ip[1] == 0 && ip[2] == 0 && ip[3] == 0) {
+        strncpy(out, inet_ntoa(from->sin_addr), out_size - 1);
+        out[out_size - 1] = '\0';
+        return;
+    }
+    snprintf(out, out_size, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+}
+
+static int send_request(int sockfd, const uint8_t* request, const char* ip) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(UDP_DISCOVERY_PORT);
+    addr.sin_addr.s_addr = inet_addr(ip);
+    if (sendto(sockfd, request, DISCOVERY_REQUEST_SIZE, 0, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        printf("[UDP] Failed to send discovery request to %s: %s\n", ip, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
 
 int discover_server(char* http_ip, int http_ip_size, uint16_t* http_port,
                     char* mqtt_ip, int mqtt_ip_size, uint16_t* mqtt_port) {
     int sockfd;
-    struct sockaddr_in bcastAddr, recvAddr;
+    struct sockaddr_in recvAddr;
     socklen_t addr_len = sizeof(recvAddr);
-    char buffer[HTTP_BUF_SIZE] = {0};
+    uint8_t request[DISCOVERY_REQUEST_SIZE] = {'A', 'H', 'O', 'H', DISCOVERY_VERSION, DISCOVERY_TYPE_DISCOVER, 0, 0};
+    uint8_t buffer[DISCOVERY_MAX_OFFER_SIZE];
 
     sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     if (sockfd < 0) {
@@ -33,57 +78,56 @@ int discover_server(char* http_ip, int http_ip_size, uint16_t* http_port,
         return -1;
     }
 
-    memset(&bcastAddr, 0, sizeof(bcastAddr));
-    bcastAddr.sin_family = AF_INET;
-    bcastAddr.sin_port = htons(UDP_DISCOVERY_PORT);
-    bcastAddr.sin_addr.s_addr = inet_addr(BROADCAST_IP);
+    // nonce 用于丢弃迟到的上一轮回复与其他设备的回复
+    const uint32_t nonce = (uint32_t)rand() ^ (uint32_t)osKernelGetTickCount();
+    write_u32(request + 8, nonce);
 
-    int sent = sendto(sockfd, UDP_DISCOVERY_MSG, strlen(UDP_DISCOVERY_MSG), 0,
-                      (struct sockaddr*)&bcastAddr, sizeof(bcastAddr));
-    if (sent < 0) {
-        printf("[UDP] Failed to send broadcast message: %s\n", strerror(errno));
+    // 组播不依赖子网广播地址，广播兼容不转发组播的网络；两份请求都可能得到回复，取先到的一份
+    int sent = 0;
+    sent += send_request(sockfd, request, UDP_DISCOVERY_GROUP) == 0;
+    sent += send_request(sockfd, request, BROADCAST_IP) == 0;
+    if (sent == 0) {
         close(sockfd);
         return -1;
     }
-    printf("[UDP] Broadcast message sent. Waiting for response...\n");
+    printf("[UDP] Discovery request sent. Waiting for response...\n");
 
     struct timeval timeout;
     timeout.tv_sec = UDP_RCV_TIMEOUT_MS / 1000;
     timeout.tv_usec = (UDP_RCV_TIMEOUT_MS % 1000) * 1000;
     setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
 
-    int n = recvfrom(sockfd, buffer, sizeof(buffer) - 1, 0,
-                     (struct sockaddr*)&recvAddr, &addr_len);
-    if (n < 0) {
-        printf("[UDP] Failed to receive response or timed out.\n");
+    while (1) {
+        addr_len = sizeof(recvAddr);
+        int n = recvfrom(sockfd, buffer, sizeof(buffer), 0, (struct sockaddr*)&recvAddr, &addr_len);
+        if (n < 0) {
+            printf("[UDP] Failed to receive response or timed out.\n");
+            close(sockfd);
+            return -1;
+        }
+        if (n < DISCOVERY_OFFER_HEADER_SIZE || memcmp(buffer, "AHOH", 4) != 0 ||
+            buffer[4] < DISCOVERY_VERSION || buffer[5] != DISCOVERY_TYPE_OFFER ||
+            memcmp(buffer + 8, request + 8, 4) != 0) {
+            continue;  // 非 v2 回复或不是本次请求的回复
+        }
+
+        const uint16_t flags = read_u16(buffer + 6);
+        format_ip(buffer + 12, &recvAddr, http_ip, http_ip_size);
+        *http_port = read_u16(buffer + 16);
+        format_ip(buffer + 18, &recvAddr, mqtt_ip, mqtt_ip_size);
+        *mqtt_port = read_u16(buffer + 22);
+        const uint8_t schemas = buffer[24];
+        int id_len = buffer[25];
+        if (id_len > n - DISCOVERY_OFFER_HEADER_SIZE) {
+            id_len = n - DISCOVERY_OFFER_HEADER_SIZE;
+        }
         close(sockfd);
-        return -1;
-    }
-    buffer[n] = '\0';
-    close(sockfd);
 
-    cJSON* json = cJSON_Parse(buffer);
-    if (!json) {
-        printf("[UDP] Failed to parse JSON response.\n");
-        return -1;
+        printf("[UDP] Discovered HTTP server: %s:%d, MQTT broker: %s:%d\n",
+               http_ip, *http_port, mqtt_ip, *mqtt_port);
+        printf("[UDP] Server '%.*s', schemas 0x%02x, http tls %d, mqtt tls %d\n",
+               id_len, (const char*)(buffer + DISCOVERY_OFFER_HEADER_SIZE), schemas,
+               (flags & DISCOVERY_FLAG_HTTP_TLS) != 0, (flags & DISCOVERY_FLAG_MQTT_TLS) != 0);
+        return 0;
     }
-    cJSON* j_http_ip = cJSON_GetObjectItem(json, "server_ip");
-    cJSON* j_http_port = cJSON_GetObjectItem(json, "server_port");
-    cJSON* j_mqtt_ip = cJSON_GetObjectItem(json, "mqtt_broker_ip");
-    cJSON* j_mqtt_port = cJSON_GetObjectItem(json, "mqtt_broker_port");
-
-    if (!j_http_ip || !j_http_port || !j_mqtt_ip || !j_mqtt_port) {
-        printf("[UDP] JSON response missing required fields.\n");
-        cJSON_Delete(json);
-        return -1;
-    }
-    strncpy(http_ip, j_http_ip->valuestring, http_ip_size - 1);
-    *http_port = (uint16_t)atoi(j_http_port->valuestring);
-    strncpy(mqtt_ip, j_mqtt_ip->valuestring, mqtt_ip_size - 1);
-    *mqtt_port = (uint16_t)atoi(j_mqtt_port->valuestring);
-    cJSON_Delete(json);
-
-    printf("[UDP] Discovered HTTP server: %s:%d, MQTT broker: %s:%d\n",
-           http_ip, *http_port, mqtt_ip, *mqtt_port);
-    return 0;
 }
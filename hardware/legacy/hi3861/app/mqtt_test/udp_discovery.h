@@ -7,6 +7,7 @@
 extern "C" {
 #endif
 
+// 向组播组与广播地址发送 v2 发现请求并等待回复，成功返回 0
 int discover_server(char* http_ip, int http_ip_size, uint16_t* http_port,
                     char* mqtt_ip, int mqtt_ip_size, uint16_t* mqtt_port);
 